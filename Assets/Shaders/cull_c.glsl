@@ -0,0 +1,186 @@
+#version 430
+
+// GPU culling for IndirectRenderer
+// One thread per command (a whole mesh or one meshlet of it). Each command's bounding sphere
+// is tested against the camera frustum, and optionally against the depth pyramid of the last
+// frame. The commands that survive are appended to the output buffer, and the number appended
+// is left in the count buffer for glMultiDrawElementsIndirectCount, so the CPU never has to
+// read it back.
+// Meshlets whose normal cone faces away from the camera go in the second half of the output
+// (from u_backFacingOffset) with their own count, only passes that draw back faces use them.
+//
+// Features:
+// USE_COUNT_BUFFER	- compact the visible commands and count them (needs GL_ARB_indirect_parameters)
+//					  Without it every command is copied to both halves and the ones that don't
+//					  belong in a half get an instanceCount of 0
+
+layout(local_size_x = 64) in;
+
+// Same layout as DrawElementsIndirectCommand in IndirectRenderer.h
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// World space bounding spheres, xyz is the centre and w the radius
+layout(std430, binding = 1) readonly buffer BoundsBuffer
+{
+	vec4 bounds[];
+};
+
+layout(std430, binding = 2) readonly buffer InputCommandBuffer
+{
+	DrawCommand inputCommands[];
+};
+
+layout(std430, binding = 3) writeonly buffer OutputCommandBuffer
+{
+	DrawCommand outputCommands[];
+};
+
+layout(std430, binding = 4) buffer DrawCountBuffer
+{
+	uint drawCount;
+	uint backFacingCount;
+};
+
+// World space normal cones, xyz is the axis and w the cutoff (see Meshlet.h)
+layout(std430, binding = 5) readonly buffer ConeBuffer
+{
+	vec4 cones[];
+};
+
+uniform int u_numDraws;
+uniform int u_backFacingOffset;
+uniform vec4 u_cameraPosition;
+
+// From Frustum, normals point in
+uniform vec4 u_frustumPlanes[6];
+
+// Occlusion against the last frame's depth
+uniform int u_occlusion;
+uniform sampler2D u_depthPyramid;
+uniform mat4 u_pyramidView;
+uniform mat4 u_pyramidProj;
+
+// Same test as isConeBackFacing() in Meshlet.cpp
+bool isBackFacing(vec4 sphere, vec4 cone)
+{
+	vec3 toCentre = sphere.xyz - u_cameraPosition.xyz;
+	return dot(toCentre, cone.xyz) >= cone.w * length(toCentre) + sphere.w;
+}
+
+bool isInFrustum(vec4 sphere)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(u_frustumPlanes[i].xyz, sphere.xyz) + u_frustumPlanes[i].w < -sphere.w)
+			return false;
+	}
+
+	return true;
+}
+
+// Finds the screen rectangle (in 0-1 texture coordinates) a sphere covers
+// Returns false if the sphere crosses the near plane, there's no useful rectangle then
+// From "2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere" (Mara and McGuire)
+bool projectSphere(vec3 centre, float radius, float zNear, float P00, float P11, out vec4 rect)
+{
+	// View space looks down -z, flip it so z is the distance in front of the camera
+	vec3 c = vec3(centre.xy, -centre.z);
+
+	if (c.z < radius + zNear)
+		return false;
+
+	vec3 cr = c * radius;
+	float czr2 = c.z * c.z - radius * radius;
+
+	float vx = sqrt(c.x * c.x + czr2);
+	float minX = (vx * c.x - cr.z) / (vx * c.z + cr.x);
+	float maxX = (vx * c.x + cr.z) / (vx * c.z - cr.x);
+
+	float vy = sqrt(c.y * c.y + czr2);
+	float minY = (vy * c.y - cr.z) / (vy * c.z + cr.y);
+	float maxY = (vy * c.y + cr.z) / (vy * c.z - cr.y);
+
+	rect = vec4(minX * P00, minY * P11, maxX * P00, maxY * P11) * 0.5 + 0.5;
+	return true;
+}
+
+bool isOccluded(vec4 sphere)
+{
+	vec3 centre = (u_pyramidView * vec4(sphere.xyz, 1.0)).xyz;
+	float radius = sphere.w;
+
+	float P00 = u_pyramidProj[0][0];
+	float P11 = u_pyramidProj[1][1];
+	float zNear = u_pyramidProj[3][2] / (u_pyramidProj[2][2] - 1.0);
+
+	vec4 rect;
+	if (!projectSphere(centre, radius, zNear, P00, P11, rect))
+		return false;
+
+	// Depth of the sphere's closest point, in the same 0-1 range as the depth buffer
+	float closestZ = centre.z + radius;
+	vec4 closestClip = u_pyramidProj * vec4(0.0, 0.0, closestZ, 1.0);
+	float sphereDepth = closestClip.z / closestClip.w * 0.5 + 0.5;
+
+	// Pixels the rectangle covers at level 0
+	ivec2 size = textureSize(u_depthPyramid, 0);
+	ivec2 minPixel = clamp(ivec2(floor(rect.xy * vec2(size))), ivec2(0), size - 1);
+	ivec2 maxPixel = clamp(ivec2(floor(rect.zw * vec2(size))), ivec2(0), size - 1);
+
+	// The level where the rectangle is at most 2x2 texels
+	ivec2 extent = maxPixel - minPixel + 1;
+	int numLevels = textureQueryLevels(u_depthPyramid);
+	int level = min(int(ceil(log2(float(max(extent.x, extent.y))))), numLevels - 1);
+
+	// The last texel of a level also covers any leftover pixels, so clamp rather than skip them
+	// Each level is half the last rounded down, so its size is just a shift
+	// (textureSize with a level that isn't a constant gives the wrong size on some drivers)
+	ivec2 levelSize = max(size >> level, ivec2(1));
+	ivec2 minTexel = min(minPixel >> level, levelSize - 1);
+	ivec2 maxTexel = min(maxPixel >> level, levelSize - 1);
+
+	float depth = max(
+		max(texelFetch(u_depthPyramid, minTexel, level).r, texelFetch(u_depthPyramid, ivec2(maxTexel.x, minTexel.y), level).r),
+		max(texelFetch(u_depthPyramid, ivec2(minTexel.x, maxTexel.y), level).r, texelFetch(u_depthPyramid, maxTexel, level).r));
+
+	return sphereDepth > depth;
+}
+
+void main()
+{
+	int draw = int(gl_GlobalInvocationID.x);
+
+	if (draw >= u_numDraws)
+		return;
+
+	vec4 sphere = bounds[draw];
+	bool visible = isInFrustum(sphere);
+
+	if (visible && u_occlusion != 0)
+		visible = !isOccluded(sphere);
+
+	bool backFacing = isBackFacing(sphere, cones[draw]);
+
+#ifdef USE_COUNT_BUFFER
+	if (visible && !backFacing)
+		outputCommands[atomicAdd(drawCount, 1u)] = inputCommands[draw];
+	else if (visible)
+		outputCommands[u_backFacingOffset + atomicAdd(backFacingCount, 1u)] = inputCommands[draw];
+#else
+	DrawCommand command = inputCommands[draw];
+	uint instanceCount = command.instanceCount;
+
+	command.instanceCount = visible && !backFacing ? instanceCount : 0u;
+	outputCommands[draw] = command;
+
+	command.instanceCount = visible && backFacing ? instanceCount : 0u;
+	outputCommands[u_backFacingOffset + draw] = command;
+#endif
+}
@@ -0,0 +1,14 @@
+#version 400
+
+// Fragment Shader Inputs
+in VertexData
+{
+	vec4 colour;
+} vIn;
+
+layout(location = 0) out vec4 FragColor;
+
+void main()
+{
+	FragColor = vIn.colour;
+}
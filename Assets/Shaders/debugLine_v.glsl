@@ -0,0 +1,22 @@
+#version 400
+
+// Draws the lines of a TTK::DebugDraw, they're already in world space
+
+// Vertex Shader Inputs
+// Same layout as DebugDraw::LineVertex
+layout(location = 0) in vec3 vIn_vertex;
+layout(location = 1) in vec4 vIn_colour;
+
+// Uniforms
+uniform mat4 u_viewProj;
+
+out VertexData
+{
+	vec4 colour;
+} vOut;
+
+void main()
+{
+	vOut.colour = vIn_colour;
+	gl_Position = u_viewProj * vec4(vIn_vertex, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 400
+
+// Draws the text and points of a TTK::DebugDraw, with sprite_v.glsl
+// The font texture is a signed distance field: 0.5 is the edge of a letter,
+// higher is inside and lower is outside (see buildFont() in DebugDraw.cpp)
+
+uniform sampler2D u_texture;
+
+// Fragment Shader Inputs
+in VertexData
+{
+	vec2 texCoord;
+	vec4 colour;
+} vIn;
+
+layout(location = 0) out vec4 FragColor;
+
+// Where the letters end, and where the dark outline around them ends
+// The field goes 1.5 font units each side of the edge, so 0.38 is an outline about a third of a unit wide
+const float EDGE = 0.5;
+const float OUTLINE_EDGE = 0.38;
+
+void main()
+{
+	float distance = texture(u_texture, vIn.texCoord).r;
+
+	// About a pixel of blending, however big the text is drawn
+	float smoothing = fwidth(distance) * 0.7;
+
+	float fill = smoothstep(EDGE - smoothing, EDGE + smoothing, distance);
+	float outline = smoothstep(OUTLINE_EDGE - smoothing, OUTLINE_EDGE + smoothing, distance);
+
+	FragColor = vec4(vIn.colour.rgb * fill, vIn.colour.a * outline);
+}
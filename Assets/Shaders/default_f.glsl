@@ -1,7 +1,6 @@
 #version 400
 
 uniform vec4 u_lightPos;
-uniform vec4 u_colour;
 
 // Fragment Shader Inputs
 in VertexData
@@ -23,5 +22,5 @@ void main()
 
 	float diffuse = max(0.0, dot(N, L));
 
-	FragColor = vec4(vec3(0.5, 0.5, 0.5) * (diffuse * 0.8f) + u_colour.rgb, 1.0f);
+	FragColor = vec4(vec3(0.5, 0.5, 0.5) * (diffuse * 0.8f) + vIn.colour.rgb, 1.0f);
 }
\ No newline at end of file
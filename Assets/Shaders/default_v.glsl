@@ -1,18 +1,60 @@
  #version 400
 
+// Features:
+// USE_INDIRECT		- the object's transform, colour and texture layer come from the
+//					  per draw buffer written by IndirectRenderer instead of uniforms
+
+#ifdef USE_INDIRECT
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
+
 // Vertex Shader Inputs
 // These are the attributes of the vertex
+#ifdef USE_INDIRECT
+// Quantized by MeshBuffer (see MeshCodec.h): the position goes from 0 to 1 across the mesh's
+// bounding box and the normal is octahedral encoded
+layout(location = 0) in vec3 vIn_vertex;
+layout(location = 1) in vec2 vIn_normal;
+#else
 layout(location = 0) in vec3 vIn_vertex;
 layout(location = 1) in vec3 vIn_normal;
+#endif
 layout(location = 2) in vec3 vIn_uv;
 layout(location = 3) in vec4 vIn_colour;
 
+#ifdef USE_INDIRECT
+// Which draw of the multi-draw this vertex belongs to
+layout(location = 4) in uint vIn_drawId;
+
+// Same layout as IndirectDrawData in IndirectRenderer.h
+struct DrawData
+{
+	mat4 model;
+	vec4 colour;
+	vec4 positionOffset;
+	vec4 positionScale;
+	ivec4 textureLayer; // only x is used
+};
+
+// Bound to binding point 0 (the default, so no layout binding is needed)
+layout(std430) readonly buffer DrawBuffer
+{
+	DrawData draws[];
+};
+
+// Same for every draw
+uniform mat4 u_viewProj;
+uniform mat4 u_view;
+
+flat out int vTextureLayer;
+#else
 // Uniforms
 // Constants throughout the entire pipeline
 // These values are sent from C++ (glSendUniform*)
 uniform mat4 u_mvp;
 uniform mat4 u_mv;
 uniform vec4 u_colour;
+#endif
 
 out VertexData
 {
@@ -22,12 +64,44 @@ out VertexData
 	vec3 posEye;
 } vOut;
 
+#ifdef USE_INDIRECT
+// Same as decodeOctahedral() in MeshCodec.cpp
+vec3 decodeOctahedral(vec2 p)
+{
+	vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+
+	// The lower half is folded over the upper half
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+
+	return normalize(n);
+}
+#endif
+
 void main() 
 {
+#ifdef USE_INDIRECT
+	DrawData draw = draws[vIn_drawId];
+
+	vec3 position = draw.positionOffset.xyz + vIn_vertex * draw.positionScale.xyz;
+	vec3 normal = decodeOctahedral(vIn_normal);
+
+	vec4 posWorld = draw.model * vec4(position, 1.0);
+	vec4 normalWorld = draw.model * vec4(normal, 0.0);
+
+	vOut.texCoord = vIn_uv;
+	vOut.colour = draw.colour;
+	vOut.normal = (u_view * normalWorld).xyz;
+	vOut.posEye = (u_view * posWorld).xyz;
+	vTextureLayer = draw.textureLayer.x;
+
+	gl_Position = u_viewProj * posWorld;
+#else
 	vOut.texCoord = vIn_uv;
 	vOut.colour = u_colour;
 	vOut.normal = (u_mv * vec4(vIn_normal, 0.0)).xyz;
 	vOut.posEye = (u_mv * vec4(vIn_vertex, 1.0)).xyz;
 
 	gl_Position = u_mvp * vec4(vIn_vertex, 1.0);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#version 430
+
+// Builds one level of a DepthPyramid
+// Each thread writes one texel: the farthest depth of the texels under it in the level above
+// (or, for level 0, a straight copy of the depth buffer)
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D u_source;		// the depth buffer for level 0, the pyramid itself after that
+uniform int u_sourceLevel;
+uniform int u_copy;				// 1 for level 0
+
+layout(r32f, binding = 0) uniform writeonly image2D u_destination;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(u_destination);
+
+	if (texel.x >= size.x || texel.y >= size.y)
+		return;
+
+	if (u_copy != 0)
+	{
+		imageStore(u_destination, texel, vec4(texelFetch(u_source, texel, 0).r));
+		return;
+	}
+
+	// Levels are halved rounding down, so the size of any level is a shift of level 0's
+	ivec2 sourceSize = max(textureSize(u_source, 0) >> u_sourceLevel, ivec2(1));
+
+	// The 2x2 texels under this one
+	ivec2 first = texel * 2;
+	ivec2 last = min(first + 1, sourceSize - 1);
+
+	// When the level above has an odd size its last row or column has nowhere
+	// else to go, so the last texel takes it too
+	if (texel.x == size.x - 1)
+		last.x = sourceSize.x - 1;
+	if (texel.y == size.y - 1)
+		last.y = sourceSize.y - 1;
+
+	float depth = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+	{
+		for (int x = first.x; x <= last.x; x++)
+			depth = max(depth, texelFetch(u_source, ivec2(x, y), u_sourceLevel).r);
+	}
+
+	imageStore(u_destination, texel, vec4(depth));
+}
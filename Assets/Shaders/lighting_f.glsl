@@ -0,0 +1,118 @@
+#version 400
+
+// Lighting shader with compile time features
+// Each feature is turned on with a #define that ShaderPermutations inserts
+// after the #version line, so every lighting mode gets its own specialized
+// shader with no runtime branching.
+//
+// Features:
+// USE_AMBIENT			- constant ambient term
+// USE_DIFFUSE			- lambert diffuse
+// USE_SPECULAR			- blinn-phong specular
+// USE_RIM				- rim lighting around the silhouette
+// USE_DIFFUSE_RAMP		- quantizes diffuse into bands (toon ramp)
+// USE_SPECULAR_RAMP	- quantizes specular into bands
+// USE_GRADE_WARM		- warm colour grading
+// USE_GRADE_COOL		- cool colour grading
+// USE_GRADE_CUSTOM		- colour grading with u_gradeColour
+// USE_TEXTURE_ARRAY	- samples layer u_textureLayer of u_textures (-1 for none)
+// USE_INDIRECT			- drawn by IndirectRenderer, the texture layer comes from the vertex shader
+
+uniform vec4 u_lightPos;
+
+#ifdef USE_GRADE_CUSTOM
+uniform vec4 u_gradeColour;
+#endif
+
+#ifdef USE_TEXTURE_ARRAY
+uniform sampler2DArray u_textures;
+#ifdef USE_INDIRECT
+flat in int vTextureLayer;
+#else
+uniform int u_textureLayer;
+#endif
+#endif
+
+// Fragment Shader Inputs
+in VertexData
+{
+	vec3 normal;
+	vec3 texCoord;
+	vec4 colour;
+	vec3 posEye;
+} vIn;
+
+// Outputs
+layout(location = 0) out vec4 FragColor;
+
+// Snaps a value in [0, 1] to one of a few bands
+float ramp(float value)
+{
+	if (value <= 0.00) return 0.00;
+	else if (value <= 0.25) return 0.25;
+	else if (value <= 0.50) return 0.50;
+	else if (value <= 0.75) return 0.75;
+	return 1.00;
+}
+
+void main()
+{
+	vec3 L = normalize(u_lightPos.xyz - vIn.posEye);
+	vec3 N = normalize(vIn.normal);
+	vec3 V = normalize(-vIn.posEye);
+
+	vec3 baseColour = vec3(0.5, 0.5, 0.5);
+
+#ifdef USE_TEXTURE_ARRAY
+	#ifdef USE_INDIRECT
+	int textureLayer = vTextureLayer;
+	#else
+	int textureLayer = u_textureLayer;
+	#endif
+
+	// Same value for the whole draw, so every fragment takes the same path
+	if (textureLayer >= 0)
+		baseColour = texture(u_textures, vec3(vIn.texCoord.xy, float(textureLayer))).rgb;
+#endif
+	vec3 colour = vIn.colour.rgb;
+
+#ifdef USE_AMBIENT
+	colour += baseColour * 0.2;
+#endif
+
+#ifdef USE_DIFFUSE
+	float diffuse = max(0.0, dot(N, L));
+	#ifdef USE_DIFFUSE_RAMP
+	diffuse = ramp(diffuse);
+	#endif
+	colour += baseColour * (diffuse * 0.8);
+#endif
+
+#ifdef USE_SPECULAR
+	vec3 H = normalize(L + V);
+	float specular = pow(max(0.0, dot(N, H)), 50.0);
+	#ifdef USE_SPECULAR_RAMP
+	specular = ramp(specular);
+	#endif
+	colour += vec3(specular);
+#endif
+
+#ifdef USE_RIM
+	float rim = 1.0 - max(0.0, dot(N, V));
+	colour += vec3(smoothstep(0.6, 1.0, rim) * 0.5);
+#endif
+
+#ifdef USE_GRADE_WARM
+	colour *= vec3(1.1, 1.0, 0.8);
+#endif
+
+#ifdef USE_GRADE_COOL
+	colour *= vec3(0.8, 0.95, 1.15);
+#endif
+
+#ifdef USE_GRADE_CUSTOM
+	colour *= u_gradeColour.rgb;
+#endif
+
+	FragColor = vec4(colour, 1.0f);
+}
@@ -0,0 +1,17 @@
+#version 400
+
+uniform sampler2D u_texture;
+
+// Fragment Shader Inputs
+in VertexData
+{
+	vec2 texCoord;
+	vec4 colour;
+} vIn;
+
+layout(location = 0) out vec4 FragColor;
+
+void main()
+{
+	FragColor = texture(u_texture, vIn.texCoord) * vIn.colour;
+}
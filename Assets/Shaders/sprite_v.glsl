@@ -0,0 +1,36 @@
+#version 400
+
+// Draws the sprites of a SpriteBatch, one instance per sprite
+// There are no vertices, the 4 corners of each sprite's triangle strip come from gl_VertexID
+
+// Sprite Inputs
+// Same layout as SpriteInstance in SpriteBatch.h
+layout(location = 0) in vec4 vIn_rect;		// centre in xy, size in zw
+layout(location = 1) in vec4 vIn_uvs;		// bottom left uv in xy, top right in zw
+layout(location = 2) in vec4 vIn_colour;
+layout(location = 3) in float vIn_rotation;
+
+// Uniforms
+uniform mat4 u_viewProj;
+
+out VertexData
+{
+	vec2 texCoord;
+	vec4 colour;
+} vOut;
+
+void main()
+{
+	// 0 is bottom left, 1 bottom right, 2 top left, 3 top right
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+	// Rotate the corner about the centre
+	vec2 offset = (corner - 0.5) * vIn_rect.zw;
+	float s = sin(vIn_rotation);
+	float c = cos(vIn_rotation);
+	vec2 position = vIn_rect.xy + vec2(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+
+	vOut.texCoord = mix(vIn_uvs.xy, vIn_uvs.zw, corner);
+	vOut.colour = vIn_colour;
+	gl_Position = u_viewProj * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+#include <string>
+
+// The local transform of one joint at one point in time
+struct JointPose
+{
+	glm::vec3 translation;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+// An animation as it comes out of the authoring tool (or a procedural generator):
+// every joint's pose at every frame, sampled at a fixed rate
+// Far too big to keep around, build an AnimationClip from it
+struct RawAnimation
+{
+	std::string name;
+	float sampleRate;	// frames per second
+	unsigned int numFrames;	// at most 65535
+	std::vector<std::string> jointNames;
+
+	// numFrames * jointNames.size() poses, frame by frame: frames[frame * numJoints + joint]
+	std::vector<JointPose> frames;
+};
+
+// A quaternion packed into 48 bits, using the "smallest three" trick:
+// A unit quaternion's largest component can be rebuilt from the other three
+// (x*x + y*y + z*z + w*w = 1), and those three are all in [-1/sqrt(2), 1/sqrt(2)].
+// So we store 2 bits saying which component was dropped and 15 bits for each of the rest.
+// q and -q are the same rotation, so the dropped one is always made positive.
+struct QuantizedQuat
+{
+	unsigned short data[3];
+
+	static QuantizedQuat encode(glm::quat q);
+	glm::quat decode() const;
+};
+
+// Where each track got to in the last sample, so playing forwards
+// only has to step to the next key instead of searching for it
+// Each playing instance of a clip needs its own
+struct AnimationCursor
+{
+	// Per track (translations, then rotations, then scales), the key before the last sample time
+	std::vector<unsigned short> keys;
+
+	// Forgets where every track was, the next sample searches for its keys
+	void reset();
+};
+
+// A compressed animation
+//
+// Each joint has a translation, rotation and scale track. Each track only keeps the keys
+// it needs: keys that can be rebuilt by interpolating their neighbours (to within a
+// tolerance) are dropped, so a joint that never moves costs a single key.
+// Key values are quantized too:
+//	- rotations to 48 bits (QuantizedQuat)
+//	- translations and scales to 16 bits per component, over the range the track uses
+//	- key times to 16 bit frame numbers
+// All the keys of a track are stored next to each other.
+class AnimationClip
+{
+public:
+	// How far a compressed track may stray from the raw animation
+	struct Tolerances
+	{
+		Tolerances() : translation(0.001f), rotation(0.001f), scale(0.001f) {}
+
+		float translation;	// units
+		float rotation;		// radians
+		float scale;
+	};
+
+	AnimationClip();
+
+	// Compresses a raw animation, returns false if it has no frames or too many
+	bool build(const RawAnimation& raw, const Tolerances& tolerances = Tolerances());
+
+	// Poses every joint at time (in seconds, clamped to the clip)
+	// outPoses needs room for getNumJoints() poses
+	// The cursor remembers where each track was, pass the same one each frame for the same instance
+	void sample(float time, AnimationCursor& cursor, JointPose* outPoses) const;
+
+	// Sizes a cursor for this clip and resets it
+	void initCursor(AnimationCursor& cursor) const;
+
+	const std::string& getName() const;
+	const std::vector<std::string>& getJointNames() const;
+	unsigned int getNumJoints() const;
+	float getDuration() const;
+
+	// Total keys kept across every track
+	unsigned int getNumKeys() const;
+
+	// Bytes used by the compressed tracks, and what the raw animation would take
+	unsigned int getMemoryUsage() const;
+	unsigned int getRawMemoryUsage() const;
+
+	// Prints the name, size and compression ratio
+	void printStats() const;
+
+	// Angle between two rotations, in radians
+	static float angleBetween(const glm::quat& a, const glm::quat& b);
+
+private:
+	// firstKey indexes the key and time arrays for the track's type
+	// Quantized translations and scales are rangeMin + key * rangeScale (unused for rotations)
+	struct Track
+	{
+		unsigned int firstKey;
+		unsigned int numKeys;
+		glm::vec3 rangeMin;
+		glm::vec3 rangeScale;
+	};
+
+	void buildVec3Track(const std::vector<glm::vec3>& values, float tolerance,
+		std::vector<Track>& tracks, std::vector<unsigned short>& times, std::vector<glm::u16vec3>& keys);
+	void buildRotationTrack(const std::vector<glm::quat>& values, float tolerance);
+
+	std::string name;
+	std::vector<std::string> jointNames;
+	float sampleRate;
+	unsigned int numFrames;
+
+	std::vector<Track> translationTracks;
+	std::vector<Track> rotationTracks;
+	std::vector<Track> scaleTracks;
+
+	std::vector<unsigned short> translationTimes;
+	std::vector<unsigned short> rotationTimes;
+	std::vector<unsigned short> scaleTimes;
+
+	std::vector<glm::u16vec3> translationKeys;
+	std::vector<QuantizedQuat> rotationKeys;
+	std::vector<glm::u16vec3> scaleKeys;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "AnimationClip.h"
+
+class GameObject;
+class ThreadPool;
+
+// Plays an animation clip on a set of game objects (the joints)
+//
+// Each frame:
+//	update(dt)	- moves the play time along
+//	sample()	- poses the joints from the clip, only touches this animator
+//	apply()		- copies the poses onto the game objects
+//
+// sample() is the expensive part, for lots of characters call sampleAll() to spread them across threads.
+class Animator
+{
+public:
+	Animator();
+
+	// joints[i] is moved by the clip's joint i, null (or missing) joints are sampled but not applied
+	void setClip(std::shared_ptr<AnimationClip> _clip, const std::vector<GameObject*>& _joints);
+
+	void update(float dt);
+	void sample();
+	void apply();
+
+	// Samples a batch of animators, chunkSize animators at a time per thread
+	static void sampleAll(const std::vector<Animator*>& animators, ThreadPool* pool, unsigned int chunkSize = 16);
+
+	// The poses from the last sample(), one per clip joint
+	const std::vector<JointPose>& getPoses() const;
+
+	std::shared_ptr<AnimationClip> getClip();
+
+	float time;		// seconds into the clip
+	float speed;	// 1 = normal, negative plays backwards
+	bool looping;
+	bool playing;
+
+private:
+	std::shared_ptr<AnimationClip> clip;
+	std::vector<GameObject*> joints;
+	std::vector<JointPose> poses;
+	AnimationCursor cursor;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <functional>
+
+// Where an asset is in loading
+enum AssetState
+{
+	ASSET_LOADING,	// queued, being read, decoded or uploaded
+	ASSET_READY,	// usable
+	ASSET_FAILED	// couldn't be loaded, it never will be
+};
+
+// The part of an asset that doesn't depend on its type, so objects can wait on any mix of them
+// The state is written by the GL thread and can be read from any thread
+class Asset
+{
+public:
+	Asset(const std::string& _name) : name(_name), state(ASSET_LOADING), loadTimeMS(0.0) {}
+	virtual ~Asset() {}
+
+	AssetState getState() const { return (AssetState)state.load(std::memory_order_acquire); }
+	bool isReady() const { return getState() == ASSET_READY; }
+
+	const std::string& getName() const { return name; }
+
+	// From being asked for to ready (or failed)
+	double getLoadTimeMS() const { return loadTimeMS; }
+
+private:
+	friend class AssetManager;
+
+	std::string name;
+	std::atomic<int> state;
+	double loadTimeMS;
+
+	// Called on the GL thread when the asset is ready, before anything waiting on it sees it ready
+	std::vector<std::function<void()>> readyCallbacks;
+};
+
+// An asset holding a T (ie. a mesh or a shader program)
+// The T is created as soon as the asset is asked for, so it can be handed out (ie. to a game object)
+// right away, but it must not be used until the asset is ready
+template <typename T>
+class AssetOf : public Asset
+{
+public:
+	AssetOf(const std::string& _name, std::shared_ptr<T> _resource) : Asset(_name), resource(_resource) {}
+
+	std::shared_ptr<T> resource;
+};
+
+// A counted reference to an asset
+// The AssetManager only keeps assets while they load, once the last handle to an asset is gone
+// so is the asset, and asking for it again loads it again
+template <typename T>
+class AssetHandle
+{
+public:
+	AssetHandle() {}
+	AssetHandle(std::shared_ptr<AssetOf<T>> _asset) : asset(_asset) {}
+
+	T* get() const { return asset ? asset->resource.get() : nullptr; }
+	T* operator->() const { return get(); }
+	std::shared_ptr<T> getShared() const { return asset ? asset->resource : nullptr; }
+
+	// For waiting on the asset (see GameObject::addDependency)
+	std::shared_ptr<const Asset> getAsset() const { return asset; }
+
+	AssetState getState() const { return asset ? asset->getState() : ASSET_FAILED; }
+	bool isReady() const { return asset && asset->isReady(); }
+
+	explicit operator bool() const { return asset != nullptr; }
+
+private:
+	std::shared_ptr<AssetOf<T>> asset;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <GLEW/glew.h>
+
+#include "Asset.h"
+#include "ShaderProgram.h"
+#include "TTK/OBJMesh.h"
+#include "TTK/TextureArray.h"
+#include "TTK/TextureStreamer.h"
+#include "TTK/IO.h"
+
+// A layer of a texture array, the index is known as soon as the texture is asked for
+struct TextureLayer
+{
+	TTK::TextureArray* textures;
+	int layer;
+};
+
+// One stage of a shader program
+struct ShaderStage
+{
+	ShaderStage(const std::string& _fileName, GLenum _type, const std::string& _defines = "")
+		: fileName(_fileName), type(_type), defines(_defines)
+	{}
+
+	std::string fileName;
+	GLenum type;
+	std::string defines;
+};
+
+typedef AssetHandle<TTK::OBJMesh> MeshHandle;
+typedef AssetHandle<TextureLayer> TextureHandle;
+typedef AssetHandle<ShaderProgram> ShaderHandle;
+
+// Loads meshes, textures and shaders in the background
+//
+// Every load goes through three stages:
+//	I/O thread:		reads the files (from a mounted pack or the disk), many at once
+//	worker threads:	decodes them (parses OBJs, decodes and mipmaps images)
+//	GL thread:		uploads them (VBOs, texture layers, shader compiles) in update()
+// Texture layers are uploaded through a TextureStreamer if there is one, a few rows a frame
+// within its budget, so a big texture finishing loading doesn't make for a long frame.
+// Loads don't wait on each other, so everything loads at once and loading takes about
+// as long as the slowest asset, instead of all of them added up.
+//
+// Usage:
+//	MeshHandle sphere = assets.loadMesh("sphere.obj");
+//	object->mesh = sphere.getShared();
+//	object->addDependency(sphere);	// the object is drawn once the sphere is ready
+//	...
+//	assets.update();	// every frame on the GL thread
+//
+// Everything but the worker stages runs on the GL thread: call the load functions and update() there.
+// Asking for a file that's already loaded (or loading) returns the same asset.
+class AssetManager
+{
+public:
+	AssetManager();
+	~AssetManager();
+
+	// Starts the I/O thread and the workers (0 = one less than the number of cores)
+	void start(unsigned int numWorkers = 0);
+
+	// Waits for the threads, loads still in flight are dropped (and stay ASSET_LOADING)
+	void stop();
+
+	// Texture layers are copied through the streamer's PBO ring instead of all at once
+	// update() updates the streamer too, so don't call its update() as well
+	void setTextureStreamer(TTK::TextureStreamer* streamer);
+
+	// Description:
+	// Loads an OBJ mesh, its VBO is created on the GL thread
+	// If the mounted pack has the mesh cooked (see getCookedMeshName) that's decoded instead of the OBJ
+	// onReady is called on the GL thread once it's loaded, before the handle reports it ready
+	// (ie. to add it to a MeshBuffer)
+	MeshHandle loadMesh(const std::string& fileName, std::function<void(std::shared_ptr<TTK::OBJMesh>)> onReady = nullptr);
+
+	// Description:
+	// Loads an image into a layer of a texture array
+	// The layer is taken right away, so the index can be given to objects before the image is loaded
+	TextureHandle loadTextureLayer(TTK::TextureArray& textures, const std::string& fileName, bool flip = false,
+		std::function<void(std::shared_ptr<TextureLayer>)> onReady = nullptr);
+
+	// Description:
+	// Compiles and links a program from shader files
+	// With GL_ARB_parallel_shader_compile the driver compiles it while frames keep drawing,
+	// the program is polled each update() until it's done
+	ShaderHandle loadShaderProgram(const std::vector<ShaderStage>& stages, std::function<void(std::shared_ptr<ShaderProgram>)> onReady = nullptr);
+
+	// Finishes the loads that have been decoded, call once per frame on the GL thread
+	void update();
+
+	// Calls update() until nothing is loading (ie. for runs that need the whole scene before the first frame)
+	void waitForAll();
+
+	// Assets asked for that aren't ready (or failed) yet
+	unsigned int getNumPending();
+
+private:
+	// What the GL stage did
+	enum UploadResult
+	{
+		UPLOAD_DONE,
+		UPLOAD_FAILED,
+		UPLOAD_WAITING	// not done yet, call again next update() (ie. the driver is still compiling)
+	};
+
+	struct Request
+	{
+		std::shared_ptr<Asset> asset;
+		std::vector<std::string> fileNames;
+		std::vector<TTK::IO::FileView> files;	// filled in by the I/O thread
+		bool filesRead;
+		unsigned int filesLeft;
+
+		// Worker thread, returns false if the files couldn't be decoded (may be null)
+		std::function<bool(Request&)> decode;
+		bool decoded;
+
+		// GL thread
+		std::function<UploadResult(Request&)> upload;
+
+		std::chrono::high_resolution_clock::time_point startTime;
+	};
+
+	// Adds the asset to the cache and queues its request
+	void submit(std::shared_ptr<Request> request);
+
+	// Returns the asset already loaded (or loading) under this name, if any
+	std::shared_ptr<Asset> findCached(const std::string& name);
+
+	// Runs the callbacks and marks the asset ready, or failed
+	void finish(Request& request, bool succeeded);
+
+	// Calls onReady now if the asset is ready, or once it is if it's still loading
+	template <typename T>
+	void addReadyCallback(AssetOf<T>& asset, const std::function<void(std::shared_ptr<T>)>& onReady);
+
+	void ioLoop();
+
+	// Hands a request that's been read to the workers (or straight to the GL thread)
+	void queueDecode(std::shared_ptr<Request> request);
+	void workerLoop();
+
+	std::thread ioThread;
+	std::vector<std::thread> workers;
+	bool stopThreads;
+
+	std::mutex queueMutex;
+	std::condition_variable ioCondition;
+	std::condition_variable decodeCondition;
+	std::deque<std::shared_ptr<Request>> ioQueue;		// waiting to be read
+	std::deque<std::shared_ptr<Request>> decodeQueue;	// read, waiting to be decoded
+	std::deque<std::shared_ptr<Request>> uploadQueue;	// decoded, waiting for the GL thread
+
+	// GL thread only
+	std::vector<std::shared_ptr<Request>> uploading;	// uploads that are waiting on the driver
+	std::deque<std::shared_ptr<Request>> decodedRequests;	// taken from uploadQueue each update()
+	std::map<std::string, std::weak_ptr<Asset>> cache;
+	unsigned int numPending;
+	TTK::TextureStreamer* textureStreamer;
+
+	// Assets loaded since nothing was pending, for printing how long loading took
+	std::chrono::high_resolution_clock::time_point batchStartTime;
+	unsigned int batchSize;
+	double slowestLoadMS;
+	std::string slowestAsset;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+
+// Watches asset files on disk and calls back when one of them changes
+// Used to hot-reload shaders and meshes while the app is running,
+// so you do not need to restart to see your changes.
+//
+// On Linux the kernel tells us about changes through inotify: the folders the files are
+// in are watched, and poll() only reads the events that have come in since last time.
+// Everywhere else (or if inotify can't be used) the files' timestamps are checked instead.
+//
+// Note: callbacks are invoked from poll(), so call poll() on the thread that owns
+// the OpenGL context (ie. once per frame in the display callback)
+class AssetWatcher
+{
+public:
+	typedef std::function<void(const std::string&)> Callback;
+
+	AssetWatcher();
+	~AssetWatcher();
+
+	// Calls onChanged every time fileName is modified
+	// A file can have more than one callback (ie. a vertex shader used by two programs)
+	void watchFile(const std::string& fileName, Callback onChanged);
+
+	// Stops watching every file
+	void clear();
+
+	// Invokes the callbacks of any files that changed. Changes are only looked for
+	// every pollIntervalMS milliseconds, so this is cheap enough to call every frame
+	// (and a file saved in a few steps is only reloaded once).
+	void poll();
+
+	// How often (in milliseconds) the files are checked
+	int pollIntervalMS;
+
+	// True if changes come from inotify rather than checking timestamps
+	bool isUsingInotify() const { return inotifyFd >= 0; }
+
+private:
+	AssetWatcher(const AssetWatcher&);
+	AssetWatcher& operator=(const AssetWatcher&);
+
+	struct WatchedFile
+	{
+		long long lastWriteTime;
+		long long lastSize;
+		bool notified; // its folder is watched by inotify, so it doesn't need checking
+		std::vector<Callback> callbacks;
+	};
+
+	// Gets the last modification time (in nanoseconds, or as close as the platform has)
+	// and size of the file
+	// Returns false if the file does not exist
+	static bool getFileInfo(const std::string& fileName, long long& writeTime, long long& size);
+
+	// inotify (Linux only)
+	// Starts watching the file's folder, returns false if it can't be watched
+	bool watchDirectory(const std::string& fileName);
+
+	// Reads the events that have come in and adds the files they are about to changed
+	// Returns true if the kernel dropped some, then every file's timestamp has to be checked
+	bool readEvents(std::vector<std::string>& changed);
+
+	void notifyChanged(const std::string& fileName, WatchedFile& file);
+
+	std::map<std::string, WatchedFile> watchedFiles;
+	std::chrono::steady_clock::time_point lastPollTime;
+
+	int inotifyFd;
+	std::map<int, std::string> watchedDirectories;	// inotify watch descriptor to folder
+	std::vector<char> eventBuffer;
+};
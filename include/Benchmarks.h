@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+// Micro benchmarks for the CPU heavy parts of the engine
+// Run with: Assignment1.exe --bench <name>
+// They don't need a window or OpenGL, so they also run on build servers.
+//
+// Names:
+//	skinning	- CPU skinning kernel, plain vs SIMD vs threaded, 10k to 1M vertices
+//	animation	- clip compression (size and error) and sampling cost per character
+//	entities	- iterating and looking up 100k game objects, string map vs EntityRegistry
+//	meshes		- quantized vertex error, cooked mesh size and decode speed
+//	packs		- asset pack size, LZ4 speed and opening every asset loose (one at a time and batched) vs from the pack
+//	images		- PNG decode speed of the textures, one thread and every thread vs DevIL
+//	sprites		- atlas packing (time and how full it gets) and the cost of filling a 100k sprite batch
+//	debugdraw	- building the debug font and filling a frame with 5000 boxes, axes and labels
+//	all			- every benchmark
+//
+// Returns 0 if the benchmark ran (and its results checked out)
+int runBenchmarks(const std::string& name);
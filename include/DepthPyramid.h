@@ -0,0 +1,63 @@
+#pragma once
+
+#include "GLEW/glew.h"
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "ShaderProgram.h"
+
+// A mip chain of a depth buffer where every texel holds the farthest depth under it
+// (a "hierarchical z" buffer)
+//
+// Level 0 is a copy of the depth buffer, and each level after that is half the size
+// with every texel the max of the 2x2 texels under it. So a texel of level L covers the
+// 2^L x 2^L pixels it sits over, and anything whose nearest depth is farther than that
+// texel is hidden behind what was drawn there.
+// Halving an odd size drops a row or column, so the last texel of each row and column
+// also takes in the leftovers and a texel never misses any pixels.
+//
+// IndirectRenderer tests objects against the pyramid built from the last frame,
+// so an object only has to check a few texels no matter how big it is on screen.
+class DepthPyramid
+{
+public:
+	DepthPyramid();
+	~DepthPyramid();
+
+	// reduceShader is depthPyramid_c.glsl
+	void setReduceShader(std::shared_ptr<ShaderProgram> _reduceShader);
+
+	// Rebuilds the pyramid from a depth texture that was rendered with viewMatrix and projMatrix
+	// The pyramid is (re)created if the size changed
+	void build(GLuint depthTexture, unsigned int _width, unsigned int _height,
+		const glm::mat4& _viewMatrix, const glm::mat4& _projMatrix);
+
+	void destroy();
+
+	// False until build() has been called
+	bool isValid() { return textureHandle != 0 && reduceShader; }
+
+	GLuint getTexture() { return textureHandle; }
+	unsigned int getWidth() { return width; }
+	unsigned int getHeight() { return height; }
+	unsigned int getNumLevels() { return numLevels; }
+
+	// The camera the depth was rendered with
+	const glm::mat4& getViewMatrix() { return viewMatrix; }
+	const glm::mat4& getProjMatrix() { return projMatrix; }
+
+private:
+	DepthPyramid(const DepthPyramid&);
+	DepthPyramid& operator=(const DepthPyramid&);
+
+	void create(unsigned int _width, unsigned int _height);
+
+	std::shared_ptr<ShaderProgram> reduceShader;
+
+	GLuint textureHandle;
+	unsigned int width, height;
+	unsigned int numLevels;
+
+	glm::mat4 viewMatrix;
+	glm::mat4 projMatrix;
+};
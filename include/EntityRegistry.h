@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+
+#include "ObjectPool.h"
+#include "GameObject.h"
+
+typedef PoolHandle EntityHandle;
+
+// Owns every game object in the scene and hands out handles to them
+//
+// Looking up a handle is O(1): its index picks the slot and the generation
+// check catches handles to objects that have since been destroyed.
+// The live objects are also kept in one dense array, so going over all of them
+// is a linear scan instead of walking a tree of map nodes:
+//
+//	for (unsigned int i = 0; i < registry.size(); i++)
+//		registry[i]->update(dt);
+//
+// Names are optional and only meant for finding objects while loading a scene.
+// Look them up once and keep the handle, don't call find() every frame.
+class EntityRegistry
+{
+public:
+	// name can be empty
+	EntityHandle create(const std::string& name, glm::vec3 position,
+		std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material);
+
+	// Detaches the object from its parent and children (they become roots) and destroys it
+	void destroy(EntityHandle handle);
+
+	// Null if the handle is stale (or was never valid)
+	GameObject* get(EntityHandle handle) const;
+
+	// Handle of a named object, an invalid handle if there isn't one
+	EntityHandle find(const std::string& name) const;
+
+	void clear();
+
+	// The dense array, in no particular order (destroy() moves the last object into the gap)
+	unsigned int size() const { return (unsigned int)objects.size(); }
+	GameObject* operator[](unsigned int i) const { return objects[i]; }
+	EntityHandle getHandle(unsigned int i) const { return handles[i]; }
+
+private:
+	ObjectPool<GameObject> pool;
+
+	// Dense arrays of the live objects and their handles
+	std::vector<GameObject*> objects;
+	std::vector<EntityHandle> handles;
+
+	// Per pool slot, where its object is in the dense arrays
+	std::vector<unsigned int> denseIndices;
+
+	std::unordered_map<std::string, EntityHandle> names;
+};
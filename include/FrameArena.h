@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// A linear allocator for data that only lives for one frame (draw lists, joint transforms, ...)
+//
+// Allocating just bumps a pointer, and everything is freed at once by reset().
+// There's no per-allocation free, deallocate does nothing.
+//
+// If a frame needs more than the capacity, the extra comes from the heap and
+// the next reset() grows the arena to fit, so steady state frames never touch the heap.
+class FrameArena
+{
+public:
+	FrameArena(size_t _capacity = 0);
+	~FrameArena();
+
+	// Frees everything and (re)allocates the arena's memory
+	void create(size_t _capacity);
+
+	// Returns size bytes aligned to alignment (a power of 2)
+	void* allocate(size_t size, size_t alignment = 16);
+
+	// Frees everything allocated since the last reset
+	void reset();
+
+	size_t getCapacity();
+	size_t getUsed();
+	size_t getHighWater();		// most bytes used in one frame (including overflow)
+	unsigned int getNumOverflows();	// allocations that didn't fit, since the arena was created
+
+private:
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	void freeOverflow();
+
+	unsigned char* memory;
+	size_t capacity;
+	size_t used;
+	size_t overflowBytes;
+	size_t highWater;
+	unsigned int numOverflows;
+	std::vector<void*> overflowBlocks;
+};
+
+// Lets standard containers allocate from a FrameArena
+// Without an arena it falls back to new and delete, so containers using it still work on their own
+//
+// Usage:
+//	FrameVector<DrawItem> drawItems((ArenaAllocator<DrawItem>(&arena)));
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena* _arena = nullptr) : arena(_arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n)
+	{
+		if (arena)
+			return (T*)arena->allocate(n * sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+		else
+			return (T*)::operator new(n * sizeof(T));
+	}
+
+	void deallocate(T* p, size_t)
+	{
+		if (!arena)
+			::operator delete(p);
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+	FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -47,5 +47,8 @@ public:
 	void bindTextureForSampling(int textureIndex, GLenum textureUnit);
 	void unbindTexture(GLenum textureUnit);
 
+	// 0 if the FBO was made without depth
+	unsigned int getDepthTexture() { return depthTexHandle; }
+
 	void destroy();
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "FrameArena.h"
+
+namespace TTK
+{
+	class MeshBase;
+	class SkinnedMesh;
+}
+
+// One object to draw, with everything the GL thread needs copied out of its GameObject
+struct DrawItem
+{
+	TTK::MeshBase* mesh;
+	glm::mat4 modelMatrix;	// local to world, already interpolated
+	glm::vec4 colour;
+	int textureLayer;
+};
+
+// A skinned mesh to pose before drawing
+// Skinning writes into the mesh's VBO, so it happens on the GL thread
+struct SkinUpdate
+{
+	SkinUpdate(FrameArena* arena = nullptr) : mesh(nullptr), jointTransforms(ArenaAllocator<glm::mat4>(arena)) {}
+
+	TTK::SkinnedMesh* mesh;
+	FrameVector<glm::mat4> jointTransforms;	// model space, already interpolated
+};
+
+// Everything needed to render one frame
+// Built by the frame prep thread and only read by the GL thread after that,
+// so the GL thread never touches game objects while the simulation is running
+//
+// The lists live in the packet's arena, which is emptied when the packet is rebuilt
+struct FramePacket
+{
+	FramePacket()
+		: frameNumber(0),
+		arena(256 * 1024),
+		drawItems(ArenaAllocator<DrawItem>(&arena)),
+		skinUpdates(ArenaAllocator<SkinUpdate>(&arena))
+	{}
+
+	// Empties the lists and the arena, ready to build the next frame
+	// The lists get room for as many items as last time, so they don't grow bit by bit
+	void reset()
+	{
+		size_t numDrawItems = drawItems.size();
+		size_t numSkinUpdates = skinUpdates.size();
+
+		// Let go of the old storage before the arena hands it out again
+		FrameVector<DrawItem>(ArenaAllocator<DrawItem>(&arena)).swap(drawItems);
+		FrameVector<SkinUpdate>(ArenaAllocator<SkinUpdate>(&arena)).swap(skinUpdates);
+
+		arena.reset();
+
+		drawItems.reserve(numDrawItems);
+		skinUpdates.reserve(numSkinUpdates);
+	}
+
+	unsigned int frameNumber;
+	FrameArena arena;
+	FrameVector<DrawItem> drawItems;
+	FrameVector<SkinUpdate> skinUpdates;
+	glm::vec4 lightPos;		// world space
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "FramePacket.h"
+
+// Runs the simulation and builds the next frame on its own thread
+// while the GL thread submits the current one
+//
+//	Frame:		N			N+1			N+2
+//	Prep thread:	build N+1	build N+2	build N+3
+//	GL thread:	draw N		draw N+1	draw N+2
+//
+// On a multi-core machine a frame then takes about max(prep, submit) instead of prep + submit.
+// The cost is one frame of extra latency between simulating and showing a frame.
+//
+// The prepare function is the only thing allowed to change the game objects while the pipeline runs.
+// The GL thread should only read the packet returned by beginFrame().
+class FramePipeline
+{
+public:
+	// Fills in a packet for the next frame, dt is the time since the last frame
+	typedef std::function<void(FramePacket& packet, float dt)> PrepareFunction;
+
+	FramePipeline();
+	~FramePipeline();
+
+	// threaded = false runs prepare on the GL thread inside beginFrame(), for comparisons
+	void start(PrepareFunction _prepare, bool _threaded = true);
+
+	// Waits for the prep thread and releases the fences, call with the GL context current
+	void stop();
+
+	// Call on the GL thread at the start of a frame
+	// Waits until the packet prepared last frame is done, starts preparing the
+	// next one and returns the packet to draw this frame
+	const FramePacket& beginFrame(float dt);
+
+	// Call on the GL thread once the frame's GL commands have been issued
+	void endFrame();
+
+	bool isThreaded();
+
+	// How many frames the GPU can fall behind before beginFrame() waits for it
+	// Without a limit the driver can queue up several frames, adding latency
+	// At most MAX_FRAME_FENCES - 1
+	int maxFramesInFlight;
+
+	static const int MAX_FRAME_FENCES = 8;
+
+private:
+	void prepLoop();
+	void waitForGPU();
+
+	// Empties a packet's lists and arena, then fills it in with prepare
+	void buildPacket(FramePacket& packet, float dt);
+
+	PrepareFunction prepare;
+	bool threaded;
+
+	// Double buffered, one is drawn while the other is built
+	FramePacket packets[2];
+	int drawIndex;
+	unsigned int numFramesPrepared;
+	bool primed;	// the first packet has been built
+
+	std::thread prepThread;
+	std::mutex prepMutex;
+	std::condition_variable prepCondition;
+	bool prepRequested;	// the GL thread asked for a packet
+	bool prepFinished;	// the prep thread finished it
+	bool stopPrep;
+	float prepDeltaTime;
+
+	// One fence per frame the GPU may still be working on, oldest first
+	// A fixed ring rather than a deque, so queuing a fence never allocates
+	GLsync frameFences[MAX_FRAME_FENCES];
+	int firstFence;
+	int numFences;
+};
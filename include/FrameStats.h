@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+// Keeps the most recent frame times and summarizes them
+// Averages hide stutter, so this also reports the "1% low" and "0.1% low":
+// the average of the slowest 1% (or 0.1%) of frames. A steady frame rate has
+// lows close to the average, a stuttering one does not.
+class FrameStats
+{
+public:
+	FrameStats(unsigned int _maxFrames = 5000);
+
+	// Adds a frame time in milliseconds, the oldest frame is dropped once maxFrames are stored
+	void addFrame(double frameTimeMS);
+	void reset();
+
+	unsigned int getNumFrames();
+
+	double getAverage();
+	double getMin();
+	double getMax();
+	double getMedian();
+
+	// Average frame time of the slowest fraction of frames
+	// ie. getLow(0.01) is the 1% low, getLow(0.001) is the 0.1% low
+	double getLow(double fraction);
+
+	// Prints frame times and their frame rates on one line
+	void print(const std::string& label);
+
+private:
+	// Copy of the frame times sorted slowest first
+	std::vector<double> getSortedFrames();
+
+	std::vector<double> frameTimes;
+	unsigned int maxFrames;
+	unsigned int nextFrame;	// where the next frame goes once the buffer is full
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The six planes that bound what a camera can see
+//
+// Built from a view projection matrix (ie. TTK::Camera::viewProjMatrix), so the planes are in
+// world space and objects can be tested with their world space bounds.
+// Each plane is (normal, distance) with the normal pointing into the frustum, so a point p is
+// on the inside of a plane when dot(normal, p) + distance >= 0.
+class Frustum
+{
+public:
+	// NEAR and FAR on their own are macros in windows.h
+	enum Planes
+	{
+		PLANE_LEFT = 0,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		NUM_PLANES
+	};
+
+	Frustum();
+	Frustum(const glm::mat4& viewProj);
+
+	// Pulls the planes out of the rows of the matrix
+	void extract(const glm::mat4& viewProj);
+
+	// False only if the sphere is completely outside one of the planes
+	// Conservative: a sphere near a corner can be outside the frustum and still pass
+	bool intersectsSphere(const glm::vec3& centre, float radius) const;
+
+	// Planes as vec4(normal, distance), normalized so distances are in world units
+	glm::vec4 planes[NUM_PLANES];
+};
+
+// A bounding sphere moved into world space, xyz is the centre and w the radius
+// The radius is scaled by the matrix's largest axis, so it still covers the mesh if the scale isn't uniform
+glm::vec4 transformBoundingSphere(const glm::mat4& modelMatrix, const glm::vec4& sphere);
@@ -1,8 +1,9 @@
 #pragma once
 
-#include <GLM/glm.hpp>
-#include <GLM\gtx\transform.hpp>
-#include <GLM\gtc\type_ptr.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <vector>
 #include <string>
 #include <TTK/OBJMesh.h>
@@ -12,6 +13,8 @@
 #include <map>
 
 #include "Material.h"
+#include "FramePacket.h"
+#include "Asset.h"
 
 class GameObject
 {
@@ -23,16 +26,32 @@ protected:
 	glm::vec3 m_pLocalPosition;
 	glm::mat4 m_pLocalRotation;
 
+	// Set by setRotation(), used instead of the angles (ie. by animations)
+	glm::quat m_pRotation;
+	bool m_pUseRotationQuat;
+
 	glm::mat4 m_pLocalTransformMatrix;
 	glm::mat4 m_pLocalToWorldMatrix;
 
+	// State at the start of the last simulation step, used to interpolate between steps
+	glm::vec3 m_pPreviousPosition;
+	glm::quat m_pPreviousRotation;
+	float m_pPreviousScale;
+
+	// Transform used for drawing, in between the previous and current state
+	glm::mat4 m_pRenderMatrix;
+
 	// Forward Kinematics
 	GameObject* m_pParent;
 	std::vector<GameObject*> m_pChildren;
 
+	// Assets the object can't be drawn without, see addDependency()
+	std::vector<std::shared_ptr<const Asset>> m_pDependencies;
+	bool m_pLoaded; // every dependency was ready last time they were checked
+
 public:
 	GameObject();
-	GameObject(glm::vec3 position, std::shared_ptr<TTK::OBJMesh> _mesh, std::shared_ptr<Material> _material);
+	GameObject(glm::vec3 position, std::shared_ptr<TTK::MeshBase> _mesh, std::shared_ptr<Material> _material);
 	~GameObject();
 
 	void setPosition(glm::vec3 newPosition);
@@ -41,11 +60,40 @@ public:
 	void setRotationAngleZ(float newAngle);
 	void setScale(float newScale);
 
+	// Sets the rotation directly instead of with angles, until an angle is set again
+	void setRotation(glm::quat newRotation);
+
 	glm::mat4 getLocalToWorldMatrix();
 
+	// The interpolated transform the object is drawn with
+	glm::mat4 getRenderMatrix();
+
 	virtual void update(float dt);	
 	virtual void draw(TTK::Camera &camera);
 
+	// Interpolation
+	// The simulation runs at a fixed rate which doesn't match the frame rate, so objects are
+	// drawn part way between the previous and current simulation step
+	// Call storePreviousState() before each step and interpolate() before drawing
+	// (both on root nodes, they handle the children)
+	void storePreviousState();
+	void interpolate(float alpha); // 0 = previous step, 1 = current step
+
+	// Adds this object and its children to a frame's draw list, using the interpolated transform
+	// Objects without a mesh (ie. joints) or still loading are skipped, but their children aren't
+	void gatherDrawItems(FrameVector<DrawItem>& drawItems);
+
+	// Loading
+	// An object can be created before its assets are loaded (see AssetManager). It's updated
+	// like any other object, but isn't drawn until every asset it depends on is ready.
+	void addDependency(std::shared_ptr<const Asset> asset);
+
+	template <typename T>
+	void addDependency(const AssetHandle<T>& handle) { addDependency(handle.getAsset()); }
+
+	// True once every dependency is ready (always true for objects without any)
+	bool isLoaded();
+
 	// Forward Kinematics
 	// Pass in null to make game object a root node
 	void setParent(GameObject* newParent);
@@ -54,11 +102,19 @@ public:
 	glm::vec3 getWorldPosition();
 	glm::mat4 getWorldRotation();
 	bool isRoot();
+	GameObject* getParent();
+	const std::vector<GameObject*>& getChildren();
 
 	// Other Properties
 	std::string name;
 	glm::vec4 colour; 
 
-	std::shared_ptr<TTK::OBJMesh> mesh;
+	// Layer of the scene texture array this object samples, -1 for untextured
+	// Sent as a uniform instead of binding a texture, so objects with
+	// different textures don't change any texture state between draws
+	int textureLayer;
+
+	// Can be null for objects that are never drawn (ie. the joints of a skinned mesh)
+	std::shared_ptr<TTK::MeshBase> mesh;
 	std::shared_ptr<Material> material;
 };
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Creates an OpenGL context without a window
+// Used to run the renderer on machines with no display or GPU (ie. build servers),
+// with Mesa's software rasterizer (llvmpipe) doing the rendering.
+//
+// One of these must be defined when building to enable it:
+// USE_EGL_HEADLESS		- EGL with the surfaceless platform (EGL_MESA_platform_surfaceless), link with -lEGL
+// USE_OSMESA_HEADLESS	- Off screen Mesa, link with -lOSMesa
+//
+// Since there is no window, render into a FrameBufferObject.
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	// Creates the context and makes it current
+	// Returns false if it could not be created (or headless support was not built in)
+	bool create(int glMajorVersion = 4, int glMinorVersion = 5);
+
+	void destroy();
+
+	// Which API created the context
+	std::string getBackendName();
+
+private:
+	// Kept as void* so this header does not depend on EGL or OSMesa headers
+	void* display;
+	void* context;
+
+	// OSMesa needs a buffer to make the context current, even though we draw to an FBO
+	std::vector<unsigned char> osmesaBuffer;
+};
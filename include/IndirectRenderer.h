@@ -0,0 +1,229 @@
+#pragma once
+
+#include "GLEW/glew.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+
+#include "MeshBuffer.h"
+#include "StreamingBuffer.h"
+#include "FramePacket.h"
+#include "Frustum.h"
+#include "DepthPyramid.h"
+#include "ShaderProgram.h"
+
+// The layout glMultiDrawElementsIndirect reads each draw from
+struct DrawElementsIndirectCommand
+{
+	GLuint count;			// indices
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;	// we use it as the draw's index into the per draw data
+};
+
+// What the vertex shader needs for one draw, instead of setting uniforms before it
+// Matches the DrawData struct in the shaders (std430 layout)
+struct IndirectDrawData
+{
+	glm::mat4 modelMatrix;
+	glm::vec4 colour;
+
+	// The mesh's MeshRange::positionOffset and positionScale (w unused),
+	// the vertex shader turns the quantized positions back into model space with them
+	glm::vec4 positionOffset;
+	glm::vec4 positionScale;
+
+	int textureLayer;
+	int padding[3];
+};
+
+// Draws a whole frame packet with one glMultiDrawElementsIndirect call per pass
+//
+// Drawing objects one at a time costs a handful of uniform uploads, a VAO bind and a draw
+// call each, so the CPU time grows with the number of objects. Here every static mesh lives
+// in one MeshBuffer and each object becomes a DrawElementsIndirectCommand plus an
+// IndirectDrawData in GPU buffers. Both are written once a frame (by build()), and every
+// pass after that is a single call no matter how many objects there are.
+//
+// The shader finds its draw's data through a per instance attribute (DRAW_ID) holding 0, 1, 2...
+// Each command's baseInstance is its draw index, so instance 0 of draw i reads DRAW_ID i.
+// (gl_DrawID would do the same but needs GLSL 4.60 or GL_ARB_shader_draw_parameters)
+// Shaders opt in with USE_INDIRECT, see default_v.glsl.
+//
+// Items whose mesh isn't in the mesh buffer (ie. skinned meshes, which change every frame)
+// are listed by getSkippedItems() so they can still be drawn the usual way.
+//
+// Culling
+// build() can also drop the commands the camera can't see, by testing each one's bounding sphere:
+//	CULL_CPU: against the frustum on the CPU, only the visible commands are written
+//	CULL_GPU: in a compute shader (cull_c.glsl), which compacts the visible commands into
+//			  another buffer and counts them with an atomic counter. The draw then uses
+//			  glMultiDrawElementsIndirectCount so the count never comes back to the CPU.
+//			  Given a depth pyramid of the last frame it also drops commands hidden behind
+//			  what was drawn there (one frame late, objects that just came into view
+//			  from behind something can be missing for a frame).
+// Both use the same spheres and frustum planes, so they keep the same commands
+// (readBackVisibleCommands() is there to check that).
+//
+// Meshlets
+// With culling on, meshes made of more than one meshlet (see Meshlet.h) get a command per
+// meshlet instead of one for the whole mesh, so the parts of a big mesh that are off screen
+// are dropped too. Meshlets whose normal cone faces away from the camera are kept apart:
+// draw() skips them unless asked for back faces (ie. for outlines drawn with back face lines).
+//
+// Usage:
+//	renderer.create();
+//	renderer.getMeshBuffer().addMesh(mesh);		// once per static mesh
+//	renderer.build(packet, Frustum(camera.viewProjMatrix), camera.cameraPosition);	// once a frame
+//	shader->bind(); ... renderer.draw();		// once per pass
+class IndirectRenderer
+{
+public:
+	enum CullMode
+	{
+		CULL_NONE,
+		CULL_CPU,
+		CULL_GPU,
+		NUM_CULL_MODES
+	};
+
+	IndirectRenderer();
+	~IndirectRenderer();
+
+	// True if the driver has multi-draw indirect, base instance and shader storage buffers (GL 4.3)
+	static bool isSupported();
+
+	// maxDraws is only a starting point, it grows if a frame has more items
+	bool create(unsigned int _maxDraws = 1024);
+	void destroy();
+
+	bool isCreated() { return drawIdBuffer != 0; }
+
+	MeshBuffer& getMeshBuffer() { return meshBuffer; }
+
+	// cullShader is cull_c.glsl, CULL_GPU falls back to CULL_CPU without it
+	// It has to be compiled with USE_COUNT_BUFFER if hasCountBuffer() is true
+	void setCullShader(std::shared_ptr<ShaderProgram> _cullShader);
+
+	// True if the driver has glMultiDrawElementsIndirectCount (GL_ARB_indirect_parameters)
+	// Without it GPU culling hides draws by setting their instance count to 0 instead of compacting them
+	static bool hasCountBuffer();
+
+	void setCullMode(CullMode mode) { cullMode = mode; }
+	CullMode getCullMode() { return cullMode; }
+	static const char* getCullModeName(CullMode mode);
+
+	// Splits meshes into meshlets when culling (on by default)
+	void setMeshletCulling(bool enabled) { meshletCulling = enabled; }
+	bool getMeshletCulling() { return meshletCulling; }
+
+	// GPU culling also tests against this (null to turn it off)
+	// Build it at the end of each frame, the next frame's culling reads it
+	void setDepthPyramid(DepthPyramid* _depthPyramid) { depthPyramid = _depthPyramid; }
+
+	// Writes the commands and per draw data for every item in the packet whose mesh is in the mesh buffer
+	// and culls them against the frustum and camera position (unless the cull mode is CULL_NONE)
+	// Call on the GL thread once a frame, before the passes that draw it
+	void build(const FramePacket& packet, const Frustum& frustum, const glm::vec3& cameraPosition);
+
+	// Draws everything build() kept, with whatever shader is bound
+	// includeBackFacing also draws the meshlets that face away from the camera
+	// The shader has to be a USE_INDIRECT variant
+	void draw(bool includeBackFacing = false);
+
+	// Indices of the packet's draw items that weren't in the mesh buffer, draw these one at a time
+	const std::vector<unsigned int>& getSkippedItems() { return skippedItems; }
+
+	// Items build() found in the mesh buffer
+	unsigned int getNumDraws() { return numDraws; }
+
+	// Every command of the last build() before culling, one per draw or meshlet
+	const std::vector<DrawElementsIndirectCommand>& getCommands() { return drawCommands; }
+
+	// Finds the commands of the last build() whose bounds touch the frustum, ie. what CULL_CPU keeps
+	// Those whose meshlet faces away from the camera go in outBackFacing
+	// Both are indices into getCommands(), in order
+	void findVisibleCommands(const Frustum& frustum, const glm::vec3& cameraPosition,
+		std::vector<unsigned int>& outFrontFacing, std::vector<unsigned int>& outBackFacing);
+
+	// Reads the commands the GPU kept in the last build() with CULL_GPU, sorted
+	// Waits for the GPU, so only use it for testing
+	void readBackVisibleCommands(std::vector<unsigned int>& outFrontFacing, std::vector<unsigned int>& outBackFacing);
+
+private:
+	IndirectRenderer(const IndirectRenderer&);
+	IndirectRenderer& operator=(const IndirectRenderer&);
+
+	// (Re)creates the per frame buffers and the draw id attribute for _maxDraws draws
+	void resize(unsigned int _maxDraws);
+
+	// Runs cull_c.glsl over the commands, bounds and cones build() wrote
+	void cullOnGPU(const Frustum& frustum, const glm::vec3& cameraPosition);
+
+	MeshBuffer meshBuffer;
+
+	// Rewritten every frame, so they're streamed like dynamic vertex data
+	StreamingBuffer commandBuffer;
+	StreamingBuffer drawDataBuffer;
+
+	// World space bounding spheres and normal cones, read by the cull shader
+	StreamingBuffer boundsBuffer;
+	StreamingBuffer coneBuffer;
+
+	// 0, 1, 2... read per instance as the DRAW_ID attribute
+	GLuint drawIdBuffer;
+
+	// Written by the cull shader: the visible commands and how many there are
+	// Front facing ones are in the first half and back facing ones in the second,
+	// with a count for each
+	GLuint culledCommandBuffer;
+	GLuint drawCountBuffer;
+
+	// maxDraws is the size of the per draw and per command buffers
+	unsigned int maxDraws;
+	unsigned int numDraws;
+
+	// Commands written for draw(), the first numFrontFacing of them face the camera
+	// (with CULL_GPU that's every command before culling)
+	unsigned int numCommands;
+	unsigned int numFrontFacing;
+
+	CullMode cullMode;
+	bool meshletCulling;
+	std::shared_ptr<ShaderProgram> cullShader;
+	DepthPyramid* depthPyramid;
+
+	// Uniform locations in cull_c.glsl, looked up again whenever the program (re)links
+	// so culling doesn't build uniform names every frame
+	struct CullUniforms
+	{
+		GLuint program;
+		GLint numDraws;
+		GLint backFacingOffset;
+		GLint frustumPlanes;
+		GLint cameraPosition;
+		GLint occlusion;
+		GLint depthPyramid;
+		GLint pyramidView;
+		GLint pyramidProj;
+	};
+	CullUniforms cullUniforms;
+
+	void findCullUniforms();
+
+	// True when the last build() culled on the GPU, draw() reads the culled commands then
+	bool culledOnGPU;
+
+	// The packet item of each draw
+	std::vector<unsigned int> drawItemIndices;
+
+	// Every command of the last build() before culling, kept for the CPU culler
+	std::vector<DrawElementsIndirectCommand> drawCommands;
+	std::vector<glm::vec4> commandBounds;
+	std::vector<glm::vec4> commandCones;
+
+	std::vector<unsigned int> visibleCommands;
+	std::vector<unsigned int> backFacingCommands;
+	std::vector<unsigned int> skippedItems;
+};
@@ -7,27 +7,41 @@ class Material
 public:
 	std::shared_ptr<ShaderProgram> shader;
 
+	// The same shader compiled with USE_INDIRECT, for drawing a whole scene with an IndirectRenderer
+	// Null if the material can only draw one object at a time
+	std::shared_ptr<ShaderProgram> indirectShader;
+
+	// True if back faces show up when drawing with this material (ie. outlines drawn as back face lines)
+	// Otherwise the IndirectRenderer leaves out meshlets that face away from the camera
+	bool drawsBackFaces;
+
 	std::map<std::string, glm::vec4> vec4Uniforms;
 	std::map<std::string, glm::mat4> mat4Uniforms;
 	std::map<std::string, int> intUniforms;
 	// maps for other uniform types ...
 
 	Material()
-		: shader(std::make_shared<ShaderProgram>())
+		: shader(std::make_shared<ShaderProgram>()), drawsBackFaces(false)
 	{}
 
 	void sendUniforms()
+	{
+		sendUniforms(*shader);
+	}
+
+	// Sends the uniforms to another program (ie. indirectShader), which must be bound
+	void sendUniforms(ShaderProgram& program)
 	{
 		// Send vector4 uniforms
 		for (auto itr = vec4Uniforms.begin(); itr != vec4Uniforms.end(); itr++)
-			shader->sendUniformVec4(itr->first, itr->second);
+			program.sendUniformVec4(itr->first, itr->second);
 
 		// Send mat4 uniforms
 		for (auto itr = mat4Uniforms.begin(); itr != mat4Uniforms.end(); itr++)
-			shader->sendUniformMat4(itr->first, itr->second);
+			program.sendUniformMat4(itr->first, itr->second);
 
 		// Send int uniforms
 		for (auto itr = intUniforms.begin(); itr != intUniforms.end(); itr++)
-			shader->sendUniformInt(itr->first, itr->second);
+			program.sendUniformInt(itr->first, itr->second);
 	}
 };
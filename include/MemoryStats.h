@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+// Counts heap allocations (every call to new and delete, from any thread)
+// Used to check that a steady frame doesn't touch the heap: allocating is slow,
+// can take a lock shared with every other thread, and scatters memory around.
+//
+// Usage:
+//	MemoryStats::endFrame();	// once per frame
+//	MemoryStats::print("frame");	// allocations per frame since the last reset
+//
+// Counting is done by replacing the global operator new and delete (in MemoryStats.cpp),
+// so allocations made with malloc() directly (ie. by C libraries or the driver) aren't seen.
+class MemoryStats
+{
+public:
+	// Totals since the program started
+	static unsigned long long getNumAllocations();
+	static unsigned long long getNumFrees();
+	static unsigned long long getBytesAllocated();
+
+	// Allocations currently alive
+	static long long getNumLiveAllocations();
+
+	// Ends a frame, counting the allocations made since the last endFrame()
+	static void endFrame();
+
+	// Doesn't count the allocations made since the last endFrame() towards the next frame,
+	// for debug work done between frames (ie. reading back results to validate them)
+	static void skipAllocations();
+
+	// Allocations made during the last finished frame
+	static unsigned long long getLastFrameAllocations();
+
+	// Forgets the per frame history, ie. once loading is over
+	static void resetFrameStats();
+
+	// Prints allocations per frame (average and worst) since the last reset
+	static void print(const std::string& label);
+
+private:
+	static unsigned long long frameStartAllocations;
+	static unsigned long long lastFrameAllocations;
+	static unsigned long long maxFrameAllocations;
+	static unsigned long long totalFrameAllocations;
+	static unsigned int numFrames;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "GLEW/glew.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "RangeAllocator.h"
+#include "Meshlet.h"
+#include "MeshCodec.h"
+
+namespace TTK
+{
+	class MeshBase;
+}
+
+// Where a mesh's data is in a MeshBuffer
+// Indices are relative to baseVertex, so they can be passed straight to a draw's baseVertex
+struct MeshRange
+{
+	unsigned int firstIndex;
+	unsigned int numIndices;
+	unsigned int baseVertex;
+	unsigned int numVertices;
+
+	// Encloses every vertex, xyz is the centre and w the radius (model space)
+	glm::vec4 boundingSphere;
+
+	// Turns the quantized positions back into model space, see QuantizedMesh
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+
+	// The mesh's indices split into clusters that can be culled on their own
+	// Their firstIndex is relative to the range's firstIndex
+	std::vector<Meshlet> meshlets;
+};
+
+// One big vertex buffer and one big index buffer shared by many static meshes
+//
+// Every mesh in it uses the same VAO, so drawing a different mesh is just a different
+// range of the buffers. That's what lets a whole scene go out in one multi-draw call
+// (see IndirectRenderer), instead of binding each mesh's own VBO in turn.
+//
+// Space in the buffers is handed out by a RangeAllocator, so meshes can be removed and
+// replaced (ie. when reloaded). If a mesh doesn't fit, the buffers grow to twice their size.
+//
+// TTK meshes are triangle soups (three vertices per triangle, no indices), so adding one
+// quantizes it (see MeshCodec.h), which merges identical vertices and builds an index list for it.
+// The indices are then put in meshlet order (see Meshlet.h), so any piece of the mesh can be
+// drawn on its own.
+//
+// Vertices are QuantizedVertex, half the size of a float vertex. Positions are stored relative to
+// each mesh's bounding box, so the vertex shader needs the mesh's positionOffset and positionScale
+// (IndirectRenderer puts them in the per draw data).
+class MeshBuffer
+{
+public:
+	MeshBuffer();
+	~MeshBuffer();
+
+	// Capacities are in vertices and indices
+	void create(unsigned int _vertexCapacity = 65536, unsigned int _indexCapacity = 3 * 65536);
+	void destroy();
+
+	// Copies a mesh's vertices into the buffers
+	// A mesh loaded cooked (see OBJMesh::parseCookedMesh) is copied as it was decoded, others are quantized first
+	// Only for meshes whose vertices don't change, dynamic (ie. skinned) meshes should be drawn on their own
+	// Returns false if the mesh is already in the buffer or has no vertices
+	bool addMesh(const TTK::MeshBase* mesh);
+
+	// Frees the mesh's space for other meshes
+	void removeMesh(const TTK::MeshBase* mesh);
+
+	// Copies the mesh in again, ie. after it was reloaded
+	bool updateMesh(const TTK::MeshBase* mesh);
+
+	// Null if the mesh isn't in the buffer
+	const MeshRange* getRange(const TTK::MeshBase* mesh) const;
+
+	// Binds the VAO, which also binds the index buffer
+	void bind();
+	void unbind();
+
+	unsigned int getNumMeshes() const { return (unsigned int)ranges.size(); }
+	unsigned int getNumVertices() const { return vertexSpace.getNumUsed(); }
+	unsigned int getNumIndices() const { return indexSpace.getNumUsed(); }
+
+private:
+	MeshBuffer(const MeshBuffer&);
+	MeshBuffer& operator=(const MeshBuffer&);
+
+	// Makes a buffer bigger, keeping its contents
+	void growBuffer(GLuint& buffer, unsigned int oldSize, unsigned int newSize);
+
+	// Points the VAO at the vertex and index buffers, again after they grow
+	void setAttributePointers();
+
+	GLuint vaoHandle;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+
+	RangeAllocator vertexSpace;
+	RangeAllocator indexSpace;
+
+	std::unordered_map<const TTK::MeshBase*, MeshRange> ranges;
+};
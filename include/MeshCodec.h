@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace TTK
+{
+	class MeshBase;
+}
+
+// A vertex packed into 16 bytes instead of 32 (3 floats position, 3 floats normal, 2 floats uv)
+//	- position: 16 bits per axis across the mesh's bounding box, so the step size is
+//	  1/65535 of the mesh's size whatever its units are
+//	- normal: octahedral encoded (see encodeOctahedral) in 2 x 16 bits
+//	- uv: half floats, which keep uvs outside [0, 1] (ie. tiled textures) unlike 16 bit fixed point
+// Matches the vertex attributes MeshBuffer sets up, the vertex shaders turn it back into floats.
+struct QuantizedVertex
+{
+	glm::u16vec3 position;	// 0 to 65535 across the bounding box
+	unsigned short padding;	// keeps the normal 4 byte aligned, always 0
+	glm::i16vec2 normal;	// -32767 to 32767
+	glm::u16vec2 uv;		// half floats
+};
+
+// An indexed mesh made of QuantizedVertex
+struct QuantizedMesh
+{
+	// A position is positionOffset + position / 65535 * positionScale
+	// (the bounding box's min corner and size)
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+
+	std::vector<QuantizedVertex> vertices;
+	std::vector<unsigned int> indices;
+
+	// A vertex turned back into floats
+	glm::vec3 getPosition(unsigned int vertex) const;
+	glm::vec3 getNormal(unsigned int vertex) const;
+	glm::vec2 getUV(unsigned int vertex) const;
+};
+
+// Quantizes a TTK mesh (a triangle soup) and merges the vertices that come out the same
+// A mesh without normals gets (0, 0, 1), octahedral encoding can't store a zero normal
+void quantizeMesh(const TTK::MeshBase& mesh, QuantizedMesh& outMesh);
+
+// Renumbers the vertices in the order the indices first use them
+// Vertices used close together end up close together in memory (better for the vertex cache),
+// and the cooked format stores an index that's the next new vertex in a single byte.
+void reorderVertices(QuantizedMesh& mesh);
+
+// Octahedral normal encoding ("A Survey of Efficient Representations for Independent Unit Vectors", Cigolle et al.)
+// The unit sphere is projected onto an octahedron, whose lower half is folded over the upper half
+// to make a square. That spreads the precision evenly over every direction, unlike storing x and y
+// and rebuilding z, and 16 bits per side is under 0.01 degrees of error.
+glm::i16vec2 encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const glm::i16vec2& encoded);
+
+// Cooked meshes
+// A QuantizedMesh stored so it loads without parsing text, quantizing or merging vertices.
+// The codec is lossless: decoding gives back exactly the vertices and indices that were encoded.
+//	- vertices: each value is stored as the difference from the same value in the vertex before,
+//	  neighbouring vertices are close together, so most differences fit in one or two bytes
+//	- indices: stored relative to the next vertex no index has used yet, in first use order
+//	  (see reorderVertices) that's 0 for a new vertex and small for one used recently
+// Every number is a varint: 7 bits per byte, the top bit set if more bytes follow.
+void encodeMesh(const QuantizedMesh& mesh, std::vector<unsigned char>& outData);
+
+// Returns false if the data isn't a cooked mesh or is cut short
+bool decodeMesh(const unsigned char* data, size_t size, QuantizedMesh& outMesh);
+
+// Where an OBJ's cooked mesh is stored, the same name ending in ".mesh" (ie. "Models/sphere.mesh")
+// --make-pack puts one in the pack for every OBJ, AssetManager::loadMesh loads it when it's there
+std::string getCookedMeshName(const std::string& objFileName);
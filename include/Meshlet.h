@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// A small cluster of a mesh's triangles that can be culled on its own
+//
+// A whole mesh is almost never entirely off screen or facing away from the camera, but
+// the pieces of it often are. Splitting a mesh into clusters of neighbouring triangles
+// lets the renderer drop the pieces it can't see:
+//	- boundingSphere: against the frustum (and depth), like whole objects
+//	- cone: all the cluster's triangles face roughly the same way, so if the camera is
+//	  behind every one of them the whole cluster faces away and can be skipped
+//
+// A cluster is a contiguous range of the mesh's indices, so drawing one is just a draw
+// command with a different firstIndex and count.
+struct Meshlet
+{
+	unsigned int firstIndex;	// relative to the mesh's first index
+	unsigned int numIndices;
+
+	// Encloses the cluster's vertices, xyz is the centre and w the radius (model space)
+	glm::vec4 boundingSphere;
+
+	// xyz is the average triangle normal and w the cutoff, see isConeBackFacing()
+	// A cone that can't cull anything has a zero axis
+	glm::vec4 cone;
+};
+
+// Splits an indexed triangle list into meshlets
+// The indices are reordered so each meshlet's triangles are next to each other
+// Triangles are added to a meshlet by how many of their vertices it already has,
+// so a meshlet grows out from its first triangle over the surface
+void buildMeshlets(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices,
+	std::vector<Meshlet>& outMeshlets, unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
+
+// A cone moved into world space
+// Cones can't be moved by a non uniform scale or a mirror (the angles change), those get a cone that culls nothing
+glm::vec4 transformCone(const glm::mat4& modelMatrix, const glm::vec4& cone);
+
+// True if every triangle in the cluster faces away from the camera
+// sphere and cone have to be in the same space as the camera position
+bool isConeBackFacing(const glm::vec4& cone, const glm::vec4& sphere, const glm::vec3& cameraPosition);
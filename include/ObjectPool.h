@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// Refers to an object in an ObjectPool
+// The generation goes up every time a slot is reused, so a handle to a destroyed
+// object can be told apart from a handle to whatever took its place
+struct PoolHandle
+{
+	PoolHandle() : index(0xFFFFFFFF), generation(0) {}
+	PoolHandle(unsigned int _index, unsigned int _generation) : index(_index), generation(_generation) {}
+
+	bool operator==(const PoolHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const PoolHandle& other) const { return !(*this == other); }
+
+	unsigned int index;
+	unsigned int generation;
+};
+
+// Keeps objects of one type together in big blocks instead of scattered across the heap
+//
+// Objects never move once created, so plain pointers to them stay valid until they are destroyed.
+// Destroyed slots go on a free list and are reused by the next create(), so once the pool
+// has grown to fit the scene creating and destroying objects doesn't touch the heap.
+//
+// Usage:
+//	ObjectPool<GameObject> pool;
+//	PoolHandle handle = pool.create(position, mesh, material);
+//	GameObject* object = pool.get(handle);	// null once the object is destroyed
+//	pool.destroy(handle);
+template <typename T, unsigned int BLOCK_SIZE = 256>
+class ObjectPool
+{
+public:
+	ObjectPool() : firstFree(NO_SLOT), numAlive(0) {}
+
+	~ObjectPool()
+	{
+		clear();
+	}
+
+	template <typename... Args>
+	PoolHandle create(Args&&... args)
+	{
+		if (firstFree == NO_SLOT)
+			addBlock();
+
+		unsigned int index = firstFree;
+		Slot& slot = getSlot(index);
+		firstFree = slot.nextFree;
+
+		new (&slot.storage) T(std::forward<Args>(args)...);
+		slot.alive = true;
+		numAlive++;
+
+		return PoolHandle(index, slot.generation);
+	}
+
+	// Destroys the object, does nothing if the handle is stale
+	void destroy(PoolHandle handle)
+	{
+		T* object = get(handle);
+		if (!object)
+			return;
+
+		object->~T();
+
+		Slot& slot = getSlot(handle.index);
+		slot.alive = false;
+		slot.generation++;
+		slot.nextFree = firstFree;
+		firstFree = handle.index;
+		numAlive--;
+	}
+
+	// Null if the handle was never valid or its object has been destroyed
+	T* get(PoolHandle handle) const
+	{
+		if (handle.index >= blocks.size() * BLOCK_SIZE)
+			return nullptr;
+
+		Slot& slot = getSlot(handle.index);
+		if (!slot.alive || slot.generation != handle.generation)
+			return nullptr;
+
+		return reinterpret_cast<T*>(&slot.storage);
+	}
+
+	// Destroys every object, the memory is kept for reuse
+	void clear()
+	{
+		firstFree = NO_SLOT;
+
+		// Rebuild the free list back to front so slots are handed out in order again
+		for (unsigned int i = (unsigned int)(blocks.size() * BLOCK_SIZE); i-- > 0;)
+		{
+			Slot& slot = getSlot(i);
+
+			if (slot.alive)
+			{
+				reinterpret_cast<T*>(&slot.storage)->~T();
+				slot.alive = false;
+				slot.generation++;
+			}
+
+			slot.nextFree = firstFree;
+			firstFree = i;
+		}
+
+		numAlive = 0;
+	}
+
+	unsigned int getNumAlive() const { return numAlive; }
+	unsigned int getCapacity() const { return (unsigned int)(blocks.size() * BLOCK_SIZE); }
+
+private:
+	static const unsigned int NO_SLOT = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		unsigned int generation;
+		unsigned int nextFree;
+		bool alive;
+	};
+
+	Slot& getSlot(unsigned int index) const
+	{
+		return blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+	}
+
+	// Blocks are never moved or freed (until the pool is), that's what keeps pointers stable
+	void addBlock()
+	{
+		unsigned int firstIndex = (unsigned int)(blocks.size() * BLOCK_SIZE);
+		blocks.push_back(std::unique_ptr<Slot[]>(new Slot[BLOCK_SIZE]));
+
+		Slot* block = blocks.back().get();
+		for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+		{
+			block[i].generation = 0;
+			block[i].alive = false;
+			block[i].nextFree = i + 1 < BLOCK_SIZE ? firstIndex + i + 1 : firstFree;
+		}
+
+		firstFree = firstIndex;
+	}
+
+	std::vector<std::unique_ptr<Slot[]>> blocks;
+	unsigned int firstFree;
+	unsigned int numAlive;
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+
+// Frame-time profiler
+// Times nested CPU scopes with a high resolution clock and GPU scopes with timer queries,
+// so you can see where each frame's milliseconds are going.
+//
+// Usage:
+//	Profiler::beginFrame();
+//	{
+//		PROFILE_SCOPE("update");		// CPU only
+//		updateScene();
+//	}
+//	{
+//		PROFILE_GPU_SCOPE("render");	// CPU and GPU
+//		drawScene(camera);
+//	}
+//	Profiler::endFrame();
+//
+// CPU scopes can be used from any thread. GPU scopes must be used on the thread that owns
+// the OpenGL context. Finished scopes go into a ring buffer which can be written out with
+// exportChromeTrace() and opened in chrome://tracing (or https://ui.perfetto.dev).
+class Profiler
+{
+public:
+	struct Event
+	{
+		const char* name;		// must be a string literal (or otherwise outlive the profiler)
+		long long startUS;		// microseconds since the profiler started
+		long long durationUS;
+		int depth;				// how many scopes this one is nested in
+		int thread;				// small id for the thread, GPU events use GPU_THREAD
+		unsigned int frame;		// the GL thread's frame when the scope ended (ie. the prep thread's work is tagged with the frame it overlapped)
+	};
+
+	static const int GPU_THREAD = 1000;
+
+	// Starts and ends a frame, call once each per frame on the GL thread
+	// beginFrame() collects GPU results from previous frames without waiting for the GPU
+	static void beginFrame();
+	static void endFrame();
+
+	// Records a CPU scope that started at start and ends now
+	static void addCPUEvent(const char* name, std::chrono::high_resolution_clock::time_point start, int depth);
+
+	// Issues timestamp queries around a GPU scope
+	// Returns the index of the scope so it can be ended
+	static int beginGPU(const char* name);
+	static void endGPU(int index);
+
+	// Writes every event in the ring buffer as Chrome trace event json
+	static bool exportChromeTrace(const std::string& fileName);
+
+	// Prints the scopes of the most recent complete frame as a tree
+	static void printLastFrame();
+
+	// Copies the events of a frame out of the ring buffer
+	static std::vector<Event> getFrameEvents(unsigned int frame);
+
+	static unsigned int getFrameNumber();
+
+	// Turns collection on and off, scopes cost almost nothing while disabled
+	// Atomic, like currentFrame: scopes on every thread read it while the GL thread may change it
+	static std::atomic<bool> enabled;
+
+	// Nesting depth of the CPU scopes on the current thread
+	static int& threadDepth();
+
+private:
+	static const int MAX_EVENTS = 1 << 16;
+	// GPU results are read this many frames later, so we never wait for them
+	// More than the GPU can fall behind (FramePipeline::maxFramesInFlight, at most MAX_FRAME_FENCES - 1),
+	// otherwise a slot often comes around before its queries are done and the frame's GPU times are dropped
+	static const int NUM_QUERY_FRAMES = 8;
+
+	struct GPUScope
+	{
+		const char* name;
+		int depth;
+		GLuint startQuery, endQuery;
+		bool ended;
+	};
+
+	struct QueryFrame
+	{
+		QueryFrame() : frame(0), numUsed(0), cpuStartUS(0) {}
+
+		unsigned int frame;
+		std::vector<GPUScope> scopes;
+		std::vector<GLuint> queryPool;	// grows as needed, queries are reused every time this slot comes around
+		unsigned int numUsed;
+		long long cpuStartUS;			// used to line the GPU events up with the CPU ones
+	};
+
+	static void pushEvent(const Event& e);
+	static void collectGPUResults(QueryFrame& queryFrame);
+	static GLuint getQuery(QueryFrame& queryFrame);
+	static long long toMicroseconds(std::chrono::high_resolution_clock::time_point t);
+	static int getThreadID();
+
+	static std::chrono::high_resolution_clock::time_point startTime;
+	static std::mutex eventMutex;
+	static std::vector<Event> events;	// ring buffer
+	static unsigned int numEventsWritten;
+	static std::atomic<unsigned int> currentFrame;
+
+	static QueryFrame queryFrames[NUM_QUERY_FRAMES];
+	static int gpuDepth;
+};
+
+// Times the enclosing block on the CPU
+class ProfileScope
+{
+public:
+	ProfileScope(const char* _name);
+	~ProfileScope();
+
+private:
+	const char* name;
+	std::chrono::high_resolution_clock::time_point start;
+	int depth;
+};
+
+// Times the enclosing block on both the CPU and the GPU
+class GPUProfileScope
+{
+public:
+	GPUProfileScope(const char* _name);
+	~GPUProfileScope();
+
+private:
+	ProfileScope cpuScope;
+	int gpuIndex;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GPUProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+// Hands out ranges of a fixed size space (ie. vertices or indices in a big shared buffer)
+//
+// Free space is kept as a sorted list of ranges. allocate() takes the first one that fits
+// (first fit), free() puts the range back and merges it with its neighbours so the space
+// doesn't break up into lots of little gaps.
+//
+// It only does the bookkeeping, the memory itself lives wherever the owner keeps it.
+//
+// Usage:
+//	RangeAllocator vertices(65536);
+//	unsigned int first;
+//	if (vertices.allocate(numVertices, first))
+//		... copy the vertices to buffer[first] ...
+//	vertices.free(first, numVertices);
+class RangeAllocator
+{
+public:
+	RangeAllocator(unsigned int _capacity = 0);
+
+	// Forgets every allocation, the whole space is free again
+	void reset(unsigned int _capacity);
+
+	// Finds size free units, returns false if no free range is big enough
+	bool allocate(unsigned int size, unsigned int& outOffset);
+
+	// Gives back a range returned by allocate()
+	void free(unsigned int offset, unsigned int size);
+
+	// Adds space to the end, ie. after the owner made its buffer bigger
+	void grow(unsigned int newCapacity);
+
+	unsigned int getCapacity() const { return capacity; }
+	unsigned int getNumUsed() const { return used; }
+
+	// Size of the biggest allocation that would succeed right now
+	unsigned int getLargestFree() const;
+
+private:
+	struct Range
+	{
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	// Sorted by offset, neighbouring ranges are always merged
+	std::vector<Range> freeRanges;
+
+	unsigned int capacity;
+	unsigned int used;
+};
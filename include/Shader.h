@@ -7,6 +7,8 @@ class Shader
 private:
 	unsigned int handle;
 	GLenum shaderType;
+	std::string sourceFile;
+	std::string sourceDefines;
 
 public:
 
@@ -24,9 +26,42 @@ public:
 	~Shader();
 
 	// Returns shader handle
-	unsigned int loadShaderFromFile(std::string fileName, GLenum type);
+	// Submits the shader and then waits for the compile result
+	// defines is optional extra code (ie. "#define USE_RIM\n") inserted after the #version line
+	unsigned int loadShaderFromFile(std::string fileName, GLenum type, const std::string& defines = "");
+
+	// Batched compilation
+	// submitShaderFromFile() hands the source to the driver and returns right away,
+	// the compile status is not queried. Submit every shader first, then call
+	// checkCompileStatus() on each of them so the compiles overlap.
+	// Returns the shader handle, or 0 if the file could not be loaded
+	unsigned int submitShaderFromFile(std::string fileName, GLenum type, const std::string& defines = "");
+
+	// Same as above with the file's contents already loaded (ie. on a loading thread)
+	// fileName is remembered so the shader can still be hot reloaded
+	unsigned int submitShaderFromSource(const std::string& source, const std::string& fileName, GLenum type, const std::string& defines = "");
+
+	// Returns true once the driver has finished compiling (never blocks)
+	// Without GL_ARB_parallel_shader_compile this always returns true
+	bool isCompileComplete();
+
+	// Blocks until the compile is done and prints the log if it failed
+	// Returns the shader handle on success, 0 on failure
+	unsigned int checkCompileStatus();
+
+	// Lets the driver compile and link on its own threads when
+	// GL_ARB_parallel_shader_compile (KHR_parallel_shader_compile) is available.
+	// Call once after glewInit()
+	static bool enableParallelCompile();
 
 	unsigned int getHandle() { return handle; }
+	GLenum getType() { return shaderType; }
+	const std::string& getFileName() { return sourceFile; }
+	const std::string& getDefines() { return sourceDefines; }
+
+	// Inserts defines into the shader source right after the #version line
+	// (#version must be the first thing in a shader, so we can't just prepend)
+	static std::string injectDefines(const std::string& source, const std::string& defines);
 
 	void destroy();
-};
\ No newline at end of file
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ShaderProgram.h"
+#include <map>
+#include <memory>
+#include <vector>
+#include <string>
+
+// Builds specialized versions (permutations) of a single shader source
+// Instead of one big shader that branches on uniforms at runtime (an "uber shader"),
+// each combination of features is compiled as its own program with the
+// features turned on through #defines. The GLSL uses #ifdef to strip the unused code out.
+//
+// Variants are only compiled the first time they are asked for and are
+// cached by their feature bitmask after that.
+class ShaderPermutations
+{
+public:
+	ShaderPermutations();
+	~ShaderPermutations();
+
+	void setVertexShader(const std::string& fileName);
+	void setFragmentShader(const std::string& fileName);
+
+	// Registers a feature, ie. addFeature("USE_RIM")
+	// Returns the bit for this feature, combine bits with | to build a feature mask
+	unsigned int addFeature(const std::string& defineName);
+
+	// Returns the program compiled with the features in featureMask turned on
+	// Compiles and links it if this is the first time it is used
+	std::shared_ptr<ShaderProgram> getVariant(unsigned int featureMask);
+
+	// Recompiles every variant built so far (used for hot reloading)
+	void reloadAll();
+
+	// Returns the "#define ..." block for a feature mask
+	std::string buildDefines(unsigned int featureMask);
+
+	unsigned int getNumVariants() { return variants.size(); }
+
+private:
+	std::string vertexFile;
+	std::string fragmentFile;
+
+	std::vector<std::string> featureNames;
+	std::map<unsigned int, std::shared_ptr<ShaderProgram>> variants;
+};
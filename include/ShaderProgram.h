@@ -1,7 +1,8 @@
 #pragma once
 
 #include "Shader.h"
-#include <glm\matrix.hpp>
+#include <vector>
+#include <glm/matrix.hpp>
 #include "GLEW/glew.h"
 
 class ShaderProgram
@@ -11,8 +12,35 @@ public:
 	~ShaderProgram();
 
 	// Initialization functions
-	void attachShader(Shader shader);
+	// Note: shader is passed by reference, a copy would delete the shader in its destructor
+	void attachShader(Shader& shader);
+
+	// Links the program and waits for the result
+	// Returns the program handle on success, 0 on failure
 	int linkProgram();
+
+	// Batched linking (see Shader::submitShaderFromFile)
+	// submitLink() starts the link without waiting for it, checkLinkStatus()
+	// waits for the result and prints the log if it failed
+	void submitLink();
+	int checkLinkStatus();
+
+	// Returns true once the driver has finished linking (never blocks)
+	bool isLinkComplete();
+
+	// True once checkLinkStatus() has seen the program link (ie. it's safe to draw with)
+	// A program that's still loading, or failed to, isn't linked
+	bool isLinked() { return linked; }
+
+	// Hot reloading
+	// Recompiles every attached shader from its source file and relinks.
+	// The new program only replaces the old handle if everything compiled and
+	// linked, otherwise the old program keeps running. Materials share this object,
+	// so they all pick up the new handle without having to be rebuilt.
+	bool reload();
+
+	// Returns the file names of the attached shaders
+	std::vector<std::string> getSourceFiles();
 	
 	// Usage functions
 	void bind();
@@ -32,16 +60,29 @@ public:
 	// Must have to apply the MVP transform
 	void sendUniformMat4(const std::string& uniformName, glm::mat4& mat4);
 
+	// All uniforms have a constant location
+	// This function searches for the uniform name (as written in the shader)
+	// and returns that location. If name is not found, it returns -1
+	// Note: This is a pretty slow operation and you do not want to be
+	// calling this every frame. Look the locations up once (ie. when the program
+	// links, see getHandle()) and pass them to glUniform* yourself
+	int getUniformLocation(const std::string& uniformName);
+
+	// Changes when the program is reloaded, so cached uniform locations can be looked up again
+	unsigned int getHandle() { return handle; }
+
 	void destroy();
 
 private:
 	unsigned int handle;
+	bool linked;
 
-	// All uniforms have a constant location
-	// This function searches for the uniform name (as written in the shader)
-	// and returns that location. If name is not found, it returns 0
-	// Note: This is a pretty slow operation and you do not want to be
-	// calling this every frame. Set up a system, such as a std::map which caches
-	// the location and used the string name as a key
-	int getUniformLocation(const std::string& uniformName);
+	// Where each attached shader came from, needed to reload it
+	struct ShaderSource
+	{
+		std::string fileName;
+		std::string defines;
+		GLenum type;
+	};
+	std::vector<ShaderSource> sources;
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "GLEW/glew.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <memory>
+
+#include "ShaderProgram.h"
+#include "StreamingBuffer.h"
+#include "TTK/TextureAtlas.h"
+
+// One sprite as the GPU sees it, 32 bytes
+// sprite_v.glsl turns each one into a quad, so there are no vertices to write
+struct SpriteInstance
+{
+	glm::vec2 position;		// centre
+	glm::vec2 size;
+	glm::u16vec4 uvs;		// uvMin then uvMax, 0 to 65535
+	glm::u8vec4 colour;		// multiplies the texture
+	float rotation;			// radians, anticlockwise
+};
+
+// Draws lots of 2D sprites with as few draw calls as possible
+//
+// QuadMesh draws one sprite per draw call (and usually a texture bind). Here every sprite
+// is written straight into a StreamingBuffer as a SpriteInstance, and the whole batch is
+// drawn with one instanced draw of a 4 vertex triangle strip.
+// The batch only has to be drawn early (flushed) when the texture changes or the buffer is
+// full, so sprites should come from a TextureAtlas.
+//
+// Usage:
+//	spriteBatch.begin(glm::ortho(0.0f, (float)windowWidth, 0.0f, (float)windowHeight));
+//	for (each sprite)
+//		spriteBatch.draw(atlas.id(), atlas.getRegion(sprite.image), sprite.position, sprite.size);
+//	spriteBatch.end();
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+	~SpriteBatch();
+
+	// Room for maxSprites per flush (in each of the streaming buffer's regions)
+	bool create(unsigned int _maxSprites = 100000);
+	void destroy();
+
+	bool isCreated() { return vaoHandle != 0; }
+
+	// shader is sprite_v.glsl and sprite_f.glsl, nothing is drawn until it's set
+	void setShader(std::shared_ptr<ShaderProgram> _shader);
+
+	// Starts a batch, the sprites are drawn in the order they're given
+	// They're alpha blended over what's already drawn, without depth testing
+	void begin(const glm::mat4& _viewProj);
+
+	// Description:
+	// Adds a sprite to the batch
+	// texture is the atlas the region is in, a different texture than the last sprite's flushes the batch
+	void draw(GLuint texture, const TTK::AtlasRegion& region, const glm::vec2& position, const glm::vec2& size,
+		const glm::vec4& colour = glm::vec4(1.0f), float rotation = 0.0f)
+	{
+		if (texture != currentTexture || numSprites == maxSprites)
+		{
+			flush();
+			currentTexture = texture;
+		}
+
+		if (writeCursor)
+			writeSprite(writeCursor[numSprites++], region, position, size, colour, rotation);
+	}
+
+	// Description:
+	// Adds sprites that are already filled in (ie. by writeSprite), all from the same texture
+	void drawInstances(GLuint texture, const SpriteInstance* instances, unsigned int count);
+
+	// Draws what's left in the batch
+	void end();
+
+	// Fills in a sprite, what draw() writes to the buffer
+	static void writeSprite(SpriteInstance& out, const TTK::AtlasRegion& region, const glm::vec2& position,
+		const glm::vec2& size, const glm::vec4& colour, float rotation)
+	{
+		out.position = position;
+		out.size = size;
+		out.uvs = glm::u16vec4(region.uvMin.x * 65535.0f + 0.5f, region.uvMin.y * 65535.0f + 0.5f,
+			region.uvMax.x * 65535.0f + 0.5f, region.uvMax.y * 65535.0f + 0.5f);
+		out.colour = glm::u8vec4(glm::clamp(colour, 0.0f, 1.0f) * 255.0f + 0.5f);
+		out.rotation = rotation;
+	}
+
+	// Stats for the last batch
+	unsigned int getNumSpritesDrawn() { return numSpritesDrawn; }
+	unsigned int getNumDrawCalls() { return numDrawCalls; }
+
+private:
+	SpriteBatch(const SpriteBatch&);
+	SpriteBatch& operator=(const SpriteBatch&);
+
+	// Draws the sprites written so far and starts writing the next region
+	void flush();
+	void drawSprites();
+
+	std::shared_ptr<ShaderProgram> shader;
+	StreamingBuffer instanceBuffer;
+	GLuint vaoHandle;
+
+	unsigned int maxSprites;
+	glm::mat4 viewProj;
+
+	// Where the current region is mapped (or its CPU copy), null when not in a batch
+	SpriteInstance* writeCursor;
+	unsigned int numSprites;
+	GLuint currentTexture;
+
+	unsigned int numSpritesDrawn;
+	unsigned int numDrawCalls;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "GLEW/glew.h"
+#include <vector>
+
+// A buffer for data that changes every frame (ie. animated vertices)
+//
+// The buffer is split into regions (three by default). Each frame we write to the next region
+// while the GPU may still be reading the previous ones, so writing never waits on the GPU.
+// A fence is placed after the draws that read a region, and we only wait on it when we come
+// back around to that region, which is normally long done by then.
+//
+// The buffer is created with glBufferStorage and mapped once, persistently and coherently,
+// so an update is just a memcpy into the mapped pointer. There are no glBufferData calls
+// that reallocate the buffer, and no glMapBuffer calls that can make the driver sync.
+//
+// If GL_ARB_buffer_storage isn't supported, writes go to a CPU copy and are uploaded
+// with glBufferSubData in endWrite().
+class StreamingBuffer
+{
+public:
+	StreamingBuffer();
+	~StreamingBuffer();
+
+	// Creates a buffer of numRegions regions, each regionSize bytes
+	// Leaves the buffer bound to target
+	bool create(unsigned int _regionSize, unsigned int _numRegions = 3, GLenum _target = GL_ARRAY_BUFFER);
+
+	void destroy();
+
+	// Moves to the next region and returns a pointer to write it
+	// Waits if the GPU is still reading that region
+	void* beginWrite();
+
+	// Call once you are done writing the region
+	void endWrite();
+
+	// Call after issuing the draws that read the current region
+	// Calling this more than once for a region only keeps the last fence
+	void fenceRegion();
+
+	// Byte offset of the current region from the start of the buffer
+	// Use this as the offset when pointing attributes or draws at the buffer
+	unsigned int getRegionOffset();
+
+	unsigned int getRegionSize();
+	unsigned int getCurrentRegion();
+	GLuint getHandle();
+
+	// True if the buffer is persistently mapped (false when using the fallback)
+	bool isPersistent();
+
+	// Number of times beginWrite() had to wait for the GPU
+	unsigned int getNumStalls();
+
+private:
+	GLuint handle;
+	GLenum target;
+	unsigned char* mappedData;
+	unsigned int regionSize;
+	unsigned int numRegions;
+	unsigned int currentRegion;
+	unsigned int numStalls;
+	bool persistent;
+
+	// One fence per region, 0 if the region isn't in use by the GPU
+	std::vector<GLsync> regionFences;
+
+	// CPU copy of a region when the buffer can't be persistently mapped
+	std::vector<unsigned char> fallbackData;
+};
@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Reads many files at once
+//
+// Reading files one after another leaves the disk idle between reads: each one waits for
+// the last to finish before asking for more. A BatchReader asks for every file up front, so
+// the disk (an SSD most of all) has a full queue of reads to work through.
+//
+// On Linux the reads go through io_uring: one system call submits a batch of reads into
+// buffers registered with the kernel once, and the finished reads are collected from a
+// ring in shared memory. Everywhere else (or if the kernel doesn't allow io_uring) a few
+// threads each do blocking reads.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "TTK/IO.h"
+
+namespace TTK
+{
+	namespace IO
+	{
+		// Usage:
+		//	BatchReader reader;
+		//	reader.create();
+		//	for (...)
+		//		reader.read(fileName, [](const std::string& fileName, bool succeeded, FileView& file) { ... });
+		//	reader.submit();
+		//	reader.waitForAll();	// or poll() every frame
+		//
+		// A reader is used by one thread, the callbacks are called on it from poll(), wait() and waitForAll().
+		// Files in a mounted pack are opened from the pack instead, they never go to the disk.
+		class BatchReader
+		{
+		public:
+			// Called once a file has been read (or couldn't be), the view can be moved out of
+			typedef std::function<void(const std::string& fileName, bool succeeded, FileView& file)> ReadCallback;
+
+			BatchReader();
+			~BatchReader();
+
+			// Description:
+			// queueDepth	- how many reads are in flight at once
+			// bufferSize	- size of each registered buffer (there's one per read in flight), files up to
+			//				  this size are read into one and copied out, bigger files are read straight
+			//				  into their own memory
+			// Falls back to threads if io_uring can't be used
+			void create(unsigned int queueDepth = 32, size_t bufferSize = 256 * 1024);
+
+			// Waits for the reads in flight, their callbacks (and those of queued reads) aren't called
+			void destroy();
+
+			// Queues a read, nothing is read until submit()
+			void read(const std::string& fileName, ReadCallback onRead);
+
+			// Starts the queued reads, as many as fit in the queue (the rest start as others finish)
+			void submit();
+
+			// Calls the callbacks of the reads that have finished, returns how many there were
+			unsigned int poll();
+
+			// Same as poll(), but first waits for a read to finish if none have
+			unsigned int wait();
+
+			// Calls wait() until every read has finished
+			void waitForAll();
+
+			// Reads queued or in flight whose callbacks haven't been called yet
+			unsigned int getNumPending() const { return numPending; }
+
+			bool isUsingIoUring() const { return ring != nullptr; }
+
+		private:
+			BatchReader(const BatchReader&);
+			BatchReader& operator=(const BatchReader&);
+
+			struct Read
+			{
+				std::string fileName;
+				ReadCallback onRead;
+				FileView file;
+				bool succeeded;
+
+				// io_uring only
+				int descriptor;
+				size_t size;
+				size_t offset;	// bytes read so far
+				std::shared_ptr<std::vector<unsigned char>> buffer;	// null while reading into a registered buffer
+			};
+
+			// The io_uring rings and registered buffers (Linux only)
+			struct Ring;
+
+			// io_uring
+			void startReads();	// gives submitted reads the free slots
+			void openRead(unsigned int slot);
+			void readNextChunk(unsigned int slot);
+			void reapReads(bool waitForOne);
+			void finishRead(unsigned int slot, bool succeeded);
+
+			// Fallback threads
+			void readerLoop();
+
+			// Adds a read to the finished list, its callback is called by the next poll()
+			void complete(std::shared_ptr<Read> read);
+
+			Ring* ring;
+			std::vector<std::shared_ptr<Read>> inFlight;	// by slot, a slot is also the read's registered buffer
+			std::vector<unsigned int> freeSlots;
+
+			std::deque<std::shared_ptr<Read>> queued;		// waiting for submit()
+			std::deque<std::shared_ptr<Read>> submitted;	// waiting for a free slot (or reader thread)
+
+			std::vector<std::thread> readers;
+			bool stopReaders;
+
+			std::mutex readMutex;	// for submitted, completed and stopReaders
+			std::condition_variable readerCondition;	// reader threads wait here for reads
+			std::condition_variable completedCondition;	// wait() waits here for a reader thread to finish one
+			std::deque<std::shared_ptr<Read>> completed;
+
+			unsigned int numPending;
+		};
+	}
+}
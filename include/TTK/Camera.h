@@ -13,8 +13,8 @@
 
 #include <glm/vec3.hpp>
 #include <GLEW/glew.h>
-#include <GLM/gtc/matrix_transform.hpp>
-#include <GLM/gtx/rotate_vector.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/rotate_vector.hpp>
 
 namespace TTK
 {
@@ -0,0 +1,167 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Lines, points, boxes and text for debugging, batched
+//
+// Anything can be added at any point in the frame (between begin() and end()),
+// it's only written to a list. end() draws every line in one draw call and
+// every label and 2D point in another, so a thousand gizmos cost about the
+// same as one.
+//
+// Text uses a small built-in stroke font. Its glyphs are stored as a signed
+// distance field (how far each texel is from the edge of the letter) rather
+// than as coverage, so the text stays sharp at any size and gets a dark
+// outline for free, which keeps it readable over the scene.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include "ShaderProgram.h"
+#include "StreamingBuffer.h"
+#include "SpriteBatch.h"
+#include "TTK/TextureAtlas.h"
+
+namespace TTK
+{
+	class MeshBase;
+
+	// Usage:
+	//	debugDraw.begin(camera.viewProjMatrix, glm::vec2(windowWidth, windowHeight));
+	//	debugDraw.addBox(boundsMin, boundsMax, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+	//	debugDraw.addText3D("player", playerPosition);
+	//	debugDraw.addText("fps: 60", glm::vec2(10.0f, windowHeight - 20.0f));
+	//	...
+	//	debugDraw.end();
+	class DebugDraw
+	{
+	public:
+		DebugDraw();
+		~DebugDraw();
+
+		// Room for maxLineVertices and maxGlyphs (text characters and 2D points) a frame,
+		// anything past that is dropped (without create() there's room for the defaults)
+		bool create(unsigned int _maxLineVertices = 200000, unsigned int _maxGlyphs = 50000);
+		void destroy();
+
+		bool isCreated() { return lineVAO != 0; }
+
+		// lineShader is debugLine_v.glsl and debugLine_f.glsl
+		// textShader is sprite_v.glsl and debugText_f.glsl
+		// Nothing is drawn until they're set
+		void setLineShader(std::shared_ptr<ShaderProgram> shader);
+		void setTextShader(std::shared_ptr<ShaderProgram> shader);
+
+		// Starts a frame and empties the lists
+		// viewProj places the 3D shapes and labels, screenSize is the window in pixels
+		// Everything up to end() is CPU only, so it works without create() (ie. in benchmarks)
+		void begin(const glm::mat4& _viewProj, const glm::vec2& _screenSize);
+
+		// 3D, in world space
+		void addLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& colour);
+
+		// Three lines size long crossing at the point
+		void addPoint(const glm::vec3& position, float size, const glm::vec4& colour);
+
+		// A box's 12 edges, the box is moved by transform (ie. a model matrix) if it has one
+		void addBox(const glm::vec3& min, const glm::vec3& max, const glm::vec4& colour, const glm::mat4& transform = glm::mat4(1.0f));
+
+		// A circle around each axis
+		void addSphere(const glm::vec3& centre, float radius, const glm::vec4& colour);
+
+		// The transform's x, y and z axes in red, green and blue
+		void addAxes(const glm::mat4& transform, float size = 1.0f);
+
+		// Every triangle (or quad) edge of a mesh, ie. to see a mesh without its shader
+		void addWireframe(const MeshBase& mesh, const glm::mat4& transform, const glm::vec4& colour);
+
+		// 2D, in pixels from the bottom left of the window
+		// A round dot size pixels across
+		void addPoint2D(const glm::vec2& position, float size, const glm::vec4& colour);
+
+		// Description:
+		// Adds a line (or lines) of text
+		// position is the left end of the first line's baseline, size is the height of a line in pixels
+		void addText(const std::string& text, const glm::vec2& position, float size = 16.0f, const glm::vec4& colour = glm::vec4(1.0f));
+
+		// Same as above, starting where a world space point is on screen
+		// Skipped if the point is behind the camera
+		void addText3D(const std::string& text, const glm::vec3& position, float size = 16.0f, const glm::vec4& colour = glm::vec4(1.0f));
+
+		// Width and height of text in pixels, for lining it up
+		glm::vec2 measureText(const std::string& text, float size = 16.0f) const;
+
+		// Draws everything added since begin(), GL thread only
+		void end();
+
+		// Stats for the last frame
+		unsigned int getNumLineVertices() { return numLineVertices; }
+		unsigned int getNumGlyphs() { return numGlyphs; }
+		unsigned int getNumDrawCalls() { return numDrawCalls; }
+		unsigned int getNumDropped() { return numDropped; }
+
+	private:
+		DebugDraw(const DebugDraw&);
+		DebugDraw& operator=(const DebugDraw&);
+
+		// 16 bytes, same layout as the inputs of debugLine_v.glsl
+		struct LineVertex
+		{
+			glm::vec3 position;
+			glm::u8vec4 colour;
+		};
+
+		// Where a glyph is in the font texture, and where its quad goes from the pen (in font units)
+		struct Glyph
+		{
+			AtlasRegion region;
+			glm::vec2 offset;
+			glm::vec2 size;
+		};
+
+		// Works out the distance field of every glyph and packs them into fontPixels
+		void buildFont();
+
+		// Makes room for count line vertices, returns null (and counts them as dropped) if there isn't any
+		LineVertex* addLineVertices(unsigned int count);
+
+		void drawLines();
+
+		std::shared_ptr<ShaderProgram> lineShader;
+		StreamingBuffer lineBuffer;
+		GLuint lineVAO;
+
+		// Glyphs are sprites drawn with an SDF shader
+		SpriteBatch textBatch;
+
+		unsigned int maxLineVertices;
+		unsigned int maxGlyphs;
+
+		glm::mat4 viewProj;
+		glm::vec2 screenSize;
+
+		// Room for the most a frame can have, only the first numLineVertices and numGlyphs are used
+		std::vector<LineVertex> lineVertices;
+		std::vector<SpriteInstance> glyphInstances;
+		unsigned int numLineVertices;
+		unsigned int numGlyphs;
+
+		// ' ' to '~', then the dot used for 2D points
+		std::vector<Glyph> glyphs;
+		std::vector<unsigned char> fontPixels;
+		unsigned int fontWidth, fontHeight;
+		GLuint fontTexture;
+
+		unsigned int numDrawCalls;
+		unsigned int numDropped;
+	};
+}
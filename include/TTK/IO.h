@@ -10,12 +10,106 @@
 
 #pragma once
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
 
 namespace TTK
 {
 	namespace IO
 	{
 		// Loads the specified text file from disk and returns a copy of it in a std::string
+		// Files in a mounted pack are read from the pack instead
 		std::string loadFile(std::string fileName);
+
+		// A file mapped read only into memory
+		// The OS pages it in as it's read, so opening one costs the same however big it is
+		class MappedFile
+		{
+		public:
+			MappedFile();
+			~MappedFile();
+
+			bool open(const std::string& fileName);
+			void close();
+
+			bool isOpen() const { return bytes != nullptr; }
+			const unsigned char* data() const { return bytes; }
+			size_t size() const { return numBytes; }
+
+		private:
+			MappedFile(const MappedFile&);
+			MappedFile& operator=(const MappedFile&);
+
+			const unsigned char* bytes;
+			size_t numBytes;
+
+			// Platform handles (file and mapping on Windows, descriptor on everything else)
+			void* fileHandle;
+			void* mappingHandle;
+		};
+
+		// The bytes of a file opened with openFile()
+		// Points straight into a pack's mapping if the file is stored uncompressed in a mounted pack,
+		// otherwise it holds its own copy (decompressed, or read from disk). Either way the bytes
+		// stay valid as long as the view does, even if the pack is unmounted.
+		class FileView
+		{
+		public:
+			FileView() : bytes(nullptr), numBytes(0), zeroCopy(false) {}
+
+			const unsigned char* data() const { return bytes; }
+			size_t size() const { return numBytes; }
+
+			const unsigned char* begin() const { return bytes; }
+			const unsigned char* end() const { return bytes + numBytes; }
+			const unsigned char& operator[](size_t i) const { return bytes[i]; }
+
+			// True if the bytes weren't copied
+			bool isZeroCopy() const { return zeroCopy; }
+
+			void reset() { *this = FileView(); }
+
+		private:
+			friend bool openPackedFile(const std::string& fileName, FileView& outView);
+			friend bool openFile(const std::string& fileName, FileView& outView);
+			friend class BatchReader;
+
+			const unsigned char* bytes;
+			size_t numBytes;
+			bool zeroCopy;
+
+			// Whatever the bytes live in (a pack or a buffer), kept alive by the view
+			std::shared_ptr<const void> owner;
+		};
+
+		// Virtual file system
+		// Files under mountPoint (ie. "../../Assets/") are looked up in the pack first, so a
+		// mounted pack replaces thousands of file opens with one mapping. Packs mounted later
+		// are searched first. Loose files are only read when no pack has the file, so hot
+		// reloading only sees edits to files that aren't packed.
+
+		// Returns false if the pack can't be opened
+		bool mountPack(const std::string& packFileName, const std::string& mountPoint);
+		void unmountAll();
+
+		// Description:
+		// Opens a file from the mounted packs, or from disk if none of them has it
+		// Safe to call from any thread
+		bool openFile(const std::string& fileName, FileView& outView);
+
+		// Same as above, but only looks in the mounted packs (returns false if none of them has the file)
+		bool openPackedFile(const std::string& fileName, FileView& outView);
+
+		// True if a mounted pack or the disk has the file
+		bool fileExists(const std::string& fileName);
+
+		// Description:
+		// Lists every file under a directory (and its subdirectories), relative to it with '/' between names
+		bool listFiles(const std::string& directory, std::vector<std::string>& outFiles);
+
+		// Files opened since the start, from packs and from disk
+		unsigned int getNumPackedOpens();
+		unsigned int getNumDiskOpens();
 	}
-}
\ No newline at end of file
+}
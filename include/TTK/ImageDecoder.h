@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// PNG and JPEG decoding to RGBA8
+// - PNG: every colour type and bit depth, palettes, transparency and interlacing
+//   (16 bit channels are cut to 8 bits). Rows are unfiltered with SSE2.
+// - JPEG: baseline (sequential Huffman) files, greyscale or YCbCr with any chroma
+//   subsampling. The IDCT and colour conversion use SSE2. Progressive JPEGs aren't
+//   supported, they fail to decode.
+//
+// Unlike DevIL there's no global state: a decoder only has its own scratch memory,
+// so any number of threads can decode at once, each with its own decoder.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace TTK
+{
+	enum ImageFileType
+	{
+		IMAGE_FILE_UNKNOWN,
+		IMAGE_FILE_PNG,
+		IMAGE_FILE_JPEG
+	};
+
+	struct ImageInfo
+	{
+		ImageFileType type;
+		unsigned int width;
+		unsigned int height;
+	};
+
+	// Usage:
+	//	ImageDecoder decoder;	// keep it around, its scratch memory is reused
+	//	ImageInfo info;
+	//	if (ImageDecoder::readInfo(data, size, info))
+	//	{
+	//		pixels.resize(info.width * info.height * 4);
+	//		decoder.decode(data, size, &pixels[0], true);
+	//	}
+	class ImageDecoder
+	{
+	public:
+		ImageDecoder();
+
+		// The type of image, from its first bytes rather than the file's extension
+		static ImageFileType getFileType(const unsigned char* data, size_t size);
+
+		// Description:
+		// Reads just the image's header, ie. to get a buffer of the right size to decode into
+		// Returns false if the image isn't a PNG or JPEG, or its header is damaged
+		static bool readInfo(const unsigned char* data, size_t size, ImageInfo& outInfo);
+
+		// Description:
+		// Decodes the image to RGBA8 into pixels, which has to hold width * height * 4 bytes
+		// bottomRowFirst puts the rows in OpenGL's order, otherwise they're in the file's (top row first)
+		// Returns false if the image can't be decoded, see getError() for why
+		bool decode(const unsigned char* data, size_t size, unsigned char* pixels, bool bottomRowFirst);
+
+		// Same as above, resizing pixels to fit (a reused vector keeps its memory)
+		bool decode(const unsigned char* data, size_t size, std::vector<unsigned char>& pixels,
+			unsigned int& outWidth, unsigned int& outHeight, bool bottomRowFirst);
+
+		// Why the last decode failed
+		const char* getError() const { return error; }
+
+	private:
+		static bool readPNGInfo(const unsigned char* data, size_t size, ImageInfo& outInfo);
+		static bool readJPEGInfo(const unsigned char* data, size_t size, ImageInfo& outInfo);
+
+		bool decodePNG(const unsigned char* data, size_t size, unsigned char* pixels, bool bottomRowFirst);
+		bool decodeJPEG(const unsigned char* data, size_t size, unsigned char* pixels, bool bottomRowFirst);
+
+		// Sets the error and returns false
+		bool fail(const char* message);
+
+		const char* error;
+
+		// Scratch memory, kept between decodes
+		std::vector<unsigned char> compressed;	// PNG: the image data joined from its chunks
+		std::vector<unsigned char> filtered;	// PNG: the inflated rows
+		std::vector<unsigned char> row;			// PNG: an interlaced row converted to RGBA, JPEG: upsampled chroma
+		std::vector<unsigned char> planes;		// JPEG: each component's samples for one row of MCUs
+	};
+}
@@ -0,0 +1,33 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// DEFLATE decompression (https://www.ietf.org/rfc/rfc1951.txt), the compression used by zlib
+// and so by PNG images
+// - The input is a list of blocks, each either stored as is or Huffman coded: literal bytes
+//   and copies of earlier output (up to 32 KB back, 3 to 258 bytes long).
+// - Huffman codes up to 10 bits long (nearly all of them) are decoded with one table lookup.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+namespace TTK
+{
+	namespace Inflate
+	{
+		// Description:
+		// Decompresses raw DEFLATE data into exactly outputSize bytes
+		// Returns false if the data is corrupt or doesn't decompress to outputSize bytes,
+		// never reads or writes outside the buffers either way
+		bool decompress(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+
+		// Description:
+		// Same as above for a zlib stream (https://www.ietf.org/rfc/rfc1950.txt), DEFLATE data with
+		// a 2 byte header. The Adler-32 checksum at the end isn't checked.
+		bool decompressZlib(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+	}
+}
@@ -0,0 +1,36 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// LZ4 block compression (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md)
+// - Compressed data is a list of sequences: some literal bytes, then a copy of earlier output
+//   (2 byte offset back, 4+ bytes long). Decompressing is little more than memcpy, so it's
+//   fast enough to do while loading.
+// - Blocks only, no frame header or checksum. The caller stores the sizes (ie. in a pack's TOC).
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+namespace TTK
+{
+	namespace LZ4
+	{
+		// The most bytes compress() can write for inputSize bytes (data that doesn't compress at all)
+		size_t compressBound(size_t inputSize);
+
+		// Description:
+		// Compresses input into output
+		// Returns the compressed size, or 0 if it doesn't fit in outputCapacity
+		size_t compress(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputCapacity);
+
+		// Description:
+		// Decompresses a block made by compress() into exactly outputSize bytes
+		// Returns false if the block is corrupt or doesn't decompress to outputSize bytes,
+		// never reads or writes outside the buffers either way
+		bool decompress(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+	}
+}
@@ -13,9 +13,12 @@
 #define MESH_BASE_H
 
 #include <vector>
-#include "GLM/glm.hpp"
+#include <memory>
+#include "glm/glm.hpp"
 #include "VertexBufferObject.h"
 
+struct QuantizedMesh; // see MeshCodec.h
+
 namespace TTK
 {
 	enum PrimitiveType
@@ -30,6 +33,8 @@ namespace TTK
 		// Description:
 		// Very simple draw function which binds all three buffers
 		// Yes, it uses OpenGL 1.0 draw calls... for now.
+		// To look at a mesh's triangles while debugging, DebugDraw::addWireframe draws
+		// them in one batch with every other debug line instead
 		void draw_1_0();
 
 		// The modern draw function which uses vertex buffer objects!
@@ -39,7 +44,13 @@ namespace TTK
 		// Sets all per-vertex colours to the specified colour
 		void setAllColours(glm::vec4 colour);
 		
-		void createVBO();
+		// Set dynamic to true for meshes whose vertices change while running (ie. animated or skinned meshes)
+		void createVBO(bool dynamic = false);
+
+		// Dynamic meshes only
+		// Sends the current contents of the vertex arrays to the GPU,
+		// the number of vertices must be the same as when the VBO was created
+		void updateVBO();
 
 		std::vector<glm::vec3> vertices;
 		std::vector<glm::vec3> normals;
@@ -48,6 +59,10 @@ namespace TTK
 
 		PrimitiveType primitiveType;
 
+		// Set if the mesh was loaded cooked (see MeshCodec.h), MeshBuffer uploads it as it is
+		// instead of quantizing the vertex arrays again. Null for meshes built any other way.
+		std::shared_ptr<QuantizedMesh> quantized;
+
 		VertexBufferObject vbo;
 	};
 }
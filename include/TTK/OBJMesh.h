@@ -19,5 +19,23 @@ namespace TTK
 	{
 	public:
 		void loadMesh(std::string filename);
+
+		// Fills in the vertex arrays from an OBJ file that's already in memory, without creating the VBO
+		// Doesn't touch OpenGL, so it can run on a loading thread (call createVBO() on the GL thread after)
+		void parseMesh(const std::string& filename, const unsigned char* data, size_t size);
+
+		// Same as above, from a cooked mesh (see MeshCodec.h) instead of the OBJ it was cooked from
+		// filename is the OBJ's, reloadMesh() reads that. Keeps the decoded mesh in quantized,
+		// so a MeshBuffer takes it without quantizing it again.
+		// Returns false if the data isn't a cooked mesh
+		bool parseCookedMesh(const std::string& filename, const unsigned char* data, size_t size);
+
+		// Throws away the current data and loads the mesh again from the same file
+		// Used for hot reloading, the VBO is recreated in place so anything
+		// holding on to this mesh sees the new data
+		void reloadMesh();
+
+	private:
+		std::string sourceFile;
 	};
 }
\ No newline at end of file
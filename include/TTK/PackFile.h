@@ -0,0 +1,142 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Asset packs: many files stored in one, read through a memory mapping
+//
+// Layout (little endian, offsets from the start of the pack):
+//	PackHeader
+//	PackEntry[numEntries]	- the table of contents, at tocOffset (64 byte aligned), sorted by name hash
+//	names					- every entry's name, one after another (not null terminated)
+//	data					- every entry's bytes, each 16 byte aligned, LZ4 compressed or stored as is
+//
+// Nothing is parsed or copied when a pack is opened: the header and TOC are used straight
+// from the mapping, and finding a file is a binary search of the TOC by the hash of its name.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "TTK/IO.h"
+
+namespace TTK
+{
+	struct PackHeader
+	{
+		char magic[4];			// "TPAK"
+		uint32_t version;
+		uint32_t numEntries;
+		uint32_t entrySize;		// sizeof(PackEntry) when the pack was written
+		uint64_t tocOffset;
+		uint64_t namesOffset;
+	};
+
+	enum PackEntryFlags
+	{
+		PACK_ENTRY_LZ4 = 1		// stored LZ4 compressed (see LZ4.h)
+	};
+
+	struct PackEntry
+	{
+		uint64_t nameHash;		// see hashPackName()
+		uint64_t dataOffset;
+		uint32_t nameOffset;	// from the header's namesOffset
+		uint32_t nameLength;
+		uint32_t storedSize;	// bytes in the pack
+		uint32_t size;			// bytes once decompressed
+		uint32_t flags;			// PackEntryFlags
+		uint32_t padding;
+	};
+
+	// FNV-1a (64 bit) of a name, with '\' counted as '/'
+	uint64_t hashPackName(const std::string& name);
+
+	// A pack opened for reading
+	class PackFile
+	{
+	public:
+		PackFile();
+
+		// Maps the pack and checks its header and TOC fit in the file
+		bool open(const std::string& fileName);
+		void close();
+
+		bool isOpen() const { return header != nullptr; }
+
+		// Null if the pack doesn't have the file (names are relative to the packed directory)
+		const PackEntry* findEntry(const std::string& name) const;
+
+		unsigned int getNumEntries() const { return header ? header->numEntries : 0; }
+		const PackEntry& getEntry(unsigned int i) const { return entries[i]; }
+		std::string getEntryName(const PackEntry& entry) const;
+
+		// The entry's bytes as they are in the pack (compressed if PACK_ENTRY_LZ4 is set)
+		const unsigned char* getStoredData(const PackEntry& entry) const { return file.data() + entry.dataOffset; }
+
+		// Description:
+		// Copies the entry's bytes out, decompressing them if needed
+		// Returns false if a compressed entry is corrupt
+		bool readEntry(const PackEntry& entry, std::vector<unsigned char>& out) const;
+
+	private:
+		PackFile(const PackFile&);
+		PackFile& operator=(const PackFile&);
+
+		IO::MappedFile file;
+
+		const PackHeader* header;
+		const PackEntry* entries;
+		const char* names;
+	};
+
+	// Builds a pack
+	// Usage:
+	//	PackWriter writer;
+	//	writer.addDirectory("../../Assets/");
+	//	writer.write("../../Assets/assets.pak");
+	class PackWriter
+	{
+	public:
+		// Description:
+		// Adds a file's bytes under name
+		// With compress, the file is LZ4 compressed if that saves at least an eighth of its size
+		// (files that are already compressed, ie. PNGs, are stored as they are)
+		// Off by default: a stored file opens as a view straight into the mapping, a compressed one
+		// is decompressed into new memory every time it's opened. Only compress big files that are
+		// rarely opened, where the disk space matters more.
+		void addFile(const std::string& name, const unsigned char* data, size_t size, bool compress = false);
+
+		// Description:
+		// Adds every file under a directory, named relative to it
+		// Files ending in one of compressExtensions (ie. ".obj") are compressed, the rest are stored
+		// Files ending in skipExtension (ie. the pack itself) are left out
+		// Returns false if the directory or one of its files can't be read
+		bool addDirectory(const std::string& directory, const std::vector<std::string>& compressExtensions = std::vector<std::string>(),
+			const std::string& skipExtension = ".pak");
+
+		// Returns false if the file can't be written
+		bool write(const std::string& fileName);
+
+		unsigned int getNumFiles() const { return (unsigned int)files.size(); }
+
+		// Totals of the files added so far
+		size_t getTotalSize() const;
+		size_t getTotalStoredSize() const;
+
+	private:
+		struct File
+		{
+			std::string name;
+			std::vector<unsigned char> stored;
+			uint32_t size;
+			uint32_t flags;
+		};
+
+		std::vector<File> files;
+	};
+}
@@ -0,0 +1,35 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// A labelled point that can be picked with the mouse (ie. to drag it around)
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include "glm/glm.hpp"
+
+namespace TTK
+{
+	class DebugDraw;
+}
+
+class PointHandle
+{
+public:
+	PointHandle(float _pointSize, glm::vec3 _position, std::string _label);
+
+	// True if p is within pointSize of the handle
+	bool isInside(glm::vec3 p);
+
+	// Adds the point and its label to debugDraw, so every handle is drawn in the same draw call
+	// position is in pixels from the bottom left of the window (ie. mousePositionFlipped)
+	void draw(TTK::DebugDraw& debugDraw);
+
+	float pointSize;
+	glm::vec3 position;
+	std::string label;
+};
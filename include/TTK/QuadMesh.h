@@ -1,6 +1,7 @@
 #pragma once
 
 #include "TTK/MeshBase.h"
+#include "TTK/TextureAtlas.h"
 
 class QuadMesh : public TTK::MeshBase
 {
@@ -12,4 +13,8 @@ public:
 	void setUVtopLeft(float u, float v);
 	void setUVbottomRight(float u, float v);
 	void setUVtopRight(float u, float v);
+
+	// Sets all four corners to an image in a texture atlas
+	// Note: to draw lots of sprites, SpriteBatch is far faster than a QuadMesh each
+	void setUVs(const TTK::AtlasRegion& region);
 };
\ No newline at end of file
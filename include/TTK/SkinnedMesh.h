@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// A mesh that deforms with a skeleton (linear blend skinning)
+//
+// Every vertex is attached to up to 4 joints with weights that add up to 1.
+// Each frame the vertex is moved by each of its joints' transforms and the
+// results are blended by the weights. The skinning is done on the CPU,
+// split across threads, and the results are written straight into a
+// persistently mapped VBO.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/MeshBase.h"
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+
+class ThreadPool;
+
+namespace TTK
+{
+	// The top 3 rows of a joint's skinning matrix, the only part that's needed
+	// (the bottom row is always 0, 0, 0, 1). Padded to 16 floats so the
+	// first two rows can be loaded together.
+	struct SkinMatrix
+	{
+		float rows[3][4];
+		float padding[4];
+	};
+
+	class SkinnedMesh : public MeshBase
+	{
+	public:
+		SkinnedMesh();
+
+		// Description:
+		// Copies the vertices of another mesh to use as the bind pose
+		// (the pose the mesh is in when every joint has its bind transform)
+		void createFromMesh(const MeshBase& mesh);
+
+		// Description:
+		// Creates the dynamic VBO, call once the joints and weights are set up
+		void createSkinnedVBO();
+
+		// Description:
+		// Moves the vertices to match the joints and sends them to the GPU
+		// jointTransforms are the model space transforms of each joint
+		// Pass a thread pool to split the vertices across threads
+		void skin(const glm::mat4* jointTransforms, unsigned int numJoints, ThreadPool* pool = nullptr);
+
+		// Description:
+		// The skinning kernel, skins vertices [begin, end) of the bind pose into outPositions and outNormals
+		// outPositions and outNormals are indexed from 0 (not begin)
+		// Set useSIMD to false to force the plain C++ version (ie. to compare them)
+		void skinRange(const SkinMatrix* matrices, unsigned int begin, unsigned int end,
+			glm::vec3* outPositions, glm::vec3* outNormals, bool useSIMD = true) const;
+
+		// Description:
+		// Builds the skinning matrices (joint transform * inverse bind matrix) for skinRange()
+		void computeSkinMatrices(const glm::mat4* jointTransforms, unsigned int numJoints, std::vector<SkinMatrix>& skinMatrices) const;
+
+		// True if the SIMD kernel was compiled in (AVX, turned on by /arch:AVX2)
+		static bool hasSIMD();
+
+		// Per vertex, the joints affecting it and how much
+		// Weights should add up to 1, unused slots have a weight of 0
+		std::vector<glm::u16vec4> jointIndices;
+		std::vector<glm::vec4> jointWeights;
+
+		// Per joint, takes a model space position to the joint's space in the bind pose
+		std::vector<glm::mat4> inverseBindMatrices;
+
+		// Number of vertices each thread skins at a time
+		unsigned int chunkSize;
+
+		// Number of vertices skinned in the last call to skin()
+		unsigned int numSkinnedVertices;
+
+	private:
+		std::vector<SkinMatrix> skinMatrices;
+	};
+}
@@ -13,12 +13,17 @@
 #define TEXTURE_2D_H
 
 #include <string>
+#include <vector>
 #include <GLEW/glew.h>
+#include "TTK/TextureFormats.h"
 
 namespace TTK
 {
 	class Texture2D
 	{
+		// The streamer fills in textures loaded in the background
+		friend class TextureStreamer;
+
 	public:
 		Texture2D();
 		Texture2D(std::string filename);
@@ -33,11 +38,15 @@ namespace TTK
 		// file path is relative to the executable.
 		// If createGLTexture is true, the texture data will be sent to vram and a handle will be created
 		// otherwise, only the data will be loaded (accessible with "data")
+		// A full mip chain is generated for the GL texture.
+		// .dds and .ktx files are loaded as block compressed textures (BC1 / BC3 / BC7),
+		// with the mip levels stored in the file.
 		void loadTexture(std::string fileName, bool createGLTexture = true, bool flip = false);
 
 		// Description:
 		// Calling this before drawing will make the mesh being drawn use
 		// this texture, providing the mesh has texture coordinates.
+		// Note: this no longer turns on blending, set the blend state once per pass instead
 		void bind(GLenum textureUnit = GL_TEXTURE0);
 
 		void unbind(GLenum textureUnit = GL_TEXTURE0);
@@ -46,20 +55,83 @@ namespace TTK
 		unsigned int id();
 
 		// Returns pointer to texture data
+		// Only valid if the texture was loaded with createGLTexture = false
 		unsigned char* data();
 
 		int type();
 		int format();
 
+		// Description:
+		// Returns a bindless handle for this texture (GL_ARB_bindless_texture) and makes it resident
+		// The handle can be stored in a buffer or uniform and sampled without ever binding the texture.
+		// Returns 0 if bindless textures are not supported.
+		GLuint64 getBindlessHandle();
+
+		// Returns false while the texture is still being streamed in
+		// (a placeholder texture is bound until then)
+		bool isResident();
+
+		// Description:
+		// Decodes an image file into RGBA8 pixels
+		// The pixels are written to "pixels", which is resized as needed (pass in a
+		// reused buffer to avoid allocating). Safe to call from any thread: PNGs and JPEGs
+		// decode in parallel (see ImageDecoder.h), other files go through DevIL one at a time.
+		// Returns false if the image could not be loaded
+		static bool decodeImage(const std::string& fileName, bool flip, std::vector<unsigned char>& pixels,
+			unsigned int& outWidth, unsigned int& outHeight);
+
+		// Description:
+		// Same as above for an image file that's already in memory
+		// fileName is only used for its extension, which says what type of image it is
+		static bool decodeImage(const std::string& fileName, const unsigned char* data, size_t size, bool flip,
+			std::vector<unsigned char>& pixels, unsigned int& outWidth, unsigned int& outHeight);
+
+		// Description:
+		// Loads any supported texture file into "out", ready for uploading
+		// Compressed files are loaded as is, other images are decoded to RGBA8 and
+		// a mip chain is generated. Safe to call from any thread.
+		static bool loadTextureData(const std::string& fileName, bool flip, TextureData& out);
+
+		// Description:
+		// Writes RGB8 pixels to an image file, the type comes from the extension (ie. .png)
+		// The rows go bottom to top, the way glReadPixels() gives them
+		// DevIL is shared with decodeImage(), so this takes the same lock and is safe from any thread
+		static bool saveImage(const std::string& fileName, const unsigned char* pixels, unsigned int width, unsigned int height);
+
+		// Prints how much video memory textures are using, and how much
+		// mipmapped RGBA8 textures would need instead
+		static void printMemoryReport();
+
 	private:
 		unsigned int texWidth;
 		unsigned int texHeight;
 		GLenum texUnit;
 		unsigned int texID;
-		unsigned char* dataPtr;
+		std::vector<unsigned char> pixelData;
 		int dataType;
 		int pixelFormat;
+
+		// False while a placeholder is in texID, we must not delete that one
+		bool resident;
+
+		GLuint64 bindlessHandle;
+
+		// Creates the GL texture from data and sets texID
+		void createFromTextureData(TextureData& data);
+
+		// Texture memory tracking
+		void trackMemory(TextureData& data);
+		void untrackMemory();
+
+		unsigned int vramBytes;			// bytes this texture uses on the GPU
+		unsigned int rgba8Bytes;		// bytes it would use as RGBA8 with mips
+		unsigned int rgba8NoMipBytes;	// bytes it would use as RGBA8 without mips
+
+		static unsigned int numTrackedTextures;
+		static unsigned long long totalVRAMBytes;
+		static unsigned long long totalRGBA8Bytes;
+		static unsigned long long totalRGBA8NoMipBytes;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
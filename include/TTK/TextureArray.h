@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library. 
+// You may not use this header in your GDW games.
+//
+// An array of same sized textures stored in a single GL_TEXTURE_2D_ARRAY
+//
+// Every layer is sampled through the same binding, so objects using different
+// textures don't need a texture bind between them. Objects just store the
+// index of their layer, which makes it possible to draw them all together.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <GLEW/glew.h>
+#include "TTK/TextureFormats.h"
+
+namespace TTK
+{
+	class TextureArray
+	{
+	public:
+		TextureArray();
+		~TextureArray();
+
+		// Description:
+		// Allocates room for maxLayers RGBA8 layers of width x height, with mipmaps
+		void create(unsigned int width, unsigned int height, unsigned int maxLayers);
+
+		// Description:
+		// Loads an image into the next free layer
+		// Images that are not the size of the array are resized to fit.
+		// Returns the layer index, or -1 if the image could not be loaded or the array is full
+		int addLayer(const std::string& fileName, bool flip = false);
+
+		// Description:
+		// Copies RGBA8 pixels into the next free layer, same rules as above
+		int addLayer(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height);
+
+		// Loading a layer in steps, so the slow parts can run on another thread (see AssetManager)
+		// reserveLayer() hands out the layer index before the image is loaded, returns -1 if the array is full
+		// prepareLayer() resizes the pixels to fit and builds their mip chain, it doesn't touch OpenGL
+		// uploadLayer() copies the prepared levels into the layer, GL thread only
+		int reserveLayer();
+		void prepareLayer(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height,
+			std::vector<unsigned char>& outPixels, std::vector<MipLevel>& outLevels) const;
+		void uploadLayer(int layer, const std::vector<unsigned char>& pixels, const std::vector<MipLevel>& levels);
+
+		void bind(GLenum textureUnit = GL_TEXTURE0);
+		void unbind(GLenum textureUnit = GL_TEXTURE0);
+
+		// Description:
+		// Returns a bindless handle for the whole array (GL_ARB_bindless_texture)
+		// Returns 0 if bindless textures are not supported
+		GLuint64 getBindlessHandle();
+
+		unsigned int id();
+		unsigned int getNumLayers();
+		unsigned int getMaxLayers();
+
+		void destroy();
+
+	private:
+		unsigned int texID;
+		unsigned int layerWidth;
+		unsigned int layerHeight;
+		unsigned int numLayers;
+		unsigned int maxLayers;
+		unsigned int numLevels;
+		GLuint64 bindlessHandle;
+	};
+}
@@ -0,0 +1,151 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Many small images packed into one texture
+//
+// Sprites drawn from the same atlas don't need a texture bind between them,
+// so SpriteBatch can draw thousands of them in one call. Each image's place
+// in the atlas is an AtlasRegion, which is all a sprite needs to know.
+//
+// Images are packed with a "skyline": the packer keeps the height of the
+// packed area at every x, and puts each image where it leaves its top the
+// lowest (then furthest left). Packing the tallest images first keeps the
+// skyline flat, which wastes very little space.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+namespace TTK
+{
+	// Where an image is in the atlas
+	struct AtlasRegion
+	{
+		unsigned int x, y;			// in texels, from the bottom left
+		unsigned int width, height;
+		glm::vec2 uvMin;			// bottom left
+		glm::vec2 uvMax;			// top right
+	};
+
+	// Skyline bottom-left rectangle packing, on its own so it can be used for
+	// anything that needs rectangles packed (ie. lightmaps, glyphs)
+	class AtlasPacker
+	{
+	public:
+		AtlasPacker();
+
+		// Empties the packer, with room for width x height
+		void reset(unsigned int width, unsigned int height);
+
+		// Description:
+		// Finds a place for a width x height rectangle
+		// Returns false if it doesn't fit
+		bool pack(unsigned int width, unsigned int height, unsigned int& outX, unsigned int& outY);
+
+		// How much of the area is covered by packed rectangles, 0 to 1
+		float getOccupancy() const;
+
+		// The top of the highest rectangle
+		unsigned int getUsedHeight() const;
+
+		unsigned int getWidth() const { return binWidth; }
+		unsigned int getHeight() const { return binHeight; }
+
+	private:
+		// A flat part of the skyline, from x to x + width at height y
+		struct SkylineNode
+		{
+			unsigned int x, y, width;
+		};
+
+		// The height the rectangle would sit at if its left edge was at node index,
+		// returns false if it would go past the right or top edge
+		bool fitAt(unsigned int index, unsigned int width, unsigned int height, unsigned int& outY) const;
+
+		std::vector<SkylineNode> skyline;
+		unsigned int binWidth, binHeight;
+		unsigned long long usedArea;
+	};
+
+	// Usage:
+	//	TextureAtlas atlas;
+	//	int player = atlas.addImage("player.png");
+	//	int enemy = atlas.addImage("enemy.png");
+	//	atlas.build();
+	//	atlas.upload();
+	//	spriteBatch.draw(atlas.id(), atlas.getRegion(player), position, size);
+	class TextureAtlas
+	{
+	public:
+		TextureAtlas();
+		~TextureAtlas();
+
+		// Description:
+		// Adds an image to be packed by build()
+		// Returns its region index, or -1 if the image could not be loaded
+		int addImage(const std::string& fileName, bool flip = false);
+
+		// Description:
+		// Same as above for RGBA8 pixels (bottom row first, like everything sent to OpenGL)
+		int addImage(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height);
+
+		// Description:
+		// Packs every image added so far and copies them into the atlas' pixels
+		// The atlas is the smallest power of two wide that the images fit in, and only as high
+		// as they need. Each image gets padding texels around it, copied from its edges so filtering
+		// never blends in its neighbours. Doesn't touch OpenGL, so it can run on any thread.
+		// Returns false if the images don't fit in maxSize x maxSize
+		bool build(unsigned int maxSize = 4096, unsigned int padding = 1);
+
+		// Description:
+		// Creates (or replaces) the texture from the built pixels, GL thread only
+		// The pixels are freed afterwards unless keepPixels is set
+		void upload(bool keepPixels = false);
+
+		void bind(GLenum textureUnit = GL_TEXTURE0);
+		void unbind(GLenum textureUnit = GL_TEXTURE0);
+
+		const AtlasRegion& getRegion(int index) const { return regions[index]; }
+		unsigned int getNumRegions() const { return (unsigned int)regions.size(); }
+
+		unsigned int id() const { return texID; }
+		unsigned int getWidth() const { return atlasWidth; }
+		unsigned int getHeight() const { return atlasHeight; }
+
+		// How much of the atlas the images cover (without padding), 0 to 1
+		float getOccupancy() const { return occupancy; }
+
+		// The built atlas, RGBA8 bottom row first
+		const std::vector<unsigned char>& getPixels() const { return pixels; }
+
+		void destroy();
+
+	private:
+		TextureAtlas(const TextureAtlas&);
+		TextureAtlas& operator=(const TextureAtlas&);
+
+		struct Image
+		{
+			std::vector<unsigned char> pixels;
+			unsigned int width, height;
+		};
+
+		// Copies an image and its extruded edges into the atlas at its region
+		void copyImage(const Image& image, const AtlasRegion& region, unsigned int padding);
+
+		std::vector<Image> images;
+		std::vector<AtlasRegion> regions;
+		std::vector<unsigned char> pixels;
+
+		unsigned int texID;
+		unsigned int atlasWidth, atlasHeight;
+		float occupancy;
+	};
+}
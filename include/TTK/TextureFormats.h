@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library. 
+// You may not use this header in your GDW games.
+//
+// Helpers for building texture data
+// - Mipmap chain generation for RGBA8 images
+// - Loading block compressed (BC1 / BC3 / BC7) textures from DDS and KTX files
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <GLEW/glew.h>
+
+namespace TTK
+{
+	// Describes one level of a mip chain stored in a single buffer
+	struct MipLevel
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int offset;	// in bytes from the start of the buffer
+		unsigned int size;		// in bytes
+	};
+
+	// Texture data ready to be sent to OpenGL
+	// Level 0 is the full size image, every level after is half the size of the previous
+	struct TextureData
+	{
+		TextureData() : internalFormat(GL_RGBA8), compressed(false), blockSize(0) {}
+
+		GLenum internalFormat;
+		bool compressed;
+		unsigned int blockSize;	// bytes per 4x4 block for compressed formats
+
+		std::vector<unsigned char> data;
+		std::vector<MipLevel> levels;
+
+		// Total size of all levels in bytes
+		unsigned int totalSize();
+	};
+
+	namespace TextureFormats
+	{
+		// Description:
+		// Builds the full mip chain for an RGBA8 image using a 2x2 box filter.
+		// "pixels" holds level 0 on input, the smaller levels are appended to it.
+		// Uses SSE2 where available.
+		void generateMipChain(std::vector<unsigned char>& pixels, unsigned int width, unsigned int height,
+			std::vector<MipLevel>& levels);
+
+		// Description:
+		// Resizes an RGBA8 image with bilinear filtering
+		void resizeImage(const std::vector<unsigned char>& src, unsigned int srcWidth, unsigned int srcHeight,
+			std::vector<unsigned char>& dst, unsigned int dstWidth, unsigned int dstHeight);
+
+		// Description:
+		// Loads a DDS file containing BC1 (DXT1), BC3 (DXT5) or BC7 data
+		// including any mip levels stored in the file
+		bool loadDDS(const std::string& fileName, TextureData& out);
+
+		// Description:
+		// Loads a KTX (version 1) file with a compressed internal format
+		bool loadKTX(const std::string& fileName, TextureData& out);
+
+		// Returns true if the file name ends in .dds or .ktx
+		bool isCompressedFile(const std::string& fileName);
+
+		// Loads a .dds or .ktx file
+		bool loadCompressed(const std::string& fileName, TextureData& out);
+
+		// Size in bytes of a level of a block compressed texture
+		// 64 bit (and UINT64_MAX if even that's too small), so the sizes in a corrupt file's
+		// header can't wrap around to something small
+		uint64_t compressedLevelSize(unsigned int width, unsigned int height, unsigned int blockSize);
+	}
+}
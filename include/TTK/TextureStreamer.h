@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library. 
+// You may not use this header in your GDW games.
+//
+// Loads textures in the background
+//
+// Images are decoded (and mipmapped) on worker threads into pooled staging buffers,
+// then uploaded a few rows at a time through a ring of pixel buffer objects (PBOs)
+// so that no single frame has to wait for a large texture.
+// Until a texture is fully uploaded a placeholder texture is bound instead.
+//
+// Images decoded somewhere else (ie. texture array layers from the AssetManager)
+// can be handed straight to the upload ring, so they share the same budget.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/Texture2D.h"
+#include "TTK/TextureArray.h"
+#include <memory>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace TTK
+{
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer();
+		~TextureStreamer();
+
+		// Starts the decode threads and creates the PBO ring
+		// Must be called on the GL thread after glewInit()
+		void init(unsigned int numWorkers = 2, unsigned int numPBOs = 3, unsigned int pboSizeBytes = 4 * 1024 * 1024);
+
+		// Stops the workers and frees the GL objects
+		void shutdown();
+
+		// Queues a texture to be loaded and returns right away
+		// The returned texture can be bound immediately, it shows the
+		// placeholder until it is resident.
+		std::shared_ptr<Texture2D> loadTextureAsync(const std::string& fileName, bool flip = false);
+
+		// Description:
+		// Queues RGBA8 levels (see TextureArray::prepareLayer) to be copied into a layer of a texture array
+		// The pixels are moved out of, onUploaded is called from update() once the whole layer is copied
+		// GL thread only
+		void uploadLayerAsync(TextureArray& textures, int layer, std::vector<unsigned char>& pixels,
+			std::vector<MipLevel>& levels, std::function<void()> onUploaded = nullptr);
+
+		// Uploads decoded textures to the GPU, call once per frame on the GL thread
+		// At most uploadBudgetBytes are copied per call
+		void update();
+
+		// Number of textures that are not resident yet
+		unsigned int getNumPending();
+
+		// Max number of bytes uploaded per frame
+		unsigned int uploadBudgetBytes;
+
+	private:
+		struct Request
+		{
+			std::shared_ptr<Texture2D> texture;
+			std::string fileName;
+			bool flip;
+
+			// Layer uploads only, texture is null
+			TextureArray* textures;
+			int layer;
+			std::function<void()> onUploaded;
+
+			// Decoded texture, data is from the staging pool
+			TextureData texData;
+			bool decoded;
+
+			// Upload progress
+			// For compressed textures a "row" is a row of 4x4 blocks
+			unsigned int glTexture;
+			unsigned int currentLevel;
+			unsigned int rowsUploaded;
+		};
+
+		void workerLoop();
+
+		// Number of rows in the level being uploaded
+		unsigned int getNumRows(Request& request);
+
+		// Uploads part of a request, returns the number of bytes copied
+		// Returns 0 if no PBO is free this frame
+		unsigned int uploadRows(Request& request, unsigned int maxBytes);
+
+		void finishRequest(Request& request);
+
+		// Staging pool, reuses pixel buffers so decoding does not allocate every time
+		std::vector<unsigned char> acquireStagingBuffer();
+		void releaseStagingBuffer(std::vector<unsigned char>& buffer);
+
+		// Workers
+		std::vector<std::thread> workers;
+		bool stopWorkers;
+		std::mutex queueMutex;
+		std::condition_variable queueCondition;
+		std::deque<std::shared_ptr<Request>> decodeQueue;	// waiting to be decoded
+		std::deque<std::shared_ptr<Request>> uploadQueue;	// decoded, waiting for the GL thread
+		unsigned int numPending;
+
+		std::mutex stagingMutex;
+		std::vector<std::vector<unsigned char>> stagingPool;
+
+		// GL thread only
+		std::deque<std::shared_ptr<Request>> uploading;
+		std::vector<unsigned int> pbos;
+		std::vector<GLsync> pboFences;
+		unsigned int pboSize;
+		unsigned int nextPBO;
+		unsigned int placeholderTexture;
+	};
+}
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "glm/glm.hpp"
-#include <glm\gtx\color_space.hpp>
+#include <glm/gtx/color_space.hpp>
 
 // Simple function to get a rgb color at the specified hue point
 // t is meant to be between 0 and 1
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// A fixed set of worker threads for splitting big loops across cores
+//
+// Usage:
+//	ThreadPool pool;
+//	pool.parallelFor(numVertices, 4096, [&](unsigned int begin, unsigned int end)
+//	{
+//		for (unsigned int i = begin; i < end; i++)
+//			...
+//	});
+//
+// The calling thread works on chunks too, so nothing sits idle while it waits.
+// parallelFor can be called from any thread, but calls run one at a time.
+class ThreadPool
+{
+public:
+	// 0 threads uses one less than the number of cores (the caller is the last one)
+	ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	// Calls func(begin, end) on chunks of [0, count) in parallel and waits for all of them to finish
+	// Chunks are chunkSize long (the last may be shorter)
+	template <typename Func>
+	void parallelFor(unsigned int count, unsigned int chunkSize, const Func& func)
+	{
+		// func is called through a plain function pointer instead of being copied
+		// into a std::function, which allocates for lambdas with more than a capture or two
+		run(count, chunkSize, &callRange<Func>, &func);
+	}
+
+	// Workers plus the calling thread
+	unsigned int getNumThreads();
+
+private:
+	typedef void (*RangeCallback)(const void* func, unsigned int begin, unsigned int end);
+
+	template <typename Func>
+	static void callRange(const void* func, unsigned int begin, unsigned int end)
+	{
+		(*(const Func*)func)(begin, end);
+	}
+
+	struct Job
+	{
+		RangeCallback callback;
+		const void* func;
+		unsigned int count;
+		unsigned int chunkSize;
+		std::atomic<unsigned int> nextChunk;
+		std::atomic<unsigned int> chunksLeft;
+	};
+
+	void run(unsigned int count, unsigned int chunkSize, RangeCallback callback, const void* func);
+	void workerLoop();
+
+	// Takes chunks from the job until there are none left
+	void runChunks(Job& job);
+
+	std::vector<std::thread> workers;
+	std::mutex callMutex;	// held for a whole parallelFor, so calls from different threads take turns
+	std::mutex jobMutex;
+	std::condition_variable jobCondition;	// workers wait here for a job
+	std::condition_variable doneCondition;	// parallelFor waits here for the job to finish
+	Job* currentJob;
+	unsigned int jobNumber;	// so workers can tell a new job from the one they just did
+	unsigned int numActiveWorkers;	// workers currently holding currentJob
+	bool stopWorkers;
+};
@@ -2,6 +2,9 @@
 
 #include "GLEW/glew.h"
 #include <vector>
+#include <string>
+
+#include "StreamingBuffer.h"
 
 // These locations correspond to the locations in shaders (glEnableVertexAttribArray)
 // These are constants and will never change
@@ -13,7 +16,8 @@ enum AttributeLocations
 	VERTEX = 0,
 	NORMAL,
 	TEX_COORD,
-	COLOUR
+	COLOUR,
+	DRAW_ID		// per instance, which draw of a multi-draw a vertex belongs to (see IndirectRenderer)
 };
 
 // This struct describes the array for an attribute
@@ -58,6 +62,16 @@ private:
 	// is interleaved. 
 	std::vector<unsigned int> vboHandles;
 
+	// Dynamic VBOs keep every attribute in one streaming buffer instead of vboHandles
+	// Each region holds a full copy of all the attributes, at attributeOffsets
+	bool dynamic;
+	StreamingBuffer streamingBuffer;
+	std::vector<unsigned int> attributeOffsets;
+	unsigned char* updateRegion; // set between beginUpdate() and endUpdate()
+
+	// Points the VAO's attributes at the current region of the streaming buffer
+	void setDynamicAttributePointers();
+
 public:
 	VertexBufferObject();
 	~VertexBufferObject();
@@ -66,9 +80,30 @@ public:
 	// this object will have.
 	int addAttributeArray(AttributeDescriptor attrib);
 
+	// Call this before createVBO() if the data will change often (ie. every frame)
+	// Dynamic VBOs can be updated with updateVBO() without recreating anything
+	void setDynamic(bool _dynamic);
+	bool isDynamic();
+
 	// Call this once you add all the AttributeDescriptor objects
 	void createVBO();
 
+	// Changes where an attribute's data is copied from in updateVBO()
+	// ie. if the std::vector holding it was resized
+	void setAttributeData(AttributeLocations location, void* data);
+
+	// Dynamic VBOs only
+	// Copies the data of every attribute into the next region of the streaming buffer
+	// The amount of data must not change since createVBO()
+	void updateVBO();
+
+	// Dynamic VBOs only
+	// For writing vertex data straight into the buffer instead of copying it from the attributes' data
+	// Call beginUpdate(), write every attribute through getAttributePointer(), then call endUpdate()
+	void beginUpdate();
+	void* getAttributePointer(AttributeLocations location);
+	void endUpdate();
+
 	// Call this when you want to draw the object
 	void draw();
 
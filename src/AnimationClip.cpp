@@ -0,0 +1,438 @@
+#include "AnimationClip.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+static const float SQRT2 = 1.41421356f;
+
+// Marks a cursor key as unknown, so the key has to be searched for
+static const unsigned short NO_KEY = 0xFFFF;
+
+QuantizedQuat QuantizedQuat::encode(glm::quat q)
+{
+	q = glm::normalize(q);
+	float c[4] = { q.x, q.y, q.z, q.w };
+
+	int largest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (fabs(c[i]) > fabs(c[largest]))
+			largest = i;
+	}
+
+	// Flip the quaternion so the dropped component is positive
+	float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+	// 2 bits of index, then 3 x 15 bits
+	unsigned long long bits = (unsigned long long)largest << 45;
+	int shift = 30;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (i == largest)
+			continue;
+
+		// [-1/sqrt(2), 1/sqrt(2)] -> [0, 32767]
+		float v = glm::clamp((c[i] * sign * SQRT2 + 1.0f) * 0.5f, 0.0f, 1.0f);
+		unsigned long long q15 = (unsigned long long)(v * 32767.0f + 0.5f);
+
+		bits |= q15 << shift;
+		shift -= 15;
+	}
+
+	QuantizedQuat result;
+	result.data[0] = (unsigned short)(bits >> 32);
+	result.data[1] = (unsigned short)(bits >> 16);
+	result.data[2] = (unsigned short)bits;
+	return result;
+}
+
+glm::quat QuantizedQuat::decode() const
+{
+	unsigned long long bits = ((unsigned long long)data[0] << 32) | ((unsigned long long)data[1] << 16) | data[2];
+	int largest = (int)(bits >> 45) & 3;
+
+	float c[4];
+	float sumSquares = 0.0f;
+	int shift = 30;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (i == largest)
+			continue;
+
+		unsigned int q15 = (unsigned int)(bits >> shift) & 0x7FFF;
+		c[i] = (q15 / 32767.0f * 2.0f - 1.0f) / SQRT2;
+		sumSquares += c[i] * c[i];
+		shift -= 15;
+	}
+
+	c[largest] = sqrt(std::max(0.0f, 1.0f - sumSquares));
+
+	return glm::quat(c[3], c[0], c[1], c[2]);
+}
+
+void AnimationCursor::reset()
+{
+	std::fill(keys.begin(), keys.end(), NO_KEY);
+}
+
+// Helpers
+
+// Normalized lerp, takes the short way around
+// Much cheaper than slerp, and keys are close enough together that the difference is tiny
+static inline glm::quat nlerp(const glm::quat& a, glm::quat b, float t)
+{
+	if (glm::dot(a, b) < 0.0f)
+		b = -b;
+
+	return glm::normalize(a * (1.0f - t) + b * t);
+}
+
+// Greedily picks the frames to keep as keys
+// Starting from a key, the next key is pushed out as far as segmentFits(key, next) allows
+template <typename SegmentFits>
+static void reduceKeys(unsigned int numFrames, SegmentFits segmentFits, std::vector<unsigned int>& keyFrames)
+{
+	keyFrames.clear();
+	keyFrames.push_back(0);
+
+	unsigned int start = 0;
+	while (start + 1 < numFrames)
+	{
+		unsigned int end = start + 1;
+		while (end + 1 < numFrames && segmentFits(start, end + 1))
+			end++;
+
+		keyFrames.push_back(end);
+		start = end;
+	}
+}
+
+// Finds the key at or before frame
+// Playing forwards the cursor is already there or one or two keys behind,
+// only a fresh cursor or jumping backwards (ie. looping) needs a search
+static inline unsigned int findKey(const unsigned short* times, unsigned int numKeys, float frame, unsigned short& cursor)
+{
+	unsigned int k = cursor;
+
+	if (k >= numKeys || frame < times[k])
+		k = (unsigned int)(std::upper_bound(times, times + numKeys, frame) - times) - 1;
+
+	while (k + 1 < numKeys && times[k + 1] <= frame)
+		k++;
+
+	cursor = (unsigned short)k;
+	return k;
+}
+
+static inline glm::vec3 sampleVec3(const unsigned short* times, const glm::u16vec3* keys, unsigned int numKeys,
+	const glm::vec3& rangeMin, const glm::vec3& rangeScale, float frame, unsigned short& cursor)
+{
+	if (numKeys == 1)
+		return rangeMin + glm::vec3(keys[0]) * rangeScale;
+
+	unsigned int k = findKey(times, numKeys, frame, cursor);
+
+	glm::vec3 a = rangeMin + glm::vec3(keys[k]) * rangeScale;
+	if (k + 1 == numKeys)
+		return a;
+
+	glm::vec3 b = rangeMin + glm::vec3(keys[k + 1]) * rangeScale;
+	float t = (frame - times[k]) / (float)(times[k + 1] - times[k]);
+
+	return glm::mix(a, b, t);
+}
+
+static inline glm::quat sampleRotation(const unsigned short* times, const QuantizedQuat* keys, unsigned int numKeys,
+	float frame, unsigned short& cursor)
+{
+	if (numKeys == 1)
+		return keys[0].decode();
+
+	unsigned int k = findKey(times, numKeys, frame, cursor);
+
+	glm::quat a = keys[k].decode();
+	if (k + 1 == numKeys)
+		return a;
+
+	glm::quat b = keys[k + 1].decode();
+	float t = (frame - times[k]) / (float)(times[k + 1] - times[k]);
+
+	return nlerp(a, b, t);
+}
+
+// AnimationClip
+
+AnimationClip::AnimationClip()
+{
+	sampleRate = 30.0f;
+	numFrames = 0;
+}
+
+bool AnimationClip::build(const RawAnimation& raw, const Tolerances& tolerances)
+{
+	unsigned int numJoints = (unsigned int)raw.jointNames.size();
+
+	if (raw.numFrames == 0 || raw.numFrames > 65535 || raw.sampleRate <= 0.0f ||
+		raw.frames.size() != raw.numFrames * numJoints)
+	{
+		std::cout << "AnimationClip: " << raw.name << " has no frames, too many frames, or the wrong number of poses" << std::endl;
+		return false;
+	}
+
+	name = raw.name;
+	jointNames = raw.jointNames;
+	sampleRate = raw.sampleRate;
+	numFrames = raw.numFrames;
+
+	translationTracks.clear();
+	rotationTracks.clear();
+	scaleTracks.clear();
+	translationTimes.clear();
+	rotationTimes.clear();
+	scaleTimes.clear();
+	translationKeys.clear();
+	rotationKeys.clear();
+	scaleKeys.clear();
+
+	std::vector<glm::vec3> translations(numFrames);
+	std::vector<glm::quat> rotations(numFrames);
+	std::vector<glm::vec3> scales(numFrames);
+
+	for (unsigned int j = 0; j < numJoints; j++)
+	{
+		for (unsigned int f = 0; f < numFrames; f++)
+		{
+			const JointPose& pose = raw.frames[f * numJoints + j];
+			translations[f] = pose.translation;
+			rotations[f] = glm::normalize(pose.rotation);
+			scales[f] = pose.scale;
+		}
+
+		buildVec3Track(translations, tolerances.translation, translationTracks, translationTimes, translationKeys);
+		buildRotationTrack(rotations, tolerances.rotation);
+		buildVec3Track(scales, tolerances.scale, scaleTracks, scaleTimes, scaleKeys);
+	}
+
+	return true;
+}
+
+void AnimationClip::buildVec3Track(const std::vector<glm::vec3>& values, float tolerance,
+	std::vector<Track>& tracks, std::vector<unsigned short>& times, std::vector<glm::u16vec3>& keys)
+{
+	unsigned int n = (unsigned int)values.size();
+
+	// Quantize over the range this track actually uses
+	glm::vec3 minValue = values[0];
+	glm::vec3 maxValue = values[0];
+	for (unsigned int i = 1; i < n; i++)
+	{
+		minValue = glm::min(minValue, values[i]);
+		maxValue = glm::max(maxValue, values[i]);
+	}
+
+	Track track;
+	track.firstKey = (unsigned int)keys.size();
+	track.rangeMin = minValue;
+	track.rangeScale = (maxValue - minValue) / 65535.0f;
+
+	glm::vec3 toQuantized;
+	for (int c = 0; c < 3; c++)
+		toQuantized[c] = track.rangeScale[c] > 0.0f ? 1.0f / track.rangeScale[c] : 0.0f;
+
+	// Quantize every frame first, so keys are fitted to the values we'll actually get back
+	std::vector<glm::u16vec3> quantized(n);
+	std::vector<glm::vec3> dequantized(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		glm::vec3 q = glm::clamp((values[i] - minValue) * toQuantized + 0.5f, 0.0f, 65535.0f);
+		quantized[i] = glm::u16vec3(q);
+		dequantized[i] = minValue + glm::vec3(quantized[i]) * track.rangeScale;
+	}
+
+	// A track that doesn't move only needs one key
+	bool constant = true;
+	for (unsigned int i = 1; i < n && constant; i++)
+		constant = glm::length(dequantized[0] - values[i]) <= tolerance;
+
+	std::vector<unsigned int> keyFrames;
+
+	if (constant)
+	{
+		keyFrames.push_back(0);
+	}
+	else
+	{
+		reduceKeys(n, [&](unsigned int a, unsigned int b)
+		{
+			for (unsigned int k = a + 1; k < b; k++)
+			{
+				glm::vec3 v = glm::mix(dequantized[a], dequantized[b], (float)(k - a) / (b - a));
+				if (glm::length(v - values[k]) > tolerance)
+					return false;
+			}
+			return true;
+		}, keyFrames);
+	}
+
+	for (unsigned int i = 0; i < keyFrames.size(); i++)
+	{
+		times.push_back((unsigned short)keyFrames[i]);
+		keys.push_back(quantized[keyFrames[i]]);
+	}
+
+	track.numKeys = (unsigned int)keyFrames.size();
+	tracks.push_back(track);
+}
+
+void AnimationClip::buildRotationTrack(const std::vector<glm::quat>& values, float tolerance)
+{
+	unsigned int n = (unsigned int)values.size();
+
+	Track track;
+	track.firstKey = (unsigned int)rotationKeys.size();
+	track.rangeMin = glm::vec3(0.0f);
+	track.rangeScale = glm::vec3(0.0f);
+
+	std::vector<QuantizedQuat> quantized(n);
+	std::vector<glm::quat> dequantized(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		quantized[i] = QuantizedQuat::encode(values[i]);
+		dequantized[i] = quantized[i].decode();
+	}
+
+	bool constant = true;
+	for (unsigned int i = 1; i < n && constant; i++)
+		constant = angleBetween(dequantized[0], values[i]) <= tolerance;
+
+	std::vector<unsigned int> keyFrames;
+
+	if (constant)
+	{
+		keyFrames.push_back(0);
+	}
+	else
+	{
+		reduceKeys(n, [&](unsigned int a, unsigned int b)
+		{
+			for (unsigned int k = a + 1; k < b; k++)
+			{
+				glm::quat q = nlerp(dequantized[a], dequantized[b], (float)(k - a) / (b - a));
+				if (angleBetween(q, values[k]) > tolerance)
+					return false;
+			}
+			return true;
+		}, keyFrames);
+	}
+
+	for (unsigned int i = 0; i < keyFrames.size(); i++)
+	{
+		rotationTimes.push_back((unsigned short)keyFrames[i]);
+		rotationKeys.push_back(quantized[keyFrames[i]]);
+	}
+
+	track.numKeys = (unsigned int)keyFrames.size();
+	rotationTracks.push_back(track);
+}
+
+float AnimationClip::angleBetween(const glm::quat& a, const glm::quat& b)
+{
+	// acos(dot(a, b)) loses almost all its precision for small angles (the dot is so close to 1),
+	// the distance between the two quaternions doesn't: |a - b| = 2 sin(angle / 4)
+	float sign = glm::dot(a, b) < 0.0f ? -1.0f : 1.0f;
+	glm::vec4 d(a.x - b.x * sign, a.y - b.y * sign, a.z - b.z * sign, a.w - b.w * sign);
+
+	return 4.0f * asin(std::min(glm::length(d) * 0.5f, 1.0f));
+}
+
+void AnimationClip::initCursor(AnimationCursor& cursor) const
+{
+	cursor.keys.resize(getNumJoints() * 3);
+	cursor.reset();
+}
+
+void AnimationClip::sample(float time, AnimationCursor& cursor, JointPose* outPoses) const
+{
+	unsigned int numJoints = getNumJoints();
+	if (numJoints == 0)
+		return;
+
+	if (cursor.keys.size() != numJoints * 3)
+		initCursor(cursor);
+
+	float frame = glm::clamp(time * sampleRate, 0.0f, (float)(numFrames - 1));
+
+	unsigned short* translationCursors = &cursor.keys[0];
+	unsigned short* rotationCursors = translationCursors + numJoints;
+	unsigned short* scaleCursors = rotationCursors + numJoints;
+
+	for (unsigned int j = 0; j < numJoints; j++)
+	{
+		const Track& t = translationTracks[j];
+		outPoses[j].translation = sampleVec3(&translationTimes[t.firstKey], &translationKeys[t.firstKey], t.numKeys,
+			t.rangeMin, t.rangeScale, frame, translationCursors[j]);
+
+		const Track& r = rotationTracks[j];
+		outPoses[j].rotation = sampleRotation(&rotationTimes[r.firstKey], &rotationKeys[r.firstKey], r.numKeys,
+			frame, rotationCursors[j]);
+
+		const Track& s = scaleTracks[j];
+		outPoses[j].scale = sampleVec3(&scaleTimes[s.firstKey], &scaleKeys[s.firstKey], s.numKeys,
+			s.rangeMin, s.rangeScale, frame, scaleCursors[j]);
+	}
+}
+
+const std::string& AnimationClip::getName() const
+{
+	return name;
+}
+
+const std::vector<std::string>& AnimationClip::getJointNames() const
+{
+	return jointNames;
+}
+
+unsigned int AnimationClip::getNumJoints() const
+{
+	return (unsigned int)translationTracks.size();
+}
+
+float AnimationClip::getDuration() const
+{
+	return numFrames > 0 ? (numFrames - 1) / sampleRate : 0.0f;
+}
+
+unsigned int AnimationClip::getNumKeys() const
+{
+	return (unsigned int)(translationKeys.size() + rotationKeys.size() + scaleKeys.size());
+}
+
+unsigned int AnimationClip::getMemoryUsage() const
+{
+	unsigned int bytes = 0;
+
+	bytes += (unsigned int)((translationTracks.size() + rotationTracks.size() + scaleTracks.size()) * sizeof(Track));
+	bytes += (unsigned int)((translationTimes.size() + rotationTimes.size() + scaleTimes.size()) * sizeof(unsigned short));
+	bytes += (unsigned int)((translationKeys.size() + scaleKeys.size()) * sizeof(glm::u16vec3));
+	bytes += (unsigned int)(rotationKeys.size() * sizeof(QuantizedQuat));
+
+	return bytes;
+}
+
+unsigned int AnimationClip::getRawMemoryUsage() const
+{
+	return numFrames * getNumJoints() * (unsigned int)sizeof(JointPose);
+}
+
+void AnimationClip::printStats() const
+{
+	unsigned int bytes = getMemoryUsage();
+	unsigned int rawBytes = getRawMemoryUsage();
+
+	printf("Animation '%s': %u joints, %.2f s, %u keys, %.1f KB (raw %.1f KB, %.1fx smaller)\n",
+		name.c_str(), getNumJoints(), getDuration(), getNumKeys(),
+		bytes / 1024.0f, rawBytes / 1024.0f, bytes > 0 ? (float)rawBytes / bytes : 0.0f);
+}
@@ -0,0 +1,104 @@
+#include "Animator.h"
+#include "GameObject.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <cmath>
+
+Animator::Animator()
+{
+	time = 0.0f;
+	speed = 1.0f;
+	looping = true;
+	playing = true;
+}
+
+void Animator::setClip(std::shared_ptr<AnimationClip> _clip, const std::vector<GameObject*>& _joints)
+{
+	clip = _clip;
+	joints = _joints;
+	time = 0.0f;
+
+	if (clip)
+	{
+		poses.resize(clip->getNumJoints());
+		clip->initCursor(cursor);
+	}
+	else
+	{
+		poses.clear();
+	}
+}
+
+void Animator::update(float dt)
+{
+	if (!clip || !playing)
+		return;
+
+	time += dt * speed;
+
+	float duration = clip->getDuration();
+
+	if (looping && duration > 0.0f)
+	{
+		time = fmod(time, duration);
+		if (time < 0.0f)
+			time += duration;
+	}
+	else
+	{
+		time = time < 0.0f ? 0.0f : (time > duration ? duration : time);
+	}
+}
+
+void Animator::sample()
+{
+	if (clip && !poses.empty())
+		clip->sample(time, cursor, &poses[0]);
+}
+
+void Animator::apply()
+{
+	unsigned int numJoints = (unsigned int)(joints.size() < poses.size() ? joints.size() : poses.size());
+
+	for (unsigned int i = 0; i < numJoints; i++)
+	{
+		if (!joints[i])
+			continue;
+
+		joints[i]->setPosition(poses[i].translation);
+		joints[i]->setRotation(poses[i].rotation);
+
+		// Game objects only have a uniform scale
+		joints[i]->setScale(poses[i].scale.x);
+	}
+}
+
+void Animator::sampleAll(const std::vector<Animator*>& animators, ThreadPool* pool, unsigned int chunkSize)
+{
+	PROFILE_SCOPE("sample animations");
+
+	// Animators don't share anything they write to, so they can all be sampled at once
+	if (pool)
+	{
+		pool->parallelFor((unsigned int)animators.size(), chunkSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+				animators[i]->sample();
+		});
+	}
+	else
+	{
+		for (unsigned int i = 0; i < animators.size(); i++)
+			animators[i]->sample();
+	}
+}
+
+const std::vector<JointPose>& Animator::getPoses() const
+{
+	return poses;
+}
+
+std::shared_ptr<AnimationClip> Animator::getClip()
+{
+	return clip;
+}
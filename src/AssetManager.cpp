@@ -0,0 +1,495 @@
+#include "AssetManager.h"
+#include "TTK/Texture2D.h"
+#include "Profiler.h"
+#include "TTK/BatchReader.h"
+#include "MeshCodec.h"
+#include <iostream>
+
+AssetManager::AssetManager()
+{
+	stopThreads = false;
+	numPending = 0;
+	textureStreamer = nullptr;
+	batchSize = 0;
+	slowestLoadMS = 0.0;
+}
+
+AssetManager::~AssetManager()
+{
+	stop();
+}
+
+void AssetManager::start(unsigned int numWorkers)
+{
+	if (numWorkers == 0)
+	{
+		unsigned int numCores = std::thread::hardware_concurrency();
+		numWorkers = numCores > 1 ? numCores - 1 : 1;
+	}
+
+	stopThreads = false;
+	ioThread = std::thread(&AssetManager::ioLoop, this);
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+		workers.push_back(std::thread(&AssetManager::workerLoop, this));
+}
+
+void AssetManager::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopThreads = true;
+	}
+	ioCondition.notify_all();
+	decodeCondition.notify_all();
+
+	if (ioThread.joinable())
+		ioThread.join();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	ioQueue.clear();
+	decodeQueue.clear();
+	uploadQueue.clear();
+	uploading.clear();
+}
+
+void AssetManager::setTextureStreamer(TTK::TextureStreamer* streamer)
+{
+	textureStreamer = streamer;
+}
+
+template <typename T>
+void AssetManager::addReadyCallback(AssetOf<T>& asset, const std::function<void(std::shared_ptr<T>)>& onReady)
+{
+	if (!onReady)
+		return;
+
+	// The callback holds the resource rather than the asset, so it doesn't keep the asset alive
+	std::shared_ptr<T> resource = asset.resource;
+
+	if (asset.getState() == ASSET_READY)
+		onReady(resource);
+	else if (asset.getState() == ASSET_LOADING)
+		asset.readyCallbacks.push_back([resource, onReady]() { onReady(resource); });
+}
+
+MeshHandle AssetManager::loadMesh(const std::string& fileName, std::function<void(std::shared_ptr<TTK::OBJMesh>)> onReady)
+{
+	std::string name = "mesh:" + fileName;
+
+	std::shared_ptr<AssetOf<TTK::OBJMesh>> asset = std::static_pointer_cast<AssetOf<TTK::OBJMesh>>(findCached(name));
+	if (asset)
+	{
+		addReadyCallback(*asset, onReady);
+		return MeshHandle(asset);
+	}
+
+	std::shared_ptr<TTK::OBJMesh> mesh = std::make_shared<TTK::OBJMesh>();
+	asset = std::make_shared<AssetOf<TTK::OBJMesh>>(name, mesh);
+	addReadyCallback(*asset, onReady);
+
+	// A pack made with --make-pack has the mesh cooked, which loads without parsing text or merging vertices
+	std::string cookedName = getCookedMeshName(fileName);
+	bool cooked = TTK::IO::fileExists(cookedName);
+
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->asset = asset;
+	request->fileNames.push_back(cooked ? cookedName : fileName);
+
+	request->decode = [mesh, fileName, cooked](Request& r)
+	{
+		if (cooked)
+			return mesh->parseCookedMesh(fileName, r.files[0].data(), r.files[0].size());
+
+		mesh->parseMesh(fileName, r.files[0].data(), r.files[0].size());
+		return !mesh->vertices.empty();
+	};
+
+	request->upload = [mesh](Request&)
+	{
+		mesh->createVBO();
+		return UPLOAD_DONE;
+	};
+
+	submit(request);
+	return MeshHandle(asset);
+}
+
+TextureHandle AssetManager::loadTextureLayer(TTK::TextureArray& textures, const std::string& fileName, bool flip,
+	std::function<void(std::shared_ptr<TextureLayer>)> onReady)
+{
+	// Only the same texture in the same array, flipped the same way, is the same asset
+	char arrayName[32];
+	snprintf(arrayName, sizeof(arrayName), "%p", (void*)&textures);
+	std::string name = "texture:" + fileName + "[" + arrayName + (flip ? ",flip]" : "]");
+
+	std::shared_ptr<AssetOf<TextureLayer>> asset = std::static_pointer_cast<AssetOf<TextureLayer>>(findCached(name));
+	if (asset)
+	{
+		addReadyCallback(*asset, onReady);
+		return TextureHandle(asset);
+	}
+
+	std::shared_ptr<TextureLayer> layer = std::make_shared<TextureLayer>();
+	layer->textures = &textures;
+	layer->layer = textures.reserveLayer();
+
+	asset = std::make_shared<AssetOf<TextureLayer>>(name, layer);
+	addReadyCallback(*asset, onReady);
+
+	// Decoded and mipmapped by a worker, only the copy into the layer is left for the GL thread
+	struct Decoded
+	{
+		Decoded() : queued(false), uploaded(false) {}
+
+		std::vector<unsigned char> pixels;
+		std::vector<TTK::MipLevel> levels;
+		bool queued;	// handed to the streamer
+		bool uploaded;
+	};
+	std::shared_ptr<Decoded> decoded = std::make_shared<Decoded>();
+
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->asset = asset;
+	request->fileNames.push_back(fileName);
+
+	request->decode = [layer, decoded, flip](Request& r)
+	{
+		// Each worker decodes into the same memory every time, prepareLayer() copies out of it
+		static thread_local std::vector<unsigned char> image;
+		unsigned int width, height;
+
+		if (layer->layer < 0 || !TTK::Texture2D::decodeImage(r.fileNames[0], r.files[0].data(), r.files[0].size(), flip, image, width, height))
+			return false;
+
+		layer->textures->prepareLayer(image, width, height, decoded->pixels, decoded->levels);
+		return true;
+	};
+
+	request->upload = [this, layer, decoded](Request&)
+	{
+		// A few rows a frame through the streamer's PBOs, the layer is ready once they're all copied
+		if (textureStreamer)
+		{
+			if (!decoded->queued)
+			{
+				decoded->queued = true;
+				textureStreamer->uploadLayerAsync(*layer->textures, layer->layer, decoded->pixels, decoded->levels,
+					[decoded]() { decoded->uploaded = true; });
+			}
+
+			return decoded->uploaded ? UPLOAD_DONE : UPLOAD_WAITING;
+		}
+
+		layer->textures->uploadLayer(layer->layer, decoded->pixels, decoded->levels);
+
+		decoded->pixels = std::vector<unsigned char>();
+		return UPLOAD_DONE;
+	};
+
+	submit(request);
+	return TextureHandle(asset);
+}
+
+ShaderHandle AssetManager::loadShaderProgram(const std::vector<ShaderStage>& stages, std::function<void(std::shared_ptr<ShaderProgram>)> onReady)
+{
+	// The same files with different defines are different programs
+	std::string name = "shader:";
+	for (unsigned int i = 0; i < stages.size(); i++)
+		name += stages[i].fileName + "[" + stages[i].defines + "];";
+
+	std::shared_ptr<AssetOf<ShaderProgram>> asset = std::static_pointer_cast<AssetOf<ShaderProgram>>(findCached(name));
+	if (asset)
+	{
+		addReadyCallback(*asset, onReady);
+		return ShaderHandle(asset);
+	}
+
+	std::shared_ptr<ShaderProgram> program = std::make_shared<ShaderProgram>();
+	asset = std::make_shared<AssetOf<ShaderProgram>>(name, program);
+	addReadyCallback(*asset, onReady);
+
+	// The shaders only have to live until the program is linked
+	std::shared_ptr<std::vector<Shader>> shaders = std::make_shared<std::vector<Shader>>();
+
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->asset = asset;
+	for (unsigned int i = 0; i < stages.size(); i++)
+		request->fileNames.push_back(stages[i].fileName);
+
+	// Nothing to decode, the source goes straight to the driver
+	request->upload = [program, shaders, stages](Request& r)
+	{
+		if (shaders->empty())
+		{
+			shaders->resize(stages.size());
+
+			for (unsigned int i = 0; i < stages.size(); i++)
+			{
+				std::string source((const char*)r.files[i].data(), r.files[i].size());
+				if ((*shaders)[i].submitShaderFromSource(source, stages[i].fileName, stages[i].type, stages[i].defines) == 0)
+					return UPLOAD_FAILED;
+
+				program->attachShader((*shaders)[i]);
+			}
+
+			program->submitLink();
+			r.files.clear();
+		}
+
+		// Without GL_ARB_parallel_shader_compile these are always complete, and the checks below wait
+		for (unsigned int i = 0; i < shaders->size(); i++)
+		{
+			if (!(*shaders)[i].isCompileComplete())
+				return UPLOAD_WAITING;
+		}
+
+		if (!program->isLinkComplete())
+			return UPLOAD_WAITING;
+
+		for (unsigned int i = 0; i < shaders->size(); i++)
+			(*shaders)[i].checkCompileStatus();
+
+		bool linked = program->checkLinkStatus() != 0;
+
+		shaders->clear();
+		return linked ? UPLOAD_DONE : UPLOAD_FAILED;
+	};
+
+	submit(request);
+	return ShaderHandle(asset);
+}
+
+void AssetManager::submit(std::shared_ptr<Request> request)
+{
+	request->filesRead = false;
+	request->filesLeft = 0;
+	request->decoded = true;
+	request->startTime = std::chrono::high_resolution_clock::now();
+
+	cache[request->asset->getName()] = request->asset;
+
+	if (numPending == 0)
+	{
+		batchStartTime = request->startTime;
+		batchSize = 0;
+		slowestLoadMS = 0.0;
+		slowestAsset.clear();
+	}
+	numPending++;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		ioQueue.push_back(request);
+	}
+	ioCondition.notify_one();
+}
+
+std::shared_ptr<Asset> AssetManager::findCached(const std::string& name)
+{
+	auto itr = cache.find(name);
+	if (itr == cache.end())
+		return nullptr;
+
+	// Gone once every handle to it is, and failed loads are tried again
+	std::shared_ptr<Asset> asset = itr->second.lock();
+	if (!asset || asset->getState() == ASSET_FAILED)
+	{
+		cache.erase(itr);
+		return nullptr;
+	}
+
+	return asset;
+}
+
+void AssetManager::update()
+{
+	PROFILE_SCOPE("asset uploads");
+
+	// A member rather than a local, an empty std::deque still allocates, and this runs every frame
+	std::deque<std::shared_ptr<Request>>& decoded = decodedRequests;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		decoded.swap(uploadQueue);
+	}
+
+	for (unsigned int i = 0; i < decoded.size(); i++)
+	{
+		if (decoded[i]->filesRead && decoded[i]->decoded)
+			uploading.push_back(decoded[i]);
+		else
+			finish(*decoded[i], false);
+	}
+	decoded.clear();
+
+	for (unsigned int i = 0; i < uploading.size();)
+	{
+		UploadResult result = uploading[i]->upload(*uploading[i]);
+
+		if (result == UPLOAD_WAITING)
+		{
+			i++;
+			continue;
+		}
+
+		finish(*uploading[i], result == UPLOAD_DONE);
+		uploading.erase(uploading.begin() + i);
+	}
+
+	// Copies as much of the queued textures as the budget allows, they're finished above once they're done
+	if (textureStreamer)
+		textureStreamer->update();
+}
+
+void AssetManager::waitForAll()
+{
+	// Nothing would ever finish
+	if (!ioThread.joinable())
+		return;
+
+	while (numPending > 0)
+	{
+		update();
+
+		if (numPending > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+unsigned int AssetManager::getNumPending()
+{
+	return numPending;
+}
+
+void AssetManager::finish(Request& request, bool succeeded)
+{
+	Asset& asset = *request.asset;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - request.startTime;
+	asset.loadTimeMS = elapsed.count();
+
+	// Callbacks first (ie. adding a mesh to the mesh buffer), so nothing sees the asset ready without them
+	if (succeeded)
+	{
+		for (unsigned int i = 0; i < asset.readyCallbacks.size(); i++)
+			asset.readyCallbacks[i]();
+	}
+	else
+	{
+		std::cout << "AssetManager: could not load " << asset.getName() << std::endl;
+	}
+
+	asset.readyCallbacks.clear();
+	asset.state.store(succeeded ? ASSET_READY : ASSET_FAILED, std::memory_order_release);
+
+	batchSize++;
+	if (asset.loadTimeMS > slowestLoadMS)
+	{
+		slowestLoadMS = asset.loadTimeMS;
+		slowestAsset = asset.getName();
+	}
+
+	numPending--;
+	if (numPending == 0)
+	{
+		std::chrono::duration<double, std::milli> batchTime = std::chrono::high_resolution_clock::now() - batchStartTime;
+		printf("AssetManager: %u assets loaded in %.2f ms (slowest %s, %.2f ms)\n",
+			batchSize, batchTime.count(), slowestAsset.c_str(), slowestLoadMS);
+	}
+}
+
+void AssetManager::ioLoop()
+{
+	// Reads go out in batches, so a cold start keeps the disk busy instead of waiting on it one file at a time
+	TTK::IO::BatchReader reader;
+	reader.create();
+
+	while (true)
+	{
+		std::deque<std::shared_ptr<Request>> requests;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			ioCondition.wait(lock, [&]() { return stopThreads || !ioQueue.empty() || reader.getNumPending() > 0; });
+
+			if (stopThreads)
+				return;
+
+			requests.swap(ioQueue);
+		}
+
+		for (unsigned int i = 0; i < requests.size(); i++)
+		{
+			std::shared_ptr<Request> request = requests[i];
+			request->files.resize(request->fileNames.size());
+			request->filesRead = true;
+			request->filesLeft = (unsigned int)request->fileNames.size();
+
+			for (unsigned int j = 0; j < request->fileNames.size(); j++)
+			{
+				reader.read(request->fileNames[j], [this, request, j](const std::string&, bool succeeded, TTK::IO::FileView& file)
+				{
+					request->files[j] = file;
+					request->filesRead &= succeeded;
+
+					if (--request->filesLeft == 0)
+						queueDecode(request);
+				});
+			}
+		}
+
+		reader.submit();
+
+		{
+			PROFILE_SCOPE("read assets");
+
+			// Only reading here, so a slow disk never holds up a worker
+			reader.wait();
+		}
+	}
+}
+
+void AssetManager::queueDecode(std::shared_ptr<Request> request)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		if (request->filesRead && request->decode)
+			decodeQueue.push_back(request);
+		else
+			uploadQueue.push_back(request);
+	}
+	decodeCondition.notify_one();
+}
+
+void AssetManager::workerLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<Request> request;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			decodeCondition.wait(lock, [this]() { return stopThreads || !decodeQueue.empty(); });
+
+			if (stopThreads)
+				return;
+
+			request = decodeQueue.front();
+			decodeQueue.pop_front();
+		}
+
+		{
+			PROFILE_SCOPE("decode asset");
+
+			request->decoded = request->decode(*request);
+
+			// Done with the file's bytes (and any pack they point into)
+			request->files.clear();
+		}
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		uploadQueue.push_back(request);
+	}
+}
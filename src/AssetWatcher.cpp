@@ -0,0 +1,245 @@
+#include "AssetWatcher.h"
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+namespace
+{
+	// Saving writes and closes the file, or (for editors that save a copy first) moves the
+	// copy over it. Deleting isn't a change, the new file shows up as one of these.
+	const unsigned int WATCHED_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+}
+#endif
+
+AssetWatcher::AssetWatcher()
+{
+	pollIntervalMS = 250;
+	lastPollTime = std::chrono::steady_clock::now();
+	inotifyFd = -1;
+
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (inotifyFd < 0)
+		std::cout << "AssetWatcher: inotify isn't available, checking timestamps instead" << std::endl;
+	else
+		eventBuffer.resize(16 * 1024); // room for a few hundred events
+#endif
+}
+
+AssetWatcher::~AssetWatcher()
+{
+	clear();
+
+#ifdef __linux__
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+}
+
+void AssetWatcher::watchFile(const std::string& fileName, Callback onChanged)
+{
+	// operator[] creates the entry the first time we see this file
+	WatchedFile& file = watchedFiles[fileName];
+
+	if (file.callbacks.empty())
+	{
+		if (!getFileInfo(fileName, file.lastWriteTime, file.lastSize))
+		{
+			file.lastWriteTime = -1;
+			file.lastSize = -1;
+		}
+
+		file.notified = watchDirectory(fileName);
+	}
+
+	file.callbacks.push_back(onChanged);
+}
+
+void AssetWatcher::clear()
+{
+#ifdef __linux__
+	for (auto itr = watchedDirectories.begin(); itr != watchedDirectories.end(); ++itr)
+		inotify_rm_watch(inotifyFd, itr->first);
+#endif
+
+	watchedDirectories.clear();
+	watchedFiles.clear();
+}
+
+void AssetWatcher::poll()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPollTime).count() < pollIntervalMS)
+		return;
+
+	lastPollTime = now;
+
+	// A file saved in a few steps has a few events, it's only reloaded once
+	std::vector<std::string> changed;
+	bool lostEvents = readEvents(changed);
+
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+	for (unsigned int i = 0; i < changed.size(); i++)
+	{
+		auto itr = watchedFiles.find(changed[i]);
+
+		// Some other file in the same folder
+		if (itr == watchedFiles.end())
+			continue;
+
+		getFileInfo(itr->first, itr->second.lastWriteTime, itr->second.lastSize);
+		notifyChanged(itr->first, itr->second);
+	}
+
+	// Files inotify isn't watching, or all of them if some of its events were lost
+	for (auto itr = watchedFiles.begin(); itr != watchedFiles.end(); ++itr)
+	{
+		if (itr->second.notified && !lostEvents)
+			continue;
+
+		long long writeTime, size;
+
+		// Editors often delete the file and write a new one when saving,
+		// ignore the moment where it does not exist
+		if (!getFileInfo(itr->first, writeTime, size))
+			continue;
+
+		if (writeTime == itr->second.lastWriteTime && size == itr->second.lastSize)
+			continue;
+
+		itr->second.lastWriteTime = writeTime;
+		itr->second.lastSize = size;
+
+		notifyChanged(itr->first, itr->second);
+	}
+}
+
+void AssetWatcher::notifyChanged(const std::string& fileName, WatchedFile& file)
+{
+	std::cout << "Asset changed, reloading: " << fileName << std::endl;
+
+	// Only the assets that depend on this file are rebuilt
+	for (unsigned int i = 0; i < file.callbacks.size(); i++)
+		file.callbacks[i](fileName);
+}
+
+bool AssetWatcher::getFileInfo(const std::string& fileName, long long& writeTime, long long& size)
+{
+#ifdef _WIN32
+	// stat() only has whole seconds on Windows, the file's attributes have 100 ns
+	WIN32_FILE_ATTRIBUTE_DATA info;
+
+	if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &info))
+		return false;
+
+	writeTime = ((long long)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+	size = ((long long)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+#else
+	struct stat info;
+
+	if (stat(fileName.c_str(), &info) != 0)
+		return false;
+
+	// Seconds alone would miss a change saved within a second of the last one
+	// (ie. tweaking a constant in a shader) if the size stayed the same
+#if defined(__APPLE__)
+	writeTime = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+	writeTime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+
+	size = (long long)info.st_size;
+#endif
+
+	return true;
+}
+
+bool AssetWatcher::watchDirectory(const std::string& fileName)
+{
+#ifdef __linux__
+	if (inotifyFd < 0)
+		return false;
+
+	size_t slash = fileName.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : fileName.substr(0, slash);
+
+	// Watching a folder twice gives back the same descriptor
+	int descriptor = inotify_add_watch(inotifyFd, directory.c_str(), WATCHED_EVENTS);
+
+	if (descriptor < 0)
+	{
+		std::cout << "AssetWatcher: can't watch " << directory << ", checking its timestamps instead" << std::endl;
+		return false;
+	}
+
+	watchedDirectories[descriptor] = directory;
+	return true;
+#else
+	(void)fileName;
+	return false;
+#endif
+}
+
+bool AssetWatcher::readEvents(std::vector<std::string>& changed)
+{
+	bool lostEvents = false;
+
+#ifdef __linux__
+	if (inotifyFd < 0)
+		return false;
+
+	for (;;)
+	{
+		ssize_t length = read(inotifyFd, &eventBuffer[0], eventBuffer.size());
+
+		// EAGAIN, no more events
+		if (length <= 0)
+			break;
+
+		for (ssize_t offset = 0; offset < length; )
+		{
+			const inotify_event* event = (const inotify_event*)&eventBuffer[offset];
+			offset += sizeof(inotify_event) + event->len;
+
+			// Too many events came in between polls and some were dropped
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				lostEvents = true;
+				continue;
+			}
+
+			auto directory = watchedDirectories.find(event->wd);
+
+			if (directory == watchedDirectories.end() || event->len == 0)
+				continue;
+
+			// Same form as the name the file was watched with
+			if (directory->second == ".")
+				changed.push_back(event->name);
+			else
+				changed.push_back(directory->second + "/" + event->name);
+		}
+	}
+#else
+	(void)changed;
+#endif
+
+	return lostEvents;
+}
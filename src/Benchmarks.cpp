@@ -0,0 +1,985 @@
+#include "Benchmarks.h"
+#include "ThreadPool.h"
+#include "TTK/SkinnedMesh.h"
+#include "AnimationClip.h"
+#include "Animator.h"
+#include "EntityRegistry.h"
+#include "MeshCodec.h"
+#include "Meshlet.h"
+#include "TTK/PackFile.h"
+#include "TTK/LZ4.h"
+#include "TTK/BatchReader.h"
+#include "TTK/ImageDecoder.h"
+#include "TTK/TextureAtlas.h"
+#include "SpriteBatch.h"
+#include "TTK/DebugDraw.h"
+#include <IL/il.h>
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <atomic>
+#include <glm/gtx/transform.hpp>
+
+// Runs func until at least minTimeMS has passed (and at least minRuns times)
+// Returns the fastest run in milliseconds, the fastest is the least disturbed by everything else running
+static double timeBest(std::function<void()> func, double minTimeMS = 250.0, int minRuns = 3)
+{
+	double best = 1e30;
+	double total = 0.0;
+
+	for (int run = 0; run < minRuns || total < minTimeMS; run++)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		func();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		total += elapsed.count();
+		if (elapsed.count() < best)
+			best = elapsed.count();
+	}
+
+	return best;
+}
+
+// Skinning
+
+static const unsigned int NUM_BENCH_JOINTS = 64;
+
+// Builds a mesh with random vertices, each weighted to 4 random joints
+static void makeRandomSkinnedMesh(TTK::SkinnedMesh& mesh, unsigned int numVertices, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> weight(0.0f, 1.0f);
+	std::uniform_int_distribution<int> joint(0, NUM_BENCH_JOINTS - 1);
+
+	mesh.vertices.resize(numVertices);
+	mesh.normals.resize(numVertices);
+	mesh.jointIndices.resize(numVertices);
+	mesh.jointWeights.resize(numVertices);
+
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		mesh.vertices[i] = glm::vec3(position(rng), position(rng), position(rng));
+		mesh.normals[i] = glm::normalize(glm::vec3(position(rng), position(rng), position(rng)) + glm::vec3(0.0f, 0.0f, 0.01f));
+
+		glm::vec4 w(weight(rng), weight(rng), weight(rng), weight(rng));
+		mesh.jointWeights[i] = w / (w.x + w.y + w.z + w.w);
+		mesh.jointIndices[i] = glm::u16vec4(joint(rng), joint(rng), joint(rng), joint(rng));
+	}
+
+	mesh.inverseBindMatrices.assign(NUM_BENCH_JOINTS, glm::mat4(1.0f));
+}
+
+static int benchSkinning()
+{
+	std::cout << "---- Skinning (" << NUM_BENCH_JOINTS << " joints, 4 weights per vertex) ----" << std::endl;
+
+	if (!TTK::SkinnedMesh::hasSIMD())
+		std::cout << "SIMD kernel not compiled in (build with /arch:AVX2 or -mavx2), SIMD numbers use the plain kernel" << std::endl;
+
+	std::mt19937 rng(1234);
+	ThreadPool pool;
+
+	// Random rotations and translations for the joints
+	std::vector<glm::mat4> jointTransforms(NUM_BENCH_JOINTS);
+	std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+	for (unsigned int i = 0; i < NUM_BENCH_JOINTS; i++)
+	{
+		jointTransforms[i] = glm::translate(glm::vec3(angle(rng), angle(rng), angle(rng))) *
+			glm::rotate(angle(rng), glm::normalize(glm::vec3(angle(rng), angle(rng), angle(rng)) + glm::vec3(0.01f)));
+	}
+
+	unsigned int vertexCounts[] = { 10000, 100000, 1000000 };
+	int result = 0;
+
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		unsigned int numVertices = vertexCounts[c];
+
+		TTK::SkinnedMesh mesh;
+		makeRandomSkinnedMesh(mesh, numVertices, rng);
+
+		std::vector<TTK::SkinMatrix> matrices;
+		mesh.computeSkinMatrices(&jointTransforms[0], NUM_BENCH_JOINTS, matrices);
+
+		std::vector<glm::vec3> plainPositions(numVertices), plainNormals(numVertices);
+		std::vector<glm::vec3> simdPositions(numVertices), simdNormals(numVertices);
+
+		double plainMS = timeBest([&]()
+		{
+			mesh.skinRange(&matrices[0], 0, numVertices, &plainPositions[0], &plainNormals[0], false);
+		});
+
+		double simdMS = timeBest([&]()
+		{
+			mesh.skinRange(&matrices[0], 0, numVertices, &simdPositions[0], &simdNormals[0], true);
+		});
+
+		// Make sure the SIMD kernel gets the same answer
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < numVertices; i++)
+		{
+			glm::vec3 d = glm::abs(plainPositions[i] - simdPositions[i]) + glm::abs(plainNormals[i] - simdNormals[i]);
+			maxError = std::max(maxError, std::max(d.x, std::max(d.y, d.z)));
+		}
+
+		double threadedMS = timeBest([&]()
+		{
+			pool.parallelFor(numVertices, mesh.chunkSize, [&](unsigned int begin, unsigned int end)
+			{
+				mesh.skinRange(&matrices[0], begin, end, &simdPositions[begin], &simdNormals[begin], true);
+			});
+		});
+
+		printf("%8u vertices  plain %8.3f ms (%6.1f Mverts/s)  simd %8.3f ms (%6.1f Mverts/s)  simd x%u threads %8.3f ms (%6.1f Mverts/s)  max error %g\n",
+			numVertices,
+			plainMS, numVertices / plainMS / 1000.0,
+			simdMS, numVertices / simdMS / 1000.0,
+			pool.getNumThreads(), threadedMS, numVertices / threadedMS / 1000.0,
+			maxError);
+
+		if (maxError > 1e-3f)
+		{
+			std::cout << "Skinning: SIMD and plain kernels disagree!" << std::endl;
+			result = 1;
+		}
+	}
+
+	return result;
+}
+
+// Animation
+
+// A made up walk-like animation: every joint's rotation is a few sine waves,
+// the root also moves around, the rest keep their bone offsets
+static void makeRandomAnimation(RawAnimation& raw, unsigned int numJoints, float seconds, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> random(0.0f, 1.0f);
+
+	raw.name = "benchmark";
+	raw.sampleRate = 30.0f;
+	raw.numFrames = (unsigned int)(seconds * raw.sampleRate) + 1;
+	raw.jointNames.clear();
+	raw.frames.resize(raw.numFrames * numJoints);
+
+	for (unsigned int j = 0; j < numJoints; j++)
+	{
+		raw.jointNames.push_back("joint" + std::to_string(j));
+
+		glm::vec3 boneOffset(random(rng) - 0.5f, random(rng) + 0.5f, random(rng) - 0.5f);
+		glm::vec3 axis = glm::normalize(glm::vec3(random(rng), random(rng), random(rng)) + glm::vec3(0.01f));
+
+		float frequencies[3], phases[3], amplitudes[3];
+		for (int w = 0; w < 3; w++)
+		{
+			frequencies[w] = (w + 1) * (0.5f + random(rng));
+			phases[w] = random(rng) * 6.28318f;
+			amplitudes[w] = (0.6f - w * 0.2f) * random(rng);
+		}
+
+		for (unsigned int f = 0; f < raw.numFrames; f++)
+		{
+			float t = f / raw.sampleRate;
+
+			float angle = 0.0f;
+			for (int w = 0; w < 3; w++)
+				angle += amplitudes[w] * sin(t * frequencies[w] + phases[w]);
+
+			JointPose& pose = raw.frames[f * numJoints + j];
+			pose.translation = j == 0 ? glm::vec3(sin(t) * 2.0f, 1.0f + 0.05f * sin(t * 4.0f), cos(t) * 2.0f) : boneOffset;
+			pose.rotation = glm::angleAxis(angle, axis);
+			pose.scale = glm::vec3(1.0f);
+		}
+	}
+}
+
+static int benchAnimation()
+{
+	const unsigned int NUM_JOINTS = 64;
+	const unsigned int NUM_CHARACTERS = 1000;
+	const float FRAME_TIME = 1.0f / 60.0f;
+
+	std::cout << "---- Animation (" << NUM_JOINTS << " joints, 10 second clip at 30 Hz) ----" << std::endl;
+
+	std::mt19937 rng(1234);
+
+	RawAnimation raw;
+	makeRandomAnimation(raw, NUM_JOINTS, 10.0f, rng);
+
+	std::shared_ptr<AnimationClip> clip = std::make_shared<AnimationClip>();
+	clip->build(raw);
+	clip->printStats();
+
+	// Compare against every raw frame
+	AnimationCursor cursor;
+	std::vector<JointPose> poses(NUM_JOINTS);
+	float maxTranslationError = 0.0f;
+	float maxRotationError = 0.0f;
+
+	for (unsigned int f = 0; f < raw.numFrames; f++)
+	{
+		clip->sample(f / raw.sampleRate, cursor, &poses[0]);
+
+		for (unsigned int j = 0; j < NUM_JOINTS; j++)
+		{
+			const JointPose& expected = raw.frames[f * NUM_JOINTS + j];
+
+			maxTranslationError = std::max(maxTranslationError, glm::length(poses[j].translation - expected.translation));
+			maxRotationError = std::max(maxRotationError, AnimationClip::angleBetween(poses[j].rotation, expected.rotation));
+		}
+	}
+
+	printf("max error: translation %g units, rotation %g degrees\n", maxTranslationError, glm::degrees(maxRotationError));
+
+	// One character playing forwards, the cursor only steps to the next key
+	float time = 0.0f;
+	double sequentialMS = timeBest([&]()
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			time = fmod(time + FRAME_TIME, clip->getDuration());
+			clip->sample(time, cursor, &poses[0]);
+		}
+	});
+
+	// Random times, every track has to search for its keys
+	std::uniform_real_distribution<float> randomTime(0.0f, clip->getDuration());
+	std::vector<float> times(1000);
+	for (unsigned int i = 0; i < times.size(); i++)
+		times[i] = randomTime(rng);
+
+	double randomMS = timeBest([&]()
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			cursor.reset();
+			clip->sample(times[i], cursor, &poses[0]);
+		}
+	});
+
+	// 1000 samples each, so the milliseconds are also microseconds per sample
+	printf("1 character:  sequential (cursor) %6.3f us  random access %6.3f us\n", sequentialMS, randomMS);
+
+	// A crowd, all at different points in the clip
+	std::vector<Animator> crowd(NUM_CHARACTERS);
+	std::vector<Animator*> crowdPointers(NUM_CHARACTERS);
+	for (unsigned int i = 0; i < NUM_CHARACTERS; i++)
+	{
+		crowd[i].setClip(clip, std::vector<GameObject*>());
+		crowd[i].time = randomTime(rng);
+		crowdPointers[i] = &crowd[i];
+	}
+
+	ThreadPool pool;
+
+	double serialMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < NUM_CHARACTERS; i++)
+			crowd[i].update(FRAME_TIME);
+		Animator::sampleAll(crowdPointers, nullptr);
+	});
+
+	double parallelMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < NUM_CHARACTERS; i++)
+			crowd[i].update(FRAME_TIME);
+		Animator::sampleAll(crowdPointers, &pool);
+	});
+
+	printf("%u characters: serial %7.3f ms (%6.3f us each)  x%u threads %7.3f ms (%6.3f us each)\n",
+		NUM_CHARACTERS,
+		serialMS, serialMS * 1000.0 / NUM_CHARACTERS,
+		pool.getNumThreads(), parallelMS, parallelMS * 1000.0 / NUM_CHARACTERS);
+
+	if (maxTranslationError > 0.01f || maxRotationError > 0.01f)
+	{
+		std::cout << "Animation: compressed clip is too far from the raw animation!" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// Entities
+
+static int benchEntities()
+{
+	const unsigned int NUM_OBJECTS = 100000;
+
+	std::cout << "---- Entities (" << NUM_OBJECTS << " game objects) ----" << std::endl;
+
+	std::mt19937 rng(1234);
+
+	// The old way: each object on its own in the heap, in a map by name
+	std::map<std::string, std::shared_ptr<GameObject>> objectMap;
+	EntityRegistry registry;
+	std::vector<std::string> names(NUM_OBJECTS);
+	std::vector<EntityHandle> handles(NUM_OBJECTS);
+
+	for (unsigned int i = 0; i < NUM_OBJECTS; i++)
+	{
+		glm::vec3 position((float)(i % 100), 0.0f, (float)(i / 100));
+		names[i] = "object" + std::to_string(i);
+
+		objectMap[names[i]] = std::make_shared<GameObject>(position, nullptr, nullptr);
+		handles[i] = registry.create(names[i], position, nullptr, nullptr);
+	}
+
+	for (auto itr = objectMap.begin(); itr != objectMap.end(); ++itr)
+		itr->second->update(0.0f);
+	for (unsigned int i = 0; i < registry.size(); i++)
+		registry[i]->update(0.0f);
+
+	// Go over every root and read its transform, like the update and draw loops do
+	glm::vec3 mapSum, registrySum;
+
+	double mapIterateMS = timeBest([&]()
+	{
+		mapSum = glm::vec3(0.0f);
+		for (auto itr = objectMap.begin(); itr != objectMap.end(); ++itr)
+		{
+			if (itr->second->isRoot())
+				mapSum += glm::vec3(itr->second->getLocalToWorldMatrix()[3]);
+		}
+	});
+
+	double registryIterateMS = timeBest([&]()
+	{
+		registrySum = glm::vec3(0.0f);
+		for (unsigned int i = 0; i < registry.size(); i++)
+		{
+			if (registry[i]->isRoot())
+				registrySum += glm::vec3(registry[i]->getLocalToWorldMatrix()[3]);
+		}
+	});
+
+	// Random lookups, by name vs by handle
+	std::vector<unsigned int> order(NUM_OBJECTS);
+	for (unsigned int i = 0; i < NUM_OBJECTS; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	int numFound = 0;
+
+	double mapLookupMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < NUM_OBJECTS; i++)
+			numFound += objectMap.find(names[order[i]]) != objectMap.end();
+	});
+
+	double registryLookupMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < NUM_OBJECTS; i++)
+			numFound += registry.get(handles[order[i]]) != nullptr;
+	});
+
+	printf("iterate all:        map %8.3f ms  registry %8.3f ms  (%.1fx)\n",
+		mapIterateMS, registryIterateMS, mapIterateMS / registryIterateMS);
+	printf("%u lookups:     map %8.3f ms  registry %8.3f ms  (%.1fx)\n",
+		NUM_OBJECTS, mapLookupMS, registryLookupMS, mapLookupMS / registryLookupMS);
+
+	// Destroyed handles must stop working, everything else must still be found
+	for (unsigned int i = 0; i < NUM_OBJECTS; i += 2)
+		registry.destroy(handles[i]);
+
+	// (the sums are added up in a different order, so only roughly the same)
+	bool ok = registry.size() == NUM_OBJECTS / 2 && glm::length(mapSum - registrySum) <= 1e-4f * glm::length(mapSum);
+	for (unsigned int i = 0; i < NUM_OBJECTS && ok; i++)
+	{
+		GameObject* object = registry.get(handles[i]);
+		ok = (i % 2 == 0) ? object == nullptr : (object && object->name == names[i]);
+	}
+
+	if (!ok)
+	{
+		std::cout << "Entities: registry lost track of an object!" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// Meshes
+
+// A torus as a triangle soup, like a loaded OBJ: rings x segments quads, uvs tiled 4 times around
+static void makeTorus(TTK::MeshBase& mesh, unsigned int rings, unsigned int segments)
+{
+	const float MAJOR_RADIUS = 2.0f;
+	const float MINOR_RADIUS = 0.5f;
+
+	mesh.vertices.clear();
+	mesh.normals.clear();
+	mesh.textureCoordinates.clear();
+
+	// Corners of each quad, as (ring, segment) offsets, in two counter clockwise triangles
+	const unsigned int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+
+	for (unsigned int r = 0; r < rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			for (unsigned int c = 0; c < 6; c++)
+			{
+				float u = (float)(r + corners[c][0]) / rings;
+				float v = (float)(s + corners[c][1]) / segments;
+
+				float theta = u * 6.28318531f;
+				float phi = v * 6.28318531f;
+
+				glm::vec3 ringCentre(cos(theta) * MAJOR_RADIUS, 0.0f, sin(theta) * MAJOR_RADIUS);
+				glm::vec3 normal(cos(theta) * cos(phi), sin(phi), sin(theta) * cos(phi));
+
+				mesh.vertices.push_back(ringCentre + normal * MINOR_RADIUS);
+				mesh.normals.push_back(normal);
+				mesh.textureCoordinates.push_back(glm::vec2(u * 4.0f, v));
+			}
+		}
+	}
+}
+
+static int benchMeshes()
+{
+	std::cout << "---- Meshes (quantized vertices and cooked mesh codec) ----" << std::endl;
+	printf("float vertex %u bytes, quantized vertex %u bytes\n", (unsigned int)(sizeof(glm::vec3) * 2 + sizeof(glm::vec2)), (unsigned int)sizeof(QuantizedVertex));
+
+	unsigned int sizes[][2] = { { 64, 32 }, { 256, 128 }, { 1024, 256 } };
+	int result = 0;
+
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		TTK::MeshBase mesh;
+		makeTorus(mesh, sizes[c][0], sizes[c][1]);
+
+		QuantizedMesh quantized;
+		double quantizeMS = timeBest([&]()
+		{
+			quantizeMesh(mesh, quantized);
+		}, 100.0, 1);
+
+		// Right after quantizing, index i is still soup vertex i
+		float maxPositionError = 0.0f;
+		float maxNormalError = 0.0f;
+		float maxUVError = 0.0f;
+		for (unsigned int i = 0; i < mesh.vertices.size(); i++)
+		{
+			unsigned int v = quantized.indices[i];
+
+			maxPositionError = std::max(maxPositionError, glm::length(quantized.getPosition(v) - mesh.vertices[i]));
+			// atan2 rather than acos of the dot, which has no precision left for tiny angles
+			glm::vec3 normal = quantized.getNormal(v);
+			maxNormalError = std::max(maxNormalError, (float)atan2(glm::length(glm::cross(normal, mesh.normals[i])), glm::dot(normal, mesh.normals[i])));
+
+			glm::vec2 uvError = glm::abs(quantized.getUV(v) - mesh.textureCoordinates[i]);
+			maxUVError = std::max(maxUVError, std::max(uvError.x, uvError.y));
+		}
+
+		// The same order MeshBuffer puts a mesh in
+		std::vector<glm::vec3> positions(quantized.vertices.size());
+		for (unsigned int i = 0; i < positions.size(); i++)
+			positions[i] = quantized.getPosition(i);
+
+		std::vector<Meshlet> meshlets;
+		buildMeshlets(positions, quantized.indices, meshlets);
+		reorderVertices(quantized);
+
+		std::vector<unsigned char> cooked;
+		encodeMesh(quantized, cooked);
+
+		// Vertices on their own, to split the size between vertices and indices
+		QuantizedMesh verticesOnly;
+		verticesOnly.positionOffset = quantized.positionOffset;
+		verticesOnly.positionScale = quantized.positionScale;
+		verticesOnly.vertices = quantized.vertices;
+		std::vector<unsigned char> cookedVertices;
+		encodeMesh(verticesOnly, cookedVertices);
+
+		unsigned int numVertices = (unsigned int)quantized.vertices.size();
+		unsigned int numTriangles = (unsigned int)quantized.indices.size() / 3;
+		size_t vertexBytes = cookedVertices.size();
+		size_t indexBytes = cooked.size() - cookedVertices.size();
+
+		QuantizedMesh decoded;
+		bool decodedOK = true;
+		double decodeMS = timeBest([&]()
+		{
+			decodedOK &= decodeMesh(&cooked[0], cooked.size(), decoded);
+		});
+
+		bool lossless = decodedOK &&
+			decoded.positionOffset == quantized.positionOffset && decoded.positionScale == quantized.positionScale &&
+			decoded.vertices.size() == quantized.vertices.size() && decoded.indices == quantized.indices &&
+			memcmp(&decoded.vertices[0], &quantized.vertices[0], numVertices * sizeof(QuantizedVertex)) == 0;
+
+		// Bytes of vertices and indices decoded, as they go to the GPU
+		double decodedBytes = (double)numVertices * sizeof(QuantizedVertex) + (double)quantized.indices.size() * sizeof(unsigned int);
+		double rawBytes = (double)numVertices * 32.0 + (double)quantized.indices.size() * sizeof(unsigned int);
+
+		printf("%7u vertices %7u triangles  quantize %7.3f ms  cooked %5.2f bytes/vertex + %5.2f bytes/triangle (%4.1f%% of float)  decode %6.3f ms (%5.2f GB/s)  %s\n",
+			numVertices, numTriangles, quantizeMS,
+			(double)vertexBytes / numVertices, (double)indexBytes / numTriangles, 100.0 * cooked.size() / rawBytes,
+			decodeMS, decodedBytes / decodeMS / 1e6,
+			lossless ? "lossless" : "MISMATCH");
+		printf("        max error: position %g (%g of the mesh size), normal %g degrees, uv %g\n",
+			maxPositionError, maxPositionError / glm::length(quantized.positionScale), glm::degrees(maxNormalError), maxUVError);
+
+		if (!lossless)
+		{
+			std::cout << "Meshes: decoded mesh differs from the one encoded!" << std::endl;
+			result = 1;
+		}
+
+		// Half a step on each axis, 0.01 degrees and half a half float step at 4
+		if (maxPositionError > glm::length(quantized.positionScale) / 65535.0f || maxNormalError > glm::radians(0.01f) || maxUVError > 0.002f)
+		{
+			std::cout << "Meshes: quantization error is too big!" << std::endl;
+			result = 1;
+		}
+	}
+
+	return result;
+}
+
+// Asset packs
+
+static int benchPacks()
+{
+	const std::string assetPath = "../../Assets/";
+	const std::string packFileName = "bench_assets.pak";
+	const std::string compressedPackFileName = "bench_assets_lz4.pak";
+
+	std::cout << "---- Packs (" << assetPath << " loose vs packed) ----" << std::endl;
+
+	// Stored as is (the default), every file opens as a view into the mapping
+	TTK::PackWriter writer;
+	if (!writer.addDirectory(assetPath) || writer.getNumFiles() == 0 || !writer.write(packFileName))
+	{
+		std::cout << "Packs: nothing to pack in " << assetPath << std::endl;
+		return 1;
+	}
+
+	// The text files compressed as well, for what LZ4 saves and costs
+	std::vector<std::string> textExtensions;
+	textExtensions.push_back(".obj");
+	textExtensions.push_back(".glsl");
+
+	TTK::PackWriter compressedWriter;
+	if (!compressedWriter.addDirectory(assetPath, textExtensions) || !compressedWriter.write(compressedPackFileName))
+		return 1;
+
+	// Reading and compressing every asset again
+	double writeMS = timeBest([&]()
+	{
+		TTK::PackWriter rebuilt;
+		rebuilt.addDirectory(assetPath, textExtensions);
+	}, 100.0, 1);
+
+	TTK::PackFile pack;
+	if (!pack.open(compressedPackFileName))
+		return 1;
+
+	std::vector<std::string> names(pack.getNumEntries());
+	size_t compressedSize = 0, uncompressedSize = 0;
+	unsigned int numCompressed = 0;
+	for (unsigned int i = 0; i < pack.getNumEntries(); i++)
+	{
+		const TTK::PackEntry& entry = pack.getEntry(i);
+		names[i] = pack.getEntryName(entry);
+
+		if (entry.flags & TTK::PACK_ENTRY_LZ4)
+		{
+			compressedSize += entry.storedSize;
+			uncompressedSize += entry.size;
+			numCompressed++;
+		}
+	}
+
+	// Decompressing every compressed entry, straight from the mapping
+	std::vector<unsigned char> scratch;
+	bool decompressedOK = true;
+	double decompressMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < pack.getNumEntries(); i++)
+		{
+			if (pack.getEntry(i).flags & TTK::PACK_ENTRY_LZ4)
+				decompressedOK &= pack.readEntry(pack.getEntry(i), scratch);
+		}
+	});
+
+	printf("%u files, %.2f MB -> %.2f MB packed, %.2f MB with the text compressed (built in %.1f ms)\n", writer.getNumFiles(),
+		writer.getTotalSize() / (1024.0 * 1024.0), writer.getTotalStoredSize() / (1024.0 * 1024.0),
+		compressedWriter.getTotalStoredSize() / (1024.0 * 1024.0), writeMS);
+	printf("LZ4 (.obj and .glsl): %u files compressed to %.1f%%, decompress %.3f ms (%.2f GB/s)\n",
+		numCompressed, uncompressedSize ? 100.0 * compressedSize / uncompressedSize : 0.0,
+		decompressMS, uncompressedSize / decompressMS / 1e6);
+
+	// Opening every file, from disk then from the mounted pack
+	std::vector<TTK::IO::FileView> loose(names.size()), packed(names.size());
+	unsigned int diskOpens = TTK::IO::getNumDiskOpens();
+
+	double looseMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < names.size(); i++)
+			TTK::IO::openFile(assetPath + names[i], loose[i]);
+	});
+
+	// The same files asked for all at once
+	std::vector<TTK::IO::FileView> batched(names.size());
+	TTK::IO::BatchReader reader;
+	reader.create();
+
+	double batchedMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < names.size(); i++)
+		{
+			reader.read(assetPath + names[i], [&batched, i](const std::string&, bool, TTK::IO::FileView& file)
+			{
+				batched[i] = file;
+			});
+		}
+		reader.waitForAll();
+	});
+
+	TTK::IO::mountPack(packFileName, assetPath);
+	unsigned int packedOpens = TTK::IO::getNumPackedOpens();
+
+	double packedMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < names.size(); i++)
+			TTK::IO::openFile(assetPath + names[i], packed[i]);
+	});
+
+	bool sameBytes = decompressedOK && TTK::IO::getNumPackedOpens() > packedOpens && TTK::IO::getNumDiskOpens() > diskOpens;
+	unsigned int numZeroCopy = 0;
+	for (unsigned int i = 0; i < names.size() && sameBytes; i++)
+	{
+		sameBytes = loose[i].size() == packed[i].size() && memcmp(loose[i].data(), packed[i].data(), loose[i].size()) == 0 &&
+			loose[i].size() == batched[i].size() && memcmp(loose[i].data(), batched[i].data(), loose[i].size()) == 0;
+		numZeroCopy += packed[i].isZeroCopy();
+	}
+
+	printf("open every file: loose %8.3f ms  packed %8.3f ms  (%.1fx, %u of %u zero copy)  %s\n",
+		looseMS, packedMS, looseMS / packedMS, numZeroCopy, (unsigned int)names.size(), sameBytes ? "same bytes" : "MISMATCH");
+	printf("batched loose reads (%s): %8.3f ms  (%.1fx one at a time)\n",
+		reader.isUsingIoUring() ? "io_uring" : "threads", batchedMS, looseMS / batchedMS);
+
+	// The views keep the pack mapped, so they go before the file does
+	TTK::IO::unmountAll();
+	loose.clear();
+	packed.clear();
+	batched.clear();
+	pack.close();
+	std::remove(packFileName.c_str());
+	std::remove(compressedPackFileName.c_str());
+
+	if (!sameBytes)
+	{
+		std::cout << "Packs: packed files differ from the loose ones!" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// Image decoding
+
+static int benchImages()
+{
+	const std::string texturePath = "../../Assets/Textures/";
+	const char* fileNames[] = { "dkong.png", "dkong2.png" };
+
+	// Each texture is decoded this many times per run, about what a level's worth of textures costs
+	const unsigned int NUM_COPIES = 64;
+
+	std::cout << "---- Images (" << NUM_COPIES << " decodes of each texture, ImageDecoder vs DevIL) ----" << std::endl;
+
+	ilInit();
+	ilEnable(IL_ORIGIN_SET);
+	ilOriginFunc(IL_ORIGIN_UPPER_LEFT);
+
+	ThreadPool pool;
+	int result = 0;
+
+	for (const char* fileName : fileNames)
+	{
+		TTK::IO::FileView file;
+		TTK::ImageInfo info;
+		if (!TTK::IO::openFile(texturePath + fileName, file) || !TTK::ImageDecoder::readInfo(file.data(), file.size(), info))
+		{
+			std::cout << "Images: couldn't read " << texturePath << fileName << std::endl;
+			result = 1;
+			continue;
+		}
+
+		// Every copy gets its own part of one buffer, like decoding into pooled staging memory
+		size_t imageBytes = (size_t)info.width * info.height * 4;
+		std::vector<unsigned char> pixels(imageBytes * NUM_COPIES);
+		double megapixels = (double)info.width * info.height * NUM_COPIES / 1e6;
+
+		TTK::ImageDecoder decoder;
+		bool decodedOK = true;
+		double singleMS = timeBest([&]()
+		{
+			for (unsigned int i = 0; i < NUM_COPIES; i++)
+				decodedOK &= decoder.decode(file.data(), file.size(), &pixels[i * imageBytes], false);
+		});
+
+		// Every thread at once, each with its own decoder as the asset manager's workers have
+		std::atomic<bool> threadedOK(true);
+		double threadedMS = timeBest([&]()
+		{
+			pool.parallelFor(NUM_COPIES, 1, [&](unsigned int begin, unsigned int end)
+			{
+				static thread_local TTK::ImageDecoder threadDecoder;
+				for (unsigned int i = begin; i < end; i++)
+				{
+					if (!threadDecoder.decode(file.data(), file.size(), &pixels[i * imageBytes], false))
+						threadedOK = false;
+				}
+			});
+		});
+
+		// DevIL decodes into its bound image, so it can only do one at a time
+		ILuint imageID;
+		ilGenImages(1, &imageID);
+		ilBindImage(imageID);
+
+		double devilMS = timeBest([&]()
+		{
+			for (unsigned int i = 0; i < NUM_COPIES; i++)
+			{
+				ilLoadL(IL_PNG, file.data(), (ILuint)file.size());
+				ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+			}
+		});
+
+		// DevIL may apply the file's gamma, so differences are reported rather than failed
+		unsigned int numDifferent = 0;
+		const unsigned char* devilPixels = ilGetData();
+		for (size_t i = 0; devilPixels && i < imageBytes; i += 4)
+			numDifferent += memcmp(devilPixels + i, &pixels[i], 4) != 0;
+
+		ilDeleteImages(1, &imageID);
+
+		printf("%-10s %4ux%-4u  ImageDecoder %7.1f MP/s  %u threads %7.1f MP/s (%.1fx)  DevIL %7.1f MP/s (%.1fx slower)  %u pixels differ\n",
+			fileName, info.width, info.height, megapixels / singleMS * 1000.0,
+			pool.getNumThreads(), megapixels / threadedMS * 1000.0, singleMS / threadedMS,
+			megapixels / devilMS * 1000.0, devilMS / singleMS, numDifferent);
+
+		if (!decodedOK || !threadedOK)
+		{
+			std::cout << "Images: " << fileName << " failed to decode: " << decoder.getError() << std::endl;
+			result = 1;
+		}
+	}
+
+	return result;
+}
+
+// Sprites
+
+static int benchSprites()
+{
+	std::cout << "---- Sprites (atlas packing and filling a 100k sprite batch) ----" << std::endl;
+
+	std::mt19937 rng(49);
+	int result = 0;
+
+	// Packing: lots of small images like a game's sprites, and fewer big ones
+	struct PackTest
+	{
+		const char* name;
+		unsigned int count, minSize, maxSize;
+	};
+	PackTest packTests[] = { { "small", 2000, 8, 64 }, { "mixed", 500, 8, 256 } };
+
+	for (const PackTest& test : packTests)
+	{
+		std::uniform_int_distribution<unsigned int> sizeDist(test.minSize, test.maxSize);
+		std::vector<glm::uvec2> sizes(test.count);
+		for (unsigned int i = 0; i < test.count; i++)
+			sizes[i] = glm::uvec2(sizeDist(rng), sizeDist(rng));
+
+		// Tallest first, like TextureAtlas::build()
+		std::sort(sizes.begin(), sizes.end(), [](const glm::uvec2& a, const glm::uvec2& b) { return a.y != b.y ? a.y > b.y : a.x > b.x; });
+
+		TTK::AtlasPacker packer;
+		bool packedAll = true;
+		double packMS = timeBest([&]()
+		{
+			packer.reset(4096, 4096);
+			packedAll = true;
+			for (unsigned int i = 0; i < test.count; i++)
+			{
+				unsigned int x, y;
+				packedAll &= packer.pack(sizes[i].x, sizes[i].y, x, y);
+			}
+		});
+
+		// The same images through the atlas, to see how small it gets
+		TTK::TextureAtlas atlas;
+		for (unsigned int i = 0; i < test.count; i++)
+			atlas.addImage(std::vector<unsigned char>(sizes[i].x * sizes[i].y * 4, 255), sizes[i].x, sizes[i].y);
+
+		bool builtAtlas = atlas.build(4096, 1);
+
+		printf("pack %-5s %4u images %3u-%3u px: %7.3f ms  atlas %ux%u, %.1f%% covered\n", test.name, test.count,
+			test.minSize, test.maxSize, packMS, atlas.getWidth(), atlas.getHeight(), atlas.getOccupancy() * 100.0f);
+
+		if (!packedAll || !builtAtlas)
+		{
+			std::cout << "Sprites: the " << test.name << " images didn't fit" << std::endl;
+			result = 1;
+		}
+	}
+
+	// Filling a batch: what SpriteBatch::draw() writes per sprite, minus the GL calls
+	const unsigned int NUM_SPRITES = 100000;
+	std::vector<SpriteInstance> instances(NUM_SPRITES);
+	std::vector<glm::vec2> positions(NUM_SPRITES);
+	std::uniform_real_distribution<float> positionDist(0.0f, 1920.0f);
+	for (unsigned int i = 0; i < NUM_SPRITES; i++)
+		positions[i] = glm::vec2(positionDist(rng), positionDist(rng));
+
+	TTK::AtlasRegion region = { 1, 1, 32, 32, glm::vec2(0.0f), glm::vec2(0.5f) };
+	double fillMS = timeBest([&]()
+	{
+		for (unsigned int i = 0; i < NUM_SPRITES; i++)
+			SpriteBatch::writeSprite(instances[i], region, positions[i], glm::vec2(32.0f), glm::vec4(1.0f), i * 0.01f);
+	});
+
+	printf("fill %u sprites: %.3f ms (%.1f ns each), %.2f MB of instances per frame\n",
+		NUM_SPRITES, fillMS, fillMS * 1e6 / NUM_SPRITES, NUM_SPRITES * sizeof(SpriteInstance) / (1024.0 * 1024.0));
+
+	return result;
+}
+
+// Debug draw
+
+static int benchDebugDraw()
+{
+	std::cout << "---- Debug draw (building the SDF font and filling a frame of gizmos and labels) ----" << std::endl;
+
+	int result = 0;
+
+	// The first begin() builds the font, without create() it never touches OpenGL
+	double fontMS = timeBest([&]()
+	{
+		TTK::DebugDraw fontDebugDraw;
+		fontDebugDraw.begin(glm::mat4(1.0f), glm::vec2(1920.0f, 1080.0f));
+	});
+
+	printf("build font: %.3f ms\n", fontMS);
+
+	// Objects on a grid in front of the camera, each with a box, its axes and a label
+	// Sized to fit in DebugDraw's default room (200k line vertices, 50k glyphs)
+	const unsigned int NUM_OBJECTS = 5000;
+	std::vector<glm::mat4> transforms(NUM_OBJECTS);
+	std::vector<std::string> labels(NUM_OBJECTS);
+	for (unsigned int i = 0; i < NUM_OBJECTS; i++)
+	{
+		transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100) - 50.0f, (float)(i / 100) - 25.0f, -60.0f));
+		labels[i] = std::to_string(i);
+	}
+
+	glm::mat4 viewProj = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+	TTK::DebugDraw debugDraw;
+	double fillMS = timeBest([&]()
+	{
+		debugDraw.begin(viewProj, glm::vec2(1920.0f, 1080.0f));
+
+		for (unsigned int i = 0; i < NUM_OBJECTS; i++)
+		{
+			debugDraw.addBox(glm::vec3(-0.4f), glm::vec3(0.4f), glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), transforms[i]);
+			debugDraw.addAxes(transforms[i], 0.5f);
+			debugDraw.addText3D(labels[i], glm::vec3(transforms[i][3]), 12.0f);
+		}
+	});
+
+	unsigned int lineBytes = debugDraw.getNumLineVertices() * 16; // position and colour
+	unsigned int glyphBytes = debugDraw.getNumGlyphs() * (unsigned int)sizeof(SpriteInstance);
+
+	printf("fill %u boxes, axes and labels: %.3f ms (%.1f ns each), %u line vertices + %u glyphs, %.2f MB per frame\n",
+		NUM_OBJECTS, fillMS, fillMS * 1e6 / NUM_OBJECTS, debugDraw.getNumLineVertices(), debugDraw.getNumGlyphs(),
+		(lineBytes + glyphBytes) / (1024.0 * 1024.0));
+
+	if (debugDraw.getNumDropped() > 0)
+	{
+		std::cout << "Debug draw: " << debugDraw.getNumDropped() << " vertices and glyphs didn't fit" << std::endl;
+		result = 1;
+	}
+
+	return result;
+}
+
+int runBenchmarks(const std::string& name)
+{
+	bool all = name == "all";
+	bool ranAny = false;
+	int result = 0;
+
+	if (all || name == "skinning")
+	{
+		result |= benchSkinning();
+		ranAny = true;
+	}
+
+	if (all || name == "animation")
+	{
+		result |= benchAnimation();
+		ranAny = true;
+	}
+
+	if (all || name == "entities")
+	{
+		result |= benchEntities();
+		ranAny = true;
+	}
+
+	if (all || name == "meshes")
+	{
+		result |= benchMeshes();
+		ranAny = true;
+	}
+
+	if (all || name == "packs")
+	{
+		result |= benchPacks();
+		ranAny = true;
+	}
+
+	if (all || name == "images")
+	{
+		result |= benchImages();
+		ranAny = true;
+	}
+
+	if (all || name == "sprites")
+	{
+		result |= benchSprites();
+		ranAny = true;
+	}
+
+	if (all || name == "debugdraw")
+	{
+		result |= benchDebugDraw();
+		ranAny = true;
+	}
+
+	if (!ranAny)
+	{
+		std::cout << "Unknown benchmark: " << name << std::endl;
+		return 1;
+	}
+
+	return result;
+}
@@ -0,0 +1,102 @@
+#include "DepthPyramid.h"
+
+DepthPyramid::DepthPyramid()
+{
+	textureHandle = 0;
+	width = 0;
+	height = 0;
+	numLevels = 0;
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	destroy();
+}
+
+void DepthPyramid::setReduceShader(std::shared_ptr<ShaderProgram> _reduceShader)
+{
+	reduceShader = _reduceShader;
+}
+
+void DepthPyramid::create(unsigned int _width, unsigned int _height)
+{
+	destroy();
+
+	width = _width;
+	height = _height;
+
+	// A full mip chain, halving (rounding down) until both sides are 1
+	numLevels = 1;
+	for (unsigned int size = glm::max(width, height); size > 1; size /= 2)
+		numLevels++;
+
+	glGenTextures(1, &textureHandle);
+	glBindTexture(GL_TEXTURE_2D, textureHandle);
+	glTexStorage2D(GL_TEXTURE_2D, numLevels, GL_R32F, width, height);
+
+	// Only ever read with texelFetch
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void DepthPyramid::build(GLuint depthTexture, unsigned int _width, unsigned int _height,
+	const glm::mat4& _viewMatrix, const glm::mat4& _projMatrix)
+{
+	if (!reduceShader || !depthTexture)
+		return;
+
+	if (_width != width || _height != height || !textureHandle)
+		create(_width, _height);
+
+	viewMatrix = _viewMatrix;
+	projMatrix = _projMatrix;
+
+	reduceShader->bind();
+	reduceShader->sendUniformInt("u_source", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+
+	unsigned int levelWidth = width;
+	unsigned int levelHeight = height;
+
+	for (unsigned int level = 0; level < numLevels; level++)
+	{
+		// Level 0 copies the depth buffer, the rest reduce the level above them
+		if (level == 0)
+			glBindTexture(GL_TEXTURE_2D, depthTexture);
+		else
+			glBindTexture(GL_TEXTURE_2D, textureHandle);
+
+		reduceShader->sendUniformInt("u_sourceLevel", level == 0 ? 0 : level - 1);
+		reduceShader->sendUniformInt("u_copy", level == 0 ? 1 : 0);
+
+		glBindImageTexture(0, textureHandle, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		// 8x8 threads per group
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+
+		// The next level reads what this one wrote
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		levelWidth = glm::max(1u, levelWidth / 2);
+		levelHeight = glm::max(1u, levelHeight / 2);
+	}
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	reduceShader->unbind();
+}
+
+void DepthPyramid::destroy()
+{
+	if (textureHandle)
+	{
+		glDeleteTextures(1, &textureHandle);
+		textureHandle = 0;
+	}
+
+	width = 0;
+	height = 0;
+	numLevels = 0;
+}
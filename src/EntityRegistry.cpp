@@ -0,0 +1,79 @@
+#include "EntityRegistry.h"
+
+EntityHandle EntityRegistry::create(const std::string& name, glm::vec3 position,
+	std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material)
+{
+	EntityHandle handle = pool.create(position, mesh, material);
+	GameObject* object = pool.get(handle);
+	object->name = name;
+
+	if (denseIndices.size() < pool.getCapacity())
+		denseIndices.resize(pool.getCapacity());
+
+	denseIndices[handle.index] = (unsigned int)objects.size();
+	objects.push_back(object);
+	handles.push_back(handle);
+
+	if (!name.empty())
+		names[name] = handle;
+
+	return handle;
+}
+
+void EntityRegistry::destroy(EntityHandle handle)
+{
+	GameObject* object = pool.get(handle);
+	if (!object)
+		return;
+
+	// Don't leave anyone pointing at it
+	if (object->getParent())
+		object->getParent()->removeChild(object);
+
+	const std::vector<GameObject*>& children = object->getChildren();
+	for (unsigned int i = 0; i < children.size(); i++)
+		children[i]->setParent(nullptr);
+
+	if (!object->name.empty())
+	{
+		auto itr = names.find(object->name);
+		if (itr != names.end() && itr->second == handle)
+			names.erase(itr);
+	}
+
+	// Move the last object into the gap so the array stays dense
+	unsigned int index = denseIndices[handle.index];
+	unsigned int last = (unsigned int)objects.size() - 1;
+
+	objects[index] = objects[last];
+	handles[index] = handles[last];
+	denseIndices[handles[index].index] = index;
+
+	objects.pop_back();
+	handles.pop_back();
+
+	pool.destroy(handle);
+}
+
+GameObject* EntityRegistry::get(EntityHandle handle) const
+{
+	return pool.get(handle);
+}
+
+EntityHandle EntityRegistry::find(const std::string& name) const
+{
+	auto itr = names.find(name);
+
+	if (itr == names.end())
+		return EntityHandle();
+
+	return itr->second;
+}
+
+void EntityRegistry::clear()
+{
+	pool.clear();
+	objects.clear();
+	handles.clear();
+	names.clear();
+}
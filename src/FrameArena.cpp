@@ -0,0 +1,89 @@
+#include "FrameArena.h"
+#include <new>
+
+FrameArena::FrameArena(size_t _capacity)
+	: memory(nullptr), capacity(0), used(0), overflowBytes(0), highWater(0), numOverflows(0)
+{
+	if (_capacity > 0)
+		create(_capacity);
+}
+
+FrameArena::~FrameArena()
+{
+	freeOverflow();
+	::operator delete(memory);
+}
+
+void FrameArena::create(size_t _capacity)
+{
+	freeOverflow();
+	::operator delete(memory);
+
+	capacity = _capacity;
+	memory = capacity > 0 ? (unsigned char*)::operator new(capacity) : nullptr;
+	used = 0;
+	overflowBytes = 0;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	// new'd memory is 16 byte aligned, so aligning the offset aligns the address
+	size_t offset = (used + alignment - 1) & ~(alignment - 1);
+
+	if (memory && offset + size <= capacity)
+	{
+		used = offset + size;
+		return memory + offset;
+	}
+
+	// Doesn't fit, borrow from the heap until the next reset()
+	numOverflows++;
+	overflowBytes += size;
+
+	void* block = ::operator new(size);
+	overflowBlocks.push_back(block);
+	return block;
+}
+
+void FrameArena::reset()
+{
+	size_t frameBytes = used + overflowBytes;
+	if (frameBytes > highWater)
+		highWater = frameBytes;
+
+	// Grow to fit the biggest frame so far (with some room to spare)
+	// so overflowing is a one off and not every frame
+	if (overflowBytes > 0)
+		create(highWater + highWater / 2);
+
+	used = 0;
+}
+
+size_t FrameArena::getCapacity()
+{
+	return capacity;
+}
+
+size_t FrameArena::getUsed()
+{
+	return used + overflowBytes;
+}
+
+size_t FrameArena::getHighWater()
+{
+	return highWater;
+}
+
+unsigned int FrameArena::getNumOverflows()
+{
+	return numOverflows;
+}
+
+void FrameArena::freeOverflow()
+{
+	for (unsigned int i = 0; i < overflowBlocks.size(); i++)
+		::operator delete(overflowBlocks[i]);
+
+	overflowBlocks.clear();
+	overflowBytes = 0;
+}
@@ -1,12 +1,13 @@
 #include "FrameBufferObject.h"
 #include <iostream>
+#include <cstring> // for memset
  
 FrameBufferObject::FrameBufferObject()
 {
 	depthTexHandle = 0;
 	numColourTex = 0;
-	memset(colourTexHandles, 0, MAX_BUFFERS);
-	memset(bufferAttachments, 0, MAX_BUFFERS);
+	memset(colourTexHandles, 0, sizeof(colourTexHandles));
+	memset(bufferAttachments, 0, sizeof(bufferAttachments));
 	numBuffers = 0;
 }
 
@@ -50,7 +51,7 @@ void FrameBufferObject::createFrameBuffer(unsigned int fboWidth, unsigned int fb
 
 	// Since we just created a bunch of textures, we need to initialize them
 	// This is similar to how you would initialize a texture loaded from file
-	for (int i = 0; i < numColourTex; i++) // for each texture...
+	for (unsigned int i = 0; i < numColourTex; i++) // for each texture...
 	{
 		// ... bind it
 		// binding tells OpenGL we want to do something with this texture
@@ -141,7 +142,7 @@ void FrameBufferObject::destroy()
 	if (numColourTex > 0)
 	{
 		glDeleteTextures(numColourTex, colourTexHandles);
-		memset(colourTexHandles, 0, MAX_BUFFERS);
+		memset(colourTexHandles, 0, sizeof(colourTexHandles));
 		numColourTex = 0;
 	}
 
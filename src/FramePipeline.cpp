@@ -0,0 +1,172 @@
+#include "FramePipeline.h"
+#include "Profiler.h"
+
+FramePipeline::FramePipeline()
+	: maxFramesInFlight(2),
+	threaded(true),
+	drawIndex(0),
+	numFramesPrepared(0),
+	primed(false),
+	prepRequested(false),
+	prepFinished(false),
+	stopPrep(false),
+	prepDeltaTime(0.0f),
+	firstFence(0),
+	numFences(0)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+	// The GL context may already be gone, so only stop the thread here
+	{
+		std::lock_guard<std::mutex> lock(prepMutex);
+		stopPrep = true;
+	}
+	prepCondition.notify_all();
+
+	if (prepThread.joinable())
+		prepThread.join();
+}
+
+void FramePipeline::start(PrepareFunction _prepare, bool _threaded)
+{
+	prepare = _prepare;
+	threaded = _threaded;
+	stopPrep = false;
+	prepRequested = false;
+	prepFinished = false;
+	numFramesPrepared = 0;
+	primed = false;
+
+	if (threaded)
+		prepThread = std::thread(&FramePipeline::prepLoop, this);
+}
+
+void FramePipeline::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(prepMutex);
+		stopPrep = true;
+	}
+	prepCondition.notify_all();
+
+	if (prepThread.joinable())
+		prepThread.join();
+
+	for (int i = 0; i < numFences; i++)
+		glDeleteSync(frameFences[(firstFence + i) % MAX_FRAME_FENCES]);
+	firstFence = 0;
+	numFences = 0;
+}
+
+const FramePacket& FramePipeline::beginFrame(float dt)
+{
+	waitForGPU();
+
+	if (!threaded)
+	{
+		buildPacket(packets[drawIndex], dt);
+		return packets[drawIndex];
+	}
+
+	std::unique_lock<std::mutex> lock(prepMutex);
+
+	if (!primed)
+	{
+		// Nothing was prepared ahead for the very first frame, build it here
+		lock.unlock();
+		buildPacket(packets[drawIndex], dt);
+		lock.lock();
+		primed = true;
+	}
+	else
+	{
+		// Wait for the packet started last frame
+		{
+			PROFILE_SCOPE("wait for prep");
+			prepCondition.wait(lock, [this] { return prepFinished; });
+		}
+
+		drawIndex = 1 - drawIndex;
+	}
+
+	// Start on the next frame while this one is drawn
+	prepFinished = false;
+	prepRequested = true;
+	prepDeltaTime = dt;
+	lock.unlock();
+	prepCondition.notify_all();
+
+	return packets[drawIndex];
+}
+
+void FramePipeline::endFrame()
+{
+	// waitForGPU() always leaves room for one more
+	frameFences[(firstFence + numFences) % MAX_FRAME_FENCES] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	numFences++;
+}
+
+bool FramePipeline::isThreaded()
+{
+	return threaded;
+}
+
+void FramePipeline::prepLoop()
+{
+	while (true)
+	{
+		float dt;
+
+		{
+			std::unique_lock<std::mutex> lock(prepMutex);
+			prepCondition.wait(lock, [this] { return stopPrep || prepRequested; });
+
+			if (stopPrep)
+				return;
+
+			prepRequested = false;
+			dt = prepDeltaTime;
+		}
+
+		// drawIndex only changes while we aren't working, so the other packet is ours
+		FramePacket& packet = packets[1 - drawIndex];
+
+		{
+			PROFILE_SCOPE("prepare frame");
+			buildPacket(packet, dt);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(prepMutex);
+			prepFinished = true;
+		}
+		prepCondition.notify_all();
+	}
+}
+
+void FramePipeline::waitForGPU()
+{
+	PROFILE_SCOPE("wait for gpu");
+
+	int maxFences = maxFramesInFlight < MAX_FRAME_FENCES - 1 ? maxFramesInFlight : MAX_FRAME_FENCES - 1;
+
+	while (numFences > 0 && numFences >= maxFences)
+	{
+		GLsync fence = frameFences[firstFence];
+		firstFence = (firstFence + 1) % MAX_FRAME_FENCES;
+		numFences--;
+
+		// Flush so the fence is guaranteed to signal, then wait up to a second for it
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fence);
+	}
+}
+
+void FramePipeline::buildPacket(FramePacket& packet, float dt)
+{
+	packet.reset();
+	packet.frameNumber = numFramesPrepared++;
+	prepare(packet, dt);
+}
@@ -0,0 +1,115 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+
+FrameStats::FrameStats(unsigned int _maxFrames)
+	: maxFrames(_maxFrames), nextFrame(0)
+{
+	frameTimes.reserve(maxFrames);
+}
+
+void FrameStats::addFrame(double frameTimeMS)
+{
+	if (maxFrames == 0)
+		return;
+
+	if (frameTimes.size() < maxFrames)
+	{
+		frameTimes.push_back(frameTimeMS);
+	}
+	else
+	{
+		frameTimes[nextFrame] = frameTimeMS;
+		nextFrame = (nextFrame + 1) % maxFrames;
+	}
+}
+
+void FrameStats::reset()
+{
+	frameTimes.clear();
+	nextFrame = 0;
+}
+
+unsigned int FrameStats::getNumFrames()
+{
+	return (unsigned int)frameTimes.size();
+}
+
+double FrameStats::getAverage()
+{
+	if (frameTimes.empty())
+		return 0.0;
+
+	double total = 0.0;
+	for (unsigned int i = 0; i < frameTimes.size(); i++)
+		total += frameTimes[i];
+
+	return total / frameTimes.size();
+}
+
+double FrameStats::getMin()
+{
+	if (frameTimes.empty())
+		return 0.0;
+
+	return *std::min_element(frameTimes.begin(), frameTimes.end());
+}
+
+double FrameStats::getMax()
+{
+	if (frameTimes.empty())
+		return 0.0;
+
+	return *std::max_element(frameTimes.begin(), frameTimes.end());
+}
+
+double FrameStats::getMedian()
+{
+	if (frameTimes.empty())
+		return 0.0;
+
+	std::vector<double> sorted = getSortedFrames();
+	return sorted[sorted.size() / 2];
+}
+
+double FrameStats::getLow(double fraction)
+{
+	if (frameTimes.empty())
+		return 0.0;
+
+	std::vector<double> sorted = getSortedFrames();
+
+	// Always include at least the single slowest frame
+	unsigned int count = (unsigned int)(sorted.size() * fraction);
+	if (count < 1)
+		count = 1;
+
+	double total = 0.0;
+	for (unsigned int i = 0; i < count; i++)
+		total += sorted[i];
+
+	return total / count;
+}
+
+void FrameStats::print(const std::string& label)
+{
+	double average = getAverage();
+	double low1 = getLow(0.01);
+	double low01 = getLow(0.001);
+
+	// Frame rates are shown as well since that's how lows are usually quoted
+	printf("%-22s %5u frames  avg %7.3f ms (%6.1f fps)  1%% low %7.3f ms (%6.1f fps)  0.1%% low %7.3f ms (%6.1f fps)  max %7.3f ms\n",
+		label.c_str(), getNumFrames(),
+		average, average > 0.0 ? 1000.0 / average : 0.0,
+		low1, low1 > 0.0 ? 1000.0 / low1 : 0.0,
+		low01, low01 > 0.0 ? 1000.0 / low01 : 0.0,
+		getMax());
+}
+
+std::vector<double> FrameStats::getSortedFrames()
+{
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end(), std::greater<double>());
+	return sorted;
+}
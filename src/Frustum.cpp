@@ -0,0 +1,57 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < NUM_PLANES; i++)
+		planes[i] = glm::vec4(0.0f);
+}
+
+Frustum::Frustum(const glm::mat4& viewProj)
+{
+	extract(viewProj);
+}
+
+void Frustum::extract(const glm::mat4& viewProj)
+{
+	// A point is inside the clip volume when -w <= x, y, z <= w.
+	// Each of those six tests is a plane, made by adding or subtracting
+	// a row of the matrix from the w row (Gribb and Hartmann).
+	// glm matrices are column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rowX(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	glm::vec4 rowY(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	glm::vec4 rowZ(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	glm::vec4 rowW(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+	planes[PLANE_LEFT] = rowW + rowX;
+	planes[PLANE_RIGHT] = rowW - rowX;
+	planes[PLANE_BOTTOM] = rowW + rowY;
+	planes[PLANE_TOP] = rowW - rowY;
+	planes[PLANE_NEAR] = rowW + rowZ;
+	planes[PLANE_FAR] = rowW - rowZ;
+
+	for (int i = 0; i < NUM_PLANES; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& centre, float radius) const
+{
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), centre) + planes[i].w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+glm::vec4 transformBoundingSphere(const glm::mat4& modelMatrix, const glm::vec4& sphere)
+{
+	glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(glm::vec3(sphere), 1.0f));
+
+	float scaleX = glm::dot(glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[0]));
+	float scaleY = glm::dot(glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[1]));
+	float scaleZ = glm::dot(glm::vec3(modelMatrix[2]), glm::vec3(modelMatrix[2]));
+	float maxScale = sqrt(glm::max(scaleX, glm::max(scaleY, scaleZ)));
+
+	return glm::vec4(centre, sphere.w * maxScale);
+}
@@ -1,15 +1,19 @@
 #include "GameObject.h"
 #include <iostream>
 
-GameObject::GameObject(glm::vec3 position, std::shared_ptr<TTK::OBJMesh> _mesh, std::shared_ptr<Material> _material)
+GameObject::GameObject(glm::vec3 position, std::shared_ptr<TTK::MeshBase> _mesh, std::shared_ptr<Material> _material)
 	: m_pScale(1.0f),
-	colour(glm::vec4(0.0f)),
+	m_pRotX(0.0f), m_pRotY(0.0f), m_pRotZ(0.0f),
 	m_pLocalPosition(position),
-	mesh(_mesh),
-	material(_material),
+	m_pUseRotationQuat(false),
 	m_pParent(nullptr),
-	m_pRotX(0.0f), m_pRotY(0.0f), m_pRotZ(0.0f)
+	m_pLoaded(true),
+	colour(glm::vec4(0.0f)),
+	textureLayer(-1),
+	mesh(_mesh),
+	material(_material)
 {
+	storePreviousState();
 }
 
 GameObject::~GameObject() {}
@@ -22,16 +26,19 @@ void GameObject::setPosition(glm::vec3 newPosition)
 void GameObject::setRotationAngleX(float newAngle)
 {
 	m_pRotX = newAngle;
+	m_pUseRotationQuat = false;
 }
 
 void GameObject::setRotationAngleY(float newAngle)
 {
 	m_pRotY = newAngle;
+	m_pUseRotationQuat = false;
 }
 
 void GameObject::setRotationAngleZ(float newAngle)
 {
 	m_pRotZ = newAngle;
+	m_pUseRotationQuat = false;
 }
 
 void GameObject::setScale(float newScale)
@@ -39,22 +46,40 @@ void GameObject::setScale(float newScale)
 	m_pScale = newScale;
 }
 
+void GameObject::setRotation(glm::quat newRotation)
+{
+	m_pRotation = newRotation;
+	m_pUseRotationQuat = true;
+}
+
 glm::mat4 GameObject::getLocalToWorldMatrix()
 {
 	return m_pLocalToWorldMatrix;
 }
 
+glm::mat4 GameObject::getRenderMatrix()
+{
+	return m_pRenderMatrix;
+}
+
 void GameObject::update(float dt)
 {
 	// Create 4x4 transformation matrix
 
 	// Create rotation matrix
-	glm::mat4 rx = glm::rotate(glm::radians(m_pRotX), glm::vec3(1.0f, 0.0f, 0.0f));
-	glm::mat4 ry = glm::rotate(glm::radians(m_pRotY), glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 rz = glm::rotate(glm::radians(m_pRotZ), glm::vec3(0.0f, 0.0f, 1.0f));
+	if (m_pUseRotationQuat)
+	{
+		m_pLocalRotation = glm::mat4_cast(m_pRotation);
+	}
+	else
+	{
+		glm::mat4 rx = glm::rotate(glm::radians(m_pRotX), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 ry = glm::rotate(glm::radians(m_pRotY), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rz = glm::rotate(glm::radians(m_pRotZ), glm::vec3(0.0f, 0.0f, 1.0f));
 
-	// Note: pay attention to rotation order, ZYX is not the same as XYZ
-	m_pLocalRotation = rz * ry * rx;
+		// Note: pay attention to rotation order, ZYX is not the same as XYZ
+		m_pLocalRotation = rz * ry * rx;
+	}
 
 	// Create translation matrix
 	glm::mat4 tran = glm::translate(m_pLocalPosition);
@@ -73,28 +98,106 @@ void GameObject::update(float dt)
 	else
 		m_pLocalToWorldMatrix = m_pLocalTransformMatrix;
 
+	// Draw the latest state unless interpolate() is called
+	m_pRenderMatrix = m_pLocalToWorldMatrix;
+
 	// Update children
-	for (int i = 0; i < m_pChildren.size(); i++)
+	for (unsigned int i = 0; i < m_pChildren.size(); i++)
 		m_pChildren[i]->update(dt);
 }
 
 void GameObject::draw(TTK::Camera &camera)
 {
-	material->shader->bind();
+	if (mesh)
+	{
+		material->shader->bind();
 
-	material->mat4Uniforms["u_mvp"] = camera.viewProjMatrix * m_pLocalToWorldMatrix;
-	material->mat4Uniforms["u_mv"] = camera.viewMatrix * m_pLocalToWorldMatrix;
-	material->vec4Uniforms["u_colour"] = colour;
-	material->sendUniforms();
+		material->mat4Uniforms["u_mvp"] = camera.viewProjMatrix * m_pRenderMatrix;
+		material->mat4Uniforms["u_mv"] = camera.viewMatrix * m_pRenderMatrix;
+		material->vec4Uniforms["u_colour"] = colour;
+		material->intUniforms["u_textureLayer"] = textureLayer;
+		material->sendUniforms();
 
-	//mesh->draw_1_0();
-	mesh->draw();
+		//mesh->draw_1_0();
+		mesh->draw();
+	}
 
 	// Draw children
-	for (int i = 0; i < m_pChildren.size(); ++i)
+	for (unsigned int i = 0; i < m_pChildren.size(); ++i)
 		m_pChildren[i]->draw(camera);
 }
 
+void GameObject::storePreviousState()
+{
+	m_pPreviousPosition = m_pLocalPosition;
+	m_pPreviousRotation = glm::quat_cast(m_pLocalRotation);
+	m_pPreviousScale = m_pScale;
+
+	for (unsigned int i = 0; i < m_pChildren.size(); i++)
+		m_pChildren[i]->storePreviousState();
+}
+
+void GameObject::interpolate(float alpha)
+{
+	// Same as update(), but with the state blended between the last two steps
+	// Rotations are slerped so they don't shrink part way through like blended matrices would
+	glm::vec3 position = glm::mix(m_pPreviousPosition, m_pLocalPosition, alpha);
+	glm::quat rotation = glm::slerp(m_pPreviousRotation, glm::quat_cast(m_pLocalRotation), alpha);
+	float scale = glm::mix(m_pPreviousScale, m_pScale, alpha);
+
+	glm::mat4 localTransform = glm::translate(position) * glm::mat4_cast(rotation) * glm::scale(glm::vec3(scale));
+
+	// Parents are interpolated before their children
+	if (m_pParent)
+		m_pRenderMatrix = m_pParent->m_pRenderMatrix * localTransform;
+	else
+		m_pRenderMatrix = localTransform;
+
+	for (unsigned int i = 0; i < m_pChildren.size(); i++)
+		m_pChildren[i]->interpolate(alpha);
+}
+
+void GameObject::gatherDrawItems(FrameVector<DrawItem>& drawItems)
+{
+	if (mesh && isLoaded())
+	{
+		DrawItem item;
+		item.mesh = mesh.get();
+		item.modelMatrix = m_pRenderMatrix;
+		item.colour = colour;
+		item.textureLayer = textureLayer;
+		drawItems.push_back(item);
+	}
+
+	for (unsigned int i = 0; i < m_pChildren.size(); i++)
+		m_pChildren[i]->gatherDrawItems(drawItems);
+}
+
+void GameObject::addDependency(std::shared_ptr<const Asset> asset)
+{
+	if (!asset)
+		return;
+
+	m_pDependencies.push_back(asset);
+	m_pLoaded = false;
+}
+
+bool GameObject::isLoaded()
+{
+	// Assets never go back to loading, so once they're all ready there's nothing left to check
+	if (m_pLoaded)
+		return true;
+
+	for (unsigned int i = 0; i < m_pDependencies.size(); i++)
+	{
+		if (!m_pDependencies[i]->isReady())
+			return false;
+	}
+
+	m_pLoaded = true;
+	return true;
+}
+
 void GameObject::setParent(GameObject* newParent)
 {
 	m_pParent = newParent;
@@ -111,7 +214,7 @@ void GameObject::addChild(GameObject* newChild)
 
 void GameObject::removeChild(GameObject* rip)
 {
-	for (int i = 0; i < m_pChildren.size(); ++i)
+	for (unsigned int i = 0; i < m_pChildren.size(); ++i)
 	{
 		if (m_pChildren[i] == rip) // compare memory locations (pointers)
 		{
@@ -145,3 +248,13 @@ bool GameObject::isRoot()
 		return true;
 }
 
+GameObject* GameObject::getParent()
+{
+	return m_pParent;
+}
+
+const std::vector<GameObject*>& GameObject::getChildren()
+{
+	return m_pChildren;
+}
+
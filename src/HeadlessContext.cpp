@@ -0,0 +1,174 @@
+#include "HeadlessContext.h"
+#include <iostream>
+
+#if defined(USE_EGL_HEADLESS)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(USE_OSMESA_HEADLESS)
+#include <GL/osmesa.h>
+#endif
+
+HeadlessContext::HeadlessContext()
+{
+	display = nullptr;
+	context = nullptr;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+#if defined(USE_EGL_HEADLESS)
+
+bool HeadlessContext::create(int glMajorVersion, int glMinorVersion)
+{
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+
+	// The surfaceless platform does not need a window system at all
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (getPlatformDisplay)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+	{
+		std::cout << "HeadlessContext Error: could not initialize EGL" << std::endl;
+		return false;
+	}
+
+	// We want desktop OpenGL, not OpenGL ES
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "HeadlessContext Error: EGL does not support desktop OpenGL" << std::endl;
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	const EGLint contextAttribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, glMajorVersion,
+		EGL_CONTEXT_MINOR_VERSION, glMinorVersion,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// No config or surface needed (EGL_KHR_no_config_context + EGL_KHR_surfaceless_context)
+	EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+
+	if (eglContext == EGL_NO_CONTEXT)
+	{
+		std::cout << "HeadlessContext Error: could not create a GL " << glMajorVersion << "." << glMinorVersion
+			<< " context (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		std::cout << "HeadlessContext Error: could not make the context current" << std::endl;
+		eglDestroyContext(eglDisplay, eglContext);
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	display = eglDisplay;
+	context = eglContext;
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (context)
+	{
+		eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+		context = nullptr;
+	}
+
+	if (display)
+	{
+		eglTerminate((EGLDisplay)display);
+		display = nullptr;
+	}
+}
+
+std::string HeadlessContext::getBackendName()
+{
+	return "EGL surfaceless";
+}
+
+#elif defined(USE_OSMESA_HEADLESS)
+
+bool HeadlessContext::create(int glMajorVersion, int glMinorVersion)
+{
+	const int contextAttribs[] =
+	{
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 24,
+		OSMESA_PROFILE, OSMESA_COMPAT_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, glMajorVersion,
+		OSMESA_CONTEXT_MINOR_VERSION, glMinorVersion,
+		0
+	};
+
+	OSMesaContext osmesaContext = OSMesaCreateContextAttribs(contextAttribs, nullptr);
+
+	if (!osmesaContext)
+	{
+		std::cout << "HeadlessContext Error: could not create an OSMesa context" << std::endl;
+		return false;
+	}
+
+	// Tiny default framebuffer, everything is drawn to FBOs
+	osmesaBuffer.resize(16 * 16 * 4);
+
+	if (!OSMesaMakeCurrent(osmesaContext, &osmesaBuffer[0], GL_UNSIGNED_BYTE, 16, 16))
+	{
+		std::cout << "HeadlessContext Error: could not make the context current" << std::endl;
+		OSMesaDestroyContext(osmesaContext);
+		return false;
+	}
+
+	context = osmesaContext;
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (context)
+	{
+		OSMesaDestroyContext((OSMesaContext)context);
+		context = nullptr;
+	}
+}
+
+std::string HeadlessContext::getBackendName()
+{
+	return "OSMesa";
+}
+
+#else
+
+bool HeadlessContext::create(int, int)
+{
+	std::cout << "HeadlessContext Error: built without headless support "
+		"(define USE_EGL_HEADLESS or USE_OSMESA_HEADLESS)" << std::endl;
+	return false;
+}
+
+void HeadlessContext::destroy()
+{
+}
+
+std::string HeadlessContext::getBackendName()
+{
+	return "none";
+}
+
+#endif
@@ -0,0 +1,489 @@
+#include "IndirectRenderer.h"
+#include "TTK/MeshBase.h"
+#include "VertexBufferObject.h" // for AttributeLocations
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+IndirectRenderer::IndirectRenderer()
+{
+	drawIdBuffer = 0;
+	culledCommandBuffer = 0;
+	drawCountBuffer = 0;
+	maxDraws = 0;
+	numDraws = 0;
+	numCommands = 0;
+	numFrontFacing = 0;
+	cullMode = CULL_CPU;
+	meshletCulling = true;
+	depthPyramid = nullptr;
+	culledOnGPU = false;
+	cullUniforms.program = 0;
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+	destroy();
+}
+
+bool IndirectRenderer::isSupported()
+{
+	return GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance && GLEW_ARB_shader_storage_buffer_object;
+}
+
+bool IndirectRenderer::hasCountBuffer()
+{
+	return GLEW_ARB_indirect_parameters != 0;
+}
+
+const char* IndirectRenderer::getCullModeName(CullMode mode)
+{
+	switch (mode)
+	{
+	case CULL_NONE: return "none";
+	case CULL_CPU: return "cpu";
+	case CULL_GPU: return "gpu";
+	default: return "unknown";
+	}
+}
+
+void IndirectRenderer::setCullShader(std::shared_ptr<ShaderProgram> _cullShader)
+{
+	cullShader = _cullShader;
+	cullUniforms.program = 0;
+}
+
+void IndirectRenderer::findCullUniforms()
+{
+	cullUniforms.program = cullShader->getHandle();
+	cullUniforms.numDraws = cullShader->getUniformLocation("u_numDraws");
+	cullUniforms.backFacingOffset = cullShader->getUniformLocation("u_backFacingOffset");
+	cullUniforms.frustumPlanes = cullShader->getUniformLocation("u_frustumPlanes");
+	cullUniforms.cameraPosition = cullShader->getUniformLocation("u_cameraPosition");
+	cullUniforms.occlusion = cullShader->getUniformLocation("u_occlusion");
+	cullUniforms.depthPyramid = cullShader->getUniformLocation("u_depthPyramid");
+	cullUniforms.pyramidView = cullShader->getUniformLocation("u_pyramidView");
+	cullUniforms.pyramidProj = cullShader->getUniformLocation("u_pyramidProj");
+}
+
+bool IndirectRenderer::create(unsigned int _maxDraws)
+{
+	if (!isSupported())
+	{
+		std::cout << "IndirectRenderer: multi-draw indirect is not supported by this driver" << std::endl;
+		return false;
+	}
+
+	meshBuffer.create();
+	resize(_maxDraws);
+
+	return true;
+}
+
+void IndirectRenderer::destroy()
+{
+	commandBuffer.destroy();
+	drawDataBuffer.destroy();
+	boundsBuffer.destroy();
+	coneBuffer.destroy();
+	meshBuffer.destroy();
+
+	GLuint* buffers[] = { &drawIdBuffer, &culledCommandBuffer, &drawCountBuffer };
+	for (int i = 0; i < 3; i++)
+	{
+		if (*buffers[i])
+		{
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+
+	maxDraws = 0;
+	numDraws = 0;
+	numCommands = 0;
+	numFrontFacing = 0;
+	culledOnGPU = false;
+}
+
+void IndirectRenderer::build(const FramePacket& packet, const Frustum& frustum, const glm::vec3& cameraPosition)
+{
+	numDraws = 0;
+	numCommands = 0;
+	numFrontFacing = 0;
+	culledOnGPU = false;
+	skippedItems.clear();
+	drawItemIndices.clear();
+	drawCommands.clear();
+	commandBounds.clear();
+	commandCones.clear();
+
+	if (!drawIdBuffer)
+		return;
+
+	CullMode mode = cullMode;
+	if (mode == CULL_GPU && !cullShader)
+		mode = CULL_CPU;
+
+	// Meshlets are only worth drawing separately if some of them get culled
+	bool splitMeshes = meshletCulling && mode != CULL_NONE;
+
+	unsigned int numItems = (unsigned int)packet.drawItems.size();
+
+	for (unsigned int i = 0; i < numItems; i++)
+	{
+		const DrawItem& item = packet.drawItems[i];
+		const MeshRange* range = meshBuffer.getRange(item.mesh);
+
+		if (!range)
+		{
+			skippedItems.push_back(i);
+			continue;
+		}
+
+		unsigned int drawIndex = (unsigned int)drawItemIndices.size();
+		drawItemIndices.push_back(i);
+
+		DrawElementsIndirectCommand command;
+		command.instanceCount = 1;
+		command.baseVertex = range->baseVertex;
+		command.baseInstance = drawIndex;
+
+		// A mesh that is one meshlet is drawn whole, it's already as small as it gets
+		if (splitMeshes && range->meshlets.size() > 1)
+		{
+			// Every meshlet of an object shares its per draw data (same baseInstance)
+			for (unsigned int m = 0; m < range->meshlets.size(); m++)
+			{
+				const Meshlet& meshlet = range->meshlets[m];
+
+				command.count = meshlet.numIndices;
+				command.firstIndex = range->firstIndex + meshlet.firstIndex;
+				drawCommands.push_back(command);
+
+				commandBounds.push_back(transformBoundingSphere(item.modelMatrix, meshlet.boundingSphere));
+				commandCones.push_back(transformCone(item.modelMatrix, meshlet.cone));
+			}
+		}
+		else
+		{
+			command.count = range->numIndices;
+			command.firstIndex = range->firstIndex;
+			drawCommands.push_back(command);
+
+			// A whole mesh faces every way, its cone can't cull anything
+			commandBounds.push_back(transformBoundingSphere(item.modelMatrix, range->boundingSphere));
+			commandCones.push_back(glm::vec4(0.0f));
+		}
+	}
+
+	numDraws = (unsigned int)drawItemIndices.size();
+
+	// A one off when the scene gets bigger than it's ever been
+	unsigned int numCandidates = (unsigned int)drawCommands.size();
+	if (numCandidates > maxDraws)
+		resize(glm::max(numCandidates, maxDraws * 2));
+
+	// The per draw data is indexed by baseInstance, so it's written for every draw even
+	// if culling drops its commands, and a draw keeps the same index whichever way it's culled
+	IndirectDrawData* drawData = (IndirectDrawData*)drawDataBuffer.beginWrite();
+
+	for (unsigned int i = 0; i < numDraws; i++)
+	{
+		const DrawItem& item = packet.drawItems[drawItemIndices[i]];
+		const MeshRange* range = meshBuffer.getRange(item.mesh);
+
+		IndirectDrawData& data = drawData[i];
+		data.modelMatrix = item.modelMatrix;
+		data.colour = item.colour;
+		data.positionOffset = glm::vec4(range->positionOffset, 0.0f);
+		data.positionScale = glm::vec4(range->positionScale, 0.0f);
+		data.textureLayer = item.textureLayer;
+	}
+
+	drawDataBuffer.endWrite();
+
+	// Written straight into the mapped buffer
+	DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)commandBuffer.beginWrite();
+
+	if (mode == CULL_CPU)
+	{
+		// The front facing commands first, then the back facing ones,
+		// so draw() can take either just the first part or all of it
+		findVisibleCommands(frustum, cameraPosition, visibleCommands, backFacingCommands);
+
+		for (unsigned int i = 0; i < visibleCommands.size(); i++)
+			commands[numCommands++] = drawCommands[visibleCommands[i]];
+
+		numFrontFacing = numCommands;
+
+		for (unsigned int i = 0; i < backFacingCommands.size(); i++)
+			commands[numCommands++] = drawCommands[backFacingCommands[i]];
+	}
+	else
+	{
+		// CULL_GPU reads all of them and writes the visible ones somewhere else
+		for (unsigned int i = 0; i < numCandidates; i++)
+			commands[numCommands++] = drawCommands[i];
+
+		numFrontFacing = numCommands;
+	}
+
+	commandBuffer.endWrite();
+
+	if (mode == CULL_GPU && numCommands > 0)
+	{
+		glm::vec4* bounds = (glm::vec4*)boundsBuffer.beginWrite();
+		memcpy(bounds, &commandBounds[0], numCommands * sizeof(glm::vec4));
+		boundsBuffer.endWrite();
+
+		glm::vec4* cones = (glm::vec4*)coneBuffer.beginWrite();
+		memcpy(cones, &commandCones[0], numCommands * sizeof(glm::vec4));
+		coneBuffer.endWrite();
+
+		cullOnGPU(frustum, cameraPosition);
+	}
+}
+
+void IndirectRenderer::cullOnGPU(const Frustum& frustum, const glm::vec3& cameraPosition)
+{
+	// The counts start at 0 every frame, the cull shader adds to them
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Binding points match cull_c.glsl
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer.getHandle(),
+		boundsBuffer.getRegionOffset(), numCommands * sizeof(glm::vec4));
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer.getHandle(),
+		commandBuffer.getRegionOffset(), numCommands * sizeof(DrawElementsIndirectCommand));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, culledCommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, drawCountBuffer);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 5, coneBuffer.getHandle(),
+		coneBuffer.getRegionOffset(), numCommands * sizeof(glm::vec4));
+
+	// First frame with this program, or it was hot reloaded
+	if (cullShader->getHandle() != cullUniforms.program)
+		findCullUniforms();
+
+	cullShader->bind();
+	glUniform1i(cullUniforms.numDraws, numCommands);
+	glUniform1i(cullUniforms.backFacingOffset, maxDraws);
+
+	// Every plane at once
+	glUniform4fv(cullUniforms.frustumPlanes, Frustum::NUM_PLANES, &frustum.planes[0][0]);
+
+	glm::vec4 camera(cameraPosition, 1.0f);
+	glUniform4fv(cullUniforms.cameraPosition, 1, &camera[0]);
+
+	bool occlusion = depthPyramid && depthPyramid->isValid();
+	glUniform1i(cullUniforms.occlusion, occlusion ? 1 : 0);
+
+	if (occlusion)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, depthPyramid->getTexture());
+		glUniform1i(cullUniforms.depthPyramid, 0);
+		glm::mat4 pyramidView = depthPyramid->getViewMatrix();
+		glm::mat4 pyramidProj = depthPyramid->getProjMatrix();
+		glUniformMatrix4fv(cullUniforms.pyramidView, 1, GL_FALSE, &pyramidView[0][0]);
+		glUniformMatrix4fv(cullUniforms.pyramidProj, 1, GL_FALSE, &pyramidProj[0][0]);
+	}
+
+	// 64 commands per group
+	glDispatchCompute((numCommands + 63) / 64, 1, 1);
+
+	// The draws read what the shader wrote as commands and the counts as parameters
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	cullShader->unbind();
+
+	if (occlusion)
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (GLuint binding = 1; binding <= 5; binding++)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+
+	// The shader is done with this frame's bounds and cones once the draws after it are
+	boundsBuffer.fenceRegion();
+	coneBuffer.fenceRegion();
+
+	culledOnGPU = true;
+}
+
+void IndirectRenderer::findVisibleCommands(const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<unsigned int>& outFrontFacing, std::vector<unsigned int>& outBackFacing)
+{
+	outFrontFacing.clear();
+	outBackFacing.clear();
+
+	for (unsigned int i = 0; i < commandBounds.size(); i++)
+	{
+		const glm::vec4& sphere = commandBounds[i];
+
+		if (!frustum.intersectsSphere(glm::vec3(sphere), sphere.w))
+			continue;
+
+		if (isConeBackFacing(commandCones[i], sphere, cameraPosition))
+			outBackFacing.push_back(i);
+		else
+			outFrontFacing.push_back(i);
+	}
+}
+
+void IndirectRenderer::readBackVisibleCommands(std::vector<unsigned int>& outFrontFacing, std::vector<unsigned int>& outBackFacing)
+{
+	outFrontFacing.clear();
+	outBackFacing.clear();
+
+	if (!culledOnGPU)
+		return;
+
+	// The culled commands are copies, find which command each one was by its draw and first index
+	std::unordered_map<unsigned long long, unsigned int> commandIndices;
+	for (unsigned int i = 0; i < numCommands; i++)
+		commandIndices[((unsigned long long)drawCommands[i].baseInstance << 32) | drawCommands[i].firstIndex] = i;
+
+	std::vector<DrawElementsIndirectCommand> commands(maxDraws * 2);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, culledCommandBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0]);
+
+	// Without the count buffer every command is there, the hidden ones have no instances
+	GLuint counts[2] = { numCommands, numCommands };
+	if (hasCountBuffer())
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::vector<unsigned int>* outputs[2] = { &outFrontFacing, &outBackFacing };
+	for (unsigned int part = 0; part < 2; part++)
+	{
+		const DrawElementsIndirectCommand* partCommands = &commands[part * maxDraws];
+
+		for (unsigned int i = 0; i < counts[part] && i < numCommands; i++)
+		{
+			if (partCommands[i].instanceCount > 0)
+				outputs[part]->push_back(commandIndices[((unsigned long long)partCommands[i].baseInstance << 32) | partCommands[i].firstIndex]);
+		}
+
+		// The atomic counters hand out slots in whatever order the threads get there
+		std::sort(outputs[part]->begin(), outputs[part]->end());
+	}
+}
+
+void IndirectRenderer::draw(bool includeBackFacing)
+{
+	if (numCommands == 0)
+		return;
+
+	meshBuffer.bind();
+
+	// The shaders' DrawBuffer block uses binding point 0
+	// Every draw's data is there even when its commands were culled
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, drawDataBuffer.getHandle(),
+		drawDataBuffer.getRegionOffset(), numDraws * sizeof(IndirectDrawData));
+
+	if (culledOnGPU)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culledCommandBuffer);
+
+		// Front facing commands from the start of the buffer, back facing ones from halfway
+		unsigned int numParts = includeBackFacing ? 2 : 1;
+
+		for (unsigned int part = 0; part < numParts; part++)
+		{
+			void* commandOffset = (void*)(size_t)(part * maxDraws * sizeof(DrawElementsIndirectCommand));
+
+			if (hasCountBuffer())
+			{
+				// numCommands is only the most there can be, the real count is read on the GPU
+				glBindBuffer(GL_PARAMETER_BUFFER_ARB, drawCountBuffer);
+				glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, commandOffset,
+					part * sizeof(GLuint), numCommands, 0);
+				glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+			}
+			else
+			{
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commandOffset, numCommands, 0);
+			}
+		}
+	}
+	else
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.getHandle());
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			(void*)(size_t)commandBuffer.getRegionOffset(), includeBackFacing ? numCommands : numFrontFacing, 0);
+	}
+
+	// Don't write over this frame's region until the GPU is done reading it
+	commandBuffer.fenceRegion();
+	drawDataBuffer.fenceRegion();
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	meshBuffer.unbind();
+}
+
+void IndirectRenderer::resize(unsigned int _maxDraws)
+{
+	maxDraws = _maxDraws;
+
+	// Regions are 256 byte aligned, which covers the SSBO offset alignment
+	commandBuffer.create(maxDraws * sizeof(DrawElementsIndirectCommand), 3, GL_DRAW_INDIRECT_BUFFER);
+	drawDataBuffer.create(maxDraws * sizeof(IndirectDrawData), 3, GL_SHADER_STORAGE_BUFFER);
+	boundsBuffer.create(maxDraws * sizeof(glm::vec4), 3, GL_SHADER_STORAGE_BUFFER);
+	coneBuffer.create(maxDraws * sizeof(glm::vec4), 3, GL_SHADER_STORAGE_BUFFER);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Only the GPU touches these, so they're ordinary buffers
+	// The GPU finishes with the last frame's before this frame's cull writes them, no need for regions
+	if (culledCommandBuffer)
+		glDeleteBuffers(1, &culledCommandBuffer);
+	if (drawCountBuffer)
+		glDeleteBuffers(1, &drawCountBuffer);
+
+	glGenBuffers(1, &culledCommandBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, culledCommandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * maxDraws * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &drawCountBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::vector<GLuint> drawIds(maxDraws);
+	for (unsigned int i = 0; i < maxDraws; i++)
+		drawIds[i] = i;
+
+	if (drawIdBuffer)
+		glDeleteBuffers(1, &drawIdBuffer);
+
+	glGenBuffers(1, &drawIdBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, maxDraws * sizeof(GLuint), &drawIds[0], GL_STATIC_DRAW);
+
+	// Advances once per instance rather than per vertex, starting at the draw's baseInstance
+	meshBuffer.bind();
+	glEnableVertexAttribArray(AttributeLocations::DRAW_ID);
+	glVertexAttribIPointer(AttributeLocations::DRAW_ID, 1, GL_UNSIGNED_INT, 0, 0);
+	glVertexAttribDivisor(AttributeLocations::DRAW_ID, 1);
+	meshBuffer.unbind();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	skippedItems.reserve(maxDraws);
+	drawItemIndices.reserve(maxDraws);
+	drawCommands.reserve(maxDraws);
+	commandBounds.reserve(maxDraws);
+	commandCones.reserve(maxDraws);
+	visibleCommands.reserve(maxDraws);
+	backFacingCommands.reserve(maxDraws);
+}
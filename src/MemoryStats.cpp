@@ -0,0 +1,108 @@
+#include "MemoryStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+
+// Plain globals (not class statics) so they are ready before any static constructor allocates
+static std::atomic<unsigned long long> numAllocations(0);
+static std::atomic<unsigned long long> numFrees(0);
+static std::atomic<unsigned long long> bytesAllocated(0);
+
+unsigned long long MemoryStats::frameStartAllocations = 0;
+unsigned long long MemoryStats::lastFrameAllocations = 0;
+unsigned long long MemoryStats::maxFrameAllocations = 0;
+unsigned long long MemoryStats::totalFrameAllocations = 0;
+unsigned int MemoryStats::numFrames = 0;
+
+// Global allocation hooks
+// The array and nothrow versions of new and delete call these by default
+
+void* operator new(size_t size)
+{
+	numAllocations.fetch_add(1, std::memory_order_relaxed);
+	bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+	// new(0) still has to return a unique pointer
+	void* p = malloc(size > 0 ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (!p)
+		return;
+
+	numFrees.fetch_add(1, std::memory_order_relaxed);
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+unsigned long long MemoryStats::getNumAllocations()
+{
+	return numAllocations.load(std::memory_order_relaxed);
+}
+
+unsigned long long MemoryStats::getNumFrees()
+{
+	return numFrees.load(std::memory_order_relaxed);
+}
+
+unsigned long long MemoryStats::getBytesAllocated()
+{
+	return bytesAllocated.load(std::memory_order_relaxed);
+}
+
+long long MemoryStats::getNumLiveAllocations()
+{
+	return (long long)getNumAllocations() - (long long)getNumFrees();
+}
+
+void MemoryStats::endFrame()
+{
+	unsigned long long allocations = getNumAllocations();
+
+	lastFrameAllocations = allocations - frameStartAllocations;
+	frameStartAllocations = allocations;
+
+	if (lastFrameAllocations > maxFrameAllocations)
+		maxFrameAllocations = lastFrameAllocations;
+
+	totalFrameAllocations += lastFrameAllocations;
+	numFrames++;
+}
+
+void MemoryStats::skipAllocations()
+{
+	frameStartAllocations = getNumAllocations();
+}
+
+unsigned long long MemoryStats::getLastFrameAllocations()
+{
+	return lastFrameAllocations;
+}
+
+void MemoryStats::resetFrameStats()
+{
+	frameStartAllocations = getNumAllocations();
+	lastFrameAllocations = 0;
+	maxFrameAllocations = 0;
+	totalFrameAllocations = 0;
+	numFrames = 0;
+}
+
+void MemoryStats::print(const std::string& label)
+{
+	printf("%-22s heap allocations per frame: avg %.2f  max %llu  (%llu over %u frames, %lld alive)\n",
+		label.c_str(),
+		numFrames > 0 ? (double)totalFrameAllocations / numFrames : 0.0,
+		maxFrameAllocations, totalFrameAllocations, numFrames,
+		getNumLiveAllocations());
+}
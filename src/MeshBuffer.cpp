@@ -0,0 +1,217 @@
+#include "MeshBuffer.h"
+#include "TTK/MeshBase.h"
+#include "VertexBufferObject.h" // for AttributeLocations
+#include <iostream>
+#include <vector>
+#include <cstddef> // for offsetof
+
+MeshBuffer::MeshBuffer()
+{
+	vaoHandle = 0;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+}
+
+MeshBuffer::~MeshBuffer()
+{
+	destroy();
+}
+
+void MeshBuffer::create(unsigned int _vertexCapacity, unsigned int _indexCapacity)
+{
+	if (vaoHandle)
+		destroy();
+
+	vertexSpace.reset(_vertexCapacity);
+	indexSpace.reset(_indexCapacity);
+
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, _vertexCapacity * sizeof(QuantizedVertex), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, _indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glGenVertexArrays(1, &vaoHandle);
+
+	glBindVertexArray(vaoHandle);
+	glEnableVertexAttribArray(AttributeLocations::VERTEX);
+	glEnableVertexAttribArray(AttributeLocations::NORMAL);
+	glEnableVertexAttribArray(AttributeLocations::TEX_COORD);
+	glBindVertexArray(0);
+
+	setAttributePointers();
+}
+
+void MeshBuffer::destroy()
+{
+	if (vaoHandle)
+	{
+		glDeleteVertexArrays(1, &vaoHandle);
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+
+	vaoHandle = 0;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+
+	vertexSpace.reset(0);
+	indexSpace.reset(0);
+	ranges.clear();
+}
+
+bool MeshBuffer::addMesh(const TTK::MeshBase* mesh)
+{
+	if (!vaoHandle || !mesh || mesh->vertices.empty() || ranges.count(mesh))
+		return false;
+
+	// Cooked meshes were quantized when the pack was made
+	QuantizedMesh quantized;
+	if (mesh->quantized)
+		quantized = *mesh->quantized;
+	else
+		quantizeMesh(*mesh, quantized);
+
+	MeshRange range;
+	range.numVertices = (unsigned int)quantized.vertices.size();
+	range.numIndices = (unsigned int)quantized.indices.size();
+	range.positionOffset = quantized.positionOffset;
+	range.positionScale = quantized.positionScale;
+
+	// Bounds are fitted to the positions the GPU will actually see, after rounding
+	std::vector<glm::vec3> positions(quantized.vertices.size());
+	for (unsigned int i = 0; i < positions.size(); i++)
+		positions[i] = quantized.getPosition(i);
+
+	// Centred on the bounding box, not the tightest sphere but close enough for culling
+	glm::vec3 boxMin = positions[0];
+	glm::vec3 boxMax = positions[0];
+	for (unsigned int i = 1; i < positions.size(); i++)
+	{
+		boxMin = glm::min(boxMin, positions[i]);
+		boxMax = glm::max(boxMax, positions[i]);
+	}
+
+	glm::vec3 centre = (boxMin + boxMax) * 0.5f;
+	float radius = 0.0f;
+	for (unsigned int i = 0; i < positions.size(); i++)
+		radius = glm::max(radius, glm::length(positions[i] - centre));
+
+	range.boundingSphere = glm::vec4(centre, radius);
+
+	// Done once here, so meshes are split up at load rather than every frame
+	buildMeshlets(positions, quantized.indices, range.meshlets);
+
+	// Meshlets only move indices around, so renumbering the vertices afterwards leaves them as they are
+	reorderVertices(quantized);
+
+	// Grow until it fits, the old contents are copied over so other meshes don't move
+	while (!vertexSpace.allocate(range.numVertices, range.baseVertex))
+	{
+		unsigned int oldCapacity = vertexSpace.getCapacity();
+		unsigned int newCapacity = glm::max(oldCapacity * 2, oldCapacity + range.numVertices);
+
+		growBuffer(vertexBuffer, oldCapacity * sizeof(QuantizedVertex), newCapacity * sizeof(QuantizedVertex));
+		vertexSpace.grow(newCapacity);
+		setAttributePointers();
+	}
+
+	while (!indexSpace.allocate(range.numIndices, range.firstIndex))
+	{
+		unsigned int oldCapacity = indexSpace.getCapacity();
+		unsigned int newCapacity = glm::max(oldCapacity * 2, oldCapacity + range.numIndices);
+
+		growBuffer(indexBuffer, oldCapacity * sizeof(unsigned int), newCapacity * sizeof(unsigned int));
+		indexSpace.grow(newCapacity);
+		setAttributePointers();
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, range.baseVertex * sizeof(QuantizedVertex), range.numVertices * sizeof(QuantizedVertex), &quantized.vertices[0]);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * sizeof(unsigned int), range.numIndices * sizeof(unsigned int), &quantized.indices[0]);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	ranges[mesh] = range;
+	return true;
+}
+
+void MeshBuffer::removeMesh(const TTK::MeshBase* mesh)
+{
+	auto itr = ranges.find(mesh);
+	if (itr == ranges.end())
+		return;
+
+	vertexSpace.free(itr->second.baseVertex, itr->second.numVertices);
+	indexSpace.free(itr->second.firstIndex, itr->second.numIndices);
+
+	ranges.erase(itr);
+}
+
+bool MeshBuffer::updateMesh(const TTK::MeshBase* mesh)
+{
+	removeMesh(mesh);
+	return addMesh(mesh);
+}
+
+const MeshRange* MeshBuffer::getRange(const TTK::MeshBase* mesh) const
+{
+	auto itr = ranges.find(mesh);
+	if (itr == ranges.end())
+		return nullptr;
+
+	return &itr->second;
+}
+
+void MeshBuffer::bind()
+{
+	glBindVertexArray(vaoHandle);
+}
+
+void MeshBuffer::unbind()
+{
+	glBindVertexArray(0);
+}
+
+void MeshBuffer::growBuffer(GLuint& buffer, unsigned int oldSize, unsigned int newSize)
+{
+	std::cout << "MeshBuffer: growing a buffer from " << oldSize / 1024 << " KB to " << newSize / 1024 << " KB" << std::endl;
+
+	GLuint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+	// Copied on the GPU, the old contents never come back to the CPU
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &buffer);
+	buffer = newBuffer;
+}
+
+void MeshBuffer::setAttributePointers()
+{
+	glBindVertexArray(vaoHandle);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	// Normalized, so the shader gets positions from 0 to 1 and the normal from -1 to 1
+	glVertexAttribPointer(AttributeLocations::VERTEX, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, position));
+	glVertexAttribPointer(AttributeLocations::NORMAL, 2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, normal));
+	glVertexAttribPointer(AttributeLocations::TEX_COORD, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, uv));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The element buffer binding is part of the VAO's state
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	glBindVertexArray(0);
+}
@@ -0,0 +1,369 @@
+#include "MeshCodec.h"
+#include "TTK/MeshBase.h"
+#include <glm/gtc/packing.hpp>
+#include <unordered_map>
+#include <cstring> // for memcmp and memcpy
+#include <cmath>
+
+namespace
+{
+	// Hashes a vertex by its bytes, for merging identical vertices
+	template <typename T>
+	struct BytesHash
+	{
+		size_t operator()(const T& value) const
+		{
+			// FNV-1a
+			const unsigned char* bytes = (const unsigned char*)&value;
+			size_t hash = 2166136261u;
+
+			for (unsigned int i = 0; i < sizeof(T); i++)
+			{
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+	};
+
+	template <typename T>
+	struct BytesEqual
+	{
+		bool operator()(const T& a, const T& b) const
+		{
+			return memcmp(&a, &b, sizeof(T)) == 0;
+		}
+	};
+
+	// At the start of every cooked mesh
+	const char COOKED_MESH_MAGIC[4] = { 'Q', 'M', 'S', 'H' };
+	const unsigned int COOKED_MESH_VERSION = 1;
+
+	struct CookedMeshHeader
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int numVertices;
+		unsigned int numIndices;
+		float positionOffset[3];
+		float positionScale[3];
+	};
+
+	// A vertex is 8 shorts, the encoder goes through them one at a time
+	// The padding (short 3) is always 0, so it isn't stored
+	const unsigned int NUM_VERTEX_SHORTS = 8;
+	const unsigned int PADDING_SHORT = 3;
+
+	static_assert(sizeof(QuantizedVertex) == NUM_VERTEX_SHORTS * sizeof(unsigned short), "QuantizedVertex must be 16 bytes");
+
+	// Maps small negative and positive numbers to small positive ones: 0, -1, 1, -2, 2... -> 0, 1, 2, 3, 4...
+	inline unsigned int zigzag(int value)
+	{
+		return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+	}
+
+	inline int unzigzag(unsigned int value)
+	{
+		return (int)(value >> 1) ^ -(int)(value & 1);
+	}
+
+	inline void writeVarint(std::vector<unsigned char>& out, unsigned int value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back((unsigned char)value);
+	}
+
+	// Returns false if the data ends in the middle of the number
+	inline bool readVarint(const unsigned char*& data, const unsigned char* end, unsigned int& value)
+	{
+		value = 0;
+
+		for (unsigned int shift = 0; shift < 35 && data < end; shift += 7)
+		{
+			unsigned char byte = *data++;
+			value |= (unsigned int)(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Changes sign to 1 or -1, never 0, so folding never lands on an axis by mistake
+	inline glm::vec2 signNotZero(const glm::vec2& v)
+	{
+		return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+	}
+}
+
+glm::vec3 QuantizedMesh::getPosition(unsigned int vertex) const
+{
+	return positionOffset + glm::vec3(vertices[vertex].position) / 65535.0f * positionScale;
+}
+
+glm::vec3 QuantizedMesh::getNormal(unsigned int vertex) const
+{
+	return decodeOctahedral(vertices[vertex].normal);
+}
+
+glm::vec2 QuantizedMesh::getUV(unsigned int vertex) const
+{
+	return glm::vec2(glm::unpackHalf1x16(vertices[vertex].uv.x), glm::unpackHalf1x16(vertices[vertex].uv.y));
+}
+
+glm::i16vec2 encodeOctahedral(const glm::vec3& normal)
+{
+	float length = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+	if (length <= 0.0f)
+		return glm::i16vec2(0);
+
+	// Onto the octahedron |x| + |y| + |z| = 1
+	glm::vec2 p = glm::vec2(normal) / length;
+
+	// Fold the lower half over the upper half
+	if (normal.z < 0.0f)
+		p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+
+	p = glm::clamp(p, -1.0f, 1.0f) * 32767.0f;
+	return glm::i16vec2((short)floor(p.x + 0.5f), (short)floor(p.y + 0.5f));
+}
+
+glm::vec3 decodeOctahedral(const glm::i16vec2& encoded)
+{
+	// The same as a GL_SHORT attribute with normalized set, so it matches the vertex shader
+	glm::vec2 p = glm::max(glm::vec2(encoded) / 32767.0f, -1.0f);
+
+	glm::vec3 normal(p, 1.0f - fabs(p.x) - fabs(p.y));
+
+	// Unfold the lower half
+	if (normal.z < 0.0f)
+	{
+		glm::vec2 folded = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+		normal.x = folded.x;
+		normal.y = folded.y;
+	}
+
+	return glm::normalize(normal);
+}
+
+void quantizeMesh(const TTK::MeshBase& mesh, QuantizedMesh& outMesh)
+{
+	outMesh.vertices.clear();
+	outMesh.indices.clear();
+
+	unsigned int numSourceVertices = (unsigned int)mesh.vertices.size();
+	if (numSourceVertices == 0)
+	{
+		outMesh.positionOffset = glm::vec3(0.0f);
+		outMesh.positionScale = glm::vec3(0.0f);
+		return;
+	}
+
+	bool hasNormals = mesh.normals.size() == numSourceVertices;
+	bool hasUVs = mesh.textureCoordinates.size() == numSourceVertices;
+
+	glm::vec3 boxMin = mesh.vertices[0];
+	glm::vec3 boxMax = mesh.vertices[0];
+	for (unsigned int i = 1; i < numSourceVertices; i++)
+	{
+		boxMin = glm::min(boxMin, mesh.vertices[i]);
+		boxMax = glm::max(boxMax, mesh.vertices[i]);
+	}
+
+	outMesh.positionOffset = boxMin;
+	outMesh.positionScale = boxMax - boxMin;
+
+	// A flat mesh has no size on one axis, its positions there are all 0
+	glm::vec3 toQuantized;
+	for (int c = 0; c < 3; c++)
+		toQuantized[c] = outMesh.positionScale[c] > 0.0f ? 65535.0f / outMesh.positionScale[c] : 0.0f;
+
+	// Merge vertices shared by neighbouring triangles and index them
+	// Merged after quantizing, so vertices that only differed by rounding merge too
+	std::unordered_map<QuantizedVertex, unsigned int, BytesHash<QuantizedVertex>, BytesEqual<QuantizedVertex>> vertexIndices;
+
+	outMesh.vertices.reserve(numSourceVertices);
+	outMesh.indices.resize(numSourceVertices);
+	vertexIndices.reserve(numSourceVertices);
+
+	for (unsigned int i = 0; i < numSourceVertices; i++)
+	{
+		glm::vec3 position = glm::clamp((mesh.vertices[i] - boxMin) * toQuantized + 0.5f, 0.0f, 65535.0f);
+		glm::vec2 uv = hasUVs ? mesh.textureCoordinates[i] : glm::vec2(0.0f);
+
+		QuantizedVertex vertex;
+		vertex.position = glm::u16vec3(position);
+		vertex.padding = 0;
+		vertex.normal = encodeOctahedral(hasNormals ? mesh.normals[i] : glm::vec3(0.0f, 0.0f, 1.0f));
+		vertex.uv = glm::u16vec2(glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y));
+
+		auto inserted = vertexIndices.insert(std::make_pair(vertex, (unsigned int)outMesh.vertices.size()));
+		if (inserted.second)
+			outMesh.vertices.push_back(vertex);
+
+		outMesh.indices[i] = inserted.first->second;
+	}
+}
+
+void reorderVertices(QuantizedMesh& mesh)
+{
+	std::vector<unsigned int> newIndices(mesh.vertices.size(), ~0u);
+	std::vector<QuantizedVertex> reordered;
+	reordered.reserve(mesh.vertices.size());
+
+	for (unsigned int i = 0; i < mesh.indices.size(); i++)
+	{
+		unsigned int& newIndex = newIndices[mesh.indices[i]];
+		if (newIndex == ~0u)
+		{
+			newIndex = (unsigned int)reordered.size();
+			reordered.push_back(mesh.vertices[mesh.indices[i]]);
+		}
+
+		mesh.indices[i] = newIndex;
+	}
+
+	// Vertices no index uses are dropped
+	mesh.vertices.swap(reordered);
+}
+
+void encodeMesh(const QuantizedMesh& mesh, std::vector<unsigned char>& outData)
+{
+	CookedMeshHeader header;
+	memcpy(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic));
+	header.version = COOKED_MESH_VERSION;
+	header.numVertices = (unsigned int)mesh.vertices.size();
+	header.numIndices = (unsigned int)mesh.indices.size();
+	for (int c = 0; c < 3; c++)
+	{
+		header.positionOffset[c] = mesh.positionOffset[c];
+		header.positionScale[c] = mesh.positionScale[c];
+	}
+
+	outData.resize(sizeof(header));
+	memcpy(&outData[0], &header, sizeof(header));
+
+	// Most values take one or two bytes
+	outData.reserve(sizeof(header) + mesh.vertices.size() * 10 + mesh.indices.size() * 2);
+
+	// Vertices, as differences from the vertex before
+	unsigned short previous[NUM_VERTEX_SHORTS] = {};
+
+	for (unsigned int v = 0; v < mesh.vertices.size(); v++)
+	{
+		const unsigned short* shorts = (const unsigned short*)&mesh.vertices[v];
+
+		for (unsigned int s = 0; s < NUM_VERTEX_SHORTS; s++)
+		{
+			if (s == PADDING_SHORT)
+				continue;
+
+			// Wraps around, so every difference fits in 16 bits
+			short delta = (short)(unsigned short)(shorts[s] - previous[s]);
+			writeVarint(outData, zigzag(delta));
+			previous[s] = shorts[s];
+		}
+	}
+
+	// Indices, relative to the next vertex not used yet
+	unsigned int nextVertex = 0;
+
+	for (unsigned int i = 0; i < mesh.indices.size(); i++)
+	{
+		unsigned int index = mesh.indices[i];
+		writeVarint(outData, zigzag((int)(nextVertex - index)));
+
+		if (index >= nextVertex)
+			nextVertex = index + 1;
+	}
+}
+
+bool decodeMesh(const unsigned char* data, size_t size, QuantizedMesh& outMesh)
+{
+	CookedMeshHeader header;
+	if (size < sizeof(header))
+		return false;
+
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic)) != 0 || header.version != COOKED_MESH_VERSION)
+		return false;
+
+	// Every value takes at least a byte, so this also catches counts too big for the data
+	// before anything is allocated for them
+	size_t minSize = (size_t)header.numVertices * (NUM_VERTEX_SHORTS - 1) + header.numIndices;
+	if (size - sizeof(header) < minSize)
+		return false;
+
+	for (int c = 0; c < 3; c++)
+	{
+		outMesh.positionOffset[c] = header.positionOffset[c];
+		outMesh.positionScale[c] = header.positionScale[c];
+	}
+
+	outMesh.vertices.resize(header.numVertices);
+	outMesh.indices.resize(header.numIndices);
+
+	const unsigned char* read = data + sizeof(header);
+	const unsigned char* end = data + size;
+
+	unsigned short previous[NUM_VERTEX_SHORTS] = {};
+	unsigned int value;
+
+	for (unsigned int v = 0; v < header.numVertices; v++)
+	{
+		unsigned short* shorts = (unsigned short*)&outMesh.vertices[v];
+
+		for (unsigned int s = 0; s < NUM_VERTEX_SHORTS; s++)
+		{
+			if (s == PADDING_SHORT)
+			{
+				shorts[s] = 0;
+				continue;
+			}
+
+			if (!readVarint(read, end, value))
+				return false;
+
+			previous[s] = (unsigned short)(previous[s] + unzigzag(value));
+			shorts[s] = previous[s];
+		}
+	}
+
+	unsigned int nextVertex = 0;
+
+	for (unsigned int i = 0; i < header.numIndices; i++)
+	{
+		if (!readVarint(read, end, value))
+			return false;
+
+		unsigned int index = nextVertex - (unsigned int)unzigzag(value);
+		if (index >= header.numVertices)
+			return false;
+
+		outMesh.indices[i] = index;
+
+		if (index >= nextVertex)
+			nextVertex = index + 1;
+	}
+
+	return read == end;
+}
+
+std::string getCookedMeshName(const std::string& objFileName)
+{
+	size_t dot = objFileName.find_last_of('.');
+	size_t slash = objFileName.find_last_of("/\\");
+
+	// A dot in a folder name isn't the extension
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return objFileName + ".mesh";
+
+	return objFileName.substr(0, dot) + ".mesh";
+}
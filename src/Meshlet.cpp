@@ -0,0 +1,215 @@
+#include "Meshlet.h"
+
+namespace
+{
+	// Sphere around the centre of the meshlet's bounding box
+	glm::vec4 computeBoundingSphere(const std::vector<glm::vec3>& positions, const unsigned int* indices, unsigned int numIndices)
+	{
+		glm::vec3 boxMin = positions[indices[0]];
+		glm::vec3 boxMax = positions[indices[0]];
+		for (unsigned int i = 1; i < numIndices; i++)
+		{
+			boxMin = glm::min(boxMin, positions[indices[i]]);
+			boxMax = glm::max(boxMax, positions[indices[i]]);
+		}
+
+		glm::vec3 centre = (boxMin + boxMax) * 0.5f;
+		float radius = 0.0f;
+		for (unsigned int i = 0; i < numIndices; i++)
+			radius = glm::max(radius, glm::length(positions[indices[i]] - centre));
+
+		return glm::vec4(centre, radius);
+	}
+
+	// Cone around the triangles' normals (see "Optimizing the Graphics Pipeline with Compute", Wihlidal)
+	glm::vec4 computeCone(const std::vector<glm::vec3>& positions, const unsigned int* indices, unsigned int numIndices)
+	{
+		std::vector<glm::vec3> normals;
+		normals.reserve(numIndices / 3);
+
+		glm::vec3 axis(0.0f);
+		for (unsigned int i = 0; i + 2 < numIndices; i += 3)
+		{
+			const glm::vec3& a = positions[indices[i]];
+			const glm::vec3& b = positions[indices[i + 1]];
+			const glm::vec3& c = positions[indices[i + 2]];
+
+			// Counter clockwise triangles are front facing
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+
+			// Zero area triangles can't be seen from either side
+			if (length <= 0.0f)
+				continue;
+
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength <= 0.0f)
+			return glm::vec4(0.0f);
+
+		axis /= axisLength;
+
+		// The normal furthest from the axis sets how wide the cone is
+		float minDot = 1.0f;
+		for (unsigned int i = 0; i < normals.size(); i++)
+			minDot = glm::min(minDot, glm::dot(axis, normals[i]));
+
+		// Some triangle faces more than 90 degrees away from the others, so from
+		// anywhere there's a triangle facing the camera
+		if (minDot <= 0.0f)
+			return glm::vec4(0.0f);
+
+		// sin of the cone's half angle: the camera has to be this far inside the
+		// opposite cone before every triangle faces away
+		return glm::vec4(axis, sqrt(1.0f - minDot * minDot));
+	}
+}
+
+void buildMeshlets(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices,
+	std::vector<Meshlet>& outMeshlets, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	outMeshlets.clear();
+
+	unsigned int numTriangles = (unsigned int)indices.size() / 3;
+	unsigned int numVertices = (unsigned int)positions.size();
+	if (numTriangles == 0)
+		return;
+
+	// The triangles using each vertex, packed into one array
+	// (vertexTriangles[vertexOffsets[v]] to vertexTriangles[vertexOffsets[v + 1]])
+	std::vector<unsigned int> vertexOffsets(numVertices + 1, 0);
+	for (unsigned int i = 0; i < numTriangles * 3; i++)
+		vertexOffsets[indices[i] + 1]++;
+	for (unsigned int v = 0; v < numVertices; v++)
+		vertexOffsets[v + 1] += vertexOffsets[v];
+
+	std::vector<unsigned int> vertexTriangles(numTriangles * 3);
+	std::vector<unsigned int> fill(vertexOffsets.begin(), vertexOffsets.end() - 1);
+	for (unsigned int i = 0; i < numTriangles * 3; i++)
+		vertexTriangles[fill[indices[i]]++] = i / 3;
+
+	std::vector<bool> triangleUsed(numTriangles, false);
+
+	// Which meshlet last used each vertex, so "is it in this meshlet" is one compare
+	std::vector<unsigned int> vertexMeshlet(numVertices, ~0u);
+
+	std::vector<unsigned int> reordered;
+	reordered.reserve(indices.size());
+
+	std::vector<unsigned int> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+
+	unsigned int nextUnused = 0;
+	unsigned int numUsed = 0;
+
+	while (numUsed < numTriangles)
+	{
+		unsigned int meshletIndex = (unsigned int)outMeshlets.size();
+		unsigned int firstIndex = (unsigned int)reordered.size();
+		unsigned int meshletTriangles = 0;
+		meshletVertices.clear();
+
+		// Start from the first triangle nothing has taken yet
+		while (triangleUsed[nextUnused])
+			nextUnused++;
+
+		unsigned int triangle = nextUnused;
+
+		while (true)
+		{
+			// Add the triangle
+			triangleUsed[triangle] = true;
+			numUsed++;
+			meshletTriangles++;
+
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				reordered.push_back(vertex);
+
+				if (vertexMeshlet[vertex] != meshletIndex)
+				{
+					vertexMeshlet[vertex] = meshletIndex;
+					meshletVertices.push_back(vertex);
+				}
+			}
+
+			if (meshletTriangles == maxTriangles)
+				break;
+
+			// Pick the neighbouring triangle that adds the fewest new vertices
+			unsigned int best = ~0u;
+			unsigned int bestNewVertices = 3;
+
+			for (unsigned int i = 0; i < meshletVertices.size() && bestNewVertices > 0; i++)
+			{
+				unsigned int vertex = meshletVertices[i];
+
+				for (unsigned int t = vertexOffsets[vertex]; t < vertexOffsets[vertex + 1]; t++)
+				{
+					unsigned int candidate = vertexTriangles[t];
+					if (triangleUsed[candidate])
+						continue;
+
+					unsigned int newVertices = 0;
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						if (vertexMeshlet[indices[candidate * 3 + corner]] != meshletIndex)
+							newVertices++;
+					}
+
+					if (newVertices < bestNewVertices || (newVertices == bestNewVertices && candidate < best))
+					{
+						best = candidate;
+						bestNewVertices = newVertices;
+					}
+				}
+			}
+
+			// Nothing left next to the meshlet, or the best one doesn't fit
+			if (best == ~0u || meshletVertices.size() + bestNewVertices > maxVertices)
+				break;
+
+			triangle = best;
+		}
+
+		Meshlet meshlet;
+		meshlet.firstIndex = firstIndex;
+		meshlet.numIndices = meshletTriangles * 3;
+		meshlet.boundingSphere = computeBoundingSphere(positions, &reordered[firstIndex], meshlet.numIndices);
+		meshlet.cone = computeCone(positions, &reordered[firstIndex], meshlet.numIndices);
+		outMeshlets.push_back(meshlet);
+	}
+
+	indices.swap(reordered);
+}
+
+glm::vec4 transformCone(const glm::mat4& modelMatrix, const glm::vec4& cone)
+{
+	glm::mat3 rotationScale(modelMatrix);
+
+	float scaleX = glm::length(rotationScale[0]);
+	float scaleY = glm::length(rotationScale[1]);
+	float scaleZ = glm::length(rotationScale[2]);
+
+	float minScale = glm::min(scaleX, glm::min(scaleY, scaleZ));
+	float maxScale = glm::max(scaleX, glm::max(scaleY, scaleZ));
+
+	if (minScale <= 0.0f || maxScale > minScale * 1.001f || glm::determinant(rotationScale) < 0.0f)
+		return glm::vec4(0.0f);
+
+	// With a uniform scale the normals turn the same way as everything else
+	return glm::vec4(rotationScale * glm::vec3(cone) / scaleX, cone.w);
+}
+
+bool isConeBackFacing(const glm::vec4& cone, const glm::vec4& sphere, const glm::vec3& cameraPosition)
+{
+	glm::vec3 toCentre = glm::vec3(sphere) - cameraPosition;
+
+	// Every triangle faces away if the camera looks down the cone's axis closely enough,
+	// with the radius as a margin so this holds from anywhere in the sphere
+	return glm::dot(toCentre, glm::vec3(cone)) >= cone.w * glm::length(toCentre) + sphere.w;
+}
@@ -0,0 +1,317 @@
+#include "Profiler.h"
+#include "FramePipeline.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+std::atomic<bool> Profiler::enabled(true);
+std::chrono::high_resolution_clock::time_point Profiler::startTime = std::chrono::high_resolution_clock::now();
+std::mutex Profiler::eventMutex;
+std::vector<Profiler::Event> Profiler::events;
+unsigned int Profiler::numEventsWritten = 0;
+std::atomic<unsigned int> Profiler::currentFrame(0);
+Profiler::QueryFrame Profiler::queryFrames[Profiler::NUM_QUERY_FRAMES];
+int Profiler::gpuDepth = 0;
+
+// The frame scopes, opened in beginFrame() and closed in endFrame()
+static std::chrono::high_resolution_clock::time_point frameStart;
+static int frameGPUScope = -1;
+
+void Profiler::beginFrame()
+{
+	static_assert(NUM_QUERY_FRAMES >= FramePipeline::MAX_FRAME_FENCES, "the GPU can be more frames behind than there are query slots");
+
+	if (!enabled)
+		return;
+
+	unsigned int frame = ++currentFrame;
+
+	// This slot was last used NUM_QUERY_FRAMES frames ago, more than the frame pipeline lets
+	// the GPU fall behind, so it has finished with it
+	QueryFrame& queryFrame = queryFrames[frame % NUM_QUERY_FRAMES];
+	collectGPUResults(queryFrame);
+
+	queryFrame.frame = frame;
+	queryFrame.scopes.clear();
+	queryFrame.numUsed = 0;
+
+	frameStart = std::chrono::high_resolution_clock::now();
+	queryFrame.cpuStartUS = toMicroseconds(frameStart);
+
+	threadDepth()++;
+	frameGPUScope = beginGPU("frame");
+}
+
+void Profiler::endFrame()
+{
+	if (!enabled || frameGPUScope < 0)
+		return;
+
+	endGPU(frameGPUScope);
+	frameGPUScope = -1;
+
+	threadDepth()--;
+	addCPUEvent("frame", frameStart, threadDepth());
+}
+
+void Profiler::addCPUEvent(const char* name, std::chrono::high_resolution_clock::time_point start, int depth)
+{
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	Event e;
+	e.name = name;
+	e.startUS = toMicroseconds(start);
+	e.durationUS = toMicroseconds(end) - e.startUS;
+	e.depth = depth;
+	e.thread = getThreadID();
+	e.frame = currentFrame.load(std::memory_order_relaxed);
+
+	pushEvent(e);
+}
+
+int Profiler::beginGPU(const char* name)
+{
+	if (!enabled)
+		return -1;
+
+	QueryFrame& queryFrame = queryFrames[currentFrame % NUM_QUERY_FRAMES];
+
+	// Timestamps are used instead of GL_TIME_ELAPSED queries
+	// since only one GL_TIME_ELAPSED query can be active at once, so they can't be nested
+	GPUScope scope;
+	scope.name = name;
+	scope.depth = gpuDepth++;
+	scope.startQuery = getQuery(queryFrame);
+	scope.endQuery = getQuery(queryFrame);
+	scope.ended = false;
+
+	glQueryCounter(scope.startQuery, GL_TIMESTAMP);
+
+	queryFrame.scopes.push_back(scope);
+	return (int)queryFrame.scopes.size() - 1;
+}
+
+void Profiler::endGPU(int index)
+{
+	QueryFrame& queryFrame = queryFrames[currentFrame % NUM_QUERY_FRAMES];
+
+	if (index < 0 || index >= (int)queryFrame.scopes.size())
+		return;
+
+	GPUScope& scope = queryFrame.scopes[index];
+	glQueryCounter(scope.endQuery, GL_TIMESTAMP);
+	scope.ended = true;
+	gpuDepth--;
+}
+
+void Profiler::collectGPUResults(QueryFrame& queryFrame)
+{
+	// The first scope is the frame, its end is the last query issued in the frame
+	if (queryFrame.scopes.empty() || !queryFrame.scopes[0].ended)
+		return;
+
+	// Every query in the frame is done once the last one issued is
+	// If the GPU is still behind, drop the frame rather than stall waiting for it
+	GLuint available = 0;
+	glGetQueryObjectuiv(queryFrame.scopes[0].endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	// The frame's start lines up with the CPU's frame start
+	GLuint64 frameStartNS = 0;
+	glGetQueryObjectui64v(queryFrame.scopes[0].startQuery, GL_QUERY_RESULT, &frameStartNS);
+
+	for (unsigned int i = 0; i < queryFrame.scopes.size(); i++)
+	{
+		GPUScope& scope = queryFrame.scopes[i];
+
+		if (!scope.ended)
+			continue;
+
+		GLuint64 startNS = 0, endNS = 0;
+		glGetQueryObjectui64v(scope.startQuery, GL_QUERY_RESULT, &startNS);
+		glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &endNS);
+
+		Event e;
+		e.name = scope.name;
+		e.startUS = queryFrame.cpuStartUS + (long long)(startNS - frameStartNS) / 1000;
+		e.durationUS = (long long)(endNS - startNS) / 1000;
+		e.depth = scope.depth;
+		e.thread = GPU_THREAD;
+		e.frame = queryFrame.frame;
+
+		pushEvent(e);
+	}
+}
+
+GLuint Profiler::getQuery(QueryFrame& queryFrame)
+{
+	if (queryFrame.numUsed == queryFrame.queryPool.size())
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		queryFrame.queryPool.push_back(query);
+	}
+
+	return queryFrame.queryPool[queryFrame.numUsed++];
+}
+
+void Profiler::pushEvent(const Event& e)
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+
+	if (events.empty())
+		events.resize(MAX_EVENTS);
+
+	// Oldest events get overwritten once the buffer is full
+	events[numEventsWritten % MAX_EVENTS] = e;
+	numEventsWritten++;
+}
+
+std::vector<Profiler::Event> Profiler::getFrameEvents(unsigned int frame)
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+
+	std::vector<Event> frameEvents;
+	unsigned int first = numEventsWritten > MAX_EVENTS ? numEventsWritten - MAX_EVENTS : 0;
+
+	for (unsigned int i = first; i < numEventsWritten; i++)
+	{
+		if (events[i % MAX_EVENTS].frame == frame)
+			frameEvents.push_back(events[i % MAX_EVENTS]);
+	}
+
+	// Parents end after their children, so sort by start time to get them back in tree order
+	std::stable_sort(frameEvents.begin(), frameEvents.end(), [](const Event& a, const Event& b)
+	{
+		if (a.thread != b.thread)
+			return a.thread < b.thread;
+		if (a.startUS != b.startUS)
+			return a.startUS < b.startUS;
+		return a.depth < b.depth;
+	});
+
+	return frameEvents;
+}
+
+unsigned int Profiler::getFrameNumber()
+{
+	return currentFrame;
+}
+
+void Profiler::printLastFrame()
+{
+	// GPU results lag behind, this is the newest frame that has them
+	if (currentFrame <= NUM_QUERY_FRAMES)
+	{
+		std::cout << "Profiler: no complete frames yet" << std::endl;
+		return;
+	}
+
+	unsigned int frame = currentFrame - NUM_QUERY_FRAMES;
+	std::vector<Event> frameEvents = getFrameEvents(frame);
+
+	std::cout << "---- Profile of frame " << frame << " ----" << std::endl;
+
+	int lastThread = -1;
+	for (unsigned int i = 0; i < frameEvents.size(); i++)
+	{
+		const Event& e = frameEvents[i];
+
+		if (e.thread != lastThread)
+		{
+			if (e.thread == GPU_THREAD)
+				std::cout << "GPU:" << std::endl;
+			else
+				std::cout << "CPU thread " << e.thread << ":" << std::endl;
+			lastThread = e.thread;
+		}
+
+		std::cout << std::string(2 + e.depth * 2, ' ') << e.name << " " << e.durationUS / 1000.0 << " ms" << std::endl;
+	}
+}
+
+bool Profiler::exportChromeTrace(const std::string& fileName)
+{
+	std::ofstream file(fileName);
+
+	if (!file)
+	{
+		std::cout << "Profiler: could not write " << fileName << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(eventMutex);
+
+	file << "{\"traceEvents\":[" << std::endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+
+	unsigned int first = numEventsWritten > MAX_EVENTS ? numEventsWritten - MAX_EVENTS : 0;
+
+	for (unsigned int i = first; i < numEventsWritten; i++)
+	{
+		const Event& e = events[i % MAX_EVENTS];
+
+		// Names are string literals in the code, so they don't need escaping
+		file << "," << std::endl << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+			<< ",\"ts\":" << e.startUS << ",\"dur\":" << e.durationUS << ",\"args\":{\"frame\":" << e.frame << "}}";
+	}
+
+	file << std::endl << "]}" << std::endl;
+
+	std::cout << "Profiler: wrote " << (numEventsWritten - first) << " events to " << fileName << std::endl;
+	return true;
+}
+
+int& Profiler::threadDepth()
+{
+	static thread_local int depth = 0;
+	return depth;
+}
+
+long long Profiler::toMicroseconds(std::chrono::high_resolution_clock::time_point t)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(t - startTime).count();
+}
+
+int Profiler::getThreadID()
+{
+	// Thread ids from std::thread are large and not printable, so hand out small ones
+	static std::atomic<int> nextID(0);
+	static thread_local int id = nextID++;
+	return id;
+}
+
+ProfileScope::ProfileScope(const char* _name)
+{
+	name = _name;
+	depth = -1;
+
+	if (Profiler::enabled)
+	{
+		depth = Profiler::threadDepth()++;
+		start = std::chrono::high_resolution_clock::now();
+	}
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (depth < 0)
+		return;
+
+	Profiler::threadDepth()--;
+	Profiler::addCPUEvent(name, start, depth);
+}
+
+GPUProfileScope::GPUProfileScope(const char* _name)
+	: cpuScope(_name)
+{
+	gpuIndex = Profiler::beginGPU(_name);
+}
+
+GPUProfileScope::~GPUProfileScope()
+{
+	Profiler::endGPU(gpuIndex);
+}
@@ -0,0 +1,118 @@
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(unsigned int _capacity)
+{
+	reset(_capacity);
+}
+
+void RangeAllocator::reset(unsigned int _capacity)
+{
+	capacity = _capacity;
+	used = 0;
+
+	freeRanges.clear();
+
+	if (capacity > 0)
+	{
+		Range all = { 0, capacity };
+		freeRanges.push_back(all);
+	}
+}
+
+bool RangeAllocator::allocate(unsigned int size, unsigned int& outOffset)
+{
+	if (size == 0)
+		return false;
+
+	for (unsigned int i = 0; i < freeRanges.size(); i++)
+	{
+		Range& range = freeRanges[i];
+
+		if (range.size < size)
+			continue;
+
+		// Take it from the front of the range, what's left stays free
+		outOffset = range.offset;
+		range.offset += size;
+		range.size -= size;
+
+		if (range.size == 0)
+			freeRanges.erase(freeRanges.begin() + i);
+
+		used += size;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int size)
+{
+	if (size == 0)
+		return;
+
+	used -= size;
+
+	// First free range after the one being freed
+	unsigned int next = 0;
+	while (next < freeRanges.size() && freeRanges[next].offset < offset)
+		next++;
+
+	bool joinsPrevious = next > 0 && freeRanges[next - 1].offset + freeRanges[next - 1].size == offset;
+	bool joinsNext = next < freeRanges.size() && offset + size == freeRanges[next].offset;
+
+	if (joinsPrevious && joinsNext)
+	{
+		// Fills the gap between two free ranges, they become one
+		freeRanges[next - 1].size += size + freeRanges[next].size;
+		freeRanges.erase(freeRanges.begin() + next);
+	}
+	else if (joinsPrevious)
+	{
+		freeRanges[next - 1].size += size;
+	}
+	else if (joinsNext)
+	{
+		freeRanges[next].offset = offset;
+		freeRanges[next].size += size;
+	}
+	else
+	{
+		Range range = { offset, size };
+		freeRanges.insert(freeRanges.begin() + next, range);
+	}
+}
+
+void RangeAllocator::grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	unsigned int added = newCapacity - capacity;
+
+	// The new space is free, merge it into the last range if that one reaches the old end
+	if (!freeRanges.empty() && freeRanges.back().offset + freeRanges.back().size == capacity)
+	{
+		freeRanges.back().size += added;
+	}
+	else
+	{
+		Range range = { capacity, added };
+		freeRanges.push_back(range);
+	}
+
+	capacity = newCapacity;
+}
+
+unsigned int RangeAllocator::getLargestFree() const
+{
+	unsigned int largest = 0;
+
+	for (unsigned int i = 0; i < freeRanges.size(); i++)
+	{
+		if (freeRanges[i].size > largest)
+			largest = freeRanges[i].size;
+	}
+
+	return largest;
+}
@@ -1,11 +1,12 @@
 #include "Shader.h"
 #include <iostream>
 #include "GLEW/glew.h"
-#include "TTK/io.h"
+#include "TTK/IO.h"
 
 Shader::Shader()
 {
 	handle = 0;
+	shaderType = 0;
 }
 
 Shader::~Shader()
@@ -13,15 +14,37 @@ Shader::~Shader()
 	destroy();
 }
 
-unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
+unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type, const std::string& defines)
+{
+	if (submitShaderFromFile(fileName, type, defines) == 0)
+		return 0;
+
+	return checkCompileStatus();
+}
+
+unsigned int Shader::submitShaderFromFile(std::string fileName, GLenum type, const std::string& defines)
 {
 	// Load shader file into memory
 	std::string shaderCode = TTK::IO::loadFile(fileName).c_str();
 
+	return submitShaderFromSource(shaderCode, fileName, type, defines);
+}
+
+unsigned int Shader::submitShaderFromSource(const std::string& source, const std::string& fileName, GLenum type, const std::string& defines)
+{
+	std::string shaderCode = source;
+
 	// Could not load file
 	if (shaderCode.length() == 0)
 		return 0;
 
+	sourceFile = fileName;
+	sourceDefines = defines;
+	shaderType = type;
+
+	if (defines.length() > 0)
+		shaderCode = injectDefines(shaderCode, defines);
+
 	// Create shader
 	// Makes an empty shader program with nothing in it
 	handle = glCreateShader(type);
@@ -35,8 +58,54 @@ unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
 	glShaderSource(handle, 1, &cstr, 0);
 
 	// Compile the shader program
+	// Note: we do not ask for the compile status here. Querying it forces the
+	// driver to finish compiling before returning, which would serialize every shader.
 	glCompileShader(handle);
 
+	return handle;
+}
+
+std::string Shader::injectDefines(const std::string& source, const std::string& defines)
+{
+	size_t versionPos = source.find("#version");
+
+	// No version line, defines can go first
+	if (versionPos == std::string::npos)
+		return defines + source;
+
+	size_t lineEnd = source.find('\n', versionPos);
+
+	if (lineEnd == std::string::npos)
+		return source + "\n" + defines;
+
+	// Keep the #version line, then the defines, then the rest of the shader
+	// #line resets the line numbers so compile errors still point at the right line in the file
+	int versionLine = 1;
+	for (size_t i = 0; i < versionPos; i++)
+		if (source[i] == '\n')
+			versionLine++;
+
+	return source.substr(0, lineEnd + 1) + defines +
+		"#line " + std::to_string(versionLine + 1) + "\n" +
+		source.substr(lineEnd + 1);
+}
+
+bool Shader::isCompileComplete()
+{
+	if (handle == 0 || !GLEW_ARB_parallel_shader_compile)
+		return true;
+
+	int complete;
+	glGetShaderiv(handle, GL_COMPLETION_STATUS_ARB, &complete);
+
+	return complete != 0;
+}
+
+unsigned int Shader::checkCompileStatus()
+{
+	if (handle == 0)
+		return 0;
+
 	// Check to see if shader compiled
 	// Returns 1 if success
 	int compileStatus;
@@ -44,11 +113,11 @@ unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
 
 	if (compileStatus)
 	{
-		std::cout << "Shader Compiled Successfully: " << fileName << std::endl;
+		std::cout << "Shader Compiled Successfully: " << sourceFile << std::endl;
 		return handle;
 	}
 
-	std::cout << "Shader Failed to Compile: " << fileName << std::endl;
+	std::cout << "Shader Failed to Compile: " << sourceFile << std::endl;
 
 	// If shader failed to compile, output the errors
 	// First need to get length of error message
@@ -69,6 +138,19 @@ unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
 	return 0;
 }
 
+bool Shader::enableParallelCompile()
+{
+	if (!GLEW_ARB_parallel_shader_compile)
+	{
+		std::cout << "Parallel shader compile not supported, shaders will compile serially" << std::endl;
+		return false;
+	}
+
+	// 0xFFFFFFFF lets the driver pick how many threads to use
+	glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	return true;
+}
+
 void Shader::destroy()
 {
 	// If handle is zero it means the shader does not exist
@@ -79,4 +161,3 @@ void Shader::destroy()
 		handle = 0;
 	}
 }
-
@@ -0,0 +1,83 @@
+#include "ShaderPermutations.h"
+#include <iostream>
+
+ShaderPermutations::ShaderPermutations()
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+	variants.clear();
+}
+
+void ShaderPermutations::setVertexShader(const std::string& fileName)
+{
+	vertexFile = fileName;
+}
+
+void ShaderPermutations::setFragmentShader(const std::string& fileName)
+{
+	fragmentFile = fileName;
+}
+
+unsigned int ShaderPermutations::addFeature(const std::string& defineName)
+{
+	if (featureNames.size() >= 32)
+	{
+		std::cout << "ShaderPermutations: too many features, " << defineName << " ignored" << std::endl;
+		return 0;
+	}
+
+	featureNames.push_back(defineName);
+	return 1u << (featureNames.size() - 1);
+}
+
+std::string ShaderPermutations::buildDefines(unsigned int featureMask)
+{
+	std::string defines;
+
+	for (unsigned int i = 0; i < featureNames.size(); i++)
+	{
+		if (featureMask & (1u << i))
+			defines += "#define " + featureNames[i] + "\n";
+	}
+
+	return defines;
+}
+
+std::shared_ptr<ShaderProgram> ShaderPermutations::getVariant(unsigned int featureMask)
+{
+	// Already built this one?
+	auto itr = variants.find(featureMask);
+	if (itr != variants.end())
+		return itr->second;
+
+	std::string defines = buildDefines(featureMask);
+
+	std::cout << "Compiling shader variant " << featureMask << " of " << fragmentFile << std::endl;
+
+	Shader vertexShader, fragmentShader;
+	vertexShader.submitShaderFromFile(vertexFile, GL_VERTEX_SHADER, defines);
+	fragmentShader.submitShaderFromFile(fragmentFile, GL_FRAGMENT_SHADER, defines);
+
+	std::shared_ptr<ShaderProgram> program = std::make_shared<ShaderProgram>();
+	program->attachShader(vertexShader);
+	program->attachShader(fragmentShader);
+	program->submitLink();
+
+	vertexShader.checkCompileStatus();
+	fragmentShader.checkCompileStatus();
+	program->checkLinkStatus();
+
+	// Cache it even if it failed, so we don't try to compile a broken shader every frame
+	// Hot reloading will fix it once the file is saved
+	variants[featureMask] = program;
+
+	return program;
+}
+
+void ShaderPermutations::reloadAll()
+{
+	for (auto itr = variants.begin(); itr != variants.end(); ++itr)
+		itr->second->reload();
+}
@@ -4,6 +4,7 @@
 ShaderProgram::ShaderProgram()
 {
 	handle = 0;
+	linked = false;
 }
 
 ShaderProgram::~ShaderProgram()
@@ -11,7 +12,7 @@ ShaderProgram::~ShaderProgram()
 	destroy();
 }
 
-void ShaderProgram::attachShader(Shader shader)
+void ShaderProgram::attachShader(Shader& shader)
 {
 	if (handle == 0)
 	{
@@ -21,16 +22,44 @@ void ShaderProgram::attachShader(Shader shader)
 	if (shader.getHandle())
 	{
 		glAttachShader(handle, shader.getHandle());
+
+		ShaderSource source;
+		source.fileName = shader.getFileName();
+		source.defines = shader.getDefines();
+		source.type = shader.getType();
+		sources.push_back(source);
 	}
 }
 
 int ShaderProgram::linkProgram()
 {
+	submitLink();
+	return checkLinkStatus();
+}
+
+void ShaderProgram::submitLink()
+{
+	// Link the shaders together into a single program
+	// The link status is not queried here so multiple programs can link at once
 	if (handle)
-	{
-		// Link the shaders together into a single program
 		glLinkProgram(handle);
+}
+
+bool ShaderProgram::isLinkComplete()
+{
+	if (handle == 0 || !GLEW_ARB_parallel_shader_compile)
+		return true;
+
+	int complete;
+	glGetProgramiv(handle, GL_COMPLETION_STATUS_ARB, &complete);
+
+	return complete != 0;
+}
 
+int ShaderProgram::checkLinkStatus()
+{
+	if (handle)
+	{
 		// Check to see if shader program linked
 		// Returns 1 if success
 		int linkStatus;
@@ -39,6 +68,7 @@ int ShaderProgram::linkProgram()
 		if (linkStatus)
 		{
 			std::cout << "Shader linked Successfully." << std::endl;
+			linked = true;
 			return handle;
 		}
 
@@ -53,7 +83,7 @@ int ShaderProgram::linkProgram()
 
 		// Get error log from OpenGL and store into string
 		// Remember string is an array of characters internally
-		glGetShaderInfoLog(handle, logLength, &logLength, &log[0]);
+		glGetProgramInfoLog(handle, logLength, &logLength, &log[0]);
 
 		// Output log to screen
 		std::cout << log << std::endl;
@@ -62,6 +92,67 @@ int ShaderProgram::linkProgram()
 	{
 		std::cout << "Shader program failed to link: handle not set" << std::endl;
 	}
+
+	return 0;
+}
+
+bool ShaderProgram::reload()
+{
+	if (sources.empty())
+		return false;
+
+	// Build the new program off to the side
+	std::vector<Shader> shaders(sources.size());
+	for (unsigned int i = 0; i < sources.size(); i++)
+		shaders[i].submitShaderFromFile(sources[i].fileName, sources[i].type, sources[i].defines);
+
+	unsigned int newHandle = glCreateProgram();
+	bool compiled = true;
+
+	for (unsigned int i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i].checkCompileStatus() == 0)
+		{
+			compiled = false;
+			break;
+		}
+
+		glAttachShader(newHandle, shaders[i].getHandle());
+	}
+
+	int linkStatus = 0;
+	if (compiled)
+	{
+		glLinkProgram(newHandle);
+		glGetProgramiv(newHandle, GL_LINK_STATUS, &linkStatus);
+	}
+
+	if (!linkStatus)
+	{
+		std::cout << "Shader reload failed, keeping the previous program" << std::endl;
+		glDeleteProgram(newHandle);
+		return false;
+	}
+
+	// Swap in the new program
+	// Everything happens on the GL thread between frames, so the old handle
+	// is never used again after this point
+	glDeleteProgram(handle);
+	handle = newHandle;
+	linked = true;
+
+	std::cout << "Shader reloaded Successfully." << std::endl;
+	return true;
+}
+
+std::vector<std::string> ShaderProgram::getSourceFiles()
+{
+	std::vector<std::string> files;
+
+	for (unsigned int i = 0; i < sources.size(); i++)
+		files.push_back(sources[i].fileName);
+
+	return files;
 }
 
 void ShaderProgram::bind()
@@ -97,7 +188,10 @@ void ShaderProgram::destroy()
 	if (handle)
 	{
 		glDeleteProgram(handle);
+		handle = 0;
 	}
+
+	linked = false;
 }
 
 int ShaderProgram::getUniformLocation(const std::string& uniformName)
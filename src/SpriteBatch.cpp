@@ -0,0 +1,190 @@
+#include "SpriteBatch.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef> // for offsetof
+
+// Attribute locations in sprite_v.glsl
+enum SpriteAttributes
+{
+	SPRITE_RECT = 0,	// position and size
+	SPRITE_UVS = 1,
+	SPRITE_COLOUR = 2,
+	SPRITE_ROTATION = 3
+};
+
+SpriteBatch::SpriteBatch()
+{
+	vaoHandle = 0;
+	maxSprites = 0;
+	writeCursor = nullptr;
+	numSprites = 0;
+	currentTexture = 0;
+	numSpritesDrawn = 0;
+	numDrawCalls = 0;
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	destroy();
+}
+
+bool SpriteBatch::create(unsigned int _maxSprites)
+{
+	destroy();
+
+	if (!GLEW_VERSION_3_3 && !GLEW_ARB_instanced_arrays)
+	{
+		std::cout << "SpriteBatch: instanced arrays are not supported by this driver" << std::endl;
+		return false;
+	}
+
+	maxSprites = _maxSprites;
+
+	glGenVertexArrays(1, &vaoHandle);
+	glBindVertexArray(vaoHandle);
+
+	instanceBuffer.create(maxSprites * sizeof(SpriteInstance));
+
+	// Every attribute steps once per sprite, the 4 corners come from gl_VertexID
+	GLuint attributes[] = { SPRITE_RECT, SPRITE_UVS, SPRITE_COLOUR, SPRITE_ROTATION };
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(attributes[i]);
+		glVertexAttribDivisor(attributes[i], 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return true;
+}
+
+void SpriteBatch::destroy()
+{
+	if (vaoHandle)
+	{
+		glDeleteVertexArrays(1, &vaoHandle);
+		vaoHandle = 0;
+	}
+
+	instanceBuffer.destroy();
+	writeCursor = nullptr;
+	numSprites = 0;
+}
+
+void SpriteBatch::setShader(std::shared_ptr<ShaderProgram> _shader)
+{
+	shader = _shader;
+}
+
+void SpriteBatch::begin(const glm::mat4& _viewProj)
+{
+	viewProj = _viewProj;
+	numSprites = 0;
+	currentTexture = 0;
+	numSpritesDrawn = 0;
+	numDrawCalls = 0;
+
+	// Sprites aren't written anywhere until there's something to draw them with
+	if (!vaoHandle || !shader || !shader->isLinked())
+	{
+		writeCursor = nullptr;
+		return;
+	}
+
+	writeCursor = (SpriteInstance*)instanceBuffer.beginWrite();
+}
+
+void SpriteBatch::drawInstances(GLuint texture, const SpriteInstance* instances, unsigned int count)
+{
+	while (count > 0)
+	{
+		if (texture != currentTexture || numSprites == maxSprites)
+		{
+			flush();
+			currentTexture = texture;
+		}
+
+		if (!writeCursor)
+			return;
+
+		// As many as fit before the buffer is full
+		unsigned int numToCopy = std::min(count, maxSprites - numSprites);
+		memcpy(writeCursor + numSprites, instances, numToCopy * sizeof(SpriteInstance));
+
+		numSprites += numToCopy;
+		instances += numToCopy;
+		count -= numToCopy;
+	}
+}
+
+void SpriteBatch::end()
+{
+	if (writeCursor && numSprites > 0)
+	{
+		instanceBuffer.endWrite();
+		drawSprites();
+	}
+
+	writeCursor = nullptr;
+	numSprites = 0;
+}
+
+void SpriteBatch::flush()
+{
+	if (!writeCursor || numSprites == 0)
+		return;
+
+	instanceBuffer.endWrite();
+	drawSprites();
+
+	// The rest of the batch goes in the next region, the GPU may still be reading this one
+	writeCursor = (SpriteInstance*)instanceBuffer.beginWrite();
+	numSprites = 0;
+}
+
+void SpriteBatch::drawSprites()
+{
+	shader->bind();
+	shader->sendUniformMat4("u_viewProj", viewProj);
+	shader->sendUniformInt("u_texture", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, currentTexture);
+
+	// Drawn over the scene in order, blended by the texture's alpha
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindVertexArray(vaoHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.getHandle());
+
+	// The region moves every flush, so the attributes are pointed at it each time
+	size_t offset = instanceBuffer.getRegionOffset();
+	GLsizei stride = sizeof(SpriteInstance);
+	glVertexAttribPointer(SPRITE_RECT, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(SpriteInstance, position)));
+	glVertexAttribPointer(SPRITE_UVS, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)(offset + offsetof(SpriteInstance, uvs)));
+	glVertexAttribPointer(SPRITE_COLOUR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(offset + offsetof(SpriteInstance, colour)));
+	glVertexAttribPointer(SPRITE_ROTATION, 1, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(SpriteInstance, rotation)));
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numSprites);
+
+	// Don't write over this region again until the GPU is done drawing it
+	instanceBuffer.fenceRegion();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	shader->unbind();
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (!blend)
+		glDisable(GL_BLEND);
+
+	numSpritesDrawn += numSprites;
+	numDrawCalls++;
+}
@@ -0,0 +1,178 @@
+#include "StreamingBuffer.h"
+#include <iostream>
+
+StreamingBuffer::StreamingBuffer()
+{
+	handle = 0;
+	target = GL_ARRAY_BUFFER;
+	mappedData = nullptr;
+	regionSize = 0;
+	numRegions = 0;
+	currentRegion = 0;
+	numStalls = 0;
+	persistent = false;
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	destroy();
+}
+
+bool StreamingBuffer::create(unsigned int _regionSize, unsigned int _numRegions, GLenum _target)
+{
+	if (handle)
+		destroy();
+
+	// Keep every region aligned so attributes in them stay aligned too
+	regionSize = (_regionSize + 255) & ~255u;
+	numRegions = _numRegions;
+	target = _target;
+
+	// Start on the last region so the first beginWrite() moves to region 0
+	currentRegion = numRegions - 1;
+	regionFences.assign(numRegions, (GLsync)0);
+
+	glGenBuffers(1, &handle);
+	glBindBuffer(target, handle);
+
+	unsigned int totalSize = regionSize * numRegions;
+
+	if (GLEW_ARB_buffer_storage)
+	{
+		// Coherent means our writes are visible to the GPU without flushing them
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glBufferStorage(target, totalSize, nullptr, flags);
+		mappedData = (unsigned char*)glMapBufferRange(target, 0, totalSize, flags);
+
+		persistent = mappedData != nullptr;
+
+		if (!persistent)
+			std::cout << "StreamingBuffer: could not map the buffer persistently" << std::endl;
+	}
+
+	if (!persistent)
+	{
+		// The storage from glBufferStorage is immutable, start over with a plain buffer
+		if (GLEW_ARB_buffer_storage)
+		{
+			glDeleteBuffers(1, &handle);
+			glGenBuffers(1, &handle);
+			glBindBuffer(target, handle);
+		}
+
+		glBufferData(target, totalSize, nullptr, GL_DYNAMIC_DRAW);
+		fallbackData.resize(regionSize);
+	}
+
+	return true;
+}
+
+void StreamingBuffer::destroy()
+{
+	for (unsigned int i = 0; i < regionFences.size(); i++)
+	{
+		if (regionFences[i])
+			glDeleteSync(regionFences[i]);
+	}
+	regionFences.clear();
+
+	if (handle)
+	{
+		if (mappedData)
+		{
+			glBindBuffer(target, handle);
+			glUnmapBuffer(target);
+			glBindBuffer(target, 0);
+		}
+
+		glDeleteBuffers(1, &handle);
+		handle = 0;
+	}
+
+	mappedData = nullptr;
+	fallbackData.clear();
+	persistent = false;
+}
+
+void* StreamingBuffer::beginWrite()
+{
+	if (!handle)
+		return nullptr;
+
+	currentRegion = (currentRegion + 1) % numRegions;
+
+	// Make sure the GPU is done with the draws that last read this region
+	GLsync& fence = regionFences[currentRegion];
+	if (fence)
+	{
+		GLenum result = glClientWaitSync(fence, 0, 0);
+
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			numStalls++;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	if (persistent)
+		return mappedData + getRegionOffset();
+	else
+		return &fallbackData[0];
+}
+
+void StreamingBuffer::endWrite()
+{
+	// Coherent mapped writes are already visible to the GPU
+	if (persistent || !handle)
+		return;
+
+	glBindBuffer(target, handle);
+	glBufferSubData(target, getRegionOffset(), regionSize, &fallbackData[0]);
+}
+
+void StreamingBuffer::fenceRegion()
+{
+	if (!handle)
+		return;
+
+	GLsync& fence = regionFences[currentRegion];
+
+	if (fence)
+		glDeleteSync(fence);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+unsigned int StreamingBuffer::getRegionOffset()
+{
+	return currentRegion * regionSize;
+}
+
+unsigned int StreamingBuffer::getRegionSize()
+{
+	return regionSize;
+}
+
+unsigned int StreamingBuffer::getCurrentRegion()
+{
+	return currentRegion;
+}
+
+GLuint StreamingBuffer::getHandle()
+{
+	return handle;
+}
+
+bool StreamingBuffer::isPersistent()
+{
+	return persistent;
+}
+
+unsigned int StreamingBuffer::getNumStalls()
+{
+	return numStalls;
+}
@@ -0,0 +1,570 @@
+#include "TTK/BatchReader.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring> // for memset and memcpy
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace
+{
+	// Empty files point here, so their views aren't null
+	const unsigned char emptyFile[1] = { 0 };
+
+	// Reads bigger than this are split up (Linux reads at most about 2 GB at a time)
+	const size_t MAX_READ_SIZE = 1 << 30;
+
+	// More threads than this just make a disk seek back and forth between files
+	const unsigned int MAX_READER_THREADS = 8;
+}
+
+TTK::IO::BatchReader::BatchReader()
+{
+	ring = nullptr;
+	stopReaders = false;
+	numPending = 0;
+}
+
+TTK::IO::BatchReader::~BatchReader()
+{
+	destroy();
+}
+
+void TTK::IO::BatchReader::read(const std::string& fileName, ReadCallback onRead)
+{
+	std::shared_ptr<Read> read = std::make_shared<Read>();
+	read->fileName = fileName;
+	read->onRead = onRead;
+	read->succeeded = false;
+	read->descriptor = -1;
+	read->size = 0;
+	read->offset = 0;
+
+	numPending++;
+
+	// Packed files are already in memory (or a decompress away)
+	if (openPackedFile(fileName, read->file))
+	{
+		read->succeeded = true;
+		complete(read);
+		return;
+	}
+
+	queued.push_back(read);
+}
+
+void TTK::IO::BatchReader::submit()
+{
+	if (queued.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(readMutex);
+		submitted.insert(submitted.end(), queued.begin(), queued.end());
+	}
+	queued.clear();
+
+	if (ring)
+		startReads();
+	else
+		readerCondition.notify_all();
+}
+
+unsigned int TTK::IO::BatchReader::poll()
+{
+	if (ring)
+		reapReads(false);
+
+	std::deque<std::shared_ptr<Read>> finished;
+	{
+		std::lock_guard<std::mutex> lock(readMutex);
+		finished.swap(completed);
+	}
+
+	// The callbacks can queue more reads
+	for (unsigned int i = 0; i < finished.size(); i++)
+	{
+		numPending--;
+
+		Read& read = *finished[i];
+		if (read.onRead)
+			read.onRead(read.fileName, read.succeeded, read.file);
+	}
+
+	return (unsigned int)finished.size();
+}
+
+unsigned int TTK::IO::BatchReader::wait()
+{
+	// Nothing to wait for until the queued reads are submitted
+	if (numPending == queued.size())
+		return poll();
+
+	if (ring)
+	{
+		bool anyCompleted;
+		{
+			std::lock_guard<std::mutex> lock(readMutex);
+			anyCompleted = !completed.empty();
+		}
+
+		if (!anyCompleted)
+			reapReads(true);
+	}
+	else
+	{
+		std::unique_lock<std::mutex> lock(readMutex);
+		completedCondition.wait(lock, [this]() { return !completed.empty(); });
+	}
+
+	return poll();
+}
+
+void TTK::IO::BatchReader::waitForAll()
+{
+	submit();
+
+	while (numPending > 0)
+		wait();
+}
+
+void TTK::IO::BatchReader::complete(std::shared_ptr<Read> read)
+{
+	{
+		std::lock_guard<std::mutex> lock(readMutex);
+		completed.push_back(read);
+	}
+	completedCondition.notify_one();
+}
+
+void TTK::IO::BatchReader::readerLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<Read> read;
+		{
+			std::unique_lock<std::mutex> lock(readMutex);
+			readerCondition.wait(lock, [this]() { return stopReaders || !submitted.empty(); });
+
+			if (stopReaders)
+				return;
+
+			read = submitted.front();
+			submitted.pop_front();
+		}
+
+		read->succeeded = openFile(read->fileName, read->file);
+		complete(read);
+	}
+}
+
+#ifdef __linux__
+
+// The rings are used without liburing: they're memory shared with the kernel, the tails say
+// how far each side has written and the heads how far the other side has read
+struct TTK::IO::BatchReader::Ring
+{
+	// Returns null if io_uring can't be used
+	static Ring* create(unsigned int queueDepth, size_t bufferSize);
+	~Ring();
+
+	// A submission entry to fill in, submitted by the next enter()
+	io_uring_sqe* getSqe();
+
+	// Submits the entries filled in, and waits for a completion if asked to
+	void enter(bool waitForOne);
+
+	int fd;
+
+	void* sqMemory;
+	size_t sqMemorySize;
+	void* cqMemory;		// the same as sqMemory with IORING_FEAT_SINGLE_MMAP
+	size_t cqMemorySize;
+	io_uring_sqe* sqes;
+	size_t sqesSize;
+
+	unsigned int* sqHead;
+	unsigned int* sqTail;
+	unsigned int* sqArray;
+	unsigned int sqMask;
+	unsigned int sqTailLocal;	// sqTail is only written by enter(), once the entries are filled in
+	unsigned int numToSubmit;
+
+	unsigned int* cqHead;
+	unsigned int* cqTail;
+	unsigned int cqMask;
+	io_uring_cqe* cqes;
+
+	// One buffer per slot, registered with the kernel once so reads into them don't have to map pages
+	std::vector<unsigned char> buffers;
+	size_t bufferSize;
+	bool buffersRegistered;
+};
+
+TTK::IO::BatchReader::Ring* TTK::IO::BatchReader::Ring::create(unsigned int queueDepth, size_t bufferSize)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	int fd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+	if (fd < 0)
+		return nullptr;
+
+	Ring* ring = new Ring();
+	ring->fd = fd;
+	ring->sqMemory = MAP_FAILED;
+	ring->cqMemory = MAP_FAILED;
+	ring->sqes = (io_uring_sqe*)MAP_FAILED;
+
+	// IORING_OP_READ came in the same kernel (5.6) as this feature
+	if (!(params.features & IORING_FEAT_RW_CUR_POS))
+	{
+		delete ring;
+		return nullptr;
+	}
+
+	ring->sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	ring->cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+	bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMapping)
+		ring->sqMemorySize = ring->cqMemorySize = std::max(ring->sqMemorySize, ring->cqMemorySize);
+
+	ring->sqMemory = mmap(nullptr, ring->sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	ring->cqMemory = singleMapping ? ring->sqMemory :
+		mmap(nullptr, ring->cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	ring->sqes = (io_uring_sqe*)mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if (ring->sqMemory == MAP_FAILED || ring->cqMemory == MAP_FAILED || ring->sqes == MAP_FAILED)
+	{
+		delete ring;
+		return nullptr;
+	}
+
+	unsigned char* sq = (unsigned char*)ring->sqMemory;
+	ring->sqHead = (unsigned int*)(sq + params.sq_off.head);
+	ring->sqTail = (unsigned int*)(sq + params.sq_off.tail);
+	ring->sqArray = (unsigned int*)(sq + params.sq_off.array);
+	ring->sqMask = *(unsigned int*)(sq + params.sq_off.ring_mask);
+	ring->sqTailLocal = *ring->sqTail;
+	ring->numToSubmit = 0;
+
+	unsigned char* cq = (unsigned char*)ring->cqMemory;
+	ring->cqHead = (unsigned int*)(cq + params.cq_off.head);
+	ring->cqTail = (unsigned int*)(cq + params.cq_off.tail);
+	ring->cqMask = *(unsigned int*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	ring->bufferSize = bufferSize;
+	ring->buffers.resize(queueDepth * bufferSize);
+
+	std::vector<iovec> iovecs(queueDepth);
+	for (unsigned int i = 0; i < queueDepth; i++)
+	{
+		iovecs[i].iov_base = ring->buffers.data() + i * bufferSize;
+		iovecs[i].iov_len = bufferSize;
+	}
+
+	// Registering pins the buffers, which can go over the locked memory limit on older kernels,
+	// in which case every file is read into its own memory
+	ring->buffersRegistered = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(), queueDepth) == 0;
+	if (!ring->buffersRegistered)
+	{
+		ring->buffers.clear();
+		ring->buffers.shrink_to_fit();
+	}
+
+	return ring;
+}
+
+TTK::IO::BatchReader::Ring::~Ring()
+{
+	if (sqes != MAP_FAILED)
+		munmap(sqes, sqesSize);
+	if (cqMemory != MAP_FAILED && cqMemory != sqMemory)
+		munmap(cqMemory, cqMemorySize);
+	if (sqMemory != MAP_FAILED)
+		munmap(sqMemory, sqMemorySize);
+
+	// Also unregisters the buffers
+	close(fd);
+}
+
+io_uring_sqe* TTK::IO::BatchReader::Ring::getSqe()
+{
+	// There's never more in flight than there are slots, and never more slots than entries,
+	// so the ring can't be full
+	unsigned int index = sqTailLocal & sqMask;
+	sqTailLocal++;
+	numToSubmit++;
+
+	io_uring_sqe* sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqArray[index] = index;
+	return sqe;
+}
+
+void TTK::IO::BatchReader::Ring::enter(bool waitForOne)
+{
+	// The kernel mustn't see the new tail before the entries behind it
+	__atomic_store_n(sqTail, sqTailLocal, __ATOMIC_RELEASE);
+
+	int result;
+	do
+	{
+		result = (int)syscall(__NR_io_uring_enter, fd, numToSubmit, waitForOne ? 1 : 0,
+			waitForOne ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+	} while (result < 0 && errno == EINTR);
+
+	// Entries the kernel didn't take (ie. it was out of memory) go with the next call
+	if (result > 0)
+		numToSubmit -= std::min((unsigned int)result, numToSubmit);
+}
+
+void TTK::IO::BatchReader::create(unsigned int queueDepth, size_t bufferSize)
+{
+	destroy();
+
+	queueDepth = std::max(queueDepth, 1u);
+
+	ring = Ring::create(queueDepth, bufferSize);
+
+	if (ring)
+	{
+		inFlight.resize(queueDepth);
+		for (unsigned int i = queueDepth; i > 0; i--)
+			freeSlots.push_back(i - 1);
+		return;
+	}
+
+	stopReaders = false;
+	for (unsigned int i = 0; i < std::min(queueDepth, MAX_READER_THREADS); i++)
+		readers.push_back(std::thread(&BatchReader::readerLoop, this));
+}
+
+void TTK::IO::BatchReader::destroy()
+{
+	if (ring)
+	{
+		// The kernel may still be writing into the buffers, so the reads in flight have to finish
+		submitted.clear();
+		while (freeSlots.size() < inFlight.size())
+			reapReads(true);
+
+		delete ring;
+		ring = nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(readMutex);
+		stopReaders = true;
+	}
+	readerCondition.notify_all();
+
+	for (unsigned int i = 0; i < readers.size(); i++)
+		readers[i].join();
+	readers.clear();
+
+	inFlight.clear();
+	freeSlots.clear();
+	queued.clear();
+	submitted.clear();
+	completed.clear();
+	numPending = 0;
+}
+
+void TTK::IO::BatchReader::startReads()
+{
+	while (!submitted.empty() && !freeSlots.empty())
+	{
+		unsigned int slot = freeSlots.back();
+		freeSlots.pop_back();
+
+		inFlight[slot] = submitted.front();
+		submitted.pop_front();
+
+		openRead(slot);
+	}
+
+	// Every read started goes to the kernel in one call
+	if (ring->numToSubmit > 0)
+		ring->enter(false);
+}
+
+void TTK::IO::BatchReader::openRead(unsigned int slot)
+{
+	Read& read = *inFlight[slot];
+
+	read.descriptor = open(read.fileName.c_str(), O_RDONLY);
+
+	struct stat info;
+	if (read.descriptor < 0 || fstat(read.descriptor, &info) != 0)
+	{
+		std::cout << "File IO Error: Cannot open file: " << read.fileName << std::endl;
+		finishRead(slot, false);
+		return;
+	}
+
+	read.size = (size_t)info.st_size;
+
+	if (read.size == 0)
+	{
+		finishRead(slot, true);
+		return;
+	}
+
+	if (read.size > ring->bufferSize || !ring->buffersRegistered)
+		read.buffer = std::make_shared<std::vector<unsigned char>>(read.size);
+
+	readNextChunk(slot);
+}
+
+void TTK::IO::BatchReader::readNextChunk(unsigned int slot)
+{
+	Read& read = *inFlight[slot];
+
+	io_uring_sqe* sqe = ring->getSqe();
+	sqe->fd = read.descriptor;
+	sqe->off = read.offset;
+	sqe->len = (unsigned int)std::min(read.size - read.offset, MAX_READ_SIZE);
+	sqe->user_data = slot;
+
+	if (read.buffer)
+	{
+		sqe->opcode = IORING_OP_READ;
+		sqe->addr = (unsigned long long)(read.buffer->data() + read.offset);
+	}
+	else
+	{
+		sqe->opcode = IORING_OP_READ_FIXED;
+		sqe->addr = (unsigned long long)(ring->buffers.data() + slot * ring->bufferSize + read.offset);
+		sqe->buf_index = slot;
+	}
+}
+
+void TTK::IO::BatchReader::reapReads(bool waitForOne)
+{
+	unsigned int head = *ring->cqHead;
+
+	// Only go to the kernel to wait if nothing has finished already
+	if (ring->numToSubmit > 0 || (waitForOne && head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)))
+		ring->enter(waitForOne);
+
+	unsigned int tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++)
+	{
+		const io_uring_cqe& cqe = ring->cqes[head & ring->cqMask];
+		unsigned int slot = (unsigned int)cqe.user_data;
+		Read& read = *inFlight[slot];
+
+		if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+		{
+			readNextChunk(slot);
+		}
+		else if (cqe.res < 0 || (cqe.res == 0 && read.offset < read.size))
+		{
+			// A read of 0 bytes means the file got shorter since it was opened
+			std::cout << "File IO Error: Cannot read file: " << read.fileName << std::endl;
+			finishRead(slot, false);
+		}
+		else
+		{
+			// Reads can come back short, the rest is read next
+			read.offset += cqe.res;
+
+			if (read.offset < read.size)
+				readNextChunk(slot);
+			else
+				finishRead(slot, true);
+		}
+	}
+
+	// The kernel can reuse the entries once the head has passed them
+	__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+	// Submitted reads take the slots just freed
+	startReads();
+}
+
+void TTK::IO::BatchReader::finishRead(unsigned int slot, bool succeeded)
+{
+	std::shared_ptr<Read> read = inFlight[slot];
+	inFlight[slot].reset();
+	freeSlots.push_back(slot);
+
+	if (read->descriptor >= 0)
+		close(read->descriptor);
+	read->descriptor = -1;
+
+	read->succeeded = succeeded;
+
+	if (succeeded)
+	{
+		// Registered buffers are reused, so the file is copied out of its
+		if (!read->buffer)
+		{
+			const unsigned char* bytes = ring->buffers.data() + slot * ring->bufferSize;
+			read->buffer = std::make_shared<std::vector<unsigned char>>(bytes, bytes + read->size);
+		}
+
+		read->file.bytes = read->buffer->empty() ? emptyFile : read->buffer->data();
+		read->file.numBytes = read->buffer->size();
+		read->file.owner = read->buffer;
+	}
+
+	read->buffer.reset();
+	complete(read);
+}
+
+#else
+
+// io_uring is Linux only
+struct TTK::IO::BatchReader::Ring
+{
+	static Ring* create(unsigned int queueDepth, size_t bufferSize) { return nullptr; }
+};
+
+void TTK::IO::BatchReader::create(unsigned int queueDepth, size_t bufferSize)
+{
+	destroy();
+
+	stopReaders = false;
+	for (unsigned int i = 0; i < std::min(std::max(queueDepth, 1u), MAX_READER_THREADS); i++)
+		readers.push_back(std::thread(&BatchReader::readerLoop, this));
+}
+
+void TTK::IO::BatchReader::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(readMutex);
+		stopReaders = true;
+	}
+	readerCondition.notify_all();
+
+	for (unsigned int i = 0; i < readers.size(); i++)
+		readers[i].join();
+	readers.clear();
+
+	queued.clear();
+	submitted.clear();
+	completed.clear();
+	numPending = 0;
+}
+
+void TTK::IO::BatchReader::startReads() {}
+void TTK::IO::BatchReader::openRead(unsigned int slot) {}
+void TTK::IO::BatchReader::readNextChunk(unsigned int slot) {}
+void TTK::IO::BatchReader::reapReads(bool waitForOne) {}
+void TTK::IO::BatchReader::finishRead(unsigned int slot, bool succeeded) {}
+
+#endif
@@ -0,0 +1,672 @@
+#include "TTK/DebugDraw.h"
+#include "TTK/MeshBase.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef> // for offsetof
+#include <cstring>
+#include <iostream>
+
+// The font is drawn with lines on a grid 4 units wide, with the baseline at 2,
+// capitals and digits 6 units high and descenders down to 0
+// Each glyph is a list of strokes separated by spaces, and each stroke is a list of
+// points as two digits (x then y). A stroke with one point is a dot.
+static const char* const fontStrokes[] =
+{
+	"",												// ' '
+	"2824 22",										// !
+	"1816 3836",									// "
+	"0646 0444 1812 3832",							// #
+	"473818070615354443321203 2921",				// $
+	"0248 17 33",									// %
+	"4216172837360403122244",						// &
+	"2826",											// '
+	"38272332",										// (
+	"18272312",										// )
+	"2723 0644 0446",								// *
+	"2723 0545",									// +
+	"2210",											// ,
+	"1535",											// -
+	"22",											// .
+	"0248",											// /
+	"183847433212030718 1337",						// 0
+	"172822 1232",									// 1
+	"07183847460242",								// 2
+	"0718384746354443321203 1535",					// 3
+	"32380444",										// 4
+	"4808053544433202",								// 5
+	"38180703123243443505",							// 6
+	"084812",										// 7
+	"15060718384746351504031232434435",				// 8
+	"45150607183847433212",							// 9
+	"25 22",										// :
+	"25 2210",										// ;
+	"470543",										// <
+	"0444 0646",									// =
+	"074503",										// >
+	"071838474624 22",								// ?
+	"3616143436 344447381807031242",				// @
+	"0206284642 0444",								// A
+	"02083847463505 3544433202",					// B
+	"4738180703123243",								// C
+	"02082846442202",								// D
+	"48080242 0535",								// E
+	"480802 0535",									// F
+	"47381807031232434525",							// G
+	"0208 4842 0545",								// H
+	"1838 2822 1232",								// I
+	"4843321203",									// J
+	"0208 4804 1542",								// K
+	"080242",										// L
+	"0208254842",									// M
+	"02084248",										// N
+	"183847433212030718",							// O
+	"02083847463505",								// P
+	"183847433212030718 2442",						// Q
+	"02083847463505 2542",							// R
+	"473818070615354443321203",						// S
+	"0848 2822",									// T
+	"080312324348",									// U
+	"082248",										// V
+	"0812253248",									// W
+	"0842 0248",									// X
+	"082548 2522",									// Y
+	"08484202",										// Z
+	"38181232",										// [
+	"0842",											// backslash
+	"18383212",										// ]
+	"062846",										// ^
+	"0040",											// _
+	"1827",											// `
+	"16364542 4414031242",							// a
+	"08023243453606",								// b
+	"461605031242",									// c
+	"48421203051646",								// d
+	"044445361605031242",							// e
+	"4738281712 0636",								// f
+	"4641301001 461605041343",						// g
+	"0802 06364542",								// h
+	"2622 28",										// i
+	"3631201001 38",								// j
+	"0802 4604 2542",								// k
+	"18282332",										// l
+	"0602 05162522 25364542",						// m
+	"0602 0516364542",								// n
+	"163645433212030516",							// o
+	"0600 063645433202",							// p
+	"4640 461605031242",							// q
+	"0602 042646",									// r
+	"4616051434433202",								// s
+	"28233242 0646",								// t
+	"0603123243 4642",								// u
+	"062246",										// v
+	"0612243246",									// w
+	"0642 0246",									// x
+	"0622 4610",									// y
+	"06464202",										// z
+	"38272615242332",								// {
+	"2921",											// |
+	"18272635242312",								// }
+	"05163445"										// ~
+};
+
+static const unsigned int NUM_FONT_CHARACTERS = sizeof(fontStrokes) / sizeof(fontStrokes[0]);
+
+// The dot for 2D points comes after the characters
+static const unsigned int DOT_GLYPH = NUM_FONT_CHARACTERS;
+
+// Font layout, in grid units
+static const float FONT_BASELINE = 2.0f;
+static const float FONT_ADVANCE = 6.0f;			// from one character to the next
+static const float FONT_LINE_HEIGHT = 12.0f;	// from one line to the next
+static const float FONT_HALF_WIDTH = 0.45f;		// half the thickness of a stroke
+static const float DOT_RADIUS = 2.0f;
+
+// Distance field resolution, and how far from the edge of a stroke it goes
+// The outline in debugText_f.glsl has to fit inside the spread
+static const float FONT_TEXELS_PER_UNIT = 4.0f;
+static const float FONT_SPREAD = 1.5f;
+
+static const unsigned int FONT_TEXTURE_WIDTH = 256;
+
+// Attribute locations in debugLine_v.glsl
+enum DebugLineAttributes
+{
+	DEBUG_LINE_VERTEX = 0,
+	DEBUG_LINE_COLOUR = 1
+};
+
+static glm::u8vec4 packColour(const glm::vec4& colour)
+{
+	return glm::u8vec4(glm::clamp(colour, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// Distance from p to the line segment from a to b
+static float distanceToSegment(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b)
+{
+	glm::vec2 ab = b - a;
+	float lengthSquared = glm::dot(ab, ab);
+	float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(p - a, ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+	return glm::length(p - (a + ab * t));
+}
+
+TTK::DebugDraw::DebugDraw()
+{
+	lineVAO = 0;
+	maxLineVertices = 200000;
+	maxGlyphs = 50000;
+	numLineVertices = 0;
+	numGlyphs = 0;
+	fontWidth = fontHeight = 0;
+	fontTexture = 0;
+	numDrawCalls = 0;
+	numDropped = 0;
+}
+
+TTK::DebugDraw::~DebugDraw()
+{
+	destroy();
+}
+
+bool TTK::DebugDraw::create(unsigned int _maxLineVertices, unsigned int _maxGlyphs)
+{
+	destroy();
+
+	maxLineVertices = _maxLineVertices & ~1u; // lines are pairs
+	maxGlyphs = _maxGlyphs;
+
+	if (!textBatch.create(maxGlyphs))
+		return false;
+
+	// Lines
+	glGenVertexArrays(1, &lineVAO);
+	glBindVertexArray(lineVAO);
+
+	lineBuffer.create(maxLineVertices * sizeof(LineVertex));
+	glEnableVertexAttribArray(DEBUG_LINE_VERTEX);
+	glEnableVertexAttribArray(DEBUG_LINE_COLOUR);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Font, the pixels are let go of once they're uploaded
+	if (fontPixels.empty())
+		buildFont();
+
+	glGenTextures(1, &fontTexture);
+	glBindTexture(GL_TEXTURE_2D, fontTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// One channel, the distance field is filtered like any other texture
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, fontWidth, fontHeight, 0, GL_RED, GL_UNSIGNED_BYTE, &fontPixels[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	fontPixels = std::vector<unsigned char>();
+
+	return true;
+}
+
+void TTK::DebugDraw::destroy()
+{
+	if (lineVAO)
+	{
+		glDeleteVertexArrays(1, &lineVAO);
+		lineVAO = 0;
+	}
+
+	if (fontTexture)
+	{
+		glDeleteTextures(1, &fontTexture);
+		fontTexture = 0;
+	}
+
+	lineBuffer.destroy();
+	textBatch.destroy();
+}
+
+void TTK::DebugDraw::setLineShader(std::shared_ptr<ShaderProgram> shader)
+{
+	lineShader = shader;
+}
+
+void TTK::DebugDraw::setTextShader(std::shared_ptr<ShaderProgram> shader)
+{
+	textBatch.setShader(shader);
+}
+
+void TTK::DebugDraw::buildFont()
+{
+	glyphs.assign(NUM_FONT_CHARACTERS + 1, Glyph());
+
+	// Each glyph's strokes, as line segments in grid units
+	std::vector<std::vector<glm::vec2> > segments(glyphs.size());
+	std::vector<float> halfWidths(glyphs.size(), FONT_HALF_WIDTH);
+
+	for (unsigned int i = 0; i < NUM_FONT_CHARACTERS; i++)
+	{
+		const char* strokes = fontStrokes[i];
+		std::vector<glm::vec2> stroke;
+
+		for (unsigned int c = 0; ; c++)
+		{
+			if (strokes[c] >= '0' && strokes[c] <= '9' && strokes[c + 1] >= '0' && strokes[c + 1] <= '9')
+			{
+				stroke.push_back(glm::vec2(strokes[c] - '0', strokes[c + 1] - '0'));
+				c++;
+				continue;
+			}
+
+			// End of a stroke, a dot is a segment with no length
+			if (stroke.size() == 1)
+				stroke.push_back(stroke[0]);
+
+			for (unsigned int p = 0; p + 1 < stroke.size(); p++)
+			{
+				segments[i].push_back(stroke[p]);
+				segments[i].push_back(stroke[p + 1]);
+			}
+
+			stroke.clear();
+
+			if (strokes[c] == '\0')
+				break;
+		}
+	}
+
+	// The dot is one big point, centred on the origin
+	segments[DOT_GLYPH].push_back(glm::vec2(0.0f));
+	segments[DOT_GLYPH].push_back(glm::vec2(0.0f));
+	halfWidths[DOT_GLYPH] = DOT_RADIUS;
+
+	// Every glyph's box (with room for the distance field around it) packed into the texture
+	const unsigned int padding = 1;
+	AtlasPacker packer;
+	packer.reset(FONT_TEXTURE_WIDTH, 4096);
+
+	std::vector<glm::vec2> boxMins(glyphs.size());
+
+	for (unsigned int i = 0; i < glyphs.size(); i++)
+	{
+		if (segments[i].empty())
+			continue;
+
+		glm::vec2 boxMin = segments[i][0], boxMax = segments[i][0];
+		for (unsigned int s = 1; s < segments[i].size(); s++)
+		{
+			boxMin = glm::min(boxMin, segments[i][s]);
+			boxMax = glm::max(boxMax, segments[i][s]);
+		}
+
+		boxMins[i] = boxMin - (halfWidths[i] + FONT_SPREAD);
+		glm::vec2 boxSize = boxMax - boxMin + (halfWidths[i] + FONT_SPREAD) * 2.0f;
+
+		AtlasRegion& region = glyphs[i].region;
+		region.width = (unsigned int)std::ceil(boxSize.x * FONT_TEXELS_PER_UNIT);
+		region.height = (unsigned int)std::ceil(boxSize.y * FONT_TEXELS_PER_UNIT);
+
+		packer.pack(region.width + padding * 2, region.height + padding * 2, region.x, region.y);
+		region.x += padding;
+		region.y += padding;
+
+		// The quad is whole texels, so it can be a bit bigger than the box
+		glyphs[i].size = glm::vec2(region.width, region.height) / FONT_TEXELS_PER_UNIT;
+		glyphs[i].offset = boxMins[i] - glm::vec2(0.0f, FONT_BASELINE);
+	}
+
+	glyphs[DOT_GLYPH].offset = -glyphs[DOT_GLYPH].size * 0.5f;
+
+	fontWidth = FONT_TEXTURE_WIDTH;
+	fontHeight = (packer.getUsedHeight() + 3) & ~3u;
+	fontPixels.assign(fontWidth * fontHeight, 0);
+
+	// 0.5 is the edge of a stroke, 1 is FONT_SPREAD inside it and 0 is FONT_SPREAD outside
+	for (unsigned int i = 0; i < glyphs.size(); i++)
+	{
+		AtlasRegion& region = glyphs[i].region;
+		if (segments[i].empty())
+			continue;
+
+		region.uvMin = glm::vec2((float)region.x / fontWidth, (float)region.y / fontHeight);
+		region.uvMax = glm::vec2((float)(region.x + region.width) / fontWidth, (float)(region.y + region.height) / fontHeight);
+
+		for (unsigned int y = 0; y < region.height; y++)
+		{
+			unsigned char* row = &fontPixels[(region.y + y) * fontWidth + region.x];
+
+			for (unsigned int x = 0; x < region.width; x++)
+			{
+				// Texel centres
+				glm::vec2 p = boxMins[i] + (glm::vec2(x, y) + 0.5f) / FONT_TEXELS_PER_UNIT;
+
+				float distance = FLT_MAX;
+				for (unsigned int s = 0; s < segments[i].size(); s += 2)
+					distance = std::min(distance, distanceToSegment(p, segments[i][s], segments[i][s + 1]));
+
+				float value = 0.5f + (halfWidths[i] - distance) / (FONT_SPREAD * 2.0f);
+				row[x] = (unsigned char)(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+	}
+}
+
+void TTK::DebugDraw::begin(const glm::mat4& _viewProj, const glm::vec2& _screenSize)
+{
+	if (glyphs.empty())
+		buildFont();
+
+	// Allocated the first frame, every frame after that writes over them
+	if (lineVertices.size() != maxLineVertices)
+		lineVertices.resize(maxLineVertices);
+	if (glyphInstances.size() != maxGlyphs)
+		glyphInstances.resize(maxGlyphs);
+
+	viewProj = _viewProj;
+	screenSize = _screenSize;
+
+	numLineVertices = 0;
+	numGlyphs = 0;
+	numDrawCalls = 0;
+	numDropped = 0;
+}
+
+TTK::DebugDraw::LineVertex* TTK::DebugDraw::addLineVertices(unsigned int count)
+{
+	if (numLineVertices + count > maxLineVertices)
+	{
+		numDropped += count;
+		return nullptr;
+	}
+
+	LineVertex* vertices = &lineVertices[numLineVertices];
+	numLineVertices += count;
+	return vertices;
+}
+
+void TTK::DebugDraw::addLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& colour)
+{
+	LineVertex* vertices = addLineVertices(2);
+	if (!vertices)
+		return;
+
+	glm::u8vec4 packedColour = packColour(colour);
+	vertices[0].position = a;
+	vertices[0].colour = packedColour;
+	vertices[1].position = b;
+	vertices[1].colour = packedColour;
+}
+
+void TTK::DebugDraw::addPoint(const glm::vec3& position, float size, const glm::vec4& colour)
+{
+	LineVertex* vertices = addLineVertices(6);
+	if (!vertices)
+		return;
+
+	glm::u8vec4 packedColour = packColour(colour);
+	float halfSize = size * 0.5f;
+
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		glm::vec3 offset(0.0f);
+		offset[axis] = halfSize;
+
+		vertices[axis * 2].position = position - offset;
+		vertices[axis * 2].colour = packedColour;
+		vertices[axis * 2 + 1].position = position + offset;
+		vertices[axis * 2 + 1].colour = packedColour;
+	}
+}
+
+void TTK::DebugDraw::addBox(const glm::vec3& min, const glm::vec3& max, const glm::vec4& colour, const glm::mat4& transform)
+{
+	LineVertex* vertices = addLineVertices(24);
+	if (!vertices)
+		return;
+
+	// Corner i has max's x if bit 0 is set, max's y for bit 1 and max's z for bit 2
+	// Only min is transformed, the rest are min plus the transformed edges
+	glm::vec3 edgeX = glm::vec3(transform[0]) * (max.x - min.x);
+	glm::vec3 edgeY = glm::vec3(transform[1]) * (max.y - min.y);
+	glm::vec3 edgeZ = glm::vec3(transform[2]) * (max.z - min.z);
+
+	glm::vec3 corners[8];
+	corners[0] = glm::vec3(transform * glm::vec4(min, 1.0f));
+	corners[1] = corners[0] + edgeX;
+	corners[2] = corners[0] + edgeY;
+	corners[3] = corners[1] + edgeY;
+	for (unsigned int i = 0; i < 4; i++)
+		corners[i + 4] = corners[i] + edgeZ;
+
+	// Edges join corners one bit apart
+	static const unsigned char edges[24] =
+	{
+		0, 1, 2, 3, 4, 5, 6, 7,		// along x
+		0, 2, 1, 3, 4, 6, 5, 7,		// along y
+		0, 4, 1, 5, 2, 6, 3, 7		// along z
+	};
+
+	glm::u8vec4 packedColour = packColour(colour);
+	for (unsigned int i = 0; i < 24; i++)
+	{
+		vertices[i].position = corners[edges[i]];
+		vertices[i].colour = packedColour;
+	}
+}
+
+void TTK::DebugDraw::addSphere(const glm::vec3& centre, float radius, const glm::vec4& colour)
+{
+	const unsigned int numSegments = 24;
+
+	LineVertex* vertices = addLineVertices(numSegments * 2 * 3);
+	if (!vertices)
+		return;
+
+	glm::u8vec4 packedColour = packColour(colour);
+
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		// The circle is in the plane of the other two axes
+		unsigned int u = (axis + 1) % 3;
+		unsigned int v = (axis + 2) % 3;
+
+		for (unsigned int i = 0; i < numSegments; i++)
+		{
+			for (unsigned int end = 0; end < 2; end++)
+			{
+				float angle = (i + end) * 6.2831853f / numSegments;
+
+				glm::vec3 position = centre;
+				position[u] += std::cos(angle) * radius;
+				position[v] += std::sin(angle) * radius;
+
+				vertices->position = position;
+				vertices->colour = packedColour;
+				vertices++;
+			}
+		}
+	}
+}
+
+void TTK::DebugDraw::addAxes(const glm::mat4& transform, float size)
+{
+	glm::vec3 origin(transform[3]);
+
+	addLine(origin, origin + glm::vec3(transform[0]) * size, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+	addLine(origin, origin + glm::vec3(transform[1]) * size, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+	addLine(origin, origin + glm::vec3(transform[2]) * size, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+}
+
+void TTK::DebugDraw::addWireframe(const MeshBase& mesh, const glm::mat4& transform, const glm::vec4& colour)
+{
+	unsigned int verticesPerFace = mesh.primitiveType == TTK::PrimitiveType::Quads ? 4 : 3;
+	unsigned int numFaces = (unsigned int)mesh.vertices.size() / verticesPerFace;
+
+	LineVertex* vertices = addLineVertices(numFaces * verticesPerFace * 2);
+	if (!vertices)
+		return;
+
+	glm::u8vec4 packedColour = packColour(colour);
+
+	for (unsigned int face = 0; face < numFaces; face++)
+	{
+		const glm::vec3* faceVertices = &mesh.vertices[face * verticesPerFace];
+
+		// Each vertex to the next, and the last back to the first
+		for (unsigned int i = 0; i < verticesPerFace; i++)
+		{
+			vertices[0].position = glm::vec3(transform * glm::vec4(faceVertices[i], 1.0f));
+			vertices[0].colour = packedColour;
+			vertices[1].position = glm::vec3(transform * glm::vec4(faceVertices[(i + 1) % verticesPerFace], 1.0f));
+			vertices[1].colour = packedColour;
+			vertices += 2;
+		}
+	}
+}
+
+void TTK::DebugDraw::addPoint2D(const glm::vec2& position, float size, const glm::vec4& colour)
+{
+	if (numGlyphs >= maxGlyphs)
+	{
+		numDropped++;
+		return;
+	}
+
+	// The dot's glyph is DOT_RADIUS * 2 units across (plus the spread around it)
+	const Glyph& glyph = glyphs[DOT_GLYPH];
+	float scale = size / (DOT_RADIUS * 2.0f);
+
+	SpriteBatch::writeSprite(glyphInstances[numGlyphs++], glyph.region, position, glyph.size * scale, colour, 0.0f);
+}
+
+void TTK::DebugDraw::addText(const std::string& text, const glm::vec2& position, float size, const glm::vec4& colour)
+{
+	float scale = size / FONT_LINE_HEIGHT;
+	glm::vec2 pen = position;
+
+	for (unsigned int i = 0; i < text.size(); i++)
+	{
+		char c = text[i];
+
+		if (c == '\n')
+		{
+			pen.x = position.x;
+			pen.y -= size;
+			continue;
+		}
+
+		// Anything not in the font shows as a '?'
+		unsigned int index = (c >= ' ' && c <= '~') ? c - ' ' : '?' - ' ';
+		const Glyph& glyph = glyphs[index];
+
+		if (glyph.region.width > 0)
+		{
+			if (numGlyphs >= maxGlyphs)
+			{
+				numDropped += (unsigned int)(text.size() - i);
+				return;
+			}
+
+			// Sprites are placed by their centre
+			SpriteBatch::writeSprite(glyphInstances[numGlyphs++], glyph.region, pen + (glyph.offset + glyph.size * 0.5f) * scale,
+				glyph.size * scale, colour, 0.0f);
+		}
+
+		pen.x += FONT_ADVANCE * scale;
+	}
+}
+
+void TTK::DebugDraw::addText3D(const std::string& text, const glm::vec3& position, float size, const glm::vec4& colour)
+{
+	glm::vec4 clipPosition = viewProj * glm::vec4(position, 1.0f);
+	if (clipPosition.w <= 0.0f)
+		return;
+
+	glm::vec2 ndc = glm::vec2(clipPosition) / clipPosition.w;
+	addText(text, (ndc * 0.5f + 0.5f) * screenSize, size, colour);
+}
+
+glm::vec2 TTK::DebugDraw::measureText(const std::string& text, float size) const
+{
+	unsigned int numLines = text.empty() ? 0 : 1;
+	unsigned int lineLength = 0, longestLine = 0;
+
+	for (unsigned int i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '\n')
+		{
+			numLines++;
+			lineLength = 0;
+			continue;
+		}
+
+		lineLength++;
+		longestLine = std::max(longestLine, lineLength);
+	}
+
+	float scale = size / FONT_LINE_HEIGHT;
+	return glm::vec2(longestLine * FONT_ADVANCE * scale, numLines * size);
+}
+
+void TTK::DebugDraw::end()
+{
+	// Lines first so labels are drawn over them
+	if (numLineVertices > 0 && lineVAO && lineShader && lineShader->isLinked())
+		drawLines();
+
+	if (numGlyphs > 0 && fontTexture)
+	{
+		textBatch.begin(glm::ortho(0.0f, screenSize.x, 0.0f, screenSize.y));
+		textBatch.drawInstances(fontTexture, &glyphInstances[0], numGlyphs);
+		textBatch.end();
+
+		numDrawCalls += textBatch.getNumDrawCalls();
+	}
+}
+
+void TTK::DebugDraw::drawLines()
+{
+	// Every line made this frame, copied into the streaming buffer's next region at once
+	LineVertex* destination = (LineVertex*)lineBuffer.beginWrite();
+	memcpy(destination, &lineVertices[0], numLineVertices * sizeof(LineVertex));
+	lineBuffer.endWrite();
+
+	lineShader->bind();
+	lineShader->sendUniformMat4("u_viewProj", viewProj);
+
+	// Drawn over the scene so they're never hidden
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindVertexArray(lineVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, lineBuffer.getHandle());
+
+	size_t offset = lineBuffer.getRegionOffset();
+	GLsizei stride = sizeof(LineVertex);
+	glVertexAttribPointer(DEBUG_LINE_VERTEX, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(LineVertex, position)));
+	glVertexAttribPointer(DEBUG_LINE_COLOUR, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(offset + offsetof(LineVertex, colour)));
+
+	glDrawArrays(GL_LINES, 0, numLineVertices);
+
+	lineBuffer.fenceRegion();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	lineShader->unbind();
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (!blend)
+		glDisable(GL_BLEND);
+
+	numDrawCalls++;
+}
@@ -1,9 +1,91 @@
 #include <TTK/IO.h>
+#include <TTK/PackFile.h>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <atomic>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+namespace
+{
+	struct MountedPack
+	{
+		std::string mountPoint;
+		std::shared_ptr<TTK::PackFile> pack;
+	};
+
+	std::mutex mountMutex;
+	std::vector<MountedPack> mountedPacks;
+
+	std::atomic<unsigned int> numPackedOpens(0);
+	std::atomic<unsigned int> numDiskOpens(0);
+
+	// Mapping an empty file fails, so empty files point here instead
+	const unsigned char emptyFile[1] = { 0 };
+
+	// True if path starts with prefix, '\' matches '/'
+	bool startsWithPath(const std::string& path, const std::string& prefix)
+	{
+		if (path.length() < prefix.length())
+			return false;
+
+		for (unsigned int i = 0; i < prefix.length(); i++)
+		{
+			char a = path[i] == '\\' ? '/' : path[i];
+			char b = prefix[i] == '\\' ? '/' : prefix[i];
+			if (a != b)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Looks for a file in the mounted packs, newest first
+	bool findPacked(const std::string& fileName, std::shared_ptr<TTK::PackFile>& outPack, const TTK::PackEntry*& outEntry)
+	{
+		std::lock_guard<std::mutex> lock(mountMutex);
+
+		for (auto itr = mountedPacks.rbegin(); itr != mountedPacks.rend(); ++itr)
+		{
+			if (!startsWithPath(fileName, itr->mountPoint))
+				continue;
+
+			const TTK::PackEntry* entry = itr->pack->findEntry(fileName.substr(itr->mountPoint.length()));
+			if (entry)
+			{
+				outPack = itr->pack;
+				outEntry = entry;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
 
 std::string TTK::IO::loadFile(std::string fileName)
 {
+	// Files in a mounted pack never touch the disk
+	std::shared_ptr<PackFile> pack;
+	const PackEntry* entry;
+	if (findPacked(fileName, pack, entry))
+	{
+		FileView view;
+		if (openFile(fileName, view))
+			return std::string((const char*)view.data(), view.size());
+	}
+
 	// std::ios::in		- read
 	// std::ios::binary	- treat data as binary, not text
 	// std::ios::ate	- start stream at end of file (useful for getting length without seeking)
@@ -12,7 +94,7 @@ std::string TTK::IO::loadFile(std::string fileName)
 	if (!file.is_open())
 	{
 		std::cout << "File IO Error: Cannot open file: " << fileName << std::endl;
-		return nullptr;
+		return std::string();
 	}
 
 	size_t end;
@@ -38,3 +120,291 @@ std::string TTK::IO::loadFile(std::string fileName)
 	 return ret;
 }
 
+TTK::IO::MappedFile::MappedFile()
+{
+	bytes = nullptr;
+	numBytes = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+
+TTK::IO::MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool TTK::IO::MappedFile::open(const std::string& fileName)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	if (size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		bytes = emptyFile;
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	bytes = (const unsigned char*)view;
+	numBytes = (size_t)size.QuadPart;
+#else
+	int descriptor = ::open(fileName.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0)
+	{
+		::close(descriptor);
+		return false;
+	}
+
+	if (info.st_size == 0)
+	{
+		::close(descriptor);
+		bytes = emptyFile;
+		return true;
+	}
+
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+	// The mapping keeps the file open on its own
+	::close(descriptor);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	bytes = (const unsigned char*)view;
+	numBytes = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+void TTK::IO::MappedFile::close()
+{
+	if (bytes && bytes != emptyFile)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(bytes);
+		CloseHandle((HANDLE)mappingHandle);
+		CloseHandle((HANDLE)fileHandle);
+#else
+		munmap((void*)bytes, numBytes);
+#endif
+	}
+
+	bytes = nullptr;
+	numBytes = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+
+bool TTK::IO::mountPack(const std::string& packFileName, const std::string& mountPoint)
+{
+	std::shared_ptr<PackFile> pack = std::make_shared<PackFile>();
+	if (!pack->open(packFileName))
+		return false;
+
+	MountedPack mounted;
+	mounted.mountPoint = mountPoint;
+	mounted.pack = pack;
+
+	// Lookups strip the mount point, so it has to end at a directory
+	if (!mounted.mountPoint.empty() && mounted.mountPoint.back() != '/' && mounted.mountPoint.back() != '\\')
+		mounted.mountPoint += '/';
+
+	std::cout << "Mounted " << packFileName << " (" << pack->getNumEntries() << " files) at " << mounted.mountPoint << std::endl;
+
+	std::lock_guard<std::mutex> lock(mountMutex);
+	mountedPacks.push_back(mounted);
+	return true;
+}
+
+void TTK::IO::unmountAll()
+{
+	// Views still using a pack keep it mapped until they're gone
+	std::lock_guard<std::mutex> lock(mountMutex);
+	mountedPacks.clear();
+}
+
+bool TTK::IO::openPackedFile(const std::string& fileName, FileView& outView)
+{
+	outView.reset();
+
+	std::shared_ptr<PackFile> pack;
+	const PackEntry* entry;
+
+	if (!findPacked(fileName, pack, entry))
+		return false;
+
+	numPackedOpens++;
+
+	if (!(entry->flags & PACK_ENTRY_LZ4))
+	{
+		// Zero copy, the view keeps the pack (and its mapping) alive
+		outView.bytes = pack->getStoredData(*entry);
+		outView.numBytes = entry->size;
+		outView.zeroCopy = true;
+		outView.owner = pack;
+		return true;
+	}
+
+	std::shared_ptr<std::vector<unsigned char>> buffer = std::make_shared<std::vector<unsigned char>>();
+	if (!pack->readEntry(*entry, *buffer))
+	{
+		std::cout << "File IO Error: Packed file is damaged: " << fileName << std::endl;
+		return false;
+	}
+
+	outView.bytes = buffer->empty() ? emptyFile : buffer->data();
+	outView.numBytes = buffer->size();
+	outView.owner = buffer;
+	return true;
+}
+
+bool TTK::IO::openFile(const std::string& fileName, FileView& outView)
+{
+	// Falls back to the disk for damaged packed files too
+	if (openPackedFile(fileName, outView))
+		return true;
+
+	numDiskOpens++;
+
+	std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+
+	if (!file.is_open())
+	{
+		std::cout << "File IO Error: Cannot open file: " << fileName << std::endl;
+		return false;
+	}
+
+	std::shared_ptr<std::vector<unsigned char>> buffer = std::make_shared<std::vector<unsigned char>>((size_t)file.tellg());
+	file.seekg(0, std::ios::beg);
+	file.read((char*)buffer->data(), buffer->size());
+
+	outView.bytes = buffer->empty() ? emptyFile : buffer->data();
+	outView.numBytes = buffer->size();
+	outView.owner = buffer;
+	return true;
+}
+
+bool TTK::IO::fileExists(const std::string& fileName)
+{
+	std::shared_ptr<PackFile> pack;
+	const PackEntry* entry;
+	if (findPacked(fileName, pack, entry))
+		return true;
+
+	std::ifstream file(fileName);
+	return file.is_open();
+}
+
+bool TTK::IO::listFiles(const std::string& directory, std::vector<std::string>& outFiles)
+{
+	// Directories still to list, relative to the one asked for ("" is that one)
+	std::vector<std::string> pending(1, "");
+
+	std::string root = directory;
+	if (!root.empty() && root.back() != '/' && root.back() != '\\')
+		root += '/';
+
+	bool listedRoot = false;
+
+	while (!pending.empty())
+	{
+		std::string relative = pending.back();
+		pending.pop_back();
+
+		std::string path = root + relative;
+
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		HANDLE search = FindFirstFileA((path + "*").c_str(), &found);
+		if (search == INVALID_HANDLE_VALUE)
+		{
+			if (!listedRoot)
+				return false;
+			continue;
+		}
+
+		do
+		{
+			std::string name = found.cFileName;
+			if (name == "." || name == "..")
+				continue;
+
+			if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				pending.push_back(relative + name + "/");
+			else
+				outFiles.push_back(relative + name);
+		} while (FindNextFileA(search, &found));
+
+		FindClose(search);
+#else
+		DIR* dir = opendir(path.empty() ? "." : path.c_str());
+		if (!dir)
+		{
+			if (!listedRoot)
+				return false;
+			continue;
+		}
+
+		while (dirent* found = readdir(dir))
+		{
+			std::string name = found->d_name;
+			if (name == "." || name == "..")
+				continue;
+
+			struct stat info;
+			if (stat((path + name).c_str(), &info) != 0)
+				continue;
+
+			if (S_ISDIR(info.st_mode))
+				pending.push_back(relative + name + "/");
+			else
+				outFiles.push_back(relative + name);
+		}
+
+		closedir(dir);
+#endif
+
+		listedRoot = true;
+	}
+
+	return true;
+}
+
+unsigned int TTK::IO::getNumPackedOpens()
+{
+	return numPackedOpens;
+}
+
+unsigned int TTK::IO::getNumDiskOpens()
+{
+	return numDiskOpens;
+}
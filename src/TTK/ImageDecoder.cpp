@@ -0,0 +1,693 @@
+#include "TTK/ImageDecoder.h"
+#include "TTK/Inflate.h"
+#include <cstring> // for memcpy, memcmp and memset
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTK_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Bigger than this is more likely a damaged header than a texture
+#define MAX_IMAGE_DIMENSION 16384
+
+namespace
+{
+	const unsigned char PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+
+	enum PNGColourType
+	{
+		PNG_GREY = 0,
+		PNG_RGB = 2,
+		PNG_PALETTE = 3,
+		PNG_GREY_ALPHA = 4,
+		PNG_RGBA = 6
+	};
+
+	enum PNGFilter
+	{
+		PNG_FILTER_NONE,
+		PNG_FILTER_SUB,		// + the pixel to the left
+		PNG_FILTER_UP,		// + the pixel above
+		PNG_FILTER_AVERAGE,	// + the average of those two
+		PNG_FILTER_PAETH	// + whichever of left, above and above left is closest to left + above - above left
+	};
+
+	// Adam7 interlacing: where each of the 7 passes' pixels start, and the gaps between them
+	const unsigned int ADAM7_X_START[7] = { 0, 4, 0, 2, 0, 1, 0 };
+	const unsigned int ADAM7_Y_START[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	const unsigned int ADAM7_X_STEP[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	const unsigned int ADAM7_Y_STEP[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	struct PNGHeader
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int bitDepth;
+		unsigned int colourType;
+		bool interlaced;
+	};
+
+	// How a row's samples are turned into RGBA
+	struct PNGFormat
+	{
+		unsigned int bitDepth;
+		unsigned int colourType;
+
+		unsigned char palette[256][4];
+
+		// tRNS for images without alpha: pixels of this colour (at the file's bit depth) are transparent
+		bool hasKey;
+		unsigned int key[3];
+	};
+
+	inline unsigned int readBE16(const unsigned char* p)
+	{
+		return (p[0] << 8) | p[1];
+	}
+
+	inline unsigned int readBE32(const unsigned char* p)
+	{
+		return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+
+	inline bool isChunk(const unsigned char* type, const char* name)
+	{
+		return memcmp(type, name, 4) == 0;
+	}
+
+	unsigned int getNumChannels(unsigned int colourType)
+	{
+		switch (colourType)
+		{
+		case PNG_GREY:			return 1;
+		case PNG_RGB:			return 3;
+		case PNG_PALETTE:		return 1;
+		case PNG_GREY_ALPHA:	return 2;
+		case PNG_RGBA:			return 4;
+		default:				return 0;
+		}
+	}
+
+	bool readPNGHeader(const unsigned char* data, size_t size, PNGHeader& out)
+	{
+		// The signature, then IHDR has to be the first chunk
+		if (size < 8 + 8 + 13 || memcmp(data, PNG_SIGNATURE, 8) != 0 || readBE32(data + 8) != 13 || !isChunk(data + 12, "IHDR"))
+			return false;
+
+		const unsigned char* ihdr = data + 16;
+		out.width = readBE32(ihdr);
+		out.height = readBE32(ihdr + 4);
+		out.bitDepth = ihdr[8];
+		out.colourType = ihdr[9];
+		out.interlaced = ihdr[12] == 1;
+
+		unsigned int channels = getNumChannels(out.colourType);
+		unsigned int depth = out.bitDepth;
+
+		// Only some bit depths go with each colour type
+		bool validDepth = (depth == 8 || depth == 16) ||
+			(out.colourType == PNG_GREY && (depth == 1 || depth == 2 || depth == 4)) ||
+			(out.colourType == PNG_PALETTE && (depth == 1 || depth == 2 || depth == 4));
+
+		return channels != 0 && validDepth && !(out.colourType == PNG_PALETTE && depth == 16) &&
+			ihdr[10] == 0 && ihdr[11] == 0 && ihdr[12] <= 1 &&
+			out.width > 0 && out.height > 0 && out.width <= MAX_IMAGE_DIMENSION && out.height <= MAX_IMAGE_DIMENSION;
+	}
+
+	inline unsigned char paethPredictor(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = p > a ? p - a : a - p;
+		int pb = p > b ? p - b : b - p;
+		int pc = p > c ? p - c : c - p;
+
+		if (pa <= pb && pa <= pc)
+			return (unsigned char)a;
+		if (pb <= pc)
+			return (unsigned char)b;
+		return (unsigned char)c;
+	}
+
+#ifdef TTK_USE_SSE2
+	// The filters for 3 and 4 byte pixels (RGB and RGBA), one pixel at a time as each depends on the last
+	// (after libpng's filter_sse2_intrinsics.c)
+
+	inline __m128i load4(const unsigned char* p)
+	{
+		int value;
+		memcpy(&value, p, 4);
+		return _mm_cvtsi32_si128(value);
+	}
+
+	inline void store4(unsigned char* p, __m128i v)
+	{
+		int value = _mm_cvtsi128_si32(v);
+		memcpy(p, &value, 4);
+	}
+
+	inline __m128i load3(const unsigned char* p)
+	{
+		int value = 0;
+		memcpy(&value, p, 3);
+		return _mm_cvtsi32_si128(value);
+	}
+
+	inline void store3(unsigned char* p, __m128i v)
+	{
+		int value = _mm_cvtsi128_si32(v);
+		memcpy(p, &value, 3);
+	}
+
+	template <unsigned int BPP>
+	inline __m128i loadPixel(const unsigned char* p)
+	{
+		return BPP == 4 ? load4(p) : load3(p);
+	}
+
+	template <unsigned int BPP>
+	inline void storePixel(unsigned char* p, __m128i v)
+	{
+		if (BPP == 4)
+			store4(p, v);
+		else
+			store3(p, v);
+	}
+
+	template <unsigned int BPP>
+	void unfilterSubSSE2(unsigned char* row, size_t rowBytes)
+	{
+		__m128i a = _mm_setzero_si128();
+		for (size_t i = 0; i < rowBytes; i += BPP)
+		{
+			a = _mm_add_epi8(loadPixel<BPP>(row + i), a);
+			storePixel<BPP>(row + i, a);
+		}
+	}
+
+	template <unsigned int BPP>
+	void unfilterAverageSSE2(unsigned char* row, const unsigned char* prior, size_t rowBytes)
+	{
+		const __m128i ones = _mm_set1_epi8(1);
+		__m128i a = _mm_setzero_si128();
+
+		for (size_t i = 0; i < rowBytes; i += BPP)
+		{
+			__m128i b = loadPixel<BPP>(prior + i);
+
+			// _mm_avg_epu8 rounds up, the filter rounds down
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), ones));
+
+			a = _mm_add_epi8(loadPixel<BPP>(row + i), average);
+			storePixel<BPP>(row + i, a);
+		}
+	}
+
+	inline __m128i abs16(__m128i x)
+	{
+		return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+	}
+
+	inline __m128i select(__m128i condition, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(condition, a), _mm_andnot_si128(condition, b));
+	}
+
+	template <unsigned int BPP>
+	void unfilterPaethSSE2(unsigned char* row, const unsigned char* prior, size_t rowBytes)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		// In 16 bits, so p - a etc. don't wrap
+		__m128i a = zero, b = zero, c = zero;
+
+		for (size_t i = 0; i < rowBytes; i += BPP)
+		{
+			c = b;
+			b = _mm_unpacklo_epi8(loadPixel<BPP>(prior + i), zero);
+			__m128i d = _mm_unpacklo_epi8(loadPixel<BPP>(row + i), zero);
+
+			// p - a = b - c, p - b = a - c, p - c = (b - c) + (a - c)
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a, c);
+			__m128i pc = _mm_add_epi16(pa, pb);
+
+			pa = abs16(pa);
+			pb = abs16(pb);
+			pc = abs16(pc);
+
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+			// Ties go to a, then b
+			__m128i nearest = select(_mm_cmpeq_epi16(smallest, pc), c, zero);
+			nearest = select(_mm_cmpeq_epi16(smallest, pb), b, nearest);
+			nearest = select(_mm_cmpeq_epi16(smallest, pa), a, nearest);
+
+			// Wraps within each byte, so the high bytes stay 0 and the pack doesn't saturate
+			d = _mm_add_epi8(d, nearest);
+			storePixel<BPP>(row + i, _mm_packus_epi16(d, d));
+			a = d;
+		}
+	}
+#endif
+
+	// Undoes a row's filter in place, prior is the row above (already unfiltered) or zeros
+	bool unfilterRow(unsigned int filter, unsigned char* row, const unsigned char* prior, size_t rowBytes, unsigned int bpp)
+	{
+		switch (filter)
+		{
+		case PNG_FILTER_NONE:
+			return true;
+
+		case PNG_FILTER_SUB:
+#ifdef TTK_USE_SSE2
+			if (bpp == 4)
+			{
+				unfilterSubSSE2<4>(row, rowBytes);
+				return true;
+			}
+			if (bpp == 3)
+			{
+				unfilterSubSSE2<3>(row, rowBytes);
+				return true;
+			}
+#endif
+			for (size_t i = bpp; i < rowBytes; i++)
+				row[i] = (unsigned char)(row[i] + row[i - bpp]);
+			return true;
+
+		case PNG_FILTER_UP:
+		{
+			size_t i = 0;
+#ifdef TTK_USE_SSE2
+			// Nothing depends on the rest of the row, so 16 bytes at a time
+			for (; i + 16 <= rowBytes; i += 16)
+			{
+				__m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(row + i)), _mm_loadu_si128((const __m128i*)(prior + i)));
+				_mm_storeu_si128((__m128i*)(row + i), sum);
+			}
+#endif
+			for (; i < rowBytes; i++)
+				row[i] = (unsigned char)(row[i] + prior[i]);
+			return true;
+		}
+
+		case PNG_FILTER_AVERAGE:
+#ifdef TTK_USE_SSE2
+			if (bpp == 4)
+			{
+				unfilterAverageSSE2<4>(row, prior, rowBytes);
+				return true;
+			}
+			if (bpp == 3)
+			{
+				unfilterAverageSSE2<3>(row, prior, rowBytes);
+				return true;
+			}
+#endif
+			for (size_t i = 0; i < bpp && i < rowBytes; i++)
+				row[i] = (unsigned char)(row[i] + prior[i] / 2);
+			for (size_t i = bpp; i < rowBytes; i++)
+				row[i] = (unsigned char)(row[i] + (row[i - bpp] + prior[i]) / 2);
+			return true;
+
+		case PNG_FILTER_PAETH:
+#ifdef TTK_USE_SSE2
+			if (bpp == 4)
+			{
+				unfilterPaethSSE2<4>(row, prior, rowBytes);
+				return true;
+			}
+			if (bpp == 3)
+			{
+				unfilterPaethSSE2<3>(row, prior, rowBytes);
+				return true;
+			}
+#endif
+			// Left of the first pixel counts as 0, so Paeth picks the pixel above
+			for (size_t i = 0; i < bpp && i < rowBytes; i++)
+				row[i] = (unsigned char)(row[i] + prior[i]);
+			for (size_t i = bpp; i < rowBytes; i++)
+				row[i] = (unsigned char)(row[i] + paethPredictor(row[i - bpp], prior[i], prior[i - bpp]));
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	// A sample from a row packed at 1, 2 or 4 bits, the first sample in the highest bits
+	inline unsigned int readPacked(const unsigned char* src, unsigned int index, unsigned int bitDepth)
+	{
+		unsigned int bit = index * bitDepth;
+		return (src[bit >> 3] >> (8 - bitDepth - (bit & 7))) & ((1 << bitDepth) - 1);
+	}
+
+	// Converts count pixels of an unfiltered row to RGBA8
+	void convertRow(const unsigned char* src, unsigned int count, unsigned char* dst, const PNGFormat& format)
+	{
+		unsigned int depth = format.bitDepth;
+
+		switch (format.colourType)
+		{
+		case PNG_RGBA:
+			if (depth == 8)
+			{
+				memcpy(dst, src, count * 4);
+			}
+			else
+			{
+				// 16 bits are big endian, the high byte comes first
+				for (unsigned int i = 0; i < count * 4; i++)
+					dst[i] = src[i * 2];
+			}
+			break;
+
+		case PNG_RGB:
+			for (unsigned int i = 0; i < count; i++)
+			{
+				const unsigned char* p = src + i * 3 * (depth / 8);
+				unsigned char* out = dst + i * 4;
+
+				if (depth == 8)
+				{
+					out[0] = p[0];
+					out[1] = p[1];
+					out[2] = p[2];
+					out[3] = format.hasKey && p[0] == format.key[0] && p[1] == format.key[1] && p[2] == format.key[2] ? 0 : 255;
+				}
+				else
+				{
+					out[0] = p[0];
+					out[1] = p[2];
+					out[2] = p[4];
+					out[3] = format.hasKey && readBE16(p) == format.key[0] && readBE16(p + 2) == format.key[1] &&
+						readBE16(p + 4) == format.key[2] ? 0 : 255;
+				}
+			}
+			break;
+
+		case PNG_GREY_ALPHA:
+			for (unsigned int i = 0; i < count; i++)
+			{
+				const unsigned char* p = src + i * 2 * (depth / 8);
+				unsigned char* out = dst + i * 4;
+				out[0] = out[1] = out[2] = p[0];
+				out[3] = depth == 8 ? p[1] : p[2];
+			}
+			break;
+
+		case PNG_GREY:
+			for (unsigned int i = 0; i < count; i++)
+			{
+				unsigned int value;
+				unsigned char grey;
+
+				if (depth == 16)
+				{
+					value = readBE16(src + i * 2);
+					grey = src[i * 2];
+				}
+				else if (depth == 8)
+				{
+					value = src[i];
+					grey = src[i];
+				}
+				else
+				{
+					// Scaled up so the brightest value is 255
+					value = readPacked(src, i, depth);
+					grey = (unsigned char)(value * (255 / ((1 << depth) - 1)));
+				}
+
+				unsigned char* out = dst + i * 4;
+				out[0] = out[1] = out[2] = grey;
+				out[3] = format.hasKey && value == format.key[0] ? 0 : 255;
+			}
+			break;
+
+		case PNG_PALETTE:
+			for (unsigned int i = 0; i < count; i++)
+			{
+				unsigned int index = depth == 8 ? src[i] : readPacked(src, i, depth);
+				memcpy(dst + i * 4, format.palette[index], 4);
+			}
+			break;
+		}
+	}
+}
+
+TTK::ImageDecoder::ImageDecoder()
+{
+	error = "";
+}
+
+bool TTK::ImageDecoder::fail(const char* message)
+{
+	error = message;
+	return false;
+}
+
+TTK::ImageFileType TTK::ImageDecoder::getFileType(const unsigned char* data, size_t size)
+{
+	if (size >= 8 && memcmp(data, PNG_SIGNATURE, 8) == 0)
+		return IMAGE_FILE_PNG;
+
+	// Every JPEG starts with a start of image marker, then another marker
+	if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+		return IMAGE_FILE_JPEG;
+
+	return IMAGE_FILE_UNKNOWN;
+}
+
+bool TTK::ImageDecoder::readInfo(const unsigned char* data, size_t size, ImageInfo& outInfo)
+{
+	switch (getFileType(data, size))
+	{
+	case IMAGE_FILE_PNG:	return readPNGInfo(data, size, outInfo);
+	case IMAGE_FILE_JPEG:	return readJPEGInfo(data, size, outInfo);
+	default:				return false;
+	}
+}
+
+bool TTK::ImageDecoder::decode(const unsigned char* data, size_t size, unsigned char* pixels, bool bottomRowFirst)
+{
+	error = "";
+
+	switch (getFileType(data, size))
+	{
+	case IMAGE_FILE_PNG:	return decodePNG(data, size, pixels, bottomRowFirst);
+	case IMAGE_FILE_JPEG:	return decodeJPEG(data, size, pixels, bottomRowFirst);
+	default:				return fail("not a PNG or JPEG");
+	}
+}
+
+bool TTK::ImageDecoder::decode(const unsigned char* data, size_t size, std::vector<unsigned char>& pixels,
+	unsigned int& outWidth, unsigned int& outHeight, bool bottomRowFirst)
+{
+	ImageInfo info;
+	if (!readInfo(data, size, info))
+		return fail("not a PNG or JPEG, or its header is damaged");
+
+	pixels.resize((size_t)info.width * info.height * 4);
+	if (!decode(data, size, &pixels[0], bottomRowFirst))
+		return false;
+
+	outWidth = info.width;
+	outHeight = info.height;
+	return true;
+}
+
+bool TTK::ImageDecoder::readPNGInfo(const unsigned char* data, size_t size, ImageInfo& outInfo)
+{
+	PNGHeader header;
+	if (!readPNGHeader(data, size, header))
+		return false;
+
+	outInfo.type = IMAGE_FILE_PNG;
+	outInfo.width = header.width;
+	outInfo.height = header.height;
+	return true;
+}
+
+bool TTK::ImageDecoder::decodePNG(const unsigned char* data, size_t size, unsigned char* pixels, bool bottomRowFirst)
+{
+	PNGHeader header;
+	if (!readPNGHeader(data, size, header))
+		return fail("PNG header is damaged");
+
+	PNGFormat format;
+	format.bitDepth = header.bitDepth;
+	format.colourType = header.colourType;
+	format.hasKey = false;
+
+	// Indices past the end of the palette come out opaque black
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		format.palette[i][0] = format.palette[i][1] = format.palette[i][2] = 0;
+		format.palette[i][3] = 255;
+	}
+
+	// Usually there's one IDAT chunk, which is inflated straight from the file. If there are
+	// more they're joined first.
+	const unsigned char* idat = nullptr;
+	size_t idatSize = 0;
+	unsigned int numIDAT = 0;
+	unsigned int numPaletteEntries = 0;
+
+	size_t pos = 8;
+	while (pos + 12 <= size)
+	{
+		size_t length = readBE32(data + pos);
+		const unsigned char* type = data + pos + 4;
+		const unsigned char* body = data + pos + 8;
+
+		if (length > size - pos - 12)
+			return fail("PNG chunk runs past the end of the file");
+
+		if (isChunk(type, "PLTE"))
+		{
+			if (length % 3 != 0 || length / 3 > 256)
+				return fail("PNG palette is damaged");
+
+			numPaletteEntries = (unsigned int)(length / 3);
+			for (unsigned int i = 0; i < numPaletteEntries; i++)
+				memcpy(format.palette[i], body + i * 3, 3);
+		}
+		else if (isChunk(type, "tRNS"))
+		{
+			if (header.colourType == PNG_PALETTE)
+			{
+				for (unsigned int i = 0; i < length && i < 256; i++)
+					format.palette[i][3] = body[i];
+			}
+			else if (header.colourType == PNG_GREY && length >= 2)
+			{
+				format.hasKey = true;
+				format.key[0] = readBE16(body);
+			}
+			else if (header.colourType == PNG_RGB && length >= 6)
+			{
+				format.hasKey = true;
+				format.key[0] = readBE16(body);
+				format.key[1] = readBE16(body + 2);
+				format.key[2] = readBE16(body + 4);
+			}
+		}
+		else if (isChunk(type, "IDAT"))
+		{
+			if (numIDAT == 1)
+				compressed.assign(idat, idat + idatSize);
+			if (numIDAT >= 1)
+				compressed.insert(compressed.end(), body, body + length);
+
+			idat = body;
+			idatSize = length;
+			numIDAT++;
+		}
+		else if (isChunk(type, "IEND"))
+		{
+			break;
+		}
+		else if (!isChunk(type, "IHDR") && !(type[0] & 32))
+		{
+			// Chunks starting with a lower case letter can be skipped, the rest are needed to decode the image
+			return fail("PNG has a chunk this decoder doesn't know");
+		}
+
+		pos += 12 + length;
+	}
+
+	if (numIDAT == 0)
+		return fail("PNG has no image data");
+
+	if (header.colourType == PNG_PALETTE && numPaletteEntries == 0)
+		return fail("PNG has no palette");
+
+	if (numIDAT > 1)
+	{
+		idat = compressed.data();
+		idatSize = compressed.size();
+	}
+
+	unsigned int bitsPerPixel = getNumChannels(header.colourType) * header.bitDepth;
+	unsigned int bpp = bitsPerPixel >= 8 ? bitsPerPixel / 8 : 1;	// filters work on whole bytes
+
+	// Each pass is its own smaller image, each row starts with its filter
+	unsigned int numPasses = header.interlaced ? 7 : 1;
+	unsigned int passWidth[7], passHeight[7];
+	size_t passRowBytes[7];
+	size_t totalSize = 0;
+	size_t maxRowBytes = 0;
+
+	for (unsigned int pass = 0; pass < numPasses; pass++)
+	{
+		unsigned int xStart = header.interlaced ? ADAM7_X_START[pass] : 0;
+		unsigned int yStart = header.interlaced ? ADAM7_Y_START[pass] : 0;
+		unsigned int xStep = header.interlaced ? ADAM7_X_STEP[pass] : 1;
+		unsigned int yStep = header.interlaced ? ADAM7_Y_STEP[pass] : 1;
+
+		passWidth[pass] = header.width > xStart ? (header.width - xStart + xStep - 1) / xStep : 0;
+		passHeight[pass] = header.height > yStart ? (header.height - yStart + yStep - 1) / yStep : 0;
+		passRowBytes[pass] = ((size_t)passWidth[pass] * bitsPerPixel + 7) / 8;
+		maxRowBytes = std::max(maxRowBytes, passRowBytes[pass]);
+
+		// Empty passes have no rows at all, not even filter bytes
+		if (passWidth[pass] > 0 && passHeight[pass] > 0)
+			totalSize += passHeight[pass] * (passRowBytes[pass] + 1);
+	}
+
+	filtered.resize(totalSize);
+	if (!Inflate::decompressZlib(idat, idatSize, filtered.data(), totalSize))
+		return fail("PNG image data is damaged");
+
+	// Zeros above the first row, then reused for converting interlaced rows
+	row.resize(std::max(maxRowBytes, (size_t)header.width * 4));
+
+	unsigned char* passRows = filtered.data();
+	for (unsigned int pass = 0; pass < numPasses; pass++)
+	{
+		if (passWidth[pass] == 0 || passHeight[pass] == 0)
+			continue;
+
+		size_t rowBytes = passRowBytes[pass];
+		size_t stride = rowBytes + 1;
+
+		memset(row.data(), 0, rowBytes);
+		for (unsigned int y = 0; y < passHeight[pass]; y++)
+		{
+			unsigned char* current = passRows + y * stride;
+			const unsigned char* prior = y > 0 ? current - stride + 1 : row.data();
+
+			if (!unfilterRow(current[0], current + 1, prior, rowBytes, bpp))
+				return fail("PNG row has an unknown filter");
+		}
+
+		for (unsigned int y = 0; y < passHeight[pass]; y++)
+		{
+			const unsigned char* src = passRows + y * stride + 1;
+
+			if (!header.interlaced)
+			{
+				unsigned int dstY = bottomRowFirst ? header.height - 1 - y : y;
+				convertRow(src, header.width, pixels + (size_t)dstY * header.width * 4, format);
+				continue;
+			}
+
+			// Spread the pass's pixels out to where they go in the image
+			convertRow(src, passWidth[pass], row.data(), format);
+
+			unsigned int imageY = ADAM7_Y_START[pass] + y * ADAM7_Y_STEP[pass];
+			unsigned int dstY = bottomRowFirst ? header.height - 1 - imageY : imageY;
+			unsigned char* dst = pixels + (size_t)dstY * header.width * 4;
+
+			for (unsigned int x = 0; x < passWidth[pass]; x++)
+				memcpy(dst + (ADAM7_X_START[pass] + x * ADAM7_X_STEP[pass]) * 4, row.data() + x * 4, 4);
+		}
+
+		passRows += passHeight[pass] * stride;
+	}
+
+	return true;
+}
@@ -0,0 +1,431 @@
+#include "TTK/Inflate.h"
+#include <cstring> // for memcpy and memset
+#include <cstdint>
+
+namespace
+{
+	// Codes this long or shorter are decoded with one lookup
+	const unsigned int FAST_BITS = 10;
+	const unsigned int FAST_MASK = (1 << FAST_BITS) - 1;
+
+	const unsigned int MAX_CODE_LENGTH = 15;
+
+	const unsigned int NUM_LITERAL_CODES = 288;
+	const unsigned int NUM_DISTANCE_CODES = 32;
+	const unsigned int END_OF_BLOCK = 256;
+
+	// Base values and extra bits for length codes 257 to 285 and the distance codes
+	const unsigned short LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+	const unsigned short DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// The order code length code lengths are stored in
+	const unsigned char CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	inline unsigned int reverseBits(unsigned int code, unsigned int numBits)
+	{
+		unsigned int reversed = 0;
+		for (unsigned int i = 0; i < numBits; i++)
+		{
+			reversed = (reversed << 1) | (code & 1);
+			code >>= 1;
+		}
+		return reversed;
+	}
+
+	// A canonical Huffman code
+	// DEFLATE stores codes starting from their last bit, so the table is indexed by the next
+	// FAST_BITS bits of input as they come. Longer codes are found by comparing the bits (in
+	// code order) against the last code of each length.
+	struct Huffman
+	{
+		unsigned short fast[1 << FAST_BITS];	// (length << 9) | symbol, 0 if the code is longer than FAST_BITS
+		unsigned int maxCode[MAX_CODE_LENGTH + 2];	// one past the last code of each length, shifted to 16 bits
+		unsigned short firstCode[MAX_CODE_LENGTH + 1];
+		unsigned short firstSymbol[MAX_CODE_LENGTH + 1];	// index into symbols of the first code of each length
+		unsigned short symbols[NUM_LITERAL_CODES];	// sorted by code
+
+		// Returns false if the lengths don't make a valid code
+		bool build(const unsigned char* lengths, unsigned int numSymbols)
+		{
+			unsigned int counts[MAX_CODE_LENGTH + 1] = {};
+			for (unsigned int i = 0; i < numSymbols; i++)
+				counts[lengths[i]]++;
+			counts[0] = 0;
+
+			memset(fast, 0, sizeof(fast));
+
+			unsigned int nextCode[MAX_CODE_LENGTH + 1];
+			unsigned int code = 0;
+			unsigned int symbol = 0;
+
+			for (unsigned int length = 1; length <= MAX_CODE_LENGTH; length++)
+			{
+				nextCode[length] = code;
+				firstCode[length] = (unsigned short)code;
+				firstSymbol[length] = (unsigned short)symbol;
+
+				code += counts[length];
+				symbol += counts[length];
+
+				// More codes of this length than there's room for
+				if (counts[length] && code > (1u << length))
+					return false;
+
+				maxCode[length] = code << (16 - length);
+				code <<= 1;
+			}
+
+			// Anything left over is longer than any code
+			maxCode[MAX_CODE_LENGTH + 1] = 0x10000;
+
+			for (unsigned int i = 0; i < numSymbols; i++)
+			{
+				unsigned int length = lengths[i];
+				if (length == 0)
+					continue;
+
+				symbols[firstSymbol[length] + nextCode[length] - firstCode[length]] = (unsigned short)i;
+
+				if (length <= FAST_BITS)
+				{
+					for (unsigned int j = reverseBits(nextCode[length], length); j < (1u << FAST_BITS); j += 1 << length)
+						fast[j] = (unsigned short)((length << 9) | i);
+				}
+
+				nextCode[length]++;
+			}
+
+			return true;
+		}
+	};
+
+	// Reads the input a bit at a time, starting from the lowest bit of each byte
+	class Decoder
+	{
+	public:
+		Decoder(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+			: in(input), inEnd(input + inputSize), out(output), outStart(output), outEnd(output + outputSize),
+			bits(0), numBits(0), numPaddingBytes(0)
+		{}
+
+		bool run()
+		{
+			bool lastBlock;
+			do
+			{
+				lastBlock = readBits(1) != 0;
+				unsigned int type = readBits(2);
+
+				bool blockOK;
+				if (type == 0)
+					blockOK = storedBlock();
+				else if (type == 1)
+					blockOK = fixedBlock();
+				else if (type == 2)
+					blockOK = dynamicBlock();
+				else
+					blockOK = false;
+
+				if (!blockOK || overran())
+					return false;
+			} while (!lastBlock);
+
+			return out == outEnd;
+		}
+
+	private:
+		// Tops up the bit buffer to at least 56 bits
+		// Past the end of the input it's padded with zeros, which decode to garbage, so
+		// overran() says whether any were used
+		inline void refill()
+		{
+			if (inEnd - in >= 8)
+			{
+				uint64_t next;
+				memcpy(&next, in, sizeof(next));
+				bits |= next << numBits;
+				in += (63 - numBits) >> 3;
+				numBits |= 56;
+				return;
+			}
+
+			while (numBits <= 56)
+			{
+				if (in < inEnd)
+					bits |= (uint64_t)*in++ << numBits;
+				else
+					numPaddingBytes++;
+				numBits += 8;
+			}
+		}
+
+		// The padding is at the top of the bit buffer, so it's been used once fewer bits are left than it has
+		bool overran() const
+		{
+			return numPaddingBytes * 8 > numBits;
+		}
+
+		inline unsigned int readBits(unsigned int count)
+		{
+			if (numBits < count)
+				refill();
+
+			unsigned int value = (unsigned int)(bits & ((1ull << count) - 1));
+			bits >>= count;
+			numBits -= count;
+			return value;
+		}
+
+		// Returns the symbol, or -1 if the bits aren't a code
+		inline int decodeSymbol(const Huffman& huffman)
+		{
+			if (numBits < 16)
+				refill();
+
+			unsigned int entry = huffman.fast[bits & FAST_MASK];
+			if (entry)
+			{
+				unsigned int length = entry >> 9;
+				bits >>= length;
+				numBits -= length;
+				return entry & 511;
+			}
+
+			// Put the next 16 bits in code order to compare them against each length's codes
+			unsigned int code = reverseBits((unsigned int)(bits & 0xffff), 16);
+
+			unsigned int length = FAST_BITS + 1;
+			while (code >= huffman.maxCode[length])
+				length++;
+
+			if (length > MAX_CODE_LENGTH)
+				return -1;
+
+			unsigned int index = (code >> (16 - length)) - huffman.firstCode[length] + huffman.firstSymbol[length];
+			bits >>= length;
+			numBits -= length;
+			return huffman.symbols[index];
+		}
+
+		bool storedBlock()
+		{
+			// Stored blocks start on a byte, the bits left in this one are skipped
+			readBits(numBits & 7);
+
+			unsigned int length = readBits(16);
+			unsigned int inverse = readBits(16);
+			if ((length ^ 0xffff) != inverse)
+				return false;
+
+			// Whole bytes still in the bit buffer come first
+			while (length > 0 && numBits >= 8)
+			{
+				if (out >= outEnd)
+					return false;
+				*out++ = (unsigned char)readBits(8);
+				length--;
+			}
+
+			if (length == 0)
+				return true;
+
+			// Then the rest straight from the input. The bit buffer is empty now, but may still have
+			// bits read ahead from where the input was, which would be wrong once it moves on.
+			bits = 0;
+
+			if (overran() || (size_t)(inEnd - in) < length || (size_t)(outEnd - out) < length)
+				return false;
+
+			memcpy(out, in, length);
+			in += length;
+			out += length;
+			return true;
+		}
+
+		bool fixedBlock()
+		{
+			unsigned char lengths[NUM_LITERAL_CODES + NUM_DISTANCE_CODES];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 256 - 144);
+			memset(lengths + 256, 7, 280 - 256);
+			memset(lengths + 280, 8, NUM_LITERAL_CODES - 280);
+			memset(lengths + NUM_LITERAL_CODES, 5, NUM_DISTANCE_CODES);
+
+			if (!literals.build(lengths, NUM_LITERAL_CODES) || !distances.build(lengths + NUM_LITERAL_CODES, NUM_DISTANCE_CODES))
+				return false;
+
+			return codedBlock();
+		}
+
+		bool dynamicBlock()
+		{
+			unsigned int numLiteralCodes = readBits(5) + 257;
+			unsigned int numDistanceCodes = readBits(5) + 1;
+			unsigned int numLengthCodes = readBits(4) + 4;
+
+			// The code lengths are themselves Huffman coded
+			unsigned char lengthCodeLengths[19] = {};
+			for (unsigned int i = 0; i < numLengthCodes; i++)
+				lengthCodeLengths[CODE_LENGTH_ORDER[i]] = (unsigned char)readBits(3);
+
+			Huffman lengthCodes;
+			if (!lengthCodes.build(lengthCodeLengths, 19))
+				return false;
+
+			unsigned char lengths[NUM_LITERAL_CODES + NUM_DISTANCE_CODES];
+			unsigned int total = numLiteralCodes + numDistanceCodes;
+			unsigned int count = 0;
+
+			while (count < total)
+			{
+				int symbol = decodeSymbol(lengthCodes);
+				if (symbol < 0)
+					return false;
+
+				if (symbol < 16)
+				{
+					lengths[count++] = (unsigned char)symbol;
+					continue;
+				}
+
+				// 16 repeats the last length, 17 and 18 are runs of zeros
+				unsigned char value = 0;
+				unsigned int repeat;
+				if (symbol == 16)
+				{
+					if (count == 0)
+						return false;
+					value = lengths[count - 1];
+					repeat = readBits(2) + 3;
+				}
+				else if (symbol == 17)
+					repeat = readBits(3) + 3;
+				else
+					repeat = readBits(7) + 11;
+
+				if (count + repeat > total)
+					return false;
+
+				memset(lengths + count, value, repeat);
+				count += repeat;
+			}
+
+			// Every block has to be able to end
+			if (lengths[END_OF_BLOCK] == 0)
+				return false;
+
+			if (!literals.build(lengths, numLiteralCodes) || !distances.build(lengths + numLiteralCodes, numDistanceCodes))
+				return false;
+
+			return codedBlock();
+		}
+
+		bool codedBlock()
+		{
+			while (true)
+			{
+				int symbol = decodeSymbol(literals);
+
+				if (symbol < 256)
+				{
+					if (symbol < 0 || out >= outEnd)
+						return false;
+					*out++ = (unsigned char)symbol;
+					continue;
+				}
+
+				if (symbol == END_OF_BLOCK)
+					return true;
+
+				symbol -= 257;
+				if (symbol >= 29)
+					return false;
+
+				size_t length = LENGTH_BASE[symbol] + readBits(LENGTH_EXTRA[symbol]);
+
+				int distanceSymbol = decodeSymbol(distances);
+				if (distanceSymbol < 0 || distanceSymbol >= 30)
+					return false;
+
+				size_t distance = DISTANCE_BASE[distanceSymbol] + readBits(DISTANCE_EXTRA[distanceSymbol]);
+
+				if (distance > (size_t)(out - outStart) || length > (size_t)(outEnd - out))
+					return false;
+
+				copyMatch(distance, length);
+
+				if (overran())
+					return false;
+			}
+		}
+
+		inline void copyMatch(size_t distance, size_t length)
+		{
+			const unsigned char* from = out - distance;
+
+			if (distance == 1)
+			{
+				memset(out, *from, length);
+			}
+			else if (distance >= 8 && (size_t)(outEnd - out) >= length + 8)
+			{
+				// 8 bytes at a time, the source never overlaps what's being written, and the
+				// last copy can run a little past the match as there's room for it
+				unsigned char* end = out + length;
+				unsigned char* to = out;
+				do
+				{
+					memcpy(to, from, 8);
+					to += 8;
+					from += 8;
+				} while (to < end);
+			}
+			else
+			{
+				for (size_t i = 0; i < length; i++)
+					out[i] = from[i];
+			}
+
+			out += length;
+		}
+
+		const unsigned char* in;
+		const unsigned char* inEnd;
+		unsigned char* out;
+		unsigned char* outStart;
+		unsigned char* outEnd;
+
+		uint64_t bits;
+		unsigned int numBits;
+		unsigned int numPaddingBytes;
+
+		Huffman literals;
+		Huffman distances;
+	};
+}
+
+bool TTK::Inflate::decompress(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+{
+	Decoder decoder(input, inputSize, output, outputSize);
+	return decoder.run();
+}
+
+bool TTK::Inflate::decompressZlib(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+{
+	if (inputSize < 2)
+		return false;
+
+	unsigned int method = input[0] & 15;
+	unsigned int header = (input[0] << 8) | input[1];
+
+	// DEFLATE, a header that checks out, and no preset dictionary
+	if (method != 8 || header % 31 != 0 || (input[1] & 32))
+		return false;
+
+	return decompress(input + 2, inputSize - 2, output, outputSize);
+}
@@ -0,0 +1,991 @@
+// The JPEG half of TTK::ImageDecoder (see ImageDecoder.cpp for the rest)
+//
+// Baseline JPEG (https://www.w3.org/Graphics/JPEG/itu-t81.pdf): the image is split into 8x8
+// blocks of each component (Y, Cb and Cr), each stored as Huffman coded DCT coefficients.
+// Decoding goes one row of MCUs (the blocks covering a strip of the image) at a time:
+//	1. Huffman decode each block's coefficients
+//	2. inverse DCT them into the component's samples
+//	3. upsample the chroma and convert YCbCr to RGBA, a row of pixels at a time
+// The IDCT and colour conversion give the same results as libjpeg's defaults (the "islow"
+// IDCT and its YCbCr tables), with chroma upsampled by repeating samples.
+
+#include "TTK/ImageDecoder.h"
+#include <cstring> // for memcpy and memset
+#include <cstdint>
+#include <algorithm>
+#include <memory> // for unique_ptr
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTK_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define MAX_IMAGE_DIMENSION 16384
+
+namespace
+{
+	// Markers, each is 0xFF then one of these
+	enum JPEGMarker
+	{
+		JPEG_SOF0 = 0xC0,	// start of frame, baseline
+		JPEG_SOF1 = 0xC1,	// start of frame, extended sequential (decodes the same at 8 bits)
+		JPEG_SOF2 = 0xC2,	// start of frame, progressive
+		JPEG_DHT = 0xC4,	// Huffman tables
+		JPEG_RST0 = 0xD0,	// restart markers 0 to 7
+		JPEG_RST7 = 0xD7,
+		JPEG_SOI = 0xD8,	// start of image
+		JPEG_EOI = 0xD9,	// end of image
+		JPEG_SOS = 0xDA,	// start of scan
+		JPEG_DQT = 0xDB,	// quantization tables
+		JPEG_DRI = 0xDD,	// restart interval
+		JPEG_APP14 = 0xEE	// Adobe's, says whether 3 components are RGB or YCbCr
+	};
+
+	// Where each coefficient in the file's (zig zag) order goes in the block
+	const unsigned char ZIGZAG[64 + 16] =
+	{
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+		// Runs past the end of a block land here, so they don't need checking per coefficient
+		63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+	};
+
+	const unsigned int FAST_BITS = 9;
+
+	struct JPEGHuffman
+	{
+		unsigned short fast[1 << FAST_BITS];	// (length << 8) | symbol, 0 if the code is longer than FAST_BITS
+		unsigned int maxCode[18];		// one past the last code of each length, shifted to 16 bits
+		int delta[17];					// code of a given length - delta = index into symbols
+		unsigned char symbols[256];
+		bool defined;
+
+		// counts: codes of each length 1 to 16
+		bool build(const unsigned char* counts, const unsigned char* values)
+		{
+			unsigned int numSymbols = 0;
+			for (unsigned int i = 0; i < 16; i++)
+				numSymbols += counts[i];
+
+			if (numSymbols > 256)
+				return false;
+
+			memcpy(symbols, values, numSymbols);
+			memset(fast, 0, sizeof(fast));
+
+			unsigned int code = 0;
+			unsigned int index = 0;
+
+			for (unsigned int length = 1; length <= 16; length++)
+			{
+				delta[length] = (int)code - (int)index;
+
+				// More codes than fit in this many bits
+				if (code + counts[length - 1] > (1u << length))
+					return false;
+
+				for (unsigned int i = 0; i < counts[length - 1]; i++, code++, index++)
+				{
+					// JPEG codes are read from the top bit down, so a short code fills a run of the table
+					if (length <= FAST_BITS)
+					{
+						unsigned int first = code << (FAST_BITS - length);
+						for (unsigned int j = 0; j < (1u << (FAST_BITS - length)); j++)
+							fast[first + j] = (unsigned short)((length << 8) | symbols[index]);
+					}
+				}
+
+				maxCode[length] = code << (16 - length);
+				code <<= 1;
+			}
+
+			maxCode[17] = 0xFFFFFFFF;
+			defined = true;
+			return true;
+		}
+	};
+
+	struct JPEGComponent
+	{
+		unsigned int id;
+		unsigned int h, v;			// sampling factors
+		unsigned int quantTable;
+		unsigned int dcTable, acTable;
+		int dcPrediction;
+
+		// This component's part of the current row of MCUs
+		unsigned char* plane;
+		unsigned int stride;
+	};
+
+	// The state of one decode, the ImageDecoder only keeps the memory
+	struct JPEGState
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t pos;
+
+		unsigned short quant[4][64];	// in natural order
+		JPEGHuffman dc[4], ac[4];
+
+		unsigned int width, height;
+		unsigned int numComponents;
+		JPEGComponent components[3];
+		unsigned int hMax, vMax;
+		bool progressive;
+		bool transformRGB;		// 3 components are YCbCr unless an Adobe marker says otherwise
+		unsigned int restartInterval;
+
+		// Entropy coded data is read from the top bit down. The next bit is bit 63.
+		uint64_t bits;
+		int numBits;
+		bool hitMarker;	// stopped at a marker, what's read from here on is zeros
+	};
+
+	inline unsigned int readBE16(const unsigned char* p)
+	{
+		return (p[0] << 8) | p[1];
+	}
+
+	// Tops up the bits to at least 57, undoing byte stuffing (0xFF 0x00 is a 0xFF byte)
+	inline void fillBits(JPEGState& s)
+	{
+		while (s.numBits <= 56)
+		{
+			unsigned int byte = 0;
+
+			if (!s.hitMarker)
+			{
+				if (s.pos >= s.size)
+				{
+					s.hitMarker = true;
+				}
+				else
+				{
+					byte = s.data[s.pos];
+
+					if (byte != 0xFF)
+						s.pos++;
+					else if (s.pos + 1 < s.size && s.data[s.pos + 1] == 0)
+						s.pos += 2;
+					else
+					{
+						// A real marker (ie. a restart), left for whoever reads markers
+						s.hitMarker = true;
+						byte = 0;
+					}
+				}
+			}
+
+			s.bits |= (uint64_t)byte << (56 - s.numBits);
+			s.numBits += 8;
+		}
+	}
+
+	// Returns the symbol, or -1 if the bits aren't a code
+	inline int decodeHuffman(JPEGState& s, const JPEGHuffman& huffman)
+	{
+		if (s.numBits < 16)
+			fillBits(s);
+
+		unsigned int entry = huffman.fast[s.bits >> (64 - FAST_BITS)];
+		if (entry)
+		{
+			unsigned int length = entry >> 8;
+			s.bits <<= length;
+			s.numBits -= length;
+			return entry & 255;
+		}
+
+		unsigned int code = (unsigned int)(s.bits >> 48);
+		unsigned int length = FAST_BITS + 1;
+		while (code >= huffman.maxCode[length])
+			length++;
+
+		if (length > 16)
+			return -1;
+
+		int index = (int)(code >> (16 - length)) - huffman.delta[length];
+		s.bits <<= length;
+		s.numBits -= length;
+		return huffman.symbols[index];
+	}
+
+	// Reads a coefficient stored in count bits: values starting with a 0 bit are negative
+	inline int receiveExtend(JPEGState& s, unsigned int count)
+	{
+		if (count == 0)
+			return 0;
+
+		if (s.numBits < (int)count)
+			fillBits(s);
+
+		int value = (int)(s.bits >> (64 - count));
+		s.bits <<= count;
+		s.numBits -= count;
+
+		if (value < (1 << (count - 1)))
+			value -= (1 << count) - 1;
+
+		return value;
+	}
+
+	// Decodes one block's coefficients (not dequantized) in natural order
+	// Returns false if the data is damaged, onlyDC says whether every AC coefficient is 0
+	bool decodeBlock(JPEGState& s, JPEGComponent& component, short* block, bool& onlyDC)
+	{
+		memset(block, 0, 64 * sizeof(short));
+
+		int size = decodeHuffman(s, s.dc[component.dcTable]);
+		if (size < 0 || size > 11)
+			return false;
+
+		component.dcPrediction += receiveExtend(s, size);
+		block[0] = (short)component.dcPrediction;
+
+		onlyDC = true;
+		const JPEGHuffman& ac = s.ac[component.acTable];
+
+		for (unsigned int k = 1; k < 64;)
+		{
+			int symbol = decodeHuffman(s, ac);
+			if (symbol < 0)
+				return false;
+
+			unsigned int run = symbol >> 4;
+			unsigned int bitCount = symbol & 15;
+
+			if (bitCount == 0)
+			{
+				// End of block, or a run of 16 zeros
+				if (run != 15)
+					break;
+				k += 16;
+				continue;
+			}
+
+			k += run;
+			if (k > 63)
+				return false;
+
+			block[ZIGZAG[k]] = (short)receiveExtend(s, bitCount);
+			onlyDC = false;
+			k++;
+		}
+
+		return true;
+	}
+
+	// libjpeg's islow IDCT (jidctint.c): fixed point with 13 bits of fraction
+	const int CONST_BITS = 13;
+	const int PASS1_BITS = 2;
+
+	const int FIX_0_298631336 = 2446;
+	const int FIX_0_390180644 = 3196;
+	const int FIX_0_541196100 = 4433;
+	const int FIX_0_765366865 = 6270;
+	const int FIX_0_899976223 = 7373;
+	const int FIX_1_175875602 = 9633;
+	const int FIX_1_501321110 = 12299;
+	const int FIX_1_847759065 = 15137;
+	const int FIX_1_961570560 = 16069;
+	const int FIX_2_053119869 = 16819;
+	const int FIX_2_562915447 = 20995;
+	const int FIX_3_072711026 = 25172;
+
+	inline unsigned char clampSample(int64_t value)
+	{
+		return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	// One 1D IDCT of 8 values (s0 to s7, in frequency order), shared by both passes
+	// out receives the 8 results before descaling. It's in 64 bits so damaged files can't overflow it.
+	inline void idct1D(int64_t s0, int64_t s1, int64_t s2, int64_t s3, int64_t s4, int64_t s5, int64_t s6, int64_t s7, int64_t* out)
+	{
+		// Even part
+		int64_t z1 = (s2 + s6) * FIX_0_541196100;
+		int64_t tmp2 = z1 + s6 * -FIX_1_847759065;
+		int64_t tmp3 = z1 + s2 * FIX_0_765366865;
+
+		int64_t tmp0 = (s0 + s4) * (1 << CONST_BITS);
+		int64_t tmp1 = (s0 - s4) * (1 << CONST_BITS);
+
+		int64_t tmp10 = tmp0 + tmp3;
+		int64_t tmp13 = tmp0 - tmp3;
+		int64_t tmp11 = tmp1 + tmp2;
+		int64_t tmp12 = tmp1 - tmp2;
+
+		// Odd part
+		tmp0 = s7;
+		tmp1 = s5;
+		tmp2 = s3;
+		tmp3 = s1;
+
+		z1 = tmp0 + tmp3;
+		int64_t z2 = tmp1 + tmp2;
+		int64_t z3 = tmp0 + tmp2;
+		int64_t z4 = tmp1 + tmp3;
+		int64_t z5 = (z3 + z4) * FIX_1_175875602;
+
+		tmp0 *= FIX_0_298631336;
+		tmp1 *= FIX_2_053119869;
+		tmp2 *= FIX_3_072711026;
+		tmp3 *= FIX_1_501321110;
+		z1 *= -FIX_0_899976223;
+		z2 *= -FIX_2_562915447;
+		z3 = z3 * -FIX_1_961570560 + z5;
+		z4 = z4 * -FIX_0_390180644 + z5;
+
+		tmp0 += z1 + z3;
+		tmp1 += z2 + z4;
+		tmp2 += z2 + z3;
+		tmp3 += z1 + z4;
+
+		out[0] = tmp10 + tmp3;
+		out[7] = tmp10 - tmp3;
+		out[1] = tmp11 + tmp2;
+		out[6] = tmp11 - tmp2;
+		out[2] = tmp12 + tmp1;
+		out[5] = tmp12 - tmp1;
+		out[3] = tmp13 + tmp0;
+		out[4] = tmp13 - tmp0;
+	}
+
+#ifndef TTK_USE_SSE2
+	void idctBlock(const short* block, const unsigned short* quant, unsigned char* out, unsigned int stride)
+	{
+		int64_t workspace[64];
+		int64_t results[8];
+
+		// Columns, dequantizing as they're read
+		for (unsigned int x = 0; x < 8; x++)
+		{
+			const short* in = block + x;
+			const unsigned short* q = quant + x;
+
+			idct1D(in[0] * q[0], in[8] * q[8], in[16] * q[16], in[24] * q[24],
+				in[32] * q[32], in[40] * q[40], in[48] * q[48], in[56] * q[56], results);
+
+			const int round = 1 << (CONST_BITS - PASS1_BITS - 1);
+			for (unsigned int y = 0; y < 8; y++)
+				workspace[y * 8 + x] = (results[y] + round) >> (CONST_BITS - PASS1_BITS);
+		}
+
+		// Then rows, with the samples centred on 128
+		for (unsigned int y = 0; y < 8; y++)
+		{
+			const int64_t* in = workspace + y * 8;
+			idct1D(in[0], in[1], in[2], in[3], in[4], in[5], in[6], in[7], results);
+
+			const int shift = CONST_BITS + PASS1_BITS + 3;
+			const int round = 1 << (shift - 1);
+			for (unsigned int x = 0; x < 8; x++)
+				out[y * stride + x] = clampSample(((results[x] + round) >> shift) + 128);
+		}
+	}
+#endif
+
+#ifdef TTK_USE_SSE2
+	// The same IDCT 8 columns at a time, in 16 bit lanes with 32 bit products from _mm_madd_epi16
+	// Gives the same results as idctBlock() (the version without SSE2), the products are split into pairs of
+	// 16 bit constants (ie. z1 * c1 + z2 * c2) that add up to what it multiplies
+
+	// Interleaves a and b and multiplies the pairs by (c0, c1), for both halves
+	#define IDCT_ROTATE(outLo, outHi, a, b, c0, c1) \
+		__m128i outLo, outHi; \
+		{ \
+			__m128i constants = _mm_setr_epi16(c0, c1, c0, c1, c0, c1, c0, c1); \
+			outLo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), constants); \
+			outHi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), constants); \
+		}
+
+	// x << CONST_BITS in 32 bits, for each half
+	#define IDCT_WIDEN(outLo, outHi, x) \
+		__m128i outLo = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x), 16 - CONST_BITS); \
+		__m128i outHi = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x), 16 - CONST_BITS);
+
+	inline __m128i descalePack(__m128i lo, __m128i hi, __m128i bias, int shift)
+	{
+		return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, bias), shift), _mm_srai_epi32(_mm_add_epi32(hi, bias), shift));
+	}
+
+	inline void idctPassSSE2(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3,
+		__m128i& r4, __m128i& r5, __m128i& r6, __m128i& r7, __m128i bias, int shift)
+	{
+		// Even part
+		// tmp2 = s2 * c541 + s6 * (c541 - c1847), tmp3 = s2 * (c541 + c765) + s6 * c541
+		IDCT_ROTATE(tmp2Lo, tmp2Hi, r2, r6, FIX_0_541196100, FIX_0_541196100 - FIX_1_847759065);
+		IDCT_ROTATE(tmp3Lo, tmp3Hi, r2, r6, FIX_0_541196100 + FIX_0_765366865, FIX_0_541196100);
+
+		IDCT_WIDEN(tmp0Lo, tmp0Hi, _mm_add_epi16(r0, r4));
+		IDCT_WIDEN(tmp1Lo, tmp1Hi, _mm_sub_epi16(r0, r4));
+
+		__m128i tmp10Lo = _mm_add_epi32(tmp0Lo, tmp3Lo), tmp10Hi = _mm_add_epi32(tmp0Hi, tmp3Hi);
+		__m128i tmp13Lo = _mm_sub_epi32(tmp0Lo, tmp3Lo), tmp13Hi = _mm_sub_epi32(tmp0Hi, tmp3Hi);
+		__m128i tmp11Lo = _mm_add_epi32(tmp1Lo, tmp2Lo), tmp11Hi = _mm_add_epi32(tmp1Hi, tmp2Hi);
+		__m128i tmp12Lo = _mm_sub_epi32(tmp1Lo, tmp2Lo), tmp12Hi = _mm_sub_epi32(tmp1Hi, tmp2Hi);
+
+		// Odd part, with z5 folded into z3 and z4:
+		// z3 = (s7 + s3) * (c1175 - c1961) + (s5 + s1) * c1175
+		// z4 = (s7 + s3) * c1175 + (s5 + s1) * (c1175 - c0390)
+		__m128i sum73 = _mm_add_epi16(r7, r3);
+		__m128i sum51 = _mm_add_epi16(r5, r1);
+		IDCT_ROTATE(z3Lo, z3Hi, sum73, sum51, FIX_1_175875602 - FIX_1_961570560, FIX_1_175875602);
+		IDCT_ROTATE(z4Lo, z4Hi, sum73, sum51, FIX_1_175875602, FIX_1_175875602 - FIX_0_390180644);
+
+		// tmp0 = s7 * (c0298 - c0899) + s1 * -c0899 + z3
+		// tmp3 = s7 * -c0899 + s1 * (c1501 - c0899) + z4
+		// tmp1 = s5 * (c2053 - c2562) + s3 * -c2562 + z4
+		// tmp2 = s5 * -c2562 + s3 * (c3072 - c2562) + z3
+		IDCT_ROTATE(o0Lo, o0Hi, r7, r1, FIX_0_298631336 - FIX_0_899976223, -FIX_0_899976223);
+		IDCT_ROTATE(o3Lo, o3Hi, r7, r1, -FIX_0_899976223, FIX_1_501321110 - FIX_0_899976223);
+		IDCT_ROTATE(o1Lo, o1Hi, r5, r3, FIX_2_053119869 - FIX_2_562915447, -FIX_2_562915447);
+		IDCT_ROTATE(o2Lo, o2Hi, r5, r3, -FIX_2_562915447, FIX_3_072711026 - FIX_2_562915447);
+
+		o0Lo = _mm_add_epi32(o0Lo, z3Lo); o0Hi = _mm_add_epi32(o0Hi, z3Hi);
+		o3Lo = _mm_add_epi32(o3Lo, z4Lo); o3Hi = _mm_add_epi32(o3Hi, z4Hi);
+		o1Lo = _mm_add_epi32(o1Lo, z4Lo); o1Hi = _mm_add_epi32(o1Hi, z4Hi);
+		o2Lo = _mm_add_epi32(o2Lo, z3Lo); o2Hi = _mm_add_epi32(o2Hi, z3Hi);
+
+		r0 = descalePack(_mm_add_epi32(tmp10Lo, o3Lo), _mm_add_epi32(tmp10Hi, o3Hi), bias, shift);
+		r7 = descalePack(_mm_sub_epi32(tmp10Lo, o3Lo), _mm_sub_epi32(tmp10Hi, o3Hi), bias, shift);
+		r1 = descalePack(_mm_add_epi32(tmp11Lo, o2Lo), _mm_add_epi32(tmp11Hi, o2Hi), bias, shift);
+		r6 = descalePack(_mm_sub_epi32(tmp11Lo, o2Lo), _mm_sub_epi32(tmp11Hi, o2Hi), bias, shift);
+		r2 = descalePack(_mm_add_epi32(tmp12Lo, o1Lo), _mm_add_epi32(tmp12Hi, o1Hi), bias, shift);
+		r5 = descalePack(_mm_sub_epi32(tmp12Lo, o1Lo), _mm_sub_epi32(tmp12Hi, o1Hi), bias, shift);
+		r3 = descalePack(_mm_add_epi32(tmp13Lo, o0Lo), _mm_add_epi32(tmp13Hi, o0Hi), bias, shift);
+		r4 = descalePack(_mm_sub_epi32(tmp13Lo, o0Lo), _mm_sub_epi32(tmp13Hi, o0Hi), bias, shift);
+	}
+
+	#undef IDCT_ROTATE
+	#undef IDCT_WIDEN
+
+	inline void transpose8x8(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3,
+		__m128i& r4, __m128i& r5, __m128i& r6, __m128i& r7)
+	{
+		__m128i a0 = _mm_unpacklo_epi16(r0, r1), a1 = _mm_unpackhi_epi16(r0, r1);
+		__m128i a2 = _mm_unpacklo_epi16(r2, r3), a3 = _mm_unpackhi_epi16(r2, r3);
+		__m128i a4 = _mm_unpacklo_epi16(r4, r5), a5 = _mm_unpackhi_epi16(r4, r5);
+		__m128i a6 = _mm_unpacklo_epi16(r6, r7), a7 = _mm_unpackhi_epi16(r6, r7);
+
+		__m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+		__m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+		__m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+		__m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+
+		r0 = _mm_unpacklo_epi64(b0, b4); r1 = _mm_unpackhi_epi64(b0, b4);
+		r2 = _mm_unpacklo_epi64(b1, b5); r3 = _mm_unpackhi_epi64(b1, b5);
+		r4 = _mm_unpacklo_epi64(b2, b6); r5 = _mm_unpackhi_epi64(b2, b6);
+		r6 = _mm_unpacklo_epi64(b3, b7); r7 = _mm_unpackhi_epi64(b3, b7);
+	}
+
+	void idctBlockSSE2(const short* block, const unsigned short* quant, unsigned char* out, unsigned int stride)
+	{
+		// Each register is a row of coefficients, so the first pass does 8 columns at once
+		__m128i r[8];
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			r[i] = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(block + i * 8)),
+				_mm_loadu_si128((const __m128i*)(quant + i * 8)));
+		}
+
+		idctPassSSE2(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7],
+			_mm_set1_epi32(1 << (CONST_BITS - PASS1_BITS - 1)), CONST_BITS - PASS1_BITS);
+
+		transpose8x8(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+
+		// The +128 is in the bias, so the descale centres the samples too
+		const int shift = CONST_BITS + PASS1_BITS + 3;
+		idctPassSSE2(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7],
+			_mm_set1_epi32((1 << (shift - 1)) + (128 << shift)), shift);
+
+		transpose8x8(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+
+		for (unsigned int i = 0; i < 8; i++)
+			_mm_storel_epi64((__m128i*)(out + i * stride), _mm_packus_epi16(r[i], r[i]));
+	}
+#endif
+
+	// A block with only a DC coefficient is flat, the IDCT of it is just the DC value scaled
+	inline void fillBlock(short dc, unsigned short quant, unsigned char* out, unsigned int stride)
+	{
+		// The same rounding as the two IDCT passes: * 4 (exact), then / 32 rounded
+		unsigned char value = clampSample(((dc * quant * 4 + 16) >> 5) + 128);
+		for (unsigned int y = 0; y < 8; y++)
+			memset(out + y * stride, value, 8);
+	}
+
+	// libjpeg's YCbCr to RGB (jdcolor.c) in 16 bit fixed point:
+	//	R = Y + 1.40200 * Cr
+	//	G = Y - 0.34414 * Cb - 0.71414 * Cr
+	//	B = Y + 1.77200 * Cb
+	const int SCALE_BITS = 16;
+	const int ONE_HALF = 1 << (SCALE_BITS - 1);
+	const int FIX_1_40200 = 91881;
+	const int FIX_1_77200 = 116130;
+	const int FIX_0_71414 = 46802;
+	const int FIX_0_34414 = 22554;
+
+	// halfChroma means cb and cr have a sample for every 2 pixels (ie. 4:2:0 and 4:2:2 images),
+	// which is repeated here rather than in a pass of its own
+	void convertYCbCrRow(const unsigned char* y, const unsigned char* cb, const unsigned char* cr, unsigned int count,
+		bool halfChroma, unsigned char* out)
+	{
+		unsigned int x = 0;
+
+#ifdef TTK_USE_SSE2
+		// 8 pixels at a time. The constants over 16 bits are split into a whole part (done with
+		// an add) and a 16 bit part, ie. 1.402 * Cr = Cr + 0.402 * Cr. The 16 bit part is done
+		// with _mm_madd_epi16 against (Cr, 2) so the rounding comes from 2 * 16384.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i centre = _mm_set1_epi16(128);
+		const __m128i twos = _mm_set1_epi16(2);
+		const __m128i alpha = _mm_set1_epi8((char)255);
+		const __m128i crToR = _mm_setr_epi16(FIX_1_40200 - 65536, 16384, FIX_1_40200 - 65536, 16384,
+			FIX_1_40200 - 65536, 16384, FIX_1_40200 - 65536, 16384);
+		const __m128i cbToB = _mm_setr_epi16(FIX_1_77200 - 131072, 16384, FIX_1_77200 - 131072, 16384,
+			FIX_1_77200 - 131072, 16384, FIX_1_77200 - 131072, 16384);
+		const __m128i toG = _mm_setr_epi16(-FIX_0_34414, 65536 - FIX_0_71414, -FIX_0_34414, 65536 - FIX_0_71414,
+			-FIX_0_34414, 65536 - FIX_0_71414, -FIX_0_34414, 65536 - FIX_0_71414);
+		const __m128i half = _mm_set1_epi32(ONE_HALF);
+
+		for (; x + 8 <= count; x += 8)
+		{
+			__m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + x)), zero);
+			__m128i cb8, cr8;
+			if (halfChroma)
+			{
+				int cb4, cr4;
+				memcpy(&cb4, cb + x / 2, 4);
+				memcpy(&cr4, cr + x / 2, 4);
+				cb8 = _mm_cvtsi32_si128(cb4);
+				cr8 = _mm_cvtsi32_si128(cr4);
+				cb8 = _mm_unpacklo_epi8(cb8, cb8);
+				cr8 = _mm_unpacklo_epi8(cr8, cr8);
+			}
+			else
+			{
+				cb8 = _mm_loadl_epi64((const __m128i*)(cb + x));
+				cr8 = _mm_loadl_epi64((const __m128i*)(cr + x));
+			}
+
+			__m128i cb16 = _mm_sub_epi16(_mm_unpacklo_epi8(cb8, zero), centre);
+			__m128i cr16 = _mm_sub_epi16(_mm_unpacklo_epi8(cr8, zero), centre);
+
+			// R = Y + Cr + ((0.402 * Cr + 0.5) >> 16)
+			__m128i rLo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cr16, twos), crToR), SCALE_BITS);
+			__m128i rHi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cr16, twos), crToR), SCALE_BITS);
+			__m128i r = _mm_add_epi16(_mm_add_epi16(y16, cr16), _mm_packs_epi32(rLo, rHi));
+
+			// B = Y + 2 * Cb + ((-0.228 * Cb + 0.5) >> 16)
+			__m128i bLo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb16, twos), cbToB), SCALE_BITS);
+			__m128i bHi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb16, twos), cbToB), SCALE_BITS);
+			__m128i b = _mm_add_epi16(_mm_add_epi16(y16, _mm_add_epi16(cb16, cb16)), _mm_packs_epi32(bLo, bHi));
+
+			// G = Y - Cr + ((-0.34414 * Cb + 0.28586 * Cr + 0.5) >> 16)
+			__m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb16, cr16), toG), half), SCALE_BITS);
+			__m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb16, cr16), toG), half), SCALE_BITS);
+			__m128i g = _mm_add_epi16(_mm_sub_epi16(y16, cr16), _mm_packs_epi32(gLo, gHi));
+
+			// Clamp to bytes and interleave into RGBA
+			__m128i r8 = _mm_packus_epi16(r, r);
+			__m128i g8 = _mm_packus_epi16(g, g);
+			__m128i b8 = _mm_packus_epi16(b, b);
+			__m128i rg = _mm_unpacklo_epi8(r8, g8);
+			__m128i ba = _mm_unpacklo_epi8(b8, alpha);
+
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i*)(out + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+#endif
+
+		for (; x < count; x++)
+		{
+			int luma = y[x];
+			unsigned int chroma = halfChroma ? x / 2 : x;
+			int blue = cb[chroma] - 128;
+			int red = cr[chroma] - 128;
+
+			unsigned char* pixel = out + x * 4;
+			pixel[0] = clampSample(luma + ((FIX_1_40200 * red + ONE_HALF) >> SCALE_BITS));
+			pixel[1] = clampSample(luma + ((-FIX_0_34414 * blue - FIX_0_71414 * red + ONE_HALF) >> SCALE_BITS));
+			pixel[2] = clampSample(luma + ((FIX_1_77200 * blue + ONE_HALF) >> SCALE_BITS));
+			pixel[3] = 255;
+		}
+	}
+
+	// Reads a marker's length and checks the segment fits in the file
+	bool readSegment(JPEGState& s, const unsigned char*& outBody, unsigned int& outLength)
+	{
+		if (s.pos + 2 > s.size)
+			return false;
+
+		unsigned int length = readBE16(s.data + s.pos);
+		if (length < 2 || s.pos + length > s.size)
+			return false;
+
+		outBody = s.data + s.pos + 2;
+		outLength = length - 2;
+		s.pos += length;
+		return true;
+	}
+
+	// Reads markers up to the first scan (or the frame header if headerOnly)
+	// Returns null if all went well, or why not
+	const char* readMarkers(JPEGState& s, bool headerOnly)
+	{
+		s.pos = 2;
+
+		while (true)
+		{
+			// Markers can be padded with any number of 0xFFs
+			if (s.pos >= s.size || s.data[s.pos] != 0xFF)
+				return "JPEG marker is damaged";
+			while (s.pos < s.size && s.data[s.pos] == 0xFF)
+				s.pos++;
+			if (s.pos >= s.size)
+				return "JPEG ends before its image data";
+
+			unsigned int marker = s.data[s.pos++];
+			if (marker == JPEG_EOI)
+				return "JPEG has no image data";
+
+			const unsigned char* body;
+			unsigned int length;
+			if (!readSegment(s, body, length))
+				return "JPEG segment runs past the end of the file";
+
+			if (marker == JPEG_SOF0 || marker == JPEG_SOF1 || marker == JPEG_SOF2)
+			{
+				if (length < 6)
+					return "JPEG frame header is damaged";
+
+				s.progressive = marker == JPEG_SOF2;
+				s.height = readBE16(body + 1);
+				s.width = readBE16(body + 3);
+				s.numComponents = body[5];
+
+				if (body[0] != 8)
+					return "JPEG isn't 8 bits per sample";
+				if (s.width == 0 || s.height == 0 || s.width > MAX_IMAGE_DIMENSION || s.height > MAX_IMAGE_DIMENSION)
+					return "JPEG size isn't supported";
+				if (s.numComponents != 1 && s.numComponents != 3)
+					return "JPEG isn't greyscale or colour (ie. it's CMYK)";
+				if (length < 6 + s.numComponents * 3)
+					return "JPEG frame header is damaged";
+
+				if (headerOnly)
+					return nullptr;
+
+				s.hMax = s.vMax = 1;
+				for (unsigned int i = 0; i < s.numComponents; i++)
+				{
+					JPEGComponent& component = s.components[i];
+					component.id = body[6 + i * 3];
+					component.h = body[7 + i * 3] >> 4;
+					component.v = body[7 + i * 3] & 15;
+					component.quantTable = body[8 + i * 3];
+
+					if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantTable > 3)
+						return "JPEG frame header is damaged";
+
+					// Greyscale images are one block per MCU, whatever the sampling says
+					if (s.numComponents == 1)
+						component.h = component.v = 1;
+
+					s.hMax = std::max(s.hMax, component.h);
+					s.vMax = std::max(s.vMax, component.v);
+				}
+			}
+			else if (marker >= 0xC3 && marker <= 0xCF && marker != JPEG_DHT && marker != 0xC8 && marker != 0xCC)
+			{
+				return "JPEG uses lossless or arithmetic coding, which isn't supported";
+			}
+			else if (headerOnly)
+			{
+				if (marker == JPEG_SOS)
+					return "JPEG has no frame header";
+			}
+			else if (marker == JPEG_DQT)
+			{
+				while (length > 0)
+				{
+					unsigned int precision = body[0] >> 4;
+					unsigned int id = body[0] & 15;
+					unsigned int tableSize = precision ? 129 : 65;
+
+					if (id > 3 || precision > 1 || length < tableSize)
+						return "JPEG quantization table is damaged";
+
+					for (unsigned int k = 0; k < 64; k++)
+						s.quant[id][ZIGZAG[k]] = (unsigned short)(precision ? readBE16(body + 1 + k * 2) : body[1 + k]);
+
+					body += tableSize;
+					length -= tableSize;
+				}
+			}
+			else if (marker == JPEG_DHT)
+			{
+				while (length > 0)
+				{
+					if (length < 17)
+						return "JPEG Huffman table is damaged";
+
+					unsigned int tableClass = body[0] >> 4;
+					unsigned int id = body[0] & 15;
+
+					unsigned int numSymbols = 0;
+					for (unsigned int i = 0; i < 16; i++)
+						numSymbols += body[1 + i];
+
+					if (tableClass > 1 || id > 3 || length < 17 + numSymbols)
+						return "JPEG Huffman table is damaged";
+
+					JPEGHuffman& table = tableClass == 0 ? s.dc[id] : s.ac[id];
+					if (!table.build(body + 1, body + 17))
+						return "JPEG Huffman table is damaged";
+
+					body += 17 + numSymbols;
+					length -= 17 + numSymbols;
+				}
+			}
+			else if (marker == JPEG_DRI)
+			{
+				if (length < 2)
+					return "JPEG restart interval is damaged";
+				s.restartInterval = readBE16(body);
+			}
+			else if (marker == JPEG_APP14)
+			{
+				// "Adobe", then the version etc., then the transform (0 means the components are RGB)
+				if (length >= 12 && memcmp(body, "Adobe", 5) == 0)
+					s.transformRGB = body[11] != 0;
+			}
+			else if (marker == JPEG_SOS)
+			{
+				if (s.numComponents == 0)
+					return "JPEG has no frame header";
+				if (s.progressive)
+					return "JPEG is progressive, which isn't supported";
+
+				unsigned int numScanComponents = length > 0 ? body[0] : 0;
+				if (numScanComponents != s.numComponents || length < 4 + numScanComponents * 2)
+					return "JPEG's scan doesn't have every component (non-interleaved), which isn't supported";
+
+				for (unsigned int i = 0; i < numScanComponents; i++)
+				{
+					unsigned int id = body[1 + i * 2];
+					unsigned int tables = body[2 + i * 2];
+
+					// Scans list the components in the same order as the frame
+					JPEGComponent& component = s.components[i];
+					if (component.id != id || (tables >> 4) > 3 || (tables & 15) > 3)
+						return "JPEG scan header is damaged";
+
+					component.dcTable = tables >> 4;
+					component.acTable = tables & 15;
+
+					if (!s.dc[component.dcTable].defined || !s.ac[component.acTable].defined)
+						return "JPEG is missing a Huffman table";
+				}
+
+				// The entropy coded data starts right after
+				return nullptr;
+			}
+		}
+	}
+}
+
+bool TTK::ImageDecoder::readJPEGInfo(const unsigned char* data, size_t size, ImageInfo& outInfo)
+{
+	JPEGState s;
+	s.data = data;
+	s.size = size;
+	s.numComponents = 0;
+
+	if (size < 4 || readMarkers(s, true) != nullptr)
+		return false;
+
+	outInfo.type = IMAGE_FILE_JPEG;
+	outInfo.width = s.width;
+	outInfo.height = s.height;
+	return true;
+}
+
+bool TTK::ImageDecoder::decodeJPEG(const unsigned char* data, size_t size, unsigned char* pixels, bool bottomRowFirst)
+{
+	// The tables are too big for the stack
+	std::unique_ptr<JPEGState> state(new JPEGState());
+	JPEGState& s = *state;
+
+	s.data = data;
+	s.size = size;
+	s.numComponents = 0;
+	s.progressive = false;
+	s.transformRGB = true;
+	s.restartInterval = 0;
+
+	for (unsigned int i = 0; i < 4; i++)
+		s.dc[i].defined = s.ac[i].defined = false;
+
+	const char* markerError = readMarkers(s, false);
+	if (markerError)
+		return fail(markerError);
+
+	// Adobe's transform flag is only for 3 components, and JFIF files are always YCbCr
+	bool isYCbCr = s.numComponents == 3 && s.transformRGB;
+
+	// The usual subsampling, half as many chroma samples across, is upsampled by the colour conversion
+	bool halfChroma = isYCbCr && s.components[0].h == s.hMax &&
+		s.components[1].h * 2 == s.hMax && s.components[2].h * 2 == s.hMax;
+
+	unsigned int mcuWidth = s.hMax * 8;
+	unsigned int mcuHeight = s.vMax * 8;
+	unsigned int mcusX = (s.width + mcuWidth - 1) / mcuWidth;
+	unsigned int mcusY = (s.height + mcuHeight - 1) / mcuHeight;
+
+	// Each component's samples for a row of MCUs
+	size_t planeSize = 0;
+	for (unsigned int i = 0; i < s.numComponents; i++)
+	{
+		JPEGComponent& component = s.components[i];
+		component.stride = mcusX * component.h * 8;
+		component.dcPrediction = 0;
+		planeSize += component.stride * component.v * 8;
+	}
+
+	planes.resize(planeSize);
+	unsigned char* plane = planes.data();
+	for (unsigned int i = 0; i < s.numComponents; i++)
+	{
+		s.components[i].plane = plane;
+		plane += s.components[i].stride * s.components[i].v * 8;
+	}
+
+	// Each component's row of pixels when it needs upsampling (usually just Cb and Cr)
+	row.resize(s.width * s.numComponents);
+
+	s.bits = 0;
+	s.numBits = 0;
+	s.hitMarker = false;
+
+	unsigned int mcusToRestart = s.restartInterval;
+
+	short block[64];
+
+	for (unsigned int mcuY = 0; mcuY < mcusY; mcuY++)
+	{
+		for (unsigned int mcuX = 0; mcuX < mcusX; mcuX++)
+		{
+			if (s.restartInterval && mcusToRestart == 0)
+			{
+				// Restarts start on a byte with fresh predictions, after an RSTn marker
+				while (s.pos + 1 < s.size && s.data[s.pos] == 0xFF && s.data[s.pos + 1] == 0xFF)
+					s.pos++;
+				if (s.pos + 1 < s.size && s.data[s.pos] == 0xFF && s.data[s.pos + 1] >= JPEG_RST0 && s.data[s.pos + 1] <= JPEG_RST7)
+					s.pos += 2;
+
+				s.bits = 0;
+				s.numBits = 0;
+				s.hitMarker = false;
+				for (unsigned int i = 0; i < s.numComponents; i++)
+					s.components[i].dcPrediction = 0;
+
+				mcusToRestart = s.restartInterval;
+			}
+
+			for (unsigned int i = 0; i < s.numComponents; i++)
+			{
+				JPEGComponent& component = s.components[i];
+				const unsigned short* quant = s.quant[component.quantTable];
+
+				for (unsigned int by = 0; by < component.v; by++)
+				{
+					for (unsigned int bx = 0; bx < component.h; bx++)
+					{
+						bool onlyDC;
+						if (!decodeBlock(s, component, block, onlyDC))
+							return fail("JPEG image data is damaged");
+
+						unsigned char* out = component.plane + by * 8 * component.stride + (mcuX * component.h + bx) * 8;
+
+						if (onlyDC)
+							fillBlock(block[0], quant[0], out, component.stride);
+						else
+#ifdef TTK_USE_SSE2
+							idctBlockSSE2(block, quant, out, component.stride);
+#else
+							idctBlock(block, quant, out, component.stride);
+#endif
+					}
+				}
+			}
+
+			mcusToRestart--;
+		}
+
+		// Upsample and colour convert the pixel rows this MCU row covers
+		unsigned int firstRow = mcuY * mcuHeight;
+		unsigned int numRows = std::min(mcuHeight, s.height - firstRow);
+
+		for (unsigned int y = 0; y < numRows; y++)
+		{
+			unsigned int imageY = firstRow + y;
+			unsigned char* dst = pixels + (size_t)(bottomRowFirst ? s.height - 1 - imageY : imageY) * s.width * 4;
+
+			// Each component's row, repeating samples where it has fewer than the image
+			const unsigned char* rows[3];
+			for (unsigned int i = 0; i < s.numComponents; i++)
+			{
+				JPEGComponent& component = s.components[i];
+				const unsigned char* src = component.plane + (y * component.v / s.vMax) * component.stride;
+
+				if (component.h == s.hMax || (halfChroma && i > 0))
+				{
+					rows[i] = src;
+					continue;
+				}
+
+				unsigned char* upsampled = row.data() + i * s.width;
+				if (s.hMax == component.h * 2)
+				{
+					for (unsigned int x = 0; x < s.width; x++)
+						upsampled[x] = src[x >> 1];
+				}
+				else
+				{
+					for (unsigned int x = 0; x < s.width; x++)
+						upsampled[x] = src[x * component.h / s.hMax];
+				}
+				rows[i] = upsampled;
+			}
+
+			if (s.numComponents == 1)
+			{
+				for (unsigned int x = 0; x < s.width; x++)
+				{
+					dst[x * 4 + 0] = dst[x * 4 + 1] = dst[x * 4 + 2] = rows[0][x];
+					dst[x * 4 + 3] = 255;
+				}
+			}
+			else if (isYCbCr)
+			{
+				convertYCbCrRow(rows[0], rows[1], rows[2], s.width, halfChroma, dst);
+			}
+			else
+			{
+				for (unsigned int x = 0; x < s.width; x++)
+				{
+					dst[x * 4 + 0] = rows[0][x];
+					dst[x * 4 + 1] = rows[1][x];
+					dst[x * 4 + 2] = rows[2][x];
+					dst[x * 4 + 3] = 255;
+				}
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,247 @@
+#include "TTK/LZ4.h"
+#include <vector>
+#include <cstring> // for memcpy
+
+namespace
+{
+	const size_t MIN_MATCH = 4;
+
+	// The format's rules for the end of a block: the last 5 bytes are always literals,
+	// and no match starts in the last 12
+	const size_t LAST_LITERALS = 5;
+	const size_t MATCH_FIND_LIMIT = 12;
+
+	// Offsets are 2 bytes
+	const size_t MAX_OFFSET = 65535;
+
+	const unsigned int HASH_BITS = 14;
+
+	// Short copies are done as one fixed size copy
+	const size_t WILD_COPY = 16;
+
+	inline unsigned int read32(const unsigned char* p)
+	{
+		unsigned int value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	// Knuth's multiplicative hash of the next 4 bytes
+	inline unsigned int hash4(unsigned int sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Lengths of 15 or more spill into extra bytes: 255 each until the last, which is less
+	inline unsigned char* writeLength(unsigned char* out, size_t length)
+	{
+		while (length >= 255)
+		{
+			*out++ = 255;
+			length -= 255;
+		}
+
+		*out++ = (unsigned char)length;
+		return out;
+	}
+
+	inline bool readLength(const unsigned char*& in, const unsigned char* end, size_t& length)
+	{
+		unsigned char byte;
+		do
+		{
+			if (in >= end)
+				return false;
+
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+
+		return true;
+	}
+
+	// Writes literals and (if matchLength isn't 0) a match as one sequence
+	// Returns null if it doesn't fit
+	unsigned char* writeSequence(unsigned char* out, unsigned char* outEnd,
+		const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		// Worst case: token, literal length bytes, literals, offset, match length bytes
+		size_t worstCase = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+		if (worstCase > (size_t)(outEnd - out))
+			return nullptr;
+
+		unsigned char* token = out++;
+
+		if (literalLength >= 15)
+		{
+			*token = 15 << 4;
+			out = writeLength(out, literalLength - 15);
+		}
+		else
+		{
+			*token = (unsigned char)(literalLength << 4);
+		}
+
+		memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		// The last sequence has no match
+		if (matchLength == 0)
+			return out;
+
+		*out++ = (unsigned char)offset;
+		*out++ = (unsigned char)(offset >> 8);
+
+		size_t storedLength = matchLength - MIN_MATCH;
+		if (storedLength >= 15)
+		{
+			*token |= 15;
+			out = writeLength(out, storedLength - 15);
+		}
+		else
+		{
+			*token |= (unsigned char)storedLength;
+		}
+
+		return out;
+	}
+}
+
+size_t TTK::LZ4::compressBound(size_t inputSize)
+{
+	return inputSize + inputSize / 255 + 16;
+}
+
+size_t TTK::LZ4::compress(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputCapacity)
+{
+	unsigned char* out = output;
+	unsigned char* outEnd = output + outputCapacity;
+
+	size_t anchor = 0;	// start of the literals not written yet
+
+	if (inputSize > MATCH_FIND_LIMIT)
+	{
+		// Where each hash was last seen
+		std::vector<unsigned int> table(1 << HASH_BITS, 0);
+
+		size_t searchEnd = inputSize - MATCH_FIND_LIMIT;
+		size_t matchEnd = inputSize - LAST_LITERALS;
+		size_t pos = 1;
+
+		// Greedy: take the first match found at each position
+		while (pos < searchEnd)
+		{
+			unsigned int sequence = read32(input + pos);
+			unsigned int& entry = table[hash4(sequence)];
+			size_t candidate = entry;
+			entry = (unsigned int)pos;
+
+			if (pos - candidate > MAX_OFFSET || read32(input + candidate) != sequence)
+			{
+				pos++;
+				continue;
+			}
+
+			// Grow the match back into the literals, then forwards as far as it goes
+			while (pos > anchor && candidate > 0 && input[pos - 1] == input[candidate - 1])
+			{
+				pos--;
+				candidate--;
+			}
+
+			size_t matchLength = MIN_MATCH;
+			while (pos + matchLength < matchEnd && input[pos + matchLength] == input[candidate + matchLength])
+				matchLength++;
+
+			out = writeSequence(out, outEnd, input + anchor, pos - anchor, pos - candidate, matchLength);
+			if (!out)
+				return 0;
+
+			pos += matchLength;
+			anchor = pos;
+		}
+	}
+
+	out = writeSequence(out, outEnd, input + anchor, inputSize - anchor, 0, 0);
+	if (!out)
+		return 0;
+
+	return (size_t)(out - output);
+}
+
+bool TTK::LZ4::decompress(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+{
+	const unsigned char* in = input;
+	const unsigned char* inEnd = input + inputSize;
+	unsigned char* out = output;
+	unsigned char* outEnd = output + outputSize;
+
+	while (in < inEnd)
+	{
+		unsigned int token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(in, inEnd, literalLength))
+			return false;
+
+		if (literalLength > (size_t)(inEnd - in) || literalLength > (size_t)(outEnd - out))
+			return false;
+
+		// Most runs are short, a fixed 16 byte copy beats memcpy's size checks when there's room
+		if (literalLength <= WILD_COPY && (size_t)(inEnd - in) >= WILD_COPY && (size_t)(outEnd - out) >= WILD_COPY)
+			memcpy(out, in, WILD_COPY);
+		else
+			memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// The last sequence is only literals
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return false;
+
+		size_t offset = in[0] | ((size_t)in[1] << 8);
+		in += 2;
+
+		if (offset == 0 || offset > (size_t)(out - output))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+			return false;
+
+		matchLength += MIN_MATCH;
+		if (matchLength > (size_t)(outEnd - out))
+			return false;
+
+		const unsigned char* match = out - offset;
+
+		if (offset >= 8 && (size_t)(outEnd - out) >= matchLength + 8)
+		{
+			// 8 bytes at a time, each block only reads bytes already written (may write a little past the match)
+			unsigned char* matchEnd = out + matchLength;
+			while (out < matchEnd)
+			{
+				memcpy(out, match, 8);
+				out += 8;
+				match += 8;
+			}
+			out = matchEnd;
+		}
+		else if (offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			// Overlaps what it's writing (ie. a run of one repeated byte), so byte by byte
+			for (size_t i = 0; i < matchLength; i++)
+				*out++ = *match++;
+		}
+	}
+
+	return out == outEnd;
+}
@@ -71,10 +71,12 @@ void TTK::MeshBase::setAllColours(glm::vec4 colour)
 	}
 }
 
-void TTK::MeshBase::createVBO()
+void TTK::MeshBase::createVBO(bool dynamic)
 {
 	int numTris = vertices.size() / 3; // todo: handle non-triangulated meshes
 
+	vbo.setDynamic(dynamic);
+
 	// Setup VBO
 	
 	// Set up position (vertex) attribute
@@ -124,3 +126,16 @@ void TTK::MeshBase::createVBO()
 
 	vbo.createVBO();
 }
+
+void TTK::MeshBase::updateVBO()
+{
+	// The vectors may have been reallocated since the VBO was created
+	if (vertices.size() > 0)
+		vbo.setAttributeData(AttributeLocations::VERTEX, &vertices[0]);
+	if (textureCoordinates.size() > 0)
+		vbo.setAttributeData(AttributeLocations::TEX_COORD, &textureCoordinates[0]);
+	if (normals.size() > 0)
+		vbo.setAttributeData(AttributeLocations::NORMAL, &normals[0]);
+
+	vbo.updateVBO();
+}
@@ -1,4 +1,6 @@
 #include "TTK/OBJMesh.h"
+#include "TTK/IO.h"
+#include "MeshCodec.h"
 #include "glm/glm.hpp"
 #include <vector>
 #include <fstream>
@@ -12,20 +14,40 @@ typedef struct
 	int vertex3, texture3, normal3;
 }Face3;
 
-void TTK::OBJMesh::loadMesh(std::string filename)
+// Lets an istream read straight from a file's bytes (ie. a view into a mounted pack)
+struct MemoryBuffer : std::streambuf
 {
-	std::ifstream file;
+	MemoryBuffer(const unsigned char* data, size_t size)
+	{
+		char* begin = (char*)data;
+		setg(begin, begin, begin + size);
+	}
+};
 
-	//open file
-	file.open(filename.c_str());
+void TTK::OBJMesh::loadMesh(std::string filename)
+{
+	TTK::IO::FileView view;
 
+	//open file (from a mounted pack if one has it)
 	//check if file opened
-	if (file.fail() == true)
+	if (!TTK::IO::openFile(filename, view))
 	{
 		std::cout << "Error - OBJMesh::loadMesh file: " << filename << " not found.\n";
 		return;
 	}
 
+	parseMesh(filename, view.data(), view.size());
+
+	createVBO();
+}
+
+void TTK::OBJMesh::parseMesh(const std::string& filename, const unsigned char* data, size_t size)
+{
+	MemoryBuffer buffer(data, size);
+	std::istream file(&buffer);
+
+	sourceFile = filename;
+
 	char currentChar;
 
 	glm::vec3 temp;
@@ -78,14 +100,12 @@ void TTK::OBJMesh::loadMesh(std::string filename)
 		file.get(currentChar);
 	}
 
-	file.close();
-
 	// Unpack data
 	vertices.reserve(objVertices.size());
 	normals.reserve(objNormals.size());
 	textureCoordinates.reserve(objUVs.size());
 
-	for (int i = 0; i < objFaces.size(); i++)
+	for (unsigned int i = 0; i < objFaces.size(); i++)
 	{
 		Face3* face = &objFaces[i];
 
@@ -101,7 +121,52 @@ void TTK::OBJMesh::loadMesh(std::string filename)
 		textureCoordinates.push_back(objUVs[face->texture2 - 1]);
 		textureCoordinates.push_back(objUVs[face->texture3 - 1]);
 	}
+}
 
-	createVBO();
+
+bool TTK::OBJMesh::parseCookedMesh(const std::string& filename, const unsigned char* data, size_t size)
+{
+	std::shared_ptr<QuantizedMesh> cooked = std::make_shared<QuantizedMesh>();
+	if (!decodeMesh(data, size, *cooked))
+		return false;
+
+	sourceFile = filename;
+
+	// Back to a triangle soup of floats for the VBO, same as parseMesh() makes
+	// (positions are the quantized ones, within 1/65535 of the mesh's size of the OBJ's)
+	vertices.resize(cooked->indices.size());
+	normals.resize(cooked->indices.size());
+	textureCoordinates.resize(cooked->indices.size());
+
+	for (unsigned int i = 0; i < cooked->indices.size(); i++)
+	{
+		unsigned int vertex = cooked->indices[i];
+
+		vertices[i] = cooked->getPosition(vertex);
+		normals[i] = cooked->getNormal(vertex);
+		textureCoordinates[i] = cooked->getUV(vertex);
+	}
+
+	quantized = cooked;
+	return true;
 }
 
+void TTK::OBJMesh::reloadMesh()
+{
+	if (sourceFile.empty())
+		return;
+
+	// Copy, loadMesh() sets sourceFile again
+	std::string filename = sourceFile;
+
+	vertices.clear();
+	normals.clear();
+	textureCoordinates.clear();
+	colours.clear();
+	vbo.destroy();
+
+	// Reloaded from the OBJ, so the cooked copy is out of date
+	quantized.reset();
+
+	loadMesh(filename);
+}
@@ -0,0 +1,338 @@
+#include "TTK/PackFile.h"
+#include "TTK/LZ4.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring> // for memcmp and memcpy
+
+namespace
+{
+	const char PACK_MAGIC[4] = { 'T', 'P', 'A', 'K' };
+	const uint32_t PACK_VERSION = 1;
+
+	// The TOC starts on a cache line, each file's data on a 16 byte boundary (so it can be
+	// read as floats or with SSE straight from the mapping)
+	const uint64_t TOC_ALIGNMENT = 64;
+	const uint64_t DATA_ALIGNMENT = 16;
+
+	inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	inline char normalizeSeparator(char c)
+	{
+		return c == '\\' ? '/' : c;
+	}
+
+	// Compares a name in the pack with one being looked up, '\' matches '/'
+	bool namesEqual(const char* packed, uint32_t packedLength, const std::string& name)
+	{
+		if (packedLength != name.length())
+			return false;
+
+		for (uint32_t i = 0; i < packedLength; i++)
+		{
+			if (packed[i] != normalizeSeparator(name[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool entryHashLess(const TTK::PackEntry& entry, uint64_t hash)
+	{
+		return entry.nameHash < hash;
+	}
+}
+
+uint64_t TTK::hashPackName(const std::string& name)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	for (unsigned int i = 0; i < name.length(); i++)
+	{
+		hash ^= (unsigned char)normalizeSeparator(name[i]);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+TTK::PackFile::PackFile()
+{
+	header = nullptr;
+	entries = nullptr;
+	names = nullptr;
+}
+
+bool TTK::PackFile::open(const std::string& fileName)
+{
+	close();
+
+	if (!file.open(fileName))
+		return false;
+
+	const unsigned char* data = file.data();
+	size_t size = file.size();
+
+	const PackHeader* packHeader = (const PackHeader*)data;
+
+	bool valid = size >= sizeof(PackHeader) &&
+		memcmp(packHeader->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 &&
+		packHeader->version == PACK_VERSION &&
+		packHeader->entrySize == sizeof(PackEntry) &&
+		packHeader->tocOffset % TOC_ALIGNMENT == 0 &&
+		packHeader->tocOffset + (uint64_t)packHeader->numEntries * sizeof(PackEntry) <= size &&
+		packHeader->namesOffset <= size;
+
+	// Everything the TOC points at has to be inside the file, so lookups never need checking
+	const PackEntry* packEntries = (const PackEntry*)(data + (valid ? packHeader->tocOffset : 0));
+
+	for (uint32_t i = 0; valid && i < packHeader->numEntries; i++)
+	{
+		const PackEntry& entry = packEntries[i];
+
+		valid = packHeader->namesOffset + entry.nameOffset + entry.nameLength <= size &&
+			entry.dataOffset + entry.storedSize <= size &&
+			(i == 0 || packEntries[i - 1].nameHash <= entry.nameHash);
+	}
+
+	if (!valid)
+	{
+		std::cout << "Pack Error: not a pack or it's damaged: " << fileName << std::endl;
+		file.close();
+		return false;
+	}
+
+	header = packHeader;
+	entries = packEntries;
+	names = (const char*)(data + header->namesOffset);
+
+	return true;
+}
+
+void TTK::PackFile::close()
+{
+	file.close();
+	header = nullptr;
+	entries = nullptr;
+	names = nullptr;
+}
+
+const TTK::PackEntry* TTK::PackFile::findEntry(const std::string& name) const
+{
+	if (!header)
+		return nullptr;
+
+	uint64_t hash = hashPackName(name);
+
+	const PackEntry* end = entries + header->numEntries;
+	const PackEntry* entry = std::lower_bound(entries, end, hash, entryHashLess);
+
+	// Two names can have the same hash, so check each entry with it
+	for (; entry != end && entry->nameHash == hash; entry++)
+	{
+		if (namesEqual(names + entry->nameOffset, entry->nameLength, name))
+			return entry;
+	}
+
+	return nullptr;
+}
+
+std::string TTK::PackFile::getEntryName(const PackEntry& entry) const
+{
+	return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+bool TTK::PackFile::readEntry(const PackEntry& entry, std::vector<unsigned char>& out) const
+{
+	out.resize(entry.size);
+
+	const unsigned char* stored = getStoredData(entry);
+
+	if (entry.flags & PACK_ENTRY_LZ4)
+		return LZ4::decompress(stored, entry.storedSize, out.data(), out.size());
+
+	if (entry.storedSize != entry.size)
+		return false;
+
+	memcpy(out.data(), stored, entry.size);
+	return true;
+}
+
+void TTK::PackWriter::addFile(const std::string& name, const unsigned char* data, size_t size, bool compress)
+{
+	File packed;
+	packed.name = name;
+	std::replace(packed.name.begin(), packed.name.end(), '\\', '/');
+	packed.size = (uint32_t)size;
+	packed.flags = 0;
+
+	if (compress && size > 0)
+	{
+		packed.stored.resize(LZ4::compressBound(size));
+		size_t compressedSize = LZ4::compress(data, size, packed.stored.data(), packed.stored.size());
+
+		if (compressedSize > 0 && compressedSize <= size - size / 8)
+		{
+			packed.stored.resize(compressedSize);
+			packed.flags = PACK_ENTRY_LZ4;
+		}
+	}
+
+	if (!(packed.flags & PACK_ENTRY_LZ4))
+		packed.stored.assign(data, data + size);
+
+	files.push_back(packed);
+}
+
+// True if name ends in extension
+static bool hasExtension(const std::string& name, const std::string& extension)
+{
+	return !extension.empty() && name.length() >= extension.length() &&
+		name.compare(name.length() - extension.length(), extension.length(), extension) == 0;
+}
+
+bool TTK::PackWriter::addDirectory(const std::string& directory, const std::vector<std::string>& compressExtensions,
+	const std::string& skipExtension)
+{
+	std::vector<std::string> fileNames;
+	if (!IO::listFiles(directory, fileNames))
+	{
+		std::cout << "Pack Error: cannot list directory: " << directory << std::endl;
+		return false;
+	}
+
+	std::string prefix = directory;
+	if (!prefix.empty() && prefix.back() != '/' && prefix.back() != '\\')
+		prefix += '/';
+
+	for (unsigned int i = 0; i < fileNames.size(); i++)
+	{
+		const std::string& name = fileNames[i];
+
+		if (hasExtension(name, skipExtension))
+			continue;
+
+		bool compress = false;
+		for (unsigned int j = 0; j < compressExtensions.size(); j++)
+			compress |= hasExtension(name, compressExtensions[j]);
+
+		// Straight from disk, not through any mounted pack
+		IO::MappedFile source;
+		if (!source.open(prefix + name))
+		{
+			std::cout << "Pack Error: cannot read file: " << prefix + name << std::endl;
+			return false;
+		}
+
+		addFile(name, source.data(), source.size(), compress);
+	}
+
+	return true;
+}
+
+bool TTK::PackWriter::write(const std::string& fileName)
+{
+	// Sorted by hash, so a reader can binary search the TOC
+	std::vector<PackEntry> toc(files.size());
+	std::vector<unsigned int> order(files.size());
+	for (unsigned int i = 0; i < files.size(); i++)
+	{
+		order[i] = i;
+		toc[i].nameHash = hashPackName(files[i].name);
+	}
+
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return toc[a].nameHash < toc[b].nameHash; });
+
+	PackHeader header;
+	memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.numEntries = (uint32_t)files.size();
+	header.entrySize = sizeof(PackEntry);
+	header.tocOffset = alignUp(sizeof(PackHeader), TOC_ALIGNMENT);
+	header.namesOffset = header.tocOffset + files.size() * sizeof(PackEntry);
+
+	// Lay out the names, then the data
+	std::vector<PackEntry> entries(files.size());
+	uint64_t namesSize = 0;
+
+	for (unsigned int i = 0; i < order.size(); i++)
+	{
+		const File& packed = files[order[i]];
+		PackEntry& entry = entries[i];
+
+		entry.nameHash = toc[order[i]].nameHash;
+		entry.nameOffset = (uint32_t)namesSize;
+		entry.nameLength = (uint32_t)packed.name.length();
+		entry.storedSize = (uint32_t)packed.stored.size();
+		entry.size = packed.size;
+		entry.flags = packed.flags;
+		entry.padding = 0;
+
+		namesSize += packed.name.length();
+	}
+
+	uint64_t dataOffset = header.namesOffset + namesSize;
+	for (unsigned int i = 0; i < entries.size(); i++)
+	{
+		dataOffset = alignUp(dataOffset, DATA_ALIGNMENT);
+		entries[i].dataOffset = dataOffset;
+		dataOffset += entries[i].storedSize;
+	}
+
+	std::ofstream out(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cout << "Pack Error: cannot write file: " << fileName << std::endl;
+		return false;
+	}
+
+	// Zeros for the gaps left by alignment
+	const char zeros[TOC_ALIGNMENT] = {};
+	uint64_t written = 0;
+
+	out.write((const char*)&header, sizeof(header));
+	written += sizeof(header);
+
+	out.write(zeros, header.tocOffset - written);
+	written = header.tocOffset;
+
+	if (!entries.empty())
+		out.write((const char*)entries.data(), entries.size() * sizeof(PackEntry));
+	written += entries.size() * sizeof(PackEntry);
+
+	for (unsigned int i = 0; i < order.size(); i++)
+		out.write(files[order[i]].name.data(), files[order[i]].name.length());
+	written += namesSize;
+
+	for (unsigned int i = 0; i < order.size(); i++)
+	{
+		out.write(zeros, entries[i].dataOffset - written);
+
+		const File& packed = files[order[i]];
+		if (!packed.stored.empty())
+			out.write((const char*)packed.stored.data(), packed.stored.size());
+
+		written = entries[i].dataOffset + entries[i].storedSize;
+	}
+
+	return out.good();
+}
+
+size_t TTK::PackWriter::getTotalSize() const
+{
+	size_t total = 0;
+	for (unsigned int i = 0; i < files.size(); i++)
+		total += files[i].size;
+	return total;
+}
+
+size_t TTK::PackWriter::getTotalStoredSize() const
+{
+	size_t total = 0;
+	for (unsigned int i = 0; i < files.size(); i++)
+		total += files[i].stored.size();
+	return total;
+}
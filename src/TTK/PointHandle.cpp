@@ -1,5 +1,5 @@
-#include "TTK\PointHandle.h"
-#include "TTK\GraphicsUtils.h"
+#include "TTK/PointHandle.h"
+#include "TTK/DebugDraw.h"
 
 PointHandle::PointHandle(float _pointSize, glm::vec3 _position, std::string _label)
 {
@@ -13,8 +13,8 @@ bool PointHandle::isInside(glm::vec3 p)
 	return glm::length((p - position)) < pointSize;
 }
 
-void PointHandle::draw()
+void PointHandle::draw(TTK::DebugDraw& debugDraw)
 {
-	TTK::Graphics::DrawPoint(position, pointSize);
-	TTK::Graphics::DrawText2D(label, (int)position.x, (int)(position.y + pointSize * 0.5f));
+	debugDraw.addPoint2D(glm::vec2(position), pointSize, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+	debugDraw.addText(label, glm::vec2(position.x, position.y + pointSize * 0.5f));
 }
@@ -16,10 +16,10 @@ QuadMesh::QuadMesh()
 	vertices.push_back(glm::vec3(0.5f, 0.5f, 0)); // top right
 	vertices.push_back(glm::vec3(0.5f, -0.5f, 0)); // bottom right
 
-	textureCoordinates.push_back(glm::vec3(0, 0, 0)); // bottom left
-	textureCoordinates.push_back(glm::vec3(0, 1, 0)); // top left
-	textureCoordinates.push_back(glm::vec3(1, 1, 0)); // top right
-	textureCoordinates.push_back(glm::vec3(1, 0, 0)); // bottom right
+	textureCoordinates.push_back(glm::vec2(0, 0)); // bottom left
+	textureCoordinates.push_back(glm::vec2(0, 1)); // top left
+	textureCoordinates.push_back(glm::vec2(1, 1)); // top right
+	textureCoordinates.push_back(glm::vec2(1, 0)); // bottom right
 
 	colours = std::vector<glm::vec4>(4, glm::vec4(0, 0, 0, 1));
 
@@ -56,3 +56,10 @@ void QuadMesh::setUVbottomRight(float u, float v)
 	textureCoordinates[3].y = v;
 }
 
+void QuadMesh::setUVs(const TTK::AtlasRegion& region)
+{
+	setUVbottomLeft(region.uvMin.x, region.uvMin.y);
+	setUVtopLeft(region.uvMin.x, region.uvMax.y);
+	setUVtopRight(region.uvMax.x, region.uvMax.y);
+	setUVbottomRight(region.uvMax.x, region.uvMin.y);
+}
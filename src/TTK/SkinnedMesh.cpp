@@ -0,0 +1,237 @@
+#include "TTK/SkinnedMesh.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <iostream>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__AVX__)
+#define TTK_USE_AVX
+#include <immintrin.h>
+
+// Every CPU with AVX2 also has FMA, MSVC doesn't have a separate flag for it
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define MADD256(a, b, c) _mm256_fmadd_ps(a, b, c)
+#define MADD128(a, b, c) _mm_fmadd_ps(a, b, c)
+#else
+#define MADD256(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#define MADD128(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+#endif
+#endif
+
+TTK::SkinnedMesh::SkinnedMesh()
+{
+	chunkSize = 4096;
+	numSkinnedVertices = 0;
+	primitiveType = Triangles;
+}
+
+void TTK::SkinnedMesh::createFromMesh(const MeshBase& mesh)
+{
+	vertices = mesh.vertices;
+	normals = mesh.normals;
+	textureCoordinates = mesh.textureCoordinates;
+	colours = mesh.colours;
+	primitiveType = mesh.primitiveType;
+
+	// Remade by createSkinnedVBO(), ie. when the source mesh is hot reloaded
+	vbo.destroy();
+
+	// Until weights are set, everything follows joint 0
+	jointIndices.assign(vertices.size(), glm::u16vec4(0));
+	jointWeights.assign(vertices.size(), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f));
+}
+
+void TTK::SkinnedMesh::createSkinnedVBO()
+{
+	if (jointIndices.size() != vertices.size() || jointWeights.size() != vertices.size())
+	{
+		std::cout << "SkinnedMesh: every vertex needs joint indices and weights!" << std::endl;
+		return;
+	}
+
+	createVBO(true);
+}
+
+void TTK::SkinnedMesh::computeSkinMatrices(const glm::mat4* jointTransforms, unsigned int numJoints, std::vector<SkinMatrix>& matrices) const
+{
+	matrices.resize(numJoints);
+
+	for (unsigned int i = 0; i < numJoints; i++)
+	{
+		glm::mat4 skinMatrix = jointTransforms[i];
+		if (i < inverseBindMatrices.size())
+			skinMatrix = skinMatrix * inverseBindMatrices[i];
+
+		// glm is column major, we want rows
+		for (int row = 0; row < 3; row++)
+		{
+			for (int col = 0; col < 4; col++)
+				matrices[i].rows[row][col] = skinMatrix[col][row];
+		}
+
+		memset(matrices[i].padding, 0, sizeof(matrices[i].padding));
+	}
+}
+
+void TTK::SkinnedMesh::skin(const glm::mat4* jointTransforms, unsigned int numJoints, ThreadPool* pool)
+{
+	PROFILE_SCOPE("skinning");
+
+	numSkinnedVertices = 0;
+
+	if (!vbo.isDynamic() || vertices.empty() || numJoints == 0)
+		return;
+
+	computeSkinMatrices(jointTransforms, numJoints, skinMatrices);
+
+	// Write straight into this frame's region of the VBO, no copies
+	vbo.beginUpdate();
+
+	glm::vec3* outPositions = (glm::vec3*)vbo.getAttributePointer(AttributeLocations::VERTEX);
+	glm::vec3* outNormals = (glm::vec3*)vbo.getAttributePointer(AttributeLocations::NORMAL);
+	void* outUVs = vbo.getAttributePointer(AttributeLocations::TEX_COORD);
+
+	if (!outPositions)
+	{
+		vbo.endUpdate();
+		return;
+	}
+
+	// UVs don't change but every region needs a copy
+	if (outUVs && !textureCoordinates.empty())
+		memcpy(outUVs, &textureCoordinates[0], textureCoordinates.size() * sizeof(glm::vec2));
+
+	const SkinMatrix* matrices = &skinMatrices[0];
+	unsigned int numVertices = (unsigned int)vertices.size();
+
+	if (pool)
+	{
+		pool->parallelFor(numVertices, chunkSize, [&](unsigned int begin, unsigned int end)
+		{
+			skinRange(matrices, begin, end, outPositions + begin, outNormals ? outNormals + begin : nullptr);
+		});
+	}
+	else
+	{
+		skinRange(matrices, 0, numVertices, outPositions, outNormals);
+	}
+
+	vbo.endUpdate();
+
+	numSkinnedVertices = numVertices;
+}
+
+bool TTK::SkinnedMesh::hasSIMD()
+{
+#ifdef TTK_USE_AVX
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TTK::SkinnedMesh::skinRange(const SkinMatrix* matrices, unsigned int begin, unsigned int end,
+	glm::vec3* outPositions, glm::vec3* outNormals, bool useSIMD) const
+{
+	bool hasNormals = outNormals && normals.size() == vertices.size();
+
+	unsigned int i = begin;
+
+#ifdef TTK_USE_AVX
+	if (useSIMD)
+	{
+		for (; i < end; i++)
+		{
+			const glm::u16vec4& joints = jointIndices[i];
+			const glm::vec4& weights = jointWeights[i];
+
+			// Blend the four matrices by the weights
+			// rows 0 and 1 are in one 8 wide register, row 2 in a 4 wide one
+			__m256 rows01 = _mm256_mul_ps(_mm256_set1_ps(weights.x), _mm256_loadu_ps(matrices[joints.x].rows[0]));
+			__m128 row2 = _mm_mul_ps(_mm_set1_ps(weights.x), _mm_loadu_ps(matrices[joints.x].rows[2]));
+
+			rows01 = MADD256(_mm256_set1_ps(weights.y), _mm256_loadu_ps(matrices[joints.y].rows[0]), rows01);
+			row2 = MADD128(_mm_set1_ps(weights.y), _mm_loadu_ps(matrices[joints.y].rows[2]), row2);
+
+			rows01 = MADD256(_mm256_set1_ps(weights.z), _mm256_loadu_ps(matrices[joints.z].rows[0]), rows01);
+			row2 = MADD128(_mm_set1_ps(weights.z), _mm_loadu_ps(matrices[joints.z].rows[2]), row2);
+
+			rows01 = MADD256(_mm256_set1_ps(weights.w), _mm256_loadu_ps(matrices[joints.w].rows[0]), rows01);
+			row2 = MADD128(_mm_set1_ps(weights.w), _mm_loadu_ps(matrices[joints.w].rows[2]), row2);
+
+			// Position is (x, y, z, 1), normal is (x, y, z, 0) so it isn't translated
+			const glm::vec3& p = vertices[i];
+			__m128 position = _mm_set_ps(1.0f, p.z, p.y, p.x);
+			__m128 normal = _mm_setzero_ps();
+			if (hasNormals)
+			{
+				const glm::vec3& n = normals[i];
+				normal = _mm_set_ps(0.0f, n.z, n.y, n.x);
+			}
+
+			// Dot each row with the position and normal
+			// After two horizontal adds: low half = (px, nx, px, nx), high half = (py, ny, py, ny)
+			__m256 position2 = _mm256_insertf128_ps(_mm256_castps128_ps256(position), position, 1);
+			__m256 normal2 = _mm256_insertf128_ps(_mm256_castps128_ps256(normal), normal, 1);
+
+			__m256 sums01 = _mm256_hadd_ps(_mm256_mul_ps(rows01, position2), _mm256_mul_ps(rows01, normal2));
+			sums01 = _mm256_hadd_ps(sums01, sums01);
+
+			// (pz, nz, pz, nz)
+			__m128 sums2 = _mm_hadd_ps(_mm_mul_ps(row2, position), _mm_mul_ps(row2, normal));
+			sums2 = _mm_hadd_ps(sums2, sums2);
+
+			float xs[4], ys[4], zs[4];
+			_mm_storeu_ps(xs, _mm256_castps256_ps128(sums01));
+			_mm_storeu_ps(ys, _mm256_extractf128_ps(sums01, 1));
+			_mm_storeu_ps(zs, sums2);
+
+			glm::vec3& outPosition = outPositions[i - begin];
+			outPosition.x = xs[0];
+			outPosition.y = ys[0];
+			outPosition.z = zs[0];
+
+			if (hasNormals)
+			{
+				glm::vec3& outNormal = outNormals[i - begin];
+				outNormal.x = xs[1];
+				outNormal.y = ys[1];
+				outNormal.z = zs[1];
+			}
+		}
+	}
+#endif
+
+	for (; i < end; i++)
+	{
+		const glm::u16vec4& joints = jointIndices[i];
+		const glm::vec4& weights = jointWeights[i];
+
+		const float* m0 = matrices[joints.x].rows[0];
+		const float* m1 = matrices[joints.y].rows[0];
+		const float* m2 = matrices[joints.z].rows[0];
+		const float* m3 = matrices[joints.w].rows[0];
+
+		// Blend the four matrices by the weights
+		float m[12];
+		for (int e = 0; e < 12; e++)
+			m[e] = weights.x * m0[e] + weights.y * m1[e] + weights.z * m2[e] + weights.w * m3[e];
+
+		const glm::vec3& p = vertices[i];
+		outPositions[i - begin] = glm::vec3(
+			m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+			m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+			m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]);
+
+		// Normals aren't translated, and with no non-uniform scaling the
+		// blended matrix is fine for them too (the shader normalizes them)
+		if (hasNormals)
+		{
+			const glm::vec3& n = normals[i];
+			outNormals[i - begin] = glm::vec3(
+				m[0] * n.x + m[1] * n.y + m[2] * n.z,
+				m[4] * n.x + m[5] * n.y + m[6] * n.z,
+				m[8] * n.x + m[9] * n.y + m[10] * n.z);
+		}
+	}
+}
@@ -1,22 +1,54 @@
 #include "GLEW/glew.h"
 #include "TTK/Texture2D.h"
-#include "IL/ilut.h"
+#include "TTK/IO.h"
+#include "TTK/ImageDecoder.h"
+#include "IL/il.h"
+#include "IL/ilu.h" // for iluErrorString()
+#include <mutex>
+#include <iostream>
+
+// DevIL keeps the "bound" image in global state, so only one thread
+// can use it at a time. It's only used for files ImageDecoder can't do.
+static std::mutex ilMutex;
+
+unsigned int TTK::Texture2D::numTrackedTextures = 0;
+unsigned long long TTK::Texture2D::totalVRAMBytes = 0;
+unsigned long long TTK::Texture2D::totalRGBA8Bytes = 0;
+unsigned long long TTK::Texture2D::totalRGBA8NoMipBytes = 0;
 
 TTK::Texture2D::Texture2D()
 {
 	texWidth = texHeight = 0;
+	texID = 0;
+	resident = true;
+	dataType = GL_UNSIGNED_BYTE;
+	pixelFormat = GL_RGBA;
+	vramBytes = rgba8Bytes = rgba8NoMipBytes = 0;
+	bindlessHandle = 0;
 }
 
 
 TTK::Texture2D::Texture2D(std::string filename)
 {
 	texWidth = texHeight = 0;
+	texID = 0;
+	resident = true;
+	dataType = GL_UNSIGNED_BYTE;
+	pixelFormat = GL_RGBA;
+	vramBytes = rgba8Bytes = rgba8NoMipBytes = 0;
+	bindlessHandle = 0;
 	loadTexture(filename);
 }
 
 TTK::Texture2D::~Texture2D()
 {
-	glDeleteTextures(1, &texID);
+	if (bindlessHandle)
+		glMakeTextureHandleNonResidentARB(bindlessHandle);
+
+	if (texID && resident)
+		glDeleteTextures(1, &texID);
+
+	untrackMemory();
 }
 
 int TTK::Texture2D::width()
@@ -29,12 +61,39 @@ int TTK::Texture2D::height()
 	return texHeight;
 }
 
-void TTK::Texture2D::loadTexture(std::string filename, bool createGLTexture, bool flip)
+bool TTK::Texture2D::decodeImage(const std::string& fileName, bool flip, std::vector<unsigned char>& pixels,
+	unsigned int& outWidth, unsigned int& outHeight)
 {
-	glEnable(GL_TEXTURE_2D);
+	// Read the file before taking the lock, DevIL only has to decode it
+	TTK::IO::FileView file;
+	if (!TTK::IO::openFile(fileName, file))
+		return false;
+
+	return decodeImage(fileName, file.data(), file.size(), flip, pixels, outWidth, outHeight);
+}
+
+bool TTK::Texture2D::decodeImage(const std::string& fileName, const unsigned char* data, size_t size, bool flip,
+	std::vector<unsigned char>& pixels, unsigned int& outWidth, unsigned int& outHeight)
+{
+	// PNGs and JPEGs don't need the lock, each thread has its own decoder (and its scratch memory)
+	// flip puts the top row first, ImageDecoder's default
+	if (TTK::ImageDecoder::getFileType(data, size) != TTK::IMAGE_FILE_UNKNOWN)
+	{
+		static thread_local TTK::ImageDecoder decoder;
+
+		if (decoder.decode(data, size, pixels, outWidth, outHeight, !flip))
+			return true;
 
-	ilGenImages(1, &texID);
-	ilBindImage(texID);
+		// ie. a progressive JPEG, which DevIL can still load
+		printf("Texture Loading Error:\t%s: %s, trying DevIL\n", fileName.c_str(), decoder.getError());
+	}
+
+	std::lock_guard<std::mutex> lock(ilMutex);
+
+	// Note: the IL image gets its own handle, it has nothing to do with the GL texture
+	ILuint imageID;
+	ilGenImages(1, &imageID);
+	ilBindImage(imageID);
 	ilEnable(IL_ORIGIN_SET);
 
 	if (flip)
@@ -42,44 +101,182 @@ void TTK::Texture2D::loadTexture(std::string filename, bool createGLTexture, boo
 	else
 		ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
 
-	ILboolean ret = ilLoadImage(filename.c_str()); // location relative to executable
-	texWidth = ilGetInteger(IL_IMAGE_WIDTH);
-	texHeight = ilGetInteger(IL_IMAGE_HEIGHT);
-	dataType = ilGetInteger(IL_IMAGE_TYPE);
-	pixelFormat = ilGetInteger(IL_IMAGE_FORMAT);
+	// The type comes from the extension, as it would with ilLoadImage
+	ILboolean ret = ilLoadL(ilTypeFromExt(fileName.c_str()), data, (ILuint)size);
 
-	ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
-
-	dataPtr = ilGetData();
-
-	if (createGLTexture)
+	if (ret)
 	{
-		glGenTextures(1, &texID);
-		glBindTexture(GL_TEXTURE_2D, texID);
+		ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texWidth, texHeight, 0, pixelFormat, dataType, dataPtr);
+		outWidth = ilGetInteger(IL_IMAGE_WIDTH);
+		outHeight = ilGetInteger(IL_IMAGE_HEIGHT);
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		// Copy the pixels out of DevIL's memory so we can free the IL image
+		unsigned char* ilData = ilGetData();
+		pixels.assign(ilData, ilData + outWidth * outHeight * 4);
 	}
 
 	ILenum Error;
 	while ((Error = ilGetError()) != IL_NO_ERROR)
 	{
 		printf("Texture Loading Error:\t%d: %s\n", Error, iluErrorString(Error));
-	}	
+	}
+
+	ilDeleteImages(1, &imageID);
+
+	return ret != 0;
 }
 
-void TTK::Texture2D::bind(GLenum textureUnit /* = GL_TEXTURE0 */)
+bool TTK::Texture2D::saveImage(const std::string& fileName, const unsigned char* pixels, unsigned int width, unsigned int height)
+{
+	std::lock_guard<std::mutex> lock(ilMutex);
+
+	ILuint imageID;
+	ilGenImages(1, &imageID);
+	ilBindImage(imageID);
+
+	// decodeImage() changes the origin for flipped images, set it for this one
+	ilEnable(IL_ORIGIN_SET);
+	ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
+	ilEnable(IL_FILE_OVERWRITE);
+
+	ILboolean ret = ilTexImage(width, height, 1, 3, IL_RGB, IL_UNSIGNED_BYTE, (void*)pixels) &&
+		ilSaveImage(fileName.c_str());
+
+	if (!ret)
+		printf("Texture Saving Error:\t%s: %s\n", fileName.c_str(), iluErrorString(ilGetError()));
+
+	ilDeleteImages(1, &imageID);
+
+	return ret != 0;
+}
+
+bool TTK::Texture2D::loadTextureData(const std::string& fileName, bool flip, TextureData& out)
+{
+	// Block compressed files already contain their mip levels
+	if (TextureFormats::isCompressedFile(fileName))
+		return TextureFormats::loadCompressed(fileName, out);
+
+	unsigned int width, height;
+	if (!decodeImage(fileName, flip, out.data, width, height))
+		return false;
+
+	out.internalFormat = GL_RGBA8;
+	out.compressed = false;
+	out.blockSize = 0;
+
+	TextureFormats::generateMipChain(out.data, width, height, out.levels);
+
+	return true;
+}
+
+void TTK::Texture2D::loadTexture(std::string filename, bool createGLTexture, bool flip)
+{
+	glEnable(GL_TEXTURE_2D);
+
+	// decodeImage always converts to RGBA8
+	dataType = GL_UNSIGNED_BYTE;
+	pixelFormat = GL_RGBA;
+
+	if (!createGLTexture)
+	{
+		decodeImage(filename, flip, pixelData, texWidth, texHeight);
+		return;
+	}
+
+	TextureData texData;
+	if (!loadTextureData(filename, flip, texData))
+		return;
+
+	createFromTextureData(texData);
+}
+
+void TTK::Texture2D::createFromTextureData(TextureData& data)
+{
+	if (bindlessHandle)
+	{
+		glMakeTextureHandleNonResidentARB(bindlessHandle);
+		bindlessHandle = 0;
+	}
+
+	if (texID && resident)
+		glDeleteTextures(1, &texID);
+
+	untrackMemory();
+
+	texWidth = data.levels[0].width;
+	texHeight = data.levels[0].height;
+
+	glGenTextures(1, &texID);
+	glBindTexture(GL_TEXTURE_2D, texID);
+
+	// Trilinear filtering, blends between the two closest mip levels
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.levels.size() - 1);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	for (unsigned int i = 0; i < data.levels.size(); i++)
+	{
+		MipLevel& level = data.levels[i];
+
+		if (data.compressed)
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, data.internalFormat, level.width, level.height, 0, level.size, &data.data[level.offset]);
+		else
+			glTexImage2D(GL_TEXTURE_2D, i, data.internalFormat, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &data.data[level.offset]);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	resident = true;
+	trackMemory(data);
+}
+
+void TTK::Texture2D::trackMemory(TextureData& data)
+{
+	vramBytes = data.totalSize();
+
+	// An RGBA8 mip chain is 4/3 the size of the top level
+	rgba8NoMipBytes = data.levels[0].width * data.levels[0].height * 4;
+	rgba8Bytes = rgba8NoMipBytes + rgba8NoMipBytes / 3;
+
+	numTrackedTextures++;
+	totalVRAMBytes += vramBytes;
+	totalRGBA8Bytes += rgba8Bytes;
+	totalRGBA8NoMipBytes += rgba8NoMipBytes;
+}
+
+void TTK::Texture2D::untrackMemory()
+{
+	if (vramBytes == 0)
+		return;
+
+	numTrackedTextures--;
+	totalVRAMBytes -= vramBytes;
+	totalRGBA8Bytes -= rgba8Bytes;
+	totalRGBA8NoMipBytes -= rgba8NoMipBytes;
+	vramBytes = rgba8Bytes = rgba8NoMipBytes = 0;
+}
+
+void TTK::Texture2D::printMemoryReport()
 {
-/*	glEnable(GL_TEXTURE_2D);*/
+	const double MB = 1024.0 * 1024.0;
+
+	std::cout << "---- Texture Memory ----" << std::endl;
+	std::cout << "Textures:                 " << numTrackedTextures << std::endl;
+	std::cout << "VRAM used:                " << totalVRAMBytes / MB << " MB" << std::endl;
+	std::cout << "As RGBA8, no mipmaps:     " << totalRGBA8NoMipBytes / MB << " MB" << std::endl;
+	std::cout << "As RGBA8 with mipmaps:    " << totalRGBA8Bytes / MB << " MB" << std::endl;
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	if (totalRGBA8Bytes > totalVRAMBytes)
+		std::cout << "Saved by compression:     " << (totalRGBA8Bytes - totalVRAMBytes) / MB << " MB" << std::endl;
+}
 
+void TTK::Texture2D::bind(GLenum textureUnit /* = GL_TEXTURE0 */)
+{
 	glActiveTexture(textureUnit);
 	glBindTexture(GL_TEXTURE_2D, texID);
 }
@@ -88,7 +285,21 @@ void TTK::Texture2D::unbind(GLenum textureUnit /* = GL_TEXTURE0 */)
 {
 	glActiveTexture(textureUnit);
 	glBindTexture(GL_TEXTURE_2D, 0);
-	glDisable(GL_BLEND);
+}
+
+GLuint64 TTK::Texture2D::getBindlessHandle()
+{
+	if (!GLEW_ARB_bindless_texture || !resident || texID == 0)
+		return 0;
+
+	if (bindlessHandle == 0)
+	{
+		// Note: once a handle is created the texture's parameters can't be changed
+		bindlessHandle = glGetTextureHandleARB(texID);
+		glMakeTextureHandleResidentARB(bindlessHandle);
+	}
+
+	return bindlessHandle;
 }
 
 unsigned int TTK::Texture2D::id()
@@ -98,7 +309,10 @@ unsigned int TTK::Texture2D::id()
 
 unsigned char* TTK::Texture2D::data()
 {
-	return dataPtr;
+	if (pixelData.empty())
+		return nullptr;
+
+	return &pixelData[0];
 }
 
 int TTK::Texture2D::type()
@@ -110,3 +324,8 @@ int TTK::Texture2D::format()
 {
 	return pixelFormat; 
 }
+
+bool TTK::Texture2D::isResident()
+{
+	return resident;
+}
@@ -0,0 +1,180 @@
+#include "TTK/TextureArray.h"
+#include "TTK/Texture2D.h"
+#include <iostream>
+#include <vector>
+
+TTK::TextureArray::TextureArray()
+{
+	texID = 0;
+	layerWidth = layerHeight = 0;
+	numLayers = maxLayers = 0;
+	numLevels = 0;
+	bindlessHandle = 0;
+}
+
+TTK::TextureArray::~TextureArray()
+{
+	destroy();
+}
+
+void TTK::TextureArray::create(unsigned int width, unsigned int height, unsigned int _maxLayers)
+{
+	destroy();
+
+	layerWidth = width;
+	layerHeight = height;
+	maxLayers = _maxLayers;
+	numLayers = 0;
+
+	// Number of mip levels down to 1x1
+	numLevels = 1;
+	unsigned int size = width > height ? width : height;
+	while (size > 1)
+	{
+		size /= 2;
+		numLevels++;
+	}
+
+	glGenTextures(1, &texID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+
+	// Allocate every level for every layer, the layers are filled in later
+	unsigned int w = width, h = height;
+	for (unsigned int i = 0; i < numLevels; i++)
+	{
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8, w, h, maxLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+int TTK::TextureArray::addLayer(const std::string& fileName, bool flip)
+{
+	std::vector<unsigned char> pixels;
+	unsigned int width, height;
+
+	if (!Texture2D::decodeImage(fileName, flip, pixels, width, height))
+		return -1;
+
+	return addLayer(pixels, width, height);
+}
+
+int TTK::TextureArray::addLayer(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height)
+{
+	int layer = reserveLayer();
+	if (layer < 0)
+		return -1;
+
+	std::vector<unsigned char> layerPixels;
+	std::vector<MipLevel> levels;
+	prepareLayer(pixels, width, height, layerPixels, levels);
+	uploadLayer(layer, layerPixels, levels);
+
+	return layer;
+}
+
+int TTK::TextureArray::reserveLayer()
+{
+	if (texID == 0 || numLayers >= maxLayers)
+	{
+		std::cout << "TextureArray: no free layers" << std::endl;
+		return -1;
+	}
+
+	return numLayers++;
+}
+
+void TTK::TextureArray::prepareLayer(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height,
+	std::vector<unsigned char>& outPixels, std::vector<MipLevel>& outLevels) const
+{
+	// Every layer has to be the same size
+	if (width != layerWidth || height != layerHeight)
+		TextureFormats::resizeImage(pixels, width, height, outPixels, layerWidth, layerHeight);
+	else
+		outPixels = pixels;
+
+	TextureFormats::generateMipChain(outPixels, layerWidth, layerHeight, outLevels);
+}
+
+void TTK::TextureArray::uploadLayer(int layer, const std::vector<unsigned char>& pixels, const std::vector<MipLevel>& levels)
+{
+	if (texID == 0 || layer < 0 || layer >= (int)numLayers)
+		return;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	for (unsigned int i = 0; i < levels.size() && i < numLevels; i++)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, levels[i].width, levels[i].height, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, &pixels[levels[i].offset]);
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TTK::TextureArray::bind(GLenum textureUnit)
+{
+	glActiveTexture(textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+}
+
+void TTK::TextureArray::unbind(GLenum textureUnit)
+{
+	glActiveTexture(textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLuint64 TTK::TextureArray::getBindlessHandle()
+{
+	if (!GLEW_ARB_bindless_texture || texID == 0)
+		return 0;
+
+	if (bindlessHandle == 0)
+	{
+		bindlessHandle = glGetTextureHandleARB(texID);
+		glMakeTextureHandleResidentARB(bindlessHandle);
+	}
+
+	return bindlessHandle;
+}
+
+unsigned int TTK::TextureArray::id()
+{
+	return texID;
+}
+
+unsigned int TTK::TextureArray::getNumLayers()
+{
+	return numLayers;
+}
+
+unsigned int TTK::TextureArray::getMaxLayers()
+{
+	return maxLayers;
+}
+
+void TTK::TextureArray::destroy()
+{
+	if (bindlessHandle)
+	{
+		glMakeTextureHandleNonResidentARB(bindlessHandle);
+		bindlessHandle = 0;
+	}
+
+	if (texID)
+	{
+		glDeleteTextures(1, &texID);
+		texID = 0;
+	}
+
+	numLayers = 0;
+}
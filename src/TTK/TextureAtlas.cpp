@@ -0,0 +1,338 @@
+#include "TTK/TextureAtlas.h"
+#include "TTK/Texture2D.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+TTK::AtlasPacker::AtlasPacker()
+{
+	binWidth = binHeight = 0;
+	usedArea = 0;
+}
+
+void TTK::AtlasPacker::reset(unsigned int width, unsigned int height)
+{
+	binWidth = width;
+	binHeight = height;
+	usedArea = 0;
+
+	// One flat node along the bottom
+	SkylineNode node = { 0, 0, width };
+	skyline.assign(1, node);
+}
+
+bool TTK::AtlasPacker::fitAt(unsigned int index, unsigned int width, unsigned int height, unsigned int& outY) const
+{
+	if (skyline[index].x + width > binWidth)
+		return false;
+
+	// The rectangle rests on the highest node under it
+	unsigned int y = 0;
+	unsigned int widthLeft = width;
+
+	for (unsigned int i = index; widthLeft > 0; i++)
+	{
+		y = std::max(y, skyline[i].y);
+		if (y + height > binHeight)
+			return false;
+
+		if (skyline[i].width >= widthLeft)
+			break;
+		widthLeft -= skyline[i].width;
+	}
+
+	outY = y;
+	return true;
+}
+
+bool TTK::AtlasPacker::pack(unsigned int width, unsigned int height, unsigned int& outX, unsigned int& outY)
+{
+	outX = outY = 0;
+	if (width == 0 || height == 0)
+		return true;
+
+	// Lowest top wins, the nodes go left to right so ties go to the leftmost
+	int bestIndex = -1;
+	unsigned int bestTop = 0, bestY = 0;
+
+	for (unsigned int i = 0; i < skyline.size(); i++)
+	{
+		unsigned int y;
+		if (fitAt(i, width, height, y) && (bestIndex < 0 || y + height < bestTop))
+		{
+			bestIndex = i;
+			bestTop = y + height;
+			bestY = y;
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	outX = skyline[bestIndex].x;
+	outY = bestY;
+
+	// The rectangle's top becomes part of the skyline...
+	SkylineNode node = { outX, bestTop, width };
+	skyline.insert(skyline.begin() + bestIndex, node);
+
+	// ...hiding the nodes (or the parts of them) it covers
+	unsigned int right = outX + width;
+	for (unsigned int i = bestIndex + 1; i < skyline.size();)
+	{
+		if (skyline[i].x >= right)
+			break;
+
+		unsigned int covered = right - skyline[i].x;
+		if (skyline[i].width <= covered)
+		{
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+
+		skyline[i].x += covered;
+		skyline[i].width -= covered;
+		break;
+	}
+
+	// Neighbours at the same height are one node
+	for (unsigned int i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	usedArea += (unsigned long long)width * height;
+	return true;
+}
+
+unsigned int TTK::AtlasPacker::getUsedHeight() const
+{
+	unsigned int height = 0;
+	for (unsigned int i = 0; i < skyline.size(); i++)
+		height = std::max(height, skyline[i].y);
+	return height;
+}
+
+float TTK::AtlasPacker::getOccupancy() const
+{
+	if (binWidth == 0 || binHeight == 0)
+		return 0.0f;
+
+	return (float)((double)usedArea / ((double)binWidth * binHeight));
+}
+
+TTK::TextureAtlas::TextureAtlas()
+{
+	texID = 0;
+	atlasWidth = atlasHeight = 0;
+	occupancy = 0.0f;
+}
+
+TTK::TextureAtlas::~TextureAtlas()
+{
+	destroy();
+}
+
+int TTK::TextureAtlas::addImage(const std::string& fileName, bool flip)
+{
+	Image image;
+	if (!Texture2D::decodeImage(fileName, flip, image.pixels, image.width, image.height))
+	{
+		std::cout << "TextureAtlas: couldn't load " << fileName << std::endl;
+		return -1;
+	}
+
+	images.push_back(image);
+	regions.push_back(AtlasRegion());
+	return (int)images.size() - 1;
+}
+
+int TTK::TextureAtlas::addImage(const std::vector<unsigned char>& pixels, unsigned int width, unsigned int height)
+{
+	if (pixels.size() < (size_t)width * height * 4)
+		return -1;
+
+	Image image;
+	image.pixels = pixels;
+	image.width = width;
+	image.height = height;
+
+	images.push_back(image);
+	regions.push_back(AtlasRegion());
+	return (int)images.size() - 1;
+}
+
+static unsigned int nextPowerOfTwo(unsigned int value)
+{
+	unsigned int power = 1;
+	while (power < value)
+		power *= 2;
+	return power;
+}
+
+bool TTK::TextureAtlas::build(unsigned int maxSize, unsigned int padding)
+{
+	if (images.empty())
+		return true;
+
+	// Tallest first, then widest
+	std::vector<unsigned int> order(images.size());
+	unsigned long long totalArea = 0;
+	unsigned int tallest = 0, widest = 0;
+
+	for (unsigned int i = 0; i < images.size(); i++)
+	{
+		order[i] = i;
+
+		unsigned int paddedWidth = images[i].width + padding * 2;
+		unsigned int paddedHeight = images[i].height + padding * 2;
+		totalArea += (unsigned long long)paddedWidth * paddedHeight;
+		tallest = std::max(tallest, paddedHeight);
+		widest = std::max(widest, paddedWidth);
+	}
+
+	std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+	{
+		if (images[a].height != images[b].height)
+			return images[a].height > images[b].height;
+		return images[a].width > images[b].width;
+	});
+
+	// The width starts at about the smallest that could fit (a power of two), and the images are
+	// packed as high as they need. Then the atlas is cut down to the height they used.
+	unsigned int width = std::max(nextPowerOfTwo((unsigned int)std::ceil(std::sqrt((double)totalArea))), nextPowerOfTwo(widest));
+
+	AtlasPacker packer;
+	std::vector<unsigned int> packedX(images.size()), packedY(images.size());
+
+	while (true)
+	{
+		if (width > maxSize || tallest > maxSize)
+		{
+			std::cout << "TextureAtlas: " << images.size() << " images don't fit in " << maxSize << "x" << maxSize << std::endl;
+			return false;
+		}
+
+		packer.reset(width, maxSize);
+
+		bool packedAll = true;
+		for (unsigned int i = 0; i < order.size() && packedAll; i++)
+		{
+			const Image& image = images[order[i]];
+			packedAll = packer.pack(image.width + padding * 2, image.height + padding * 2, packedX[order[i]], packedY[order[i]]);
+		}
+
+		if (packedAll)
+			break;
+
+		width *= 2;
+	}
+
+	// Rows a multiple of 4 high, like block compressed textures need
+	unsigned int height = (packer.getUsedHeight() + 3) & ~3u;
+
+	atlasWidth = width;
+	atlasHeight = height;
+	pixels.assign((size_t)atlasWidth * atlasHeight * 4, 0);
+
+	unsigned long long imageArea = 0;
+	for (unsigned int i = 0; i < images.size(); i++)
+	{
+		AtlasRegion& region = regions[i];
+		region.x = packedX[i] + padding;
+		region.y = packedY[i] + padding;
+		region.width = images[i].width;
+		region.height = images[i].height;
+		region.uvMin = glm::vec2((float)region.x / atlasWidth, (float)region.y / atlasHeight);
+		region.uvMax = glm::vec2((float)(region.x + region.width) / atlasWidth, (float)(region.y + region.height) / atlasHeight);
+
+		copyImage(images[i], region, padding);
+		imageArea += (unsigned long long)region.width * region.height;
+	}
+
+	occupancy = (float)((double)imageArea / ((double)atlasWidth * atlasHeight));
+	return true;
+}
+
+void TTK::TextureAtlas::copyImage(const Image& image, const AtlasRegion& region, unsigned int padding)
+{
+	if (image.width == 0 || image.height == 0)
+		return;
+
+	size_t rowBytes = (size_t)image.width * 4;
+
+	// Rows from padding below the image to padding above it, the padding repeats the edge rows
+	for (int y = -(int)padding; y < (int)(image.height + padding); y++)
+	{
+		unsigned int srcY = (unsigned int)std::min(std::max(y, 0), (int)image.height - 1);
+		const unsigned char* src = &image.pixels[srcY * rowBytes];
+		unsigned char* dst = &pixels[((size_t)(region.y + y) * atlasWidth + region.x) * 4];
+
+		memcpy(dst, src, rowBytes);
+
+		// And the edge columns
+		for (unsigned int x = 1; x <= padding; x++)
+		{
+			memcpy(dst - x * 4, src, 4);
+			memcpy(dst + rowBytes + (x - 1) * 4, src + rowBytes - 4, 4);
+		}
+	}
+}
+
+void TTK::TextureAtlas::upload(bool keepPixels)
+{
+	if (pixels.empty())
+		return;
+
+	if (!texID)
+		glGenTextures(1, &texID);
+
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// No mipmaps, smaller levels would blend neighbouring images together (sprites are
+	// mostly drawn about their own size anyway)
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (!keepPixels)
+		pixels = std::vector<unsigned char>();
+}
+
+void TTK::TextureAtlas::bind(GLenum textureUnit)
+{
+	glActiveTexture(textureUnit);
+	glBindTexture(GL_TEXTURE_2D, texID);
+}
+
+void TTK::TextureAtlas::unbind(GLenum textureUnit)
+{
+	glActiveTexture(textureUnit);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TTK::TextureAtlas::destroy()
+{
+	if (texID)
+	{
+		glDeleteTextures(1, &texID);
+		texID = 0;
+	}
+
+	pixels = std::vector<unsigned char>();
+}
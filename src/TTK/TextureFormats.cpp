@@ -0,0 +1,415 @@
+#include "TTK/TextureFormats.h"
+#include "TTK/IO.h"
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTK_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+unsigned int TTK::TextureData::totalSize()
+{
+	unsigned int size = 0;
+	for (unsigned int i = 0; i < levels.size(); i++)
+		size += levels[i].size;
+	return size;
+}
+
+// Averages a 2x2 block of pixels for every pixel in the destination level
+// Odd sized levels clamp to the last row / column
+static void downsampleBox(const unsigned char* src, unsigned int srcWidth, unsigned int srcHeight,
+	unsigned char* dst, unsigned int dstWidth, unsigned int dstHeight)
+{
+	for (unsigned int y = 0; y < dstHeight; y++)
+	{
+		unsigned int y0 = y * 2;
+		unsigned int y1 = (y0 + 1 < srcHeight) ? y0 + 1 : y0;
+
+		const unsigned char* row0 = src + y0 * srcWidth * 4;
+		const unsigned char* row1 = src + y1 * srcWidth * 4;
+		unsigned char* out = dst + y * dstWidth * 4;
+
+		unsigned int x = 0;
+
+#ifdef TTK_USE_SSE2
+		// 4 destination pixels (8 source pixels from each row) per iteration
+		// Only valid when both source pixels of each pair exist
+		// Summed in 16 bits and rounded once, same as the loop below (averaging twice with
+		// _mm_avg_epu8 rounds up twice, and every level would come out a little brighter)
+		if ((srcWidth & 1) == 0)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16(2);
+
+			for (; x + 4 <= dstWidth; x += 4)
+			{
+				__m128i half[2];
+
+				for (int i = 0; i < 2; i++)
+				{
+					__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + i * 16));
+					__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + i * 16));
+
+					// Both rows added, pixels 0 and 1 in the first, 2 and 3 in the second
+					__m128i rows01 = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+					__m128i rows23 = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+					// Even pixels plus odd pixels, the 4 source pixels of 2 destination pixels
+					__m128i even = _mm_unpacklo_epi64(rows01, rows23);
+					__m128i odd = _mm_unpackhi_epi64(rows01, rows23);
+					__m128i sum = _mm_add_epi16(even, odd);
+
+					half[i] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				}
+
+				_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(half[0], half[1]));
+			}
+		}
+#endif
+
+		for (; x < dstWidth; x++)
+		{
+			unsigned int x0 = x * 2;
+			unsigned int x1 = (x0 + 1 < srcWidth) ? x0 + 1 : x0;
+
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				unsigned int sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+				out[x * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void TTK::TextureFormats::generateMipChain(std::vector<unsigned char>& pixels, unsigned int width, unsigned int height,
+	std::vector<MipLevel>& levels)
+{
+	levels.clear();
+
+	MipLevel level;
+	level.width = width;
+	level.height = height;
+	level.offset = 0;
+	level.size = width * height * 4;
+	levels.push_back(level);
+
+	// Work out the total size first so the buffer is only resized once
+	unsigned int totalSize = level.size;
+	unsigned int w = width, h = height;
+	while (w > 1 || h > 1)
+	{
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+		totalSize += w * h * 4;
+	}
+
+	pixels.resize(totalSize);
+
+	while (level.width > 1 || level.height > 1)
+	{
+		MipLevel next;
+		next.width = level.width > 1 ? level.width / 2 : 1;
+		next.height = level.height > 1 ? level.height / 2 : 1;
+		next.offset = level.offset + level.size;
+		next.size = next.width * next.height * 4;
+
+		downsampleBox(&pixels[level.offset], level.width, level.height, &pixels[next.offset], next.width, next.height);
+
+		levels.push_back(next);
+		level = next;
+	}
+}
+
+void TTK::TextureFormats::resizeImage(const std::vector<unsigned char>& src, unsigned int srcWidth, unsigned int srcHeight,
+	std::vector<unsigned char>& dst, unsigned int dstWidth, unsigned int dstHeight)
+{
+	dst.resize(dstWidth * dstHeight * 4);
+
+	float scaleX = (float)srcWidth / dstWidth;
+	float scaleY = (float)srcHeight / dstHeight;
+
+	for (unsigned int y = 0; y < dstHeight; y++)
+	{
+		// Sample at the centre of the destination pixel
+		float sy = (y + 0.5f) * scaleY - 0.5f;
+		if (sy < 0.0f) sy = 0.0f;
+		unsigned int y0 = (unsigned int)sy;
+		unsigned int y1 = (y0 + 1 < srcHeight) ? y0 + 1 : y0;
+		float fy = sy - y0;
+
+		for (unsigned int x = 0; x < dstWidth; x++)
+		{
+			float sx = (x + 0.5f) * scaleX - 0.5f;
+			if (sx < 0.0f) sx = 0.0f;
+			unsigned int x0 = (unsigned int)sx;
+			unsigned int x1 = (x0 + 1 < srcWidth) ? x0 + 1 : x0;
+			float fx = sx - x0;
+
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				float top = src[(y0 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[(y0 * srcWidth + x1) * 4 + c] * fx;
+				float bottom = src[(y1 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[(y1 * srcWidth + x1) * 4 + c] * fx;
+				dst[(y * dstWidth + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+			}
+		}
+	}
+}
+
+uint64_t TTK::TextureFormats::compressedLevelSize(unsigned int width, unsigned int height, unsigned int blockSize)
+{
+	uint64_t blocksWide = ((uint64_t)width + 3) / 4;
+	uint64_t blocksHigh = ((uint64_t)height + 3) / 4;
+	uint64_t numBlocks = (blocksWide > 0 ? blocksWide : 1) * (blocksHigh > 0 ? blocksHigh : 1);
+
+	// Up to 2^60 blocks, which would still wrap past 64 bits for 16 byte blocks
+	if (blockSize > 0 && numBlocks > UINT64_MAX / blockSize)
+		return UINT64_MAX;
+
+	return numBlocks * blockSize;
+}
+
+// Fills out the level table of a compressed texture
+// Returns false if the file is too small for the levels it says it has
+static bool buildCompressedLevels(TTK::TextureData& out, unsigned int width, unsigned int height,
+	unsigned int numLevels, size_t dataSize)
+{
+	size_t offset = 0;
+
+	for (unsigned int i = 0; i < numLevels; i++)
+	{
+		// Compared with what's left rather than added to offset, so it can't wrap around
+		uint64_t size = TTK::TextureFormats::compressedLevelSize(width, height, out.blockSize);
+		if (size > dataSize - offset)
+			return false;
+
+		TTK::MipLevel level;
+		level.width = width;
+		level.height = height;
+		level.offset = (unsigned int)offset;
+		level.size = (unsigned int)size;
+
+		out.levels.push_back(level);
+		offset += level.size;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return true;
+}
+
+static uint32_t readU32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#define MAKE_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+bool TTK::TextureFormats::loadDDS(const std::string& fileName, TextureData& out)
+{
+	TTK::IO::FileView file;
+	if (!TTK::IO::openFile(fileName, file))
+		return false;
+
+	// "DDS " + 124 byte header
+	if (file.size() < 128 || readU32(&file[0]) != MAKE_FOURCC('D', 'D', 'S', ' '))
+	{
+		std::cout << "DDS Error: not a DDS file: " << fileName << std::endl;
+		return false;
+	}
+
+	const unsigned char* header = &file[4];
+	unsigned int height = readU32(header + 8);
+	unsigned int width = readU32(header + 12);
+	unsigned int numLevels = readU32(header + 24);
+	uint32_t fourCC = readU32(header + 80);	// ddspf.dwFourCC
+
+	if (numLevels == 0)
+		numLevels = 1;
+
+	unsigned int dataOffset = 128;
+
+	if (fourCC == MAKE_FOURCC('D', 'X', 'T', '1'))
+	{
+		out.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		out.blockSize = 8;
+	}
+	else if (fourCC == MAKE_FOURCC('D', 'X', 'T', '5'))
+	{
+		out.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		out.blockSize = 16;
+	}
+	else if (fourCC == MAKE_FOURCC('D', 'X', '1', '0'))
+	{
+		// Extended header, the format is a DXGI_FORMAT
+		if (file.size() < 148)
+			return false;
+
+		uint32_t dxgiFormat = readU32(&file[128]);
+		dataOffset = 148;
+
+		switch (dxgiFormat)
+		{
+		case 71: // DXGI_FORMAT_BC1_UNORM
+			out.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			out.blockSize = 8;
+			break;
+		case 77: // DXGI_FORMAT_BC3_UNORM
+			out.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			out.blockSize = 16;
+			break;
+		case 98: // DXGI_FORMAT_BC7_UNORM
+			out.internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+			out.blockSize = 16;
+			break;
+		case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+			out.internalFormat = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+			out.blockSize = 16;
+			break;
+		default:
+			std::cout << "DDS Error: unsupported DXGI format " << dxgiFormat << ": " << fileName << std::endl;
+			return false;
+		}
+	}
+	else
+	{
+		std::cout << "DDS Error: only BC1, BC3 and BC7 are supported: " << fileName << std::endl;
+		return false;
+	}
+
+	out.compressed = true;
+	out.data.assign(file.begin() + dataOffset, file.end());
+	out.levels.clear();
+
+	if (!buildCompressedLevels(out, width, height, numLevels, out.data.size()))
+	{
+		std::cout << "DDS Error: file is truncated: " << fileName << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool TTK::TextureFormats::loadKTX(const std::string& fileName, TextureData& out)
+{
+	static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	TTK::IO::FileView file;
+	if (!TTK::IO::openFile(fileName, file))
+		return false;
+
+	// 12 byte identifier + 13 uint32 fields
+	if (file.size() < 64 || memcmp(&file[0], identifier, 12) != 0)
+	{
+		std::cout << "KTX Error: not a KTX file: " << fileName << std::endl;
+		return false;
+	}
+
+	// We only read little endian files
+	if (readU32(&file[12]) != 0x04030201)
+	{
+		std::cout << "KTX Error: big endian files are not supported: " << fileName << std::endl;
+		return false;
+	}
+
+	GLenum internalFormat = readU32(&file[28]);
+	unsigned int width = readU32(&file[36]);
+	unsigned int height = readU32(&file[40]);
+	unsigned int numLevels = readU32(&file[56]);
+	unsigned int keyValueBytes = readU32(&file[60]);
+
+	if (numLevels == 0)
+		numLevels = 1;
+
+	switch (internalFormat)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		out.blockSize = 8;
+		break;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+		out.blockSize = 16;
+		break;
+	default:
+		std::cout << "KTX Error: only BC1, BC3 and BC7 are supported: " << fileName << std::endl;
+		return false;
+	}
+
+	out.internalFormat = internalFormat;
+	out.compressed = true;
+	out.data.clear();
+	out.levels.clear();
+
+	// Each level is stored as a uint32 size followed by the data (padded to 4 bytes)
+	// Sizes from the file are compared with what's left of it, never added to an offset first,
+	// so a huge size can't wrap around and pass
+	size_t offset = 64 + (size_t)keyValueBytes;
+
+	for (unsigned int i = 0; i < numLevels; i++)
+	{
+		if (offset > file.size() || file.size() - offset < 4)
+		{
+			std::cout << "KTX Error: file is truncated: " << fileName << std::endl;
+			return false;
+		}
+
+		uint32_t imageSize = readU32(&file[offset]);
+		offset += 4;
+
+		if (imageSize > file.size() - offset)
+		{
+			std::cout << "KTX Error: file is truncated: " << fileName << std::endl;
+			return false;
+		}
+
+		// glCompressedTexImage2D reads exactly this much, whatever the file says
+		if (imageSize != compressedLevelSize(width, height, out.blockSize))
+		{
+			std::cout << "KTX Error: level " << i << " is the wrong size for " << width << "x" << height << ": " << fileName << std::endl;
+			return false;
+		}
+
+		MipLevel level;
+		level.width = width;
+		level.height = height;
+		level.offset = out.data.size();
+		level.size = imageSize;
+		out.levels.push_back(level);
+
+		out.data.insert(out.data.end(), file.begin() + offset, file.begin() + offset + imageSize);
+		offset += ((size_t)imageSize + 3) & ~(size_t)3;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return true;
+}
+
+bool TTK::TextureFormats::isCompressedFile(const std::string& fileName)
+{
+	if (fileName.size() < 4)
+		return false;
+
+	std::string ext = fileName.substr(fileName.size() - 4);
+	for (unsigned int i = 0; i < ext.size(); i++)
+		ext[i] = tolower(ext[i]);
+
+	return ext == ".dds" || ext == ".ktx";
+}
+
+bool TTK::TextureFormats::loadCompressed(const std::string& fileName, TextureData& out)
+{
+	std::string ext = fileName.substr(fileName.size() - 4);
+	for (unsigned int i = 0; i < ext.size(); i++)
+		ext[i] = tolower(ext[i]);
+
+	if (ext == ".ktx")
+		return loadKTX(fileName, out);
+
+	return loadDDS(fileName, out);
+}
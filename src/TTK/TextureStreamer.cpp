@@ -0,0 +1,412 @@
+#include "TTK/TextureStreamer.h"
+#include "Profiler.h"
+#include <iostream>
+#include <cstring>
+
+TTK::TextureStreamer::TextureStreamer()
+{
+	uploadBudgetBytes = 2 * 1024 * 1024;
+	stopWorkers = false;
+	numPending = 0;
+	pboSize = 0;
+	nextPBO = 0;
+	placeholderTexture = 0;
+}
+
+TTK::TextureStreamer::~TextureStreamer()
+{
+	shutdown();
+}
+
+void TTK::TextureStreamer::init(unsigned int numWorkers, unsigned int numPBOs, unsigned int pboSizeBytes)
+{
+	// Placeholder is a single white pixel, so untextured objects still look lit
+	unsigned char white[4] = { 255, 255, 255, 255 };
+	glGenTextures(1, &placeholderTexture);
+	glBindTexture(GL_TEXTURE_2D, placeholderTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// PBO ring
+	// While the GPU copies out of one PBO we can fill the next one
+	pboSize = pboSizeBytes;
+	pbos.resize(numPBOs);
+	pboFences.resize(numPBOs, 0);
+	glGenBuffers(numPBOs, &pbos[0]);
+
+	for (unsigned int i = 0; i < numPBOs; i++)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, pboSize, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	stopWorkers = false;
+	for (unsigned int i = 0; i < numWorkers; i++)
+		workers.push_back(std::thread(&TextureStreamer::workerLoop, this));
+}
+
+void TTK::TextureStreamer::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopWorkers = true;
+	}
+	queueCondition.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	decodeQueue.clear();
+	uploadQueue.clear();
+
+	// Textures that never finished keep pointing at the placeholder,
+	// they don't own it so it is safe to delete here
+	for (unsigned int i = 0; i < uploading.size(); i++)
+	{
+		if (uploading[i]->glTexture)
+			glDeleteTextures(1, &uploading[i]->glTexture);
+	}
+	uploading.clear();
+
+	for (unsigned int i = 0; i < pboFences.size(); i++)
+	{
+		if (pboFences[i])
+			glDeleteSync(pboFences[i]);
+	}
+	pboFences.clear();
+
+	if (!pbos.empty())
+	{
+		glDeleteBuffers(pbos.size(), &pbos[0]);
+		pbos.clear();
+	}
+
+	if (placeholderTexture)
+	{
+		glDeleteTextures(1, &placeholderTexture);
+		placeholderTexture = 0;
+	}
+}
+
+std::shared_ptr<TTK::Texture2D> TTK::TextureStreamer::loadTextureAsync(const std::string& fileName, bool flip)
+{
+	std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>();
+	texture->texID = placeholderTexture;
+	texture->resident = false;
+
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->texture = texture;
+	request->fileName = fileName;
+	request->flip = flip;
+	request->textures = nullptr;
+	request->layer = -1;
+	request->decoded = false;
+	request->glTexture = 0;
+	request->currentLevel = 0;
+	request->rowsUploaded = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		decodeQueue.push_back(request);
+		numPending++;
+	}
+	queueCondition.notify_one();
+
+	return texture;
+}
+
+void TTK::TextureStreamer::uploadLayerAsync(TextureArray& textures, int layer, std::vector<unsigned char>& pixels,
+	std::vector<MipLevel>& levels, std::function<void()> onUploaded)
+{
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->flip = false;
+	request->textures = &textures;
+	request->layer = layer;
+	request->onUploaded = onUploaded;
+	request->texData.data.swap(pixels);
+	request->texData.levels.swap(levels);
+	request->decoded = true;
+	request->glTexture = 0;
+	request->currentLevel = 0;
+	request->rowsUploaded = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		numPending++;
+	}
+
+	// Already decoded, it goes straight to the upload queue
+	uploading.push_back(request);
+}
+
+unsigned int TTK::TextureStreamer::getNumPending()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return numPending;
+}
+
+void TTK::TextureStreamer::workerLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<Request> request;
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return stopWorkers || !decodeQueue.empty(); });
+
+			if (stopWorkers)
+				return;
+
+			request = decodeQueue.front();
+			decodeQueue.pop_front();
+		}
+
+		// Decoding and building the mip chain both happen here, off the GL thread
+		PROFILE_SCOPE("decode texture");
+		request->texData.data = acquireStagingBuffer();
+		request->decoded = Texture2D::loadTextureData(request->fileName, request->flip, request->texData);
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		uploadQueue.push_back(request);
+	}
+}
+
+void TTK::TextureStreamer::update()
+{
+	PROFILE_SCOPE("texture upload");
+
+	// Grab everything the workers finished since last frame
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		while (!uploadQueue.empty())
+		{
+			uploading.push_back(uploadQueue.front());
+			uploadQueue.pop_front();
+		}
+	}
+
+	unsigned int budget = uploadBudgetBytes;
+
+	while (!uploading.empty() && budget > 0)
+	{
+		Request& request = *uploading.front();
+
+		if (!request.decoded)
+		{
+			std::cout << "TextureStreamer: failed to load " << request.fileName << std::endl;
+			finishRequest(request);
+			uploading.pop_front();
+			continue;
+		}
+
+		unsigned int copied = uploadRows(request, budget);
+
+		// No free PBO this frame, try again next frame instead of stalling
+		if (copied == 0)
+			break;
+
+		budget = copied < budget ? budget - copied : 0;
+
+		// Move on to the next mip level
+		if (request.rowsUploaded == getNumRows(request))
+		{
+			request.currentLevel++;
+			request.rowsUploaded = 0;
+		}
+
+		if (request.currentLevel == request.texData.levels.size())
+		{
+			finishRequest(request);
+			uploading.pop_front();
+		}
+	}
+}
+
+unsigned int TTK::TextureStreamer::getNumRows(Request& request)
+{
+	MipLevel& level = request.texData.levels[request.currentLevel];
+
+	if (request.texData.compressed)
+		return (level.height + 3) / 4;
+
+	return level.height;
+}
+
+unsigned int TTK::TextureStreamer::uploadRows(Request& request, unsigned int maxBytes)
+{
+	TextureData& texData = request.texData;
+	MipLevel& level = texData.levels[request.currentLevel];
+
+	unsigned int numRows = getNumRows(request);
+	unsigned int rowBytes = level.size / numRows;
+
+	GLenum target = request.textures ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+
+	// The array's layers were all allocated when it was created
+	if (request.textures)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, request.textures->id());
+	}
+	// First upload for this texture, allocate the GL texture and all of its levels
+	else if (request.glTexture == 0)
+	{
+		glGenTextures(1, &request.glTexture);
+		glBindTexture(GL_TEXTURE_2D, request.glTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texData.levels.size() - 1);
+
+		for (unsigned int i = 0; i < texData.levels.size(); i++)
+		{
+			MipLevel& l = texData.levels[i];
+
+			if (texData.compressed)
+				glCompressedTexImage2D(GL_TEXTURE_2D, i, texData.internalFormat, l.width, l.height, 0, l.size, nullptr);
+			else
+				glTexImage2D(GL_TEXTURE_2D, i, texData.internalFormat, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, request.glTexture);
+	}
+
+	unsigned int rowsLeft = numRows - request.rowsUploaded;
+	unsigned int maxRows = (maxBytes < pboSize ? maxBytes : pboSize) / rowBytes;
+
+	// A single row is bigger than what we are allowed to copy, send one row anyway
+	// so huge textures still make progress
+	if (maxRows == 0)
+		maxRows = 1;
+
+	unsigned int rows = rowsLeft < maxRows ? rowsLeft : maxRows;
+	unsigned int bytes = rows * rowBytes;
+	const unsigned char* src = &texData.data[level.offset + request.rowsUploaded * rowBytes];
+
+	// Region of the level we are filling in
+	unsigned int y = request.rowsUploaded;
+	unsigned int height = rows;
+	if (texData.compressed)
+	{
+		y *= 4;
+		height = (y + rows * 4 < level.height) ? rows * 4 : level.height - y;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// Row does not fit in a PBO, upload straight from memory
+	const void* pixels = src;
+
+	if (bytes <= pboSize)
+	{
+		// Has the GPU finished reading this PBO from the last time we used it?
+		GLsync& fence = pboFences[nextPBO];
+		if (fence)
+		{
+			// The flush makes sure the fence gets to the GPU, even if nothing else is drawn
+			// (ie. while loading before the first frame)
+			if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+			{
+				glBindTexture(target, 0);
+				return 0;
+			}
+
+			glDeleteSync(fence);
+			fence = 0;
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPBO]);
+
+		void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		memcpy(dst, src, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		// With a PBO bound the last parameter is an offset into the PBO, not a pointer
+		// The copy into the texture happens asynchronously on the GPU
+		pixels = 0;
+	}
+
+	if (request.textures)
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, request.currentLevel, 0, y, request.layer, level.width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	else if (texData.compressed)
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, request.currentLevel, 0, y, level.width, height, texData.internalFormat, bytes, pixels);
+	else
+		glTexSubImage2D(GL_TEXTURE_2D, request.currentLevel, 0, y, level.width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	if (bytes <= pboSize)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		pboFences[nextPBO] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		nextPBO = (nextPBO + 1) % pbos.size();
+	}
+
+	glBindTexture(target, 0);
+
+	request.rowsUploaded += rows;
+	return bytes;
+}
+
+void TTK::TextureStreamer::finishRequest(Request& request)
+{
+	if (request.textures)
+	{
+		if (request.onUploaded)
+			request.onUploaded();
+
+		// Not from the staging pool, the pool only grows with the decode workers' buffers
+		request.texData.data = std::vector<unsigned char>();
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		numPending--;
+		return;
+	}
+
+	Texture2D* texture = request.texture.get();
+
+	if (request.decoded)
+	{
+		texture->texID = request.glTexture;
+		texture->texWidth = request.texData.levels[0].width;
+		texture->texHeight = request.texData.levels[0].height;
+		texture->resident = true;
+		texture->trackMemory(request.texData);
+		request.glTexture = 0;
+	}
+
+	releaseStagingBuffer(request.texData.data);
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+	numPending--;
+}
+
+std::vector<unsigned char> TTK::TextureStreamer::acquireStagingBuffer()
+{
+	std::lock_guard<std::mutex> lock(stagingMutex);
+
+	if (stagingPool.empty())
+		return std::vector<unsigned char>();
+
+	std::vector<unsigned char> buffer;
+	buffer.swap(stagingPool.back());
+	stagingPool.pop_back();
+
+	return buffer;
+}
+
+void TTK::TextureStreamer::releaseStagingBuffer(std::vector<unsigned char>& buffer)
+{
+	std::lock_guard<std::mutex> lock(stagingMutex);
+
+	// Keep the memory (capacity) around for the next texture
+	buffer.clear();
+	stagingPool.push_back(std::vector<unsigned char>());
+	stagingPool.back().swap(buffer);
+}
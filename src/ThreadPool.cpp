@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	currentJob = nullptr;
+	jobNumber = 0;
+	numActiveWorkers = 0;
+	stopWorkers = false;
+
+	if (numThreads == 0)
+	{
+		unsigned int numCores = std::thread::hardware_concurrency();
+		numThreads = numCores > 1 ? numCores - 1 : 0;
+	}
+
+	for (unsigned int i = 0; i < numThreads; i++)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopWorkers = true;
+	}
+	jobCondition.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ThreadPool::run(unsigned int count, unsigned int chunkSize, RangeCallback callback, const void* func)
+{
+	if (count == 0)
+		return;
+
+	if (chunkSize == 0)
+		chunkSize = 1;
+
+	unsigned int numChunks = (count + chunkSize - 1) / chunkSize;
+
+	// Not worth waking anyone up
+	if (numChunks == 1 || workers.empty())
+	{
+		callback(func, 0, count);
+		return;
+	}
+
+	// One loop at a time, a second caller waits for the first to finish
+	std::lock_guard<std::mutex> callLock(callMutex);
+
+	Job job;
+	job.callback = callback;
+	job.func = func;
+	job.count = count;
+	job.chunkSize = chunkSize;
+	job.nextChunk = 0;
+	job.chunksLeft = numChunks;
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		currentJob = &job;
+		jobNumber++;
+	}
+	jobCondition.notify_all();
+
+	runChunks(job);
+
+	// Other threads may still be finishing their last chunk
+	// The job lives on this stack frame, so also wait for every worker to let go of it
+	std::unique_lock<std::mutex> lock(jobMutex);
+	doneCondition.wait(lock, [&] { return job.chunksLeft == 0 && numActiveWorkers == 0; });
+	currentJob = nullptr;
+}
+
+unsigned int ThreadPool::getNumThreads()
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+void ThreadPool::workerLoop()
+{
+	unsigned int lastJob = 0;
+
+	while (true)
+	{
+		Job* job;
+
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobCondition.wait(lock, [&] { return stopWorkers || (currentJob && jobNumber != lastJob); });
+
+			if (stopWorkers)
+				return;
+
+			job = currentJob;
+			lastJob = jobNumber;
+			numActiveWorkers++;
+		}
+
+		runChunks(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			numActiveWorkers--;
+		}
+		doneCondition.notify_all();
+	}
+}
+
+void ThreadPool::runChunks(Job& job)
+{
+	unsigned int numChunks = (job.count + job.chunkSize - 1) / job.chunkSize;
+
+	while (true)
+	{
+		unsigned int chunk = job.nextChunk++;
+
+		if (chunk >= numChunks)
+			return;
+
+		unsigned int begin = chunk * job.chunkSize;
+		unsigned int end = begin + job.chunkSize < job.count ? begin + job.chunkSize : job.count;
+
+		job.callback(job.func, begin, end);
+
+		// The last chunk to finish wakes up parallelFor
+		if (--job.chunksLeft == 0)
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			doneCondition.notify_all();
+		}
+	}
+}
@@ -1,9 +1,12 @@
 #include "VertexBufferObject.h"
 #include <iostream>
+#include <cstring> // for memcpy
 
 VertexBufferObject::VertexBufferObject()
 {
 	vaoHandle = 0;
+	dynamic = false;
+	updateRegion = nullptr;
 }
 
 VertexBufferObject::~VertexBufferObject()
@@ -17,22 +20,60 @@ int VertexBufferObject::addAttributeArray(AttributeDescriptor attrib)
 	return 1;
 }
 
+void VertexBufferObject::setDynamic(bool _dynamic)
+{
+	dynamic = _dynamic;
+}
+
+bool VertexBufferObject::isDynamic()
+{
+	return dynamic;
+}
+
 void VertexBufferObject::createVBO()
 {
 	if (vaoHandle)
 	{
+		// destroy() clears the attributes, keep the ones we were just given
+		std::vector<AttributeDescriptor> attribs = attributeDescriptors;
 		destroy();
+		attributeDescriptors = attribs;
 	}
 
 	glGenVertexArrays(1, &vaoHandle);
 	glBindVertexArray(vaoHandle);
 
+	if (dynamic)
+	{
+		// Lay the attributes out one after another in each region
+		unsigned int regionSize = 0;
+		attributeOffsets.resize(attributeDescriptors.size());
+
+		for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+		{
+			attributeOffsets[i] = regionSize;
+			regionSize += attributeDescriptors[i].numElements * attributeDescriptors[i].elementSize;
+			regionSize = (regionSize + 15) & ~15u; // keep each attribute 16 byte aligned
+		}
+
+		streamingBuffer.create(regionSize);
+
+		for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+			glEnableVertexAttribArray(attributeDescriptors[i].attributeLocation);
+
+		glBindVertexArray(0);
+
+		// Fill the first region
+		updateVBO();
+		return;
+	}
+
 	unsigned int numBuffers = attributeDescriptors.size();
 	vboHandles.resize(numBuffers);
 
 	glGenBuffers(numBuffers, &vboHandles[0]);
 
-	for (int i = 0; i < numBuffers; i++)
+	for (unsigned int i = 0; i < numBuffers; i++)
 	{
 		AttributeDescriptor* attrib = &attributeDescriptors[i];
 		
@@ -50,6 +91,90 @@ void VertexBufferObject::createVBO()
 	glBindVertexArray(0);
 }
 
+void VertexBufferObject::setAttributeData(AttributeLocations location, void* data)
+{
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+	{
+		if (attributeDescriptors[i].attributeLocation == location)
+			attributeDescriptors[i].data = data;
+	}
+}
+
+void VertexBufferObject::updateVBO()
+{
+	beginUpdate();
+
+	if (!updateRegion)
+		return;
+
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+	{
+		AttributeDescriptor* attrib = &attributeDescriptors[i];
+
+		if (attrib->data)
+			memcpy(updateRegion + attributeOffsets[i], attrib->data, attrib->numElements * attrib->elementSize);
+	}
+
+	endUpdate();
+}
+
+void VertexBufferObject::beginUpdate()
+{
+	updateRegion = nullptr;
+
+	if (!vaoHandle || !dynamic)
+	{
+		std::cout << "VertexBufferObject: only dynamic VBOs can be updated" << std::endl;
+		return;
+	}
+
+	updateRegion = (unsigned char*)streamingBuffer.beginWrite();
+}
+
+void* VertexBufferObject::getAttributePointer(AttributeLocations location)
+{
+	if (!updateRegion)
+		return nullptr;
+
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+	{
+		if (attributeDescriptors[i].attributeLocation == location)
+			return updateRegion + attributeOffsets[i];
+	}
+
+	return nullptr;
+}
+
+void VertexBufferObject::endUpdate()
+{
+	if (!updateRegion)
+		return;
+
+	streamingBuffer.endWrite();
+	setDynamicAttributePointers();
+
+	updateRegion = nullptr;
+}
+
+void VertexBufferObject::setDynamicAttributePointers()
+{
+	glBindVertexArray(vaoHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, streamingBuffer.getHandle());
+
+	// The VAO remembers the buffer and offset of each attribute, so this only needs doing when the region changes
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+	{
+		AttributeDescriptor* attrib = &attributeDescriptors[i];
+		unsigned int offset = streamingBuffer.getRegionOffset() + attributeOffsets[i];
+
+		glVertexAttribPointer(attrib->attributeLocation, attrib->numElementsPerAttrib,
+			attrib->elementType, GL_FALSE, 0, (void*)(size_t)offset);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
 void VertexBufferObject::draw()
 {
 	if (vaoHandle)
@@ -58,6 +183,10 @@ void VertexBufferObject::draw()
 		// better way would be to just store the num of vertices
 		glDrawArrays(GL_TRIANGLES, 0, 
 			attributeDescriptors[0].numElements / attributeDescriptors[0].numElementsPerAttrib);
+
+		// Don't write over this region again until the GPU is done drawing it
+		if (dynamic)
+			streamingBuffer.fenceRegion();
 	}
 }
 
@@ -66,11 +195,16 @@ void VertexBufferObject::destroy()
 	if (vaoHandle)
 	{
 		glDeleteVertexArrays(1, &vaoHandle);
-		glDeleteBuffers(vboHandles.size(), &vboHandles[0]);
+		if (!vboHandles.empty())
+			glDeleteBuffers(vboHandles.size(), &vboHandles[0]);
+		vaoHandle = 0;
 	}
 
+	streamingBuffer.destroy();
+
 	vboHandles.clear();
 	attributeDescriptors.clear();
+	attributeOffsets.clear();
 }
 
 
@@ -4,26 +4,74 @@
 #include <math.h>
 #include <map> // for std::map
 #include <memory> // for std::shared_ptr
+#include <vector>
+#include <chrono> // for frame timing
+#include <fstream>
 
 // 3rd Party Libraries
-#include <GLEW\glew.h>
-#include <GLUT\glut.h>
-#include <TTK\OBJMesh.h>
-#include <TTK\Camera.h>
+#include <GLEW/glew.h>
+#include <GLUT/glut.h>
+#include <TTK/OBJMesh.h>
+#include <TTK/Camera.h>
+#include <TTK/TextureStreamer.h>
+#include <TTK/TextureArray.h>
+#include <TTK/SkinnedMesh.h>
+#include <TTK/TextureAtlas.h>
+#include <TTK/Texture2D.h>
 #include <IL/il.h> // for ilInit()
-#include <glm\vec3.hpp>
-#include <glm\gtx\color_space.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtx/color_space.hpp>
+#include <glm/gtc/matrix_transform.hpp> // for glm::ortho
 
 // User Libraries
 #include "Shader.h"
 #include "ShaderProgram.h"
 #include "GameObject.h"
 #include "FrameBufferObject.h"
-#include "TTK\Utilities.h"
+#include "AssetWatcher.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "FramePipeline.h"
+#include "ThreadPool.h"
+#include "Animator.h"
+#include "EntityRegistry.h"
+#include "MemoryStats.h"
+#include "Benchmarks.h"
+#include "ShaderPermutations.h"
+#include "IndirectRenderer.h"
+#include "DepthPyramid.h"
+#include "SpriteBatch.h"
+#include "AssetManager.h"
+#include "TTK/Utilities.h"
+#include "TTK/PackFile.h"
+#include "MeshCodec.h"
+#include "TTK/DebugDraw.h"
+#include "TTK/PointHandle.h"
+
+#if defined(__linux__)
+#include <GL/glx.h> // for glXGetProcAddressARB(), to set the swap interval
+#endif
 
 // Defines and Core variables
 #define FRAMES_PER_SECOND 60
-const int FRAME_DELAY = 1000 / FRAMES_PER_SECOND; // Milliseconds per frame
+
+// The simulation always steps by this much, no matter how fast we render
+// This keeps movement the same on fast and slow machines
+const float FIXED_TIMESTEP = 1.0f / FRAMES_PER_SECOND;
+
+// Most simulation steps run in one frame
+// After a long stall (ie. a breakpoint) we skip ahead rather than spend every frame catching up
+const int MAX_STEPS_PER_FRAME = 5;
+
+// How rendering is paced
+enum FramePacing
+{
+	PACING_VSYNC,	// wait for the display's refresh before each swap
+	PACING_UNCAPPED	// render as fast as possible
+};
+
+FramePacing framePacing = PACING_VSYNC;
 
 int windowWidth = 800;
 int windowHeight = 600;
@@ -35,7 +83,13 @@ glm::vec3 mousePositionFlipped; // x, height - y, 0
 const float degToRad = 3.14159f / 180.0f;
 const float radToDeg = 180.0f / 3.14159f;
 
-float deltaTime = 0.0f; // amount of time since last update (set every frame in timer callback)
+float deltaTime = 0.0f; // amount of time since last frame (set every frame in display callback)
+
+float simulationAccumulator = 0.0f; // time that hasn't been simulated yet
+float interpolationAlpha = 1.0f; // how far we are between the last two simulation steps
+
+// Frame times of the windowed mode, press 'f' to print them
+FrameStats frameStats;
 
 glm::vec3 position;
 float movementSpeed = 5.0f;
@@ -44,15 +98,84 @@ glm::vec4 lightPos;
 // Cameras
 TTK::Camera playerCamera; // the camera you move around with wasd + mouse
 
+// Loads meshes, textures and shaders in the background, objects show up as their assets finish
+AssetManager assetManager;
+
 // Asset databases
-std::map<std::string, std::shared_ptr<TTK::MeshBase>> meshes;
-std::map<std::string, std::shared_ptr<GameObject>> gameobjects;
+std::map<std::string, MeshHandle> meshes;
+
+// Every game object in the scene, looked up by handle
+EntityRegistry gameobjects;
+
+// Objects used every frame, found by name once when the scene is loaded
+EntityHandle lightSphere;
+EntityHandle jelly;
+
+// Simulates and builds frame N+1 on another thread while frame N is drawn
+// Declared after the scene so it is destroyed (and its thread stopped) first
+FramePipeline framePipeline;
+
+// Worker threads for splitting up big jobs (ie. skinning)
+ThreadPool threadPool;
+
+// A sphere that wobbles on a chain of three joints
+std::shared_ptr<TTK::SkinnedMesh> jellyMesh;
+std::vector<GameObject*> jellyJoints;
+
+// Animations
+std::shared_ptr<AnimationClip> jellyWobble;
+Animator jellyAnimator;
+std::vector<Animator*> animators; // every animator sampled each step
+
+// Reloads shaders and meshes when they are changed on disk
+AssetWatcher assetWatcher;
+
+// Loads textures in the background and uploads them a bit every frame
+TTK::TextureStreamer textureStreamer;
+
+// All scene textures, objects pick a layer with GameObject::textureLayer
+TTK::TextureArray sceneTextures;
+
+// Draws every object with a static mesh in one call per pass, press 'i' to toggle
+// Off if the driver doesn't support it, then every object is drawn on its own
+IndirectRenderer indirectRenderer;
+bool useIndirectDraws = false;
+
+// Last frame's depth, for culling draws hidden behind others on the GPU
+// Only built where the scene has a depth texture (the headless FBO), the window's back buffer has no depth
+DepthPyramid depthPyramid;
+
+// 2D sprites drawn over the scene, all from one atlas so they take a single draw call
+// Press 'b' to go through 0, 1k, 10k and 100k of them
+SpriteBatch spriteBatch;
+TTK::TextureAtlas spriteAtlas;
+
+struct BouncingSprite
+{
+	glm::vec2 position;		// in pixels
+	glm::vec2 velocity;
+	float rotation;
+	float spin;
+	int image;				// region in spriteAtlas
+};
+std::vector<BouncingSprite> bouncingSprites;
+
+// Axes, labels and stats drawn over the scene, press 'g' to show them
+// All the lines are one draw call and all the text another
+TTK::DebugDraw debugDraw;
+bool showDebugDraw = false;
+
+// Follows the mouse clicks while the debug overlay is shown
+PointHandle clickHandle(12.0f, glm::vec3(), "");
 
 // Materials
 std::shared_ptr<Material> defaultMaterial;
-std::shared_ptr<Material> toonMaterial;
+std::shared_ptr<Material> lightingMaterial;
 std::shared_ptr<Material> outlineMaterial;
 
+// Specialized versions of lighting_f.glsl, one per lighting mode
+ShaderPermutations lightingShaders;
+
 enum GameMode
 {
 	NO_LIGHTING,
@@ -68,52 +191,246 @@ enum GameMode
 };
 
 GameMode currentMode = NO_LIGHTING;
+const int NUM_GAME_MODES = COLOR_GRADING_CUSTOM + 1;
+
+const char* gameModeNames[NUM_GAME_MODES] =
+{
+	"NO_LIGHTING",
+	"AMBIENT_ONLY",
+	"SPECULAR_ONLY",
+	"SPECULAR_RIM",
+	"AMBIENT_SPEC_RIM",
+	"DIFFUSE_WARP_RAMP",
+	"SPECULAR_WARP_RAMP",
+	"COLOR_GRADING_WARM",
+	"COLOR_GRADING_COOL",
+	"COLOR_GRADING_CUSTOM"
+};
+
+// Feature bits for lightingShaders (set in initializeShaders)
+unsigned int LIGHT_AMBIENT, LIGHT_DIFFUSE, LIGHT_SPECULAR, LIGHT_RIM;
+unsigned int LIGHT_DIFFUSE_RAMP, LIGHT_SPECULAR_RAMP;
+unsigned int GRADE_WARM, GRADE_COOL, GRADE_CUSTOM;
+unsigned int TEXTURE_ARRAY;
+unsigned int INDIRECT;
+
+// Returns the lighting shader variant for a game mode, with any extra features turned on
+// The variant is compiled the first time a mode is used
+std::shared_ptr<ShaderProgram> getLightingShader(GameMode mode, unsigned int extraFeatures = 0)
+{
+	unsigned int features = 0;
+	unsigned int lit = LIGHT_AMBIENT | LIGHT_DIFFUSE | LIGHT_SPECULAR;
+
+	switch (mode)
+	{
+	case AMBIENT_ONLY:			features = LIGHT_AMBIENT; break;
+	case SPECULAR_ONLY:			features = LIGHT_SPECULAR; break;
+	case SPECULAR_RIM:			features = LIGHT_SPECULAR | LIGHT_RIM; break;
+	case AMBIENT_SPEC_RIM:		features = LIGHT_AMBIENT | LIGHT_SPECULAR | LIGHT_RIM; break;
+	case DIFFUSE_WARP_RAMP:		features = LIGHT_AMBIENT | LIGHT_DIFFUSE | LIGHT_DIFFUSE_RAMP; break;
+	case SPECULAR_WARP_RAMP:	features = lit | LIGHT_SPECULAR_RAMP; break;
+	case COLOR_GRADING_WARM:	features = lit | GRADE_WARM; break;
+	case COLOR_GRADING_COOL:	features = lit | GRADE_COOL; break;
+	case COLOR_GRADING_CUSTOM:	features = lit | GRADE_CUSTOM; break;
+	default:					features = lit; break;
+	}
+
+	// Every mode samples the scene texture array
+	features |= TEXTURE_ARRAY;
+
+	return lightingShaders.getVariant(features | extraFeatures);
+}
+
+// Switches the lighting material to the variants for a game mode
+void setLightingShader(GameMode mode)
+{
+	lightingMaterial->shader = getLightingShader(mode);
+
+	// Only compiled once indirect drawing is used
+	if (useIndirectDraws)
+		lightingMaterial->indirectShader = getLightingShader(mode, INDIRECT);
+}
+
+// Relinks the program whenever one of its shader files changes
+void watchShaderProgram(std::shared_ptr<ShaderProgram> program)
+{
+	std::vector<std::string> files = program->getSourceFiles();
+
+	for (unsigned int i = 0; i < files.size(); i++)
+		assetWatcher.watchFile(files[i], [program](const std::string&) { program->reload(); });
+}
 
 void initializeShaders()
 {
 	std::string shaderPath = "../../Assets/Shaders/";
 
 	// Load shaders
+	// Every program is compiled in the background by the asset manager, and by the driver's
+	// own threads where it can. Passes drawn with a material are skipped until its shader links.
+	// Each program is hot reloaded once it has loaded.
 
-	Shader v_default, v_passThru;
-	v_default.loadShaderFromFile(shaderPath + "default_v.glsl", GL_VERTEX_SHADER);
-	v_passThru.loadShaderFromFile(shaderPath + "passThru_v.glsl", GL_VERTEX_SHADER);
-
-	Shader f_default, f_toon, f_solidColour;
-	f_default.loadShaderFromFile(shaderPath + "default_f.glsl", GL_FRAGMENT_SHADER);
-	f_toon.loadShaderFromFile(shaderPath + "toon_f.glsl", GL_FRAGMENT_SHADER);
-	f_solidColour.loadShaderFromFile(shaderPath + "solidColour_f.glsl", GL_FRAGMENT_SHADER);
+	ShaderStage v_default(shaderPath + "default_v.glsl", GL_VERTEX_SHADER);
+	ShaderStage v_passThru(shaderPath + "passThru_v.glsl", GL_VERTEX_SHADER);
+	ShaderStage f_default(shaderPath + "default_f.glsl", GL_FRAGMENT_SHADER);
+	ShaderStage f_solidColour(shaderPath + "solidColour_f.glsl", GL_FRAGMENT_SHADER);
 
 	// Default material that all objects use
 	defaultMaterial = std::make_shared<Material>();
-	defaultMaterial->shader->attachShader(v_default);
-	defaultMaterial->shader->attachShader(f_default);
-	defaultMaterial->shader->linkProgram();
-
-	// Toon shaded material
-	toonMaterial = std::make_shared<Material>();
-	toonMaterial->shader->attachShader(v_default);
-	toonMaterial->shader->attachShader(f_toon);
-	toonMaterial->shader->linkProgram();
+	defaultMaterial->shader = assetManager.loadShaderProgram({ v_default, f_default }, watchShaderProgram).getShared();
 
 	// Solid colour material (for outlines)
 	outlineMaterial = std::make_shared<Material>();
-	outlineMaterial->shader->attachShader(v_passThru);
-	outlineMaterial->shader->attachShader(f_solidColour);
-	outlineMaterial->shader->linkProgram();
+	outlineMaterial->drawsBackFaces = true;
+	outlineMaterial->shader = assetManager.loadShaderProgram({ v_passThru, f_solidColour }, watchShaderProgram).getShared();
+
+	// The same two for drawing with the indirect renderer
+	if (indirectRenderer.isCreated())
+	{
+		std::string indirect = "#define USE_INDIRECT\n";
+
+		ShaderStage v_defaultIndirect(shaderPath + "default_v.glsl", GL_VERTEX_SHADER, indirect);
+		ShaderStage v_passThruIndirect(shaderPath + "passThru_v.glsl", GL_VERTEX_SHADER, indirect);
+		ShaderStage f_defaultIndirect(shaderPath + "default_f.glsl", GL_FRAGMENT_SHADER, indirect);
+		ShaderStage f_solidColourIndirect(shaderPath + "solidColour_f.glsl", GL_FRAGMENT_SHADER, indirect);
+
+		defaultMaterial->indirectShader = assetManager.loadShaderProgram({ v_defaultIndirect, f_defaultIndirect }, watchShaderProgram).getShared();
+		outlineMaterial->indirectShader = assetManager.loadShaderProgram({ v_passThruIndirect, f_solidColourIndirect }, watchShaderProgram).getShared();
+
+		// Culling and depth pyramid compute shaders, GPU culling is off without them (and until they load)
+		if (GLEW_ARB_compute_shader)
+		{
+			// Compact the visible draws if they can be drawn with a count from the GPU
+			std::string cullDefines = IndirectRenderer::hasCountBuffer() ? "#define USE_COUNT_BUFFER\n" : "";
+
+			assetManager.loadShaderProgram({ ShaderStage(shaderPath + "cull_c.glsl", GL_COMPUTE_SHADER, cullDefines) },
+				[](std::shared_ptr<ShaderProgram> cullShader)
+			{
+				indirectRenderer.setCullShader(cullShader);
+				watchShaderProgram(cullShader);
+			});
+
+			assetManager.loadShaderProgram({ ShaderStage(shaderPath + "depthPyramid_c.glsl", GL_COMPUTE_SHADER) },
+				[](std::shared_ptr<ShaderProgram> depthPyramidShader)
+			{
+				depthPyramid.setReduceShader(depthPyramidShader);
+				watchShaderProgram(depthPyramidShader);
+			});
+		}
+	}
+
+	// Sprites, drawn once their shader has loaded
+	assetManager.loadShaderProgram({ ShaderStage(shaderPath + "sprite_v.glsl", GL_VERTEX_SHADER), ShaderStage(shaderPath + "sprite_f.glsl", GL_FRAGMENT_SHADER) },
+		[](std::shared_ptr<ShaderProgram> spriteShader)
+	{
+		spriteBatch.setShader(spriteShader);
+		watchShaderProgram(spriteShader);
+	});
+
+	// Debug lines and text
+	assetManager.loadShaderProgram({ ShaderStage(shaderPath + "debugLine_v.glsl", GL_VERTEX_SHADER), ShaderStage(shaderPath + "debugLine_f.glsl", GL_FRAGMENT_SHADER) },
+		[](std::shared_ptr<ShaderProgram> lineShader)
+	{
+		debugDraw.setLineShader(lineShader);
+		watchShaderProgram(lineShader);
+	});
+
+	assetManager.loadShaderProgram({ ShaderStage(shaderPath + "sprite_v.glsl", GL_VERTEX_SHADER), ShaderStage(shaderPath + "debugText_f.glsl", GL_FRAGMENT_SHADER) },
+		[](std::shared_ptr<ShaderProgram> textShader)
+	{
+		debugDraw.setTextShader(textShader);
+		watchShaderProgram(textShader);
+	});
+
+	// Lighting material, its shader is swapped for the variant each mode needs
+	lightingShaders.setVertexShader(shaderPath + "default_v.glsl");
+	lightingShaders.setFragmentShader(shaderPath + "lighting_f.glsl");
+
+	LIGHT_AMBIENT = lightingShaders.addFeature("USE_AMBIENT");
+	LIGHT_DIFFUSE = lightingShaders.addFeature("USE_DIFFUSE");
+	LIGHT_SPECULAR = lightingShaders.addFeature("USE_SPECULAR");
+	LIGHT_RIM = lightingShaders.addFeature("USE_RIM");
+	LIGHT_DIFFUSE_RAMP = lightingShaders.addFeature("USE_DIFFUSE_RAMP");
+	LIGHT_SPECULAR_RAMP = lightingShaders.addFeature("USE_SPECULAR_RAMP");
+	GRADE_WARM = lightingShaders.addFeature("USE_GRADE_WARM");
+	GRADE_COOL = lightingShaders.addFeature("USE_GRADE_COOL");
+	GRADE_CUSTOM = lightingShaders.addFeature("USE_GRADE_CUSTOM");
+	TEXTURE_ARRAY = lightingShaders.addFeature("USE_TEXTURE_ARRAY");
+	INDIRECT = lightingShaders.addFeature("USE_INDIRECT");
+
+	lightingMaterial = std::make_shared<Material>();
+	lightingMaterial->vec4Uniforms["u_gradeColour"] = glm::vec4(1.0f, 0.8f, 0.9f, 1.0f);
+	lightingMaterial->intUniforms["u_textures"] = 0; // sceneTextures is bound to unit 0
+
+	assetWatcher.watchFile(shaderPath + "default_v.glsl", [](const std::string&) { lightingShaders.reloadAll(); });
+	assetWatcher.watchFile(shaderPath + "lighting_f.glsl", [](const std::string&) { lightingShaders.reloadAll(); });
+}
+
+// Loads a static mesh in the background
+// Once it's loaded it goes in the indirect renderer's buffers and is hot reloaded when it's saved
+MeshHandle loadStaticMesh(const std::string& fileName, std::function<void(std::shared_ptr<TTK::OBJMesh>)> onReady = nullptr)
+{
+	return assetManager.loadMesh(fileName, [fileName, onReady](std::shared_ptr<TTK::OBJMesh> mesh)
+	{
+		// Static meshes share the indirect renderer's buffers, so objects using them can be drawn together
+		// (does nothing if the renderer wasn't created)
+		indirectRenderer.getMeshBuffer().addMesh(mesh.get());
+
+		// onReady runs again after a reload, so anything built from the mesh (ie. the jelly) is rebuilt too
+		assetWatcher.watchFile(fileName, [mesh, onReady](const std::string&)
+		{
+			mesh->reloadMesh();
+			indirectRenderer.getMeshBuffer().updateMesh(mesh.get());
+
+			if (onReady)
+				onReady(mesh);
+		});
+
+		if (onReady)
+			onReady(mesh);
+	});
+}
+
+// Skins the jelly's copy of the sphere, once the sphere has loaded
+void buildJellyMesh(std::shared_ptr<TTK::OBJMesh> sphereMesh)
+{
+	jellyMesh->createFromMesh(*sphereMesh);
+
+	// Each vertex follows the two joints it is between
+	for (unsigned int i = 0; i < jellyMesh->vertices.size(); i++)
+	{
+		float t = glm::clamp(jellyMesh->vertices[i].y + 1.0f, 0.0f, 2.0f); // 0 at the bottom joint, 2 at the top
+		unsigned short lower = t < 1.0f ? 0 : 1;
+		float blend = t - lower;
+
+		jellyMesh->jointIndices[i] = glm::u16vec4(lower, lower + 1, 0, 0);
+		jellyMesh->jointWeights[i] = glm::vec4(1.0f - blend, blend, 0.0f, 0.0f);
+	}
+
+	jellyMesh->createSkinnedVBO();
 }
 
 void initializeScene()
 {
 	std::string meshPath = "../../Assets/Models/";
-	
-	std::shared_ptr<TTK::OBJMesh> floorMesh = std::make_shared<TTK::OBJMesh>();
-	std::shared_ptr<TTK::OBJMesh> sphereMesh = std::make_shared<TTK::OBJMesh>();
-	std::shared_ptr<TTK::OBJMesh> torusMesh = std::make_shared<TTK::OBJMesh>();
+	std::string texturePath = "../../Assets/Textures/";
+
+	// Every asset loads in the background, the objects are made right away and
+	// each one is drawn once the assets it depends on have loaded
+
+	// Load every texture into one array, images are resized to fit the layers
+	sceneTextures.create(512, 512, 8);
+	TextureHandle dkongTexture = assetManager.loadTextureLayer(sceneTextures, texturePath + "dkong.png");
+	assetManager.loadTextureLayer(sceneTextures, texturePath + "dkong2.png");
+
+	// The same textures packed into an atlas for the sprites
+	spriteAtlas.addImage(texturePath + "dkong.png");
+	spriteAtlas.addImage(texturePath + "dkong2.png");
+	if (spriteAtlas.build())
+		spriteAtlas.upload();
 
-	floorMesh->loadMesh(meshPath + "floor.obj");
-	sphereMesh->loadMesh(meshPath + "sphere.obj");
-	torusMesh->loadMesh(meshPath + "torus.obj");
+	MeshHandle floorMesh = loadStaticMesh(meshPath + "floor.obj");
+	MeshHandle sphereMesh = loadStaticMesh(meshPath + "sphere.obj", buildJellyMesh);
+	loadStaticMesh(meshPath + "torus.obj");
 
 	// Note: looking up a mesh by it's string name is not the fastest thing,
 	// you don't want to do this every frame, once in a while (like now) is fine.
@@ -124,73 +441,320 @@ void initializeScene()
 	
 
 	// Create objects
-	gameobjects["floor"] = std::make_shared<GameObject>(glm::vec3(0.0f, 0.0f, 0.0f), floorMesh, defaultMaterial);
-	gameobjects["sphere"] = std::make_shared<GameObject>(glm::vec3(0.0f, 5.0f, 0.0f), sphereMesh, defaultMaterial);
+	GameObject* floorObject = gameobjects.get(gameobjects.create("floor", glm::vec3(0.0f, 0.0f, 0.0f), floorMesh.getShared(), defaultMaterial));
+	floorObject->addDependency(floorMesh);
+	floorObject->addDependency(dkongTexture);
+
+	GameObject* sphereObject = gameobjects.get(gameobjects.create("sphere", glm::vec3(0.0f, 5.0f, 0.0f), sphereMesh.getShared(), defaultMaterial));
+	sphereObject->addDependency(sphereMesh);
 	
 	
 
 
+	// Skinned "jelly" sphere
+	// Three joints stacked along y (bottom, middle, top), each a child of the one below
+	// The joints are game objects without meshes, so they are moved like anything else
+	// The mesh is a copy of the sphere, skinned by buildJellyMesh() once the sphere loads
+	jellyMesh = std::make_shared<TTK::SkinnedMesh>();
+
+	GameObject* jellyObject = gameobjects.get(gameobjects.create("jelly", glm::vec3(-6.0f, 2.0f, 0.0f), jellyMesh, defaultMaterial));
+	jellyObject->colour = glm::vec4(0.2f, 0.8f, 0.3f, 1.0f);
+	jellyObject->addDependency(sphereMesh);
+
+	GameObject* jointParent = jellyObject;
+	std::vector<glm::vec3> jointPositions;
+	for (int i = 0; i < 3; i++)
+	{
+		// The first joint sits at the bottom of the sphere, the rest are one unit above their parent
+		glm::vec3 jointPosition = i == 0 ? glm::vec3(0.0f, -1.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		jointPositions.push_back(jointPosition);
+
+		std::string jointName = "jellyJoint" + std::to_string(i);
+		GameObject* joint = gameobjects.get(gameobjects.create(jointName, jointPosition, nullptr, defaultMaterial));
+		jointParent->addChild(joint);
+
+		jellyJoints.push_back(joint);
+		jointParent = joint;
+
+		jellyMesh->inverseBindMatrices.push_back(glm::translate(glm::vec3(0.0f, 1.0f - i, 0.0f)));
+	}
+
+	// Bake the jelly's wobble into an animation clip
+	// Each joint bends a bit later than the one below it, the whole thing repeats every 2 pi seconds
+	RawAnimation wobble;
+	wobble.name = "jelly wobble";
+	wobble.numFrames = 189;
+	wobble.sampleRate = (wobble.numFrames - 1) / (2.0f * 3.14159f);
+
+	for (unsigned int i = 0; i < jellyJoints.size(); i++)
+		wobble.jointNames.push_back("jellyJoint" + std::to_string(i));
+
+	for (unsigned int f = 0; f < wobble.numFrames; f++)
+	{
+		float t = f / wobble.sampleRate;
+
+		for (unsigned int i = 0; i < jellyJoints.size(); i++)
+		{
+			JointPose pose;
+			pose.translation = jointPositions[i];
+			pose.scale = glm::vec3(1.0f);
+			pose.rotation = glm::quat();
+
+			// The bottom joint stays put
+			if (i > 0)
+			{
+				float angleZ = sin(t * 3.0f - i) * 25.0f;
+				float angleX = cos(t * 2.0f - i) * 15.0f;
+
+				pose.rotation = glm::angleAxis(glm::radians(angleZ), glm::vec3(0.0f, 0.0f, 1.0f)) *
+					glm::angleAxis(glm::radians(angleX), glm::vec3(1.0f, 0.0f, 0.0f));
+			}
+
+			wobble.frames.push_back(pose);
+		}
+	}
+
+	jellyWobble = std::make_shared<AnimationClip>();
+	jellyWobble->build(wobble);
+	jellyWobble->printStats();
+
+	jellyAnimator.setClip(jellyWobble, jellyJoints);
+	animators.push_back(&jellyAnimator);
+
 	// Set object properties
-	gameobjects["sphere"]->colour = glm::vec4(1.0f);
+	gameobjects.get(gameobjects.find("sphere"))->colour = glm::vec4(1.0f);
+	gameobjects.get(gameobjects.find("floor"))->textureLayer = dkongTexture->layer;
+
+	// Keep handles to the objects that are needed every frame, so there are no name lookups after loading
+	lightSphere = gameobjects.find("sphere");
+	jelly = gameobjects.find("jelly");
 }
 
-void updateScene()
+void updateScene(float dt)
 {
 	// Move light in simple circular path
 	static float ang = 0.0f;
 
-	ang += deltaTime;
+	ang += dt;
 	lightPos.x = cos(ang) * 10.0f;
 	lightPos.y = cos(ang*4.0f) * 2.0f + 10.0f;
 	lightPos.z = sin(ang) * 10.0f;
 	lightPos.w = 1.0f;
 
-	gameobjects["sphere"]->setPosition(lightPos);
+	gameobjects.get(lightSphere)->setPosition(lightPos);
+
+	// Play the animations, sampling is spread across the thread pool when there are lots of them
+	for (unsigned int i = 0; i < animators.size(); i++)
+		animators[i]->update(dt);
+
+	Animator::sampleAll(animators, &threadPool);
+
+	for (unsigned int i = 0; i < animators.size(); i++)
+		animators[i]->apply();
 
 	// Update all game objects
-	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
+	for (unsigned int i = 0; i < gameobjects.size(); i++)
 	{
-		auto gameobject = itr->second;
+		GameObject* gameobject = gameobjects[i];
 
 		// Remember: root nodes are responsible for updating all of its children
 		// So we need to make sure to only invoke update() for the root nodes.
 		// Otherwise some objects would get updated twice in a frame!
 		if (gameobject->isRoot())
-			gameobject->update(deltaTime);
+			gameobject->update(dt);
 	}
 }
 
-void drawScene(TTK::Camera& cam)
+// Runs as many fixed simulation steps as the time passed covers
+void advanceSimulation(float dt)
 {
-	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
+	PROFILE_SCOPE("update");
+
+	simulationAccumulator += dt;
+
+	int numSteps = 0;
+	while (simulationAccumulator >= FIXED_TIMESTEP && numSteps < MAX_STEPS_PER_FRAME)
 	{
-		auto gameobject = itr->second;
+		for (unsigned int i = 0; i < gameobjects.size(); i++)
+		{
+			if (gameobjects[i]->isRoot())
+				gameobjects[i]->storePreviousState();
+		}
 
-		if (gameobject->isRoot())
-			gameobject->draw(cam);
+		updateScene(FIXED_TIMESTEP);
+
+		simulationAccumulator -= FIXED_TIMESTEP;
+		numSteps++;
 	}
+
+	// Fell too far behind, drop the time we couldn't simulate
+	if (simulationAccumulator > FIXED_TIMESTEP)
+		simulationAccumulator = FIXED_TIMESTEP;
+
+	// The leftover time is how far we are into the next step
+	interpolationAlpha = simulationAccumulator / FIXED_TIMESTEP;
 }
 
-void setMaterialForAllGameObjects(std::shared_ptr<Material> mat)
+// Sets every object's draw transform in between the last two simulation steps
+void interpolateScene(float alpha)
 {
-	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
+	for (unsigned int i = 0; i < gameobjects.size(); i++)
 	{
-		itr->second->material = mat;
+		if (gameobjects[i]->isRoot())
+			gameobjects[i]->interpolate(alpha);
 	}
 }
 
+// Sets how many display refreshes to wait for before swapping buffers
+// 0 = don't wait (uncapped), 1 = vsync
+void setSwapInterval(int interval)
+{
+#if defined(_WIN32)
+	typedef BOOL(WINAPI *SwapIntervalProc)(int);
+	SwapIntervalProc wglSwapIntervalEXT = (SwapIntervalProc)wglGetProcAddress("wglSwapIntervalEXT");
+
+	if (wglSwapIntervalEXT)
+		wglSwapIntervalEXT(interval);
+	else
+		std::cout << "Swap interval can not be changed on this driver" << std::endl;
+#elif defined(__linux__)
+	typedef int(*SwapIntervalProc)(unsigned int);
+	SwapIntervalProc glXSwapIntervalMESA = (SwapIntervalProc)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+
+	if (glXSwapIntervalMESA)
+		glXSwapIntervalMESA(interval);
+	else
+		std::cout << "Swap interval can not be changed on this driver" << std::endl;
+#endif
+}
 
-// This is where we draw stuff
-void DisplayCallbackFunction(void)
+void setFramePacing(FramePacing pacing)
 {
-	// Update cameras (there's two now!)
-	playerCamera.update();
+	framePacing = pacing;
+	setSwapInterval(pacing == PACING_VSYNC ? 1 : 0);
 
-	// Update all gameobjects
-	updateScene();
+	// Old frame times were paced differently
+	frameStats.reset();
+
+	std::cout << "Frame pacing: " << (pacing == PACING_VSYNC ? "vsync" : "uncapped") << std::endl;
+}
+
+// Draws one object, the material's shader must be bound
+void drawItem(const DrawItem& item, TTK::Camera& cam, std::shared_ptr<Material> mat)
+{
+	mat->mat4Uniforms["u_mvp"] = cam.viewProjMatrix * item.modelMatrix;
+	mat->mat4Uniforms["u_mv"] = cam.viewMatrix * item.modelMatrix;
+	mat->vec4Uniforms["u_colour"] = item.colour;
+	mat->intUniforms["u_textureLayer"] = item.textureLayer;
+	mat->sendUniforms();
+
+	item.mesh->draw();
+}
 
-        
-	switch (currentMode)
+// Draws every object in a frame packet with one material
+void drawScene(const FramePacket& packet, TTK::Camera& cam, std::shared_ptr<Material> mat)
+{
+	PROFILE_GPU_SCOPE("draw scene");
+
+	// The material's shader is still loading
+	if (!mat->shader->isLinked())
+		return;
+
+	if (useIndirectDraws && mat->indirectShader && mat->indirectShader->isLinked())
+	{
+		// Every object with a static mesh in one call, the per object data is already on the GPU
+		mat->indirectShader->bind();
+		mat->mat4Uniforms["u_viewProj"] = cam.viewProjMatrix;
+		mat->mat4Uniforms["u_view"] = cam.viewMatrix;
+		mat->sendUniforms(*mat->indirectShader);
+
+		indirectRenderer.draw(mat->drawsBackFaces);
+
+		// Then the rest (ie. skinned meshes) one at a time
+		const std::vector<unsigned int>& skippedItems = indirectRenderer.getSkippedItems();
+
+		mat->shader->bind();
+
+		for (unsigned int i = 0; i < skippedItems.size(); i++)
+			drawItem(packet.drawItems[skippedItems[i]], cam, mat);
+
+		return;
+	}
+
+	mat->shader->bind();
+
+	for (unsigned int i = 0; i < packet.drawItems.size(); i++)
+		drawItem(packet.drawItems[i], cam, mat);
+}
+
+// Simulates the next frame and copies out everything needed to draw it
+// Runs on the frame pipeline's prep thread
+void prepareFrame(FramePacket& packet, float dt)
+{
+	// Update all gameobjects at the fixed rate
+	advanceSimulation(dt);
+
+	// Place objects between the last two simulation steps
+	interpolateScene(interpolationAlpha);
+
+	PROFILE_SCOPE("build draw list");
+
+	packet.lightPos = lightPos;
+	packet.drawItems.clear();
+
+	for (unsigned int i = 0; i < gameobjects.size(); i++)
+	{
+		if (gameobjects[i]->isRoot())
+			gameobjects[i]->gatherDrawItems(packet.drawItems);
+	}
+
+	// The jelly's mesh is only skinned once the sphere it's made from has loaded
+	if (!gameobjects.get(jelly)->isLoaded())
+		return;
+
+	// Joint transforms relative to the jelly, since the mesh is skinned in model space
+	packet.skinUpdates.push_back(SkinUpdate(&packet.arena));
+	SkinUpdate& jellyUpdate = packet.skinUpdates.back();
+	jellyUpdate.mesh = jellyMesh.get();
+	jellyUpdate.jointTransforms.resize(jellyJoints.size());
+
+	glm::mat4 worldToJelly = glm::inverse(gameobjects.get(jelly)->getRenderMatrix());
+	for (unsigned int i = 0; i < jellyJoints.size(); i++)
+		jellyUpdate.jointTransforms[i] = worldToJelly * jellyJoints[i]->getRenderMatrix();
+}
+
+// Poses the skinned meshes in a frame packet, call on the GL thread before drawing
+void skinMeshes(const FramePacket& packet)
+{
+	for (unsigned int i = 0; i < packet.skinUpdates.size(); i++)
+	{
+		const SkinUpdate& update = packet.skinUpdates[i];
+		update.mesh->skin(update.jointTransforms.data(), (unsigned int)update.jointTransforms.size(), &threadPool);
+	}
+}
+
+// Writes the indirect draws for a frame packet, call on the GL thread before drawing
+// Done once a frame, every pass after that reuses them
+void buildIndirectDraws(const FramePacket& packet)
+{
+	if (!useIndirectDraws)
+		return;
+
+	PROFILE_SCOPE("build indirect draws");
+
+	// Every pass draws with the player camera, so the draws are culled once for all of them
+	indirectRenderer.build(packet, Frustum(playerCamera.viewProjMatrix), playerCamera.cameraPosition);
+}
+
+// Draws the scene into the bound framebuffer using the passes for a lighting mode
+void renderScene(GameMode mode, const FramePacket& packet)
+{
+	PROFILE_GPU_SCOPE("render");
+
+	// Material the objects are drawn with, set by each pass
+	std::shared_ptr<Material> passMaterial;
+
+	switch (mode)
 	{
 		// No Lighting
 		case NO_LIGHTING: // press 1
@@ -204,14 +768,14 @@ void DisplayCallbackFunction(void)
 			// Clear back buffer
 			FrameBufferObject::clearFrameBuffer(glm::vec4(0.8f, 0.8f, 0.8f, 0.0f));
 
-			// Tell all game objects to use the default material
-			setMaterialForAllGameObjects(defaultMaterial);
+			// Draw this pass with the default material
+			passMaterial = defaultMaterial;
 
 			// Set material properties
-			defaultMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+			defaultMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 			// Draw the scene to the back buffer
-			drawScene(playerCamera);
+			drawScene(packet, playerCamera, passMaterial);
 		}
 		break;
 
@@ -228,14 +792,15 @@ void DisplayCallbackFunction(void)
 			FrameBufferObject::clearFrameBuffer(glm::vec4(0.0f, 0.8f, 0.8f, 0.0f));
 	
 
-			// Tell all game objects to use the toon shading material
-			setMaterialForAllGameObjects(toonMaterial);
+			// Draw this pass with the lighting shader specialized for this mode
+			setLightingShader(mode);
+			passMaterial = lightingMaterial;
 
 			// Set material properties
-			toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+			lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 			// Draw the scene to the back buffer
-			drawScene(playerCamera);
+			drawScene(packet, playerCamera, passMaterial);
 		}
 		break;
 
@@ -254,16 +819,16 @@ void DisplayCallbackFunction(void)
 			
 
 
-			// Tell all game objects to use the toon shading material
-			setMaterialForAllGameObjects(outlineMaterial);
+			// Draw this pass with the toon shading material
+			passMaterial = outlineMaterial;
 
 			// Set material properties
-			outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+			outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 			
 
 			// Draw the scene to the back buffer
-			drawScene(playerCamera);
+			drawScene(packet, playerCamera, passMaterial);
 
 			// Turn Culling off
 			glCullFace(GL_BACK);
@@ -271,14 +836,15 @@ void DisplayCallbackFunction(void)
 			// Turn Solid Fill On
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-			// Tell all game objects to use the toon shading material
-			setMaterialForAllGameObjects(toonMaterial);
+			// Draw this pass with the lighting shader specialized for this mode
+			setLightingShader(mode);
+			passMaterial = lightingMaterial;
 
 			// Set material properties
-			toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+			lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 			// Draw the scene to the back buffer
-			drawScene(playerCamera);
+			drawScene(packet, playerCamera, passMaterial);
 
 		}
 		break;
@@ -298,16 +864,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -315,14 +881,15 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
@@ -342,16 +909,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -359,14 +926,15 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
@@ -386,16 +954,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -403,14 +971,15 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
@@ -430,16 +999,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -447,14 +1016,15 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
@@ -474,16 +1044,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -491,14 +1061,15 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
@@ -518,16 +1089,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -535,14 +1106,15 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
@@ -562,16 +1134,16 @@ void DisplayCallbackFunction(void)
 
 
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(outlineMaterial);
+            // Draw this pass with the toon shading material
+            passMaterial = outlineMaterial;
 
             // Set material properties
-            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            outlineMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
 
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
             // Turn Culling off
             glCullFace(GL_BACK);
@@ -579,18 +1151,152 @@ void DisplayCallbackFunction(void)
             // Turn Solid Fill On
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            // Tell all game objects to use the toon shading material
-            setMaterialForAllGameObjects(toonMaterial);
+            // Draw this pass with the lighting shader specialized for this mode
+            setLightingShader(mode);
+            passMaterial = lightingMaterial;
 
             // Set material properties
-            toonMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * lightPos;
+            lightingMaterial->vec4Uniforms["u_lightPos"] = playerCamera.viewMatrix * packet.lightPos;
 
             // Draw the scene to the back buffer
-            drawScene(playerCamera);
+            drawScene(packet, playerCamera, passMaterial);
 
         }
         break;
 	}
+}
+
+// Scatters count sprites over the window, each moving and spinning at its own speed
+void setNumSprites(unsigned int count)
+{
+	bouncingSprites.resize(count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		BouncingSprite& sprite = bouncingSprites[i];
+		sprite.position = glm::vec2(rand() % glm::max(windowWidth, 1), rand() % glm::max(windowHeight, 1));
+		sprite.velocity = glm::vec2(rand() % 401 - 200, rand() % 401 - 200);
+		sprite.rotation = 0.0f;
+		sprite.spin = (rand() % 601 - 300) / 100.0f;
+		sprite.image = spriteAtlas.getNumRegions() > 0 ? i % spriteAtlas.getNumRegions() : 0;
+	}
+}
+
+// Moves the sprites and draws them over the scene, bouncing off the edges of the window
+void drawSprites(float dt)
+{
+	if (bouncingSprites.empty() || !spriteAtlas.id())
+		return;
+
+	PROFILE_SCOPE("sprites");
+
+	glm::vec2 windowSize((float)windowWidth, (float)windowHeight);
+	spriteBatch.begin(glm::ortho(0.0f, windowSize.x, 0.0f, windowSize.y));
+
+	for (unsigned int i = 0; i < bouncingSprites.size(); i++)
+	{
+		BouncingSprite& sprite = bouncingSprites[i];
+		sprite.position += sprite.velocity * dt;
+		sprite.rotation += sprite.spin * dt;
+
+		for (int axis = 0; axis < 2; axis++)
+		{
+			if ((sprite.position[axis] < 0.0f && sprite.velocity[axis] < 0.0f) ||
+				(sprite.position[axis] > windowSize[axis] && sprite.velocity[axis] > 0.0f))
+				sprite.velocity[axis] = -sprite.velocity[axis];
+		}
+
+		const TTK::AtlasRegion& region = spriteAtlas.getRegion(sprite.image);
+		spriteBatch.draw(spriteAtlas.id(), region, sprite.position,
+			glm::vec2((float)region.width, (float)region.height) * 0.08f, glm::vec4(1.0f), sprite.rotation);
+	}
+
+	spriteBatch.end();
+}
+
+// Axes for every object, the light and a few stats over everything else
+void drawDebugOverlay(const FramePacket& packet)
+{
+	if (!showDebugDraw || !debugDraw.isCreated())
+		return;
+
+	PROFILE_SCOPE("debug draw");
+
+	glm::vec2 windowSize((float)windowWidth, (float)windowHeight);
+	debugDraw.begin(playerCamera.viewProjMatrix, windowSize);
+
+	for (unsigned int i = 0; i < packet.drawItems.size(); i++)
+		debugDraw.addAxes(packet.drawItems[i].modelMatrix, 0.5f);
+
+	glm::vec3 light(packet.lightPos);
+	debugDraw.addSphere(light, 0.25f, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+	debugDraw.addText3D("light", light);
+
+	if (!clickHandle.label.empty())
+		clickHandle.draw(debugDraw);
+
+	// Kept between frames so it doesn't allocate every frame
+	static std::string stats;
+	char line[128];
+
+	stats.clear();
+	snprintf(line, sizeof(line), "%.2f ms\n", deltaTime * 1000.0f);
+	stats += line;
+	snprintf(line, sizeof(line), "%u objects, %u sprites\n", (unsigned int)packet.drawItems.size(), (unsigned int)bouncingSprites.size());
+	stats += line;
+	stats += gameModeNames[currentMode];
+
+	debugDraw.addText(stats, glm::vec2(10.0f, windowSize.y - 20.0f));
+
+	debugDraw.end();
+}
+
+// This is where we draw stuff
+void DisplayCallbackFunction(void)
+{
+	// Time since the last frame, at a much finer resolution than glutGet(GLUT_ELAPSED_TIME)
+	static std::chrono::high_resolution_clock::time_point lastFrameTime = std::chrono::high_resolution_clock::now();
+	std::chrono::high_resolution_clock::time_point frameTime = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<float> frameDuration = frameTime - lastFrameTime;
+	lastFrameTime = frameTime;
+
+	deltaTime = frameDuration.count();
+	frameStats.addFrame(deltaTime * 1000.0);
+
+	Profiler::beginFrame();
+
+	{
+		PROFILE_SCOPE("upload");
+
+		// Finish any assets that have loaded, and upload some of the textures
+		assetManager.update();
+
+		// Pick up any shaders or meshes that changed on disk
+		assetWatcher.poll();
+	}
+
+	// Bound once for the whole frame, objects only pick a layer
+	sceneTextures.bind(GL_TEXTURE0);
+
+	// Update cameras (there's two now!)
+	playerCamera.update();
+
+	// Get the frame the prep thread built last frame, it starts on the next one
+	const FramePacket& packet = framePipeline.beginFrame(deltaTime);
+
+	skinMeshes(packet);
+	buildIndirectDraws(packet);
+
+	// Draw the scene with the current lighting mode
+	renderScene(currentMode, packet);
+
+	drawSprites(deltaTime);
+	drawDebugOverlay(packet);
+
+	framePipeline.endFrame();
+
+	Profiler::endFrame();
+	MemoryStats::endFrame();
 
 	/* Swap Buffers to Make it show up on screen */
 	glutSwapBuffers();
@@ -600,7 +1306,7 @@ void DisplayCallbackFunction(void)
 * Description:
 *   - this handles keyboard input when a button is pressed
 */
-void KeyboardCallbackFunction(unsigned char key, int x, int y)
+void KeyboardCallbackFunction(unsigned char key, int, int)
 {
 	switch (key)
 	{
@@ -612,6 +1318,7 @@ void KeyboardCallbackFunction(unsigned char key, int x, int y)
 	case 'e':
 	case 'E':
 		playerCamera.moveDown();
+		break;
 	case 'W':
 	case 'w':
 		playerCamera.moveForward();
@@ -635,7 +1342,7 @@ void KeyboardCallbackFunction(unsigned char key, int x, int y)
 * Description:
 *   - this handles keyboard input when a button is lifted
 */
-void KeyboardUpCallbackFunction(unsigned char key, int x, int y)
+void KeyboardUpCallbackFunction(unsigned char key, int, int)
 {
 	switch (key)
 	{            
@@ -679,34 +1386,97 @@ void KeyboardUpCallbackFunction(unsigned char key, int x, int y)
             currentMode = COLOR_GRADING_CUSTOM;
             break;
 
+		case 't':
+		case 'T':
+			TTK::Texture2D::printMemoryReport();
+			break;
+
+		case 'p':
+		case 'P':
+			Profiler::printLastFrame();
+			Profiler::exportChromeTrace("profile.json");
+			break;
+
+		case 'f':
+		case 'F':
+			frameStats.print(framePacing == PACING_VSYNC ? "vsync" : "uncapped");
+			break;
+
+		case 'v':
+		case 'V':
+			setFramePacing(framePacing == PACING_VSYNC ? PACING_UNCAPPED : PACING_VSYNC);
+			break;
+
+		case 'm':
+		case 'M':
+			MemoryStats::print("frame");
+			MemoryStats::resetFrameStats();
+			break;
+
+		case 'i':
+		case 'I':
+			if (indirectRenderer.isCreated())
+			{
+				useIndirectDraws = !useIndirectDraws;
+				std::cout << "Indirect draws: " << (useIndirectDraws ? "on" : "off") << std::endl;
+			}
+			break;
+
+		case 'c':
+		case 'C':
+			if (indirectRenderer.isCreated())
+			{
+				IndirectRenderer::CullMode cullMode = (IndirectRenderer::CullMode)((indirectRenderer.getCullMode() + 1) % IndirectRenderer::NUM_CULL_MODES);
+				indirectRenderer.setCullMode(cullMode);
+				std::cout << "Culling: " << IndirectRenderer::getCullModeName(cullMode) << std::endl;
+			}
+			break;
+
+		case 'b':
+		case 'B':
+			// 0, 1k, 10k, 100k and back to 0
+			if (spriteBatch.isCreated())
+			{
+				setNumSprites(bouncingSprites.empty() ? 1000 : (bouncingSprites.size() >= 100000 ? 0 : (unsigned int)bouncingSprites.size() * 10));
+				std::cout << "Sprites: " << bouncingSprites.size() << std::endl;
+			}
+			break;
+
+		case 'g':
+		case 'G':
+			if (debugDraw.isCreated())
+			{
+				showDebugDraw = !showDebugDraw;
+				std::cout << "Debug overlay: " << (showDebugDraw ? "on" : "off") << std::endl;
+			}
+			break;
+
+		case 'k':
+		case 'K':
+			if (indirectRenderer.isCreated())
+			{
+				indirectRenderer.setMeshletCulling(!indirectRenderer.getMeshletCulling());
+				std::cout << "Meshlet culling: " << (indirectRenderer.getMeshletCulling() ? "on" : "off") << std::endl;
+			}
+			break;
+
 
 	default:
 		break;
 	}
 }
 
-/* function TimerCallbackFunction(int value)
+/* function IdleCallbackFunction()
 * Description:
-*  - this is called many times per second
-*  - this enables you to animate things
-*  - no drawing, just changing the state
-*  - changes the frame number and calls for a redisplay
-*  - FRAME_DELAY is the number of milliseconds to wait before calling the timer again
+*  - this is called whenever GLUT has no events to handle
+*  - requests another frame right away, the display callback
+*    works out how much time passed and steps the simulation
+*  - with vsync on, swapping buffers waits for the display so we don't render faster than it refreshes
 */
-void TimerCallbackFunction(int value)
+void IdleCallbackFunction()
 {
-	// Calculate new deltaT for potential updates and physics calculations
-	static int elapsedTimeAtLastTick = 0;
-	int totalElapsedTime = glutGet(GLUT_ELAPSED_TIME);
-
-	deltaTime = totalElapsedTime - elapsedTimeAtLastTick;
-	deltaTime /= 1000.0f;
-	elapsedTimeAtLastTick = totalElapsedTime;
-
 	/* this call makes it actually show up on screen */
 	glutPostRedisplay();
-	/* this call gives it a proper frame delay to hit our target FPS */
-	glutTimerFunc(FRAME_DELAY, TimerCallbackFunction, 0);
 }
 
 /* function WindowReshapeCallbackFunction()
@@ -725,16 +1495,22 @@ void WindowReshapeCallbackFunction(int w, int h)
 }
 
 
-void MouseClickCallbackFunction(int button, int state, int x, int y)
+void MouseClickCallbackFunction(int, int state, int x, int y)
 {
 	mousePosition.x = x;
 	mousePosition.y = y;
 
 	mousePositionFlipped = mousePosition;
 	mousePositionFlipped.y = windowHeight - mousePosition.y;
+
+	if (state == GLUT_DOWN)
+	{
+		clickHandle.position = mousePositionFlipped;
+		clickHandle.label = std::to_string(x) + ", " + std::to_string(windowHeight - y);
+	}
 }
 
-void SpecialInputCallbackFunction(int key, int x, int y)
+void SpecialInputCallbackFunction(int key, int, int)
 {
 	switch (key)
 	{
@@ -766,6 +1542,451 @@ void MouseMotionCallbackFunction(int x, int y)
 	mousePositionFlipped.y = windowHeight - mousePosition.y;
 }
 
+// Sets up everything that needs an OpenGL context
+// Shared by the windowed and headless modes
+void initializeGL()
+{
+	// Init GLEW
+	// Experimental is needed for core functions on some contexts (ie. headless ones)
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+	if (err != GLEW_OK)
+	{
+		std::cout << "TTK::InitializeTTK Error: GLEW failed to init" << std::endl;
+	}
+	printf("OpenGL version: %s, GLSL version: %s\n", glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+	// Let the driver compile shaders on its own threads (if supported)
+	Shader::enableParallelCompile();
+
+	// Init IL
+	ilInit();
+
+	// Start the texture loading threads
+	textureStreamer.init();
+
+	// And the ones that load everything else, their textures are uploaded through the streamer
+	assetManager.setTextureStreamer(&textureStreamer);
+	assetManager.start();
+
+	// Init GL
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+
+	// Draw the scene with multi-draw indirect if the driver can
+	useIndirectDraws = indirectRenderer.create();
+
+	// Room for 100k sprites in one draw
+	spriteBatch.create(100000);
+
+	debugDraw.create();
+
+	// Initialize scene
+	initializeShaders();
+	initializeScene();
+}
+
+// Options for running without a window, set from the command line
+// ie. Assignment1.exe --headless --frames 300 --png frame --times times.csv
+struct HeadlessOptions
+{
+	HeadlessOptions()
+		: enabled(false), width(1280), height(720), numFrames(120), serial(false), indirect(true), numExtraObjects(0), numSprites(0), debugOverlay(false),
+		cullMode(IndirectRenderer::CULL_CPU), occlusion(false), validateCull(false), meshlets(true)
+	{}
+
+	bool enabled;
+	int width, height;
+	int numFrames;			// frames rendered per game mode
+	std::string pngPrefix;	// if set, the last frame of each mode is saved as <prefix>_<mode>.png
+	std::string timesFile;	// if set, every frame time is written to this csv file
+	std::string traceFile;	// if set, the profiler's scopes are written to this Chrome trace file
+	bool serial;			// prepare frames on the GL thread instead of the frame pipeline's thread
+	bool indirect;			// draw with the indirect renderer (if supported)
+	int numExtraObjects;	// spheres added to the scene, to see how drawing scales with the object count
+	int numSprites;			// bouncing sprites drawn over the scene
+	bool debugOverlay;		// draw the debug overlay (axes, labels and stats)
+	IndirectRenderer::CullMode cullMode;	// --cull none, cpu or gpu
+	bool occlusion;			// GPU culling also tests against the last frame's depth
+	bool validateCull;		// checks every frame that GPU culling kept the same draws as the CPU would
+	bool meshlets;			// split meshes into meshlets when culling
+};
+
+HeadlessOptions parseHeadlessOptions(int argc, char **argv)
+{
+	HeadlessOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--headless")
+			options.enabled = true;
+		else if (arg == "--frames" && hasValue)
+			options.numFrames = atoi(argv[++i]);
+		else if (arg == "--width" && hasValue)
+			options.width = atoi(argv[++i]);
+		else if (arg == "--height" && hasValue)
+			options.height = atoi(argv[++i]);
+		else if (arg == "--png" && hasValue)
+			options.pngPrefix = argv[++i];
+		else if (arg == "--times" && hasValue)
+			options.timesFile = argv[++i];
+		else if (arg == "--trace" && hasValue)
+			options.traceFile = argv[++i];
+		else if (arg == "--serial")
+			options.serial = true;
+		else if (arg == "--no-indirect")
+			options.indirect = false;
+		else if (arg == "--objects" && hasValue)
+			options.numExtraObjects = atoi(argv[++i]);
+		else if (arg == "--sprites" && hasValue)
+			options.numSprites = atoi(argv[++i]);
+		else if (arg == "--debug-draw")
+			options.debugOverlay = true;
+		else if (arg == "--cull" && hasValue)
+		{
+			std::string mode = argv[++i];
+			for (int m = 0; m < IndirectRenderer::NUM_CULL_MODES; m++)
+			{
+				if (mode == IndirectRenderer::getCullModeName((IndirectRenderer::CullMode)m))
+					options.cullMode = (IndirectRenderer::CullMode)m;
+			}
+		}
+		else if (arg == "--occlusion")
+			options.occlusion = true;
+		else if (arg == "--validate-cull")
+			options.validateCull = true;
+		else if (arg == "--no-meshlets")
+			options.meshlets = false;
+	}
+
+	return options;
+}
+
+// Scatters small spheres on a grid above the floor
+void addExtraObjects(int count)
+{
+	int gridSize = (int)ceil(sqrt((float)count));
+
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 position((i % gridSize - gridSize * 0.5f) * 0.5f, 0.5f, (i / gridSize - gridSize * 0.5f) * 0.5f);
+
+		GameObject* object = gameobjects.get(gameobjects.create("", position, meshes["sphere"].getShared(), defaultMaterial));
+		object->addDependency(meshes["sphere"]);
+		object->setScale(0.2f);
+		object->colour = glm::vec4(glm::rgbColor(glm::vec3(i * 360.0f / count, 0.5f, 0.5f)), 1.0f);
+	}
+}
+
+// Saves colour attachment 0 of the bound framebuffer as a png
+void saveFrameBufferPNG(const std::string& fileName, int width, int height)
+{
+	// RGB, the modes clear with alpha 0, which would save as a see-through background
+	std::vector<unsigned char> pixels(width * height * 3);
+
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	if (!TTK::Texture2D::saveImage(fileName, &pixels[0], width, height))
+		std::cout << "Could not save " << fileName << std::endl;
+}
+
+// Counts the entries that are only in one of two sorted lists
+// With allowDropped, ones that are only in expected don't count
+unsigned int countDifferences(const std::vector<unsigned int>& expected, const std::vector<unsigned int>& actual, bool allowDropped)
+{
+	unsigned int numWrong = 0;
+	unsigned int e = 0, a = 0;
+
+	// Both are sorted, so walk them together
+	while (e < expected.size() || a < actual.size())
+	{
+		if (a == actual.size() || (e < expected.size() && expected[e] < actual[a]))
+		{
+			if (!allowDropped)
+				numWrong++;
+			e++;
+		}
+		else if (e == expected.size() || actual[a] < expected[e])
+		{
+			numWrong++;
+			a++;
+		}
+		else
+		{
+			e++;
+			a++;
+		}
+	}
+
+	return numWrong;
+}
+
+// Compares the commands GPU culling kept this frame with the ones the CPU culler keeps
+// With occlusion the GPU can drop more, but never keep one the CPU dropped
+// Returns the number of commands that differ, outNumTriangles is how many front facing triangles the GPU kept
+unsigned int validateGPUCulling(bool occlusion, unsigned int& outNumTriangles)
+{
+	static std::vector<unsigned int> cpuFront, cpuBack, gpuFront, gpuBack;
+
+	indirectRenderer.findVisibleCommands(Frustum(playerCamera.viewProjMatrix), playerCamera.cameraPosition, cpuFront, cpuBack);
+	indirectRenderer.readBackVisibleCommands(gpuFront, gpuBack);
+
+	const std::vector<DrawElementsIndirectCommand>& commands = indirectRenderer.getCommands();
+
+	outNumTriangles = 0;
+	for (unsigned int i = 0; i < gpuFront.size(); i++)
+		outNumTriangles += commands[gpuFront[i]].count / 3;
+
+	return countDifferences(cpuFront, gpuFront, occlusion) + countDifferences(cpuBack, gpuBack, occlusion);
+}
+
+// Triangles in every command of the last build, before culling
+unsigned int countCandidateTriangles()
+{
+	const std::vector<DrawElementsIndirectCommand>& commands = indirectRenderer.getCommands();
+
+	unsigned int numTriangles = 0;
+	for (unsigned int i = 0; i < commands.size(); i++)
+		numTriangles += commands[i].count / 3;
+
+	return numTriangles;
+}
+
+// Renders every game mode into an FBO for a fixed number of frames and reports frame times
+// Used for benchmarking on machines without a display
+int runHeadless(const HeadlessOptions& options)
+{
+	HeadlessContext context;
+
+	if (!context.create())
+		return 1;
+
+	std::cout << "Running headless (" << context.getBackendName() << "), "
+		<< options.numFrames << " frames per mode at " << options.width << "x" << options.height << std::endl;
+
+	initializeGL();
+
+	useIndirectDraws = useIndirectDraws && options.indirect;
+	std::cout << "Indirect draws: " << (useIndirectDraws ? "on" : "off") << std::endl;
+
+	indirectRenderer.setCullMode(options.cullMode);
+	indirectRenderer.setMeshletCulling(options.meshlets);
+	std::cout << "Culling: " << IndirectRenderer::getCullModeName(options.cullMode)
+		<< (options.cullMode == IndirectRenderer::CULL_GPU && options.occlusion ? " + occlusion" : "")
+		<< (options.meshlets ? ", meshlets" : "") << std::endl;
+
+	bool gpuCulling = useIndirectDraws && options.cullMode == IndirectRenderer::CULL_GPU;
+	if (options.occlusion && gpuCulling)
+		indirectRenderer.setDepthPyramid(&depthPyramid);
+
+	addExtraObjects(options.numExtraObjects);
+
+	// Every run should draw the same scene from the first frame, so wait for it to load instead of letting it pop in
+	assetManager.waitForAll();
+
+	windowWidth = options.width;
+	windowHeight = options.height;
+	playerCamera.winWidth = (float)options.width;
+	playerCamera.winHeight = (float)options.height;
+
+	if (options.numSprites > 0 && spriteBatch.isCreated())
+		setNumSprites(options.numSprites);
+
+	showDebugDraw = options.debugOverlay;
+
+	// There is no window, so everything is drawn here
+	FrameBufferObject frameBuffer;
+	frameBuffer.createFrameBuffer(options.width, options.height, 1, true);
+
+	std::ofstream timesFile;
+	if (!options.timesFile.empty())
+	{
+		timesFile.open(options.timesFile);
+		timesFile << "mode,frame,ms" << std::endl;
+	}
+
+	// Every frame is one simulation step so every run does the same work
+	deltaTime = FIXED_TIMESTEP;
+
+	framePipeline.start(prepareFrame, !options.serial);
+	std::cout << "Frame preparation: " << (options.serial ? "serial" : "pipelined") << std::endl;
+
+	for (int mode = 0; mode < NUM_GAME_MODES; mode++)
+	{
+		FrameStats modeStats(options.numFrames);
+		double firstFrame = 0.0;
+		unsigned int numCullErrors = 0;
+		unsigned int numVisibleTriangles = 0;
+
+		// The last mode's depth isn't this mode's scene
+		depthPyramid.destroy();
+
+		for (int frame = 0; frame < options.numFrames; frame++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			Profiler::beginFrame();
+
+			{
+				PROFILE_SCOPE("upload");
+				assetManager.update();
+			}
+
+			sceneTextures.bind(GL_TEXTURE0);
+
+			frameBuffer.bindFrameBufferForDrawing();
+
+			playerCamera.update();
+
+			const FramePacket& packet = framePipeline.beginFrame(FIXED_TIMESTEP);
+			skinMeshes(packet);
+			buildIndirectDraws(packet);
+			renderScene((GameMode)mode, packet);
+			drawSprites(FIXED_TIMESTEP);
+			drawDebugOverlay(packet);
+			framePipeline.endFrame();
+
+			// Next frame culls against this frame's depth
+			if (options.occlusion && gpuCulling)
+			{
+				PROFILE_SCOPE("depth pyramid");
+				depthPyramid.build(frameBuffer.getDepthTexture(), options.width, options.height,
+					playerCamera.viewMatrix, playerCamera.projMatrix);
+			}
+
+			Profiler::endFrame();
+			MemoryStats::endFrame();
+
+			// Wait for the GPU so the time includes the rendering, not just submitting it
+			glFinish();
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			// Reads back from the GPU, so done after the frame is timed
+			// The readbacks allocate, which mustn't be charged to the next frame
+			if (options.validateCull && gpuCulling)
+			{
+				numCullErrors += validateGPUCulling(options.occlusion, numVisibleTriangles);
+				MemoryStats::skipAllocations();
+			}
+
+			// The first frame compiles shader variants, so report it separately
+			if (frame == 0)
+				firstFrame = elapsed.count();
+			else
+				modeStats.addFrame(elapsed.count());
+
+			// Both frame packets have been built once by now, from here on nothing should allocate
+			if (frame == 1)
+				MemoryStats::resetFrameStats();
+
+			if (timesFile.is_open())
+				timesFile << gameModeNames[mode] << "," << frame << "," << elapsed.count() << std::endl;
+		}
+
+		if (!options.pngPrefix.empty())
+			saveFrameBufferPNG(options.pngPrefix + "_" + gameModeNames[mode] + ".png", options.width, options.height);
+
+		printf("%-22s first frame %8.3f ms\n", gameModeNames[mode], firstFrame);
+
+		if (!bouncingSprites.empty())
+		{
+			printf("%-22s %u sprites in %u draw calls\n", gameModeNames[mode],
+				spriteBatch.getNumSpritesDrawn(), spriteBatch.getNumDrawCalls());
+		}
+
+		if (showDebugDraw && debugDraw.isCreated())
+		{
+			printf("%-22s debug overlay: %u line vertices and %u glyphs in %u draw calls\n", gameModeNames[mode],
+				debugDraw.getNumLineVertices(), debugDraw.getNumGlyphs(), debugDraw.getNumDrawCalls());
+		}
+
+		if (options.validateCull && gpuCulling)
+		{
+			printf("%-22s GPU culling kept %u of %u triangles, %u commands differ from the CPU culler\n",
+				gameModeNames[mode], numVisibleTriangles, countCandidateTriangles(), numCullErrors);
+		}
+
+		modeStats.print(gameModeNames[mode]);
+		MemoryStats::print(gameModeNames[mode]);
+	}
+
+	framePipeline.stop();
+
+	if (!options.traceFile.empty())
+		Profiler::exportChromeTrace(options.traceFile);
+
+	FrameBufferObject::unbindFrameBuffer(options.width, options.height);
+	frameBuffer.destroy();
+
+	return 0;
+}
+
+// The asset directory packed into one file, see TTK/PackFile.h
+const std::string assetPath = "../../Assets/";
+const std::string assetPackFile = "../../Assets/assets.pak";
+
+// Packs every asset into assetPackFile (ie. Assignment1.exe --make-pack)
+int makeAssetPack()
+{
+	// Everything is stored as is, so opening it is a view into the mapping, except the OBJs:
+	// their cooked copies below are what gets loaded, the text is only read by reloadMesh()
+	std::vector<std::string> compressExtensions(1, ".obj");
+
+	TTK::PackWriter writer;
+	if (!writer.addDirectory(assetPath, compressExtensions))
+		return 1;
+
+	// Every OBJ is also stored cooked (see MeshCodec.h), AssetManager::loadMesh loads that instead
+	std::vector<std::string> fileNames;
+	TTK::IO::listFiles(assetPath, fileNames);
+
+	for (unsigned int i = 0; i < fileNames.size(); i++)
+	{
+		const std::string& name = fileNames[i];
+		if (name.length() < 4 || name.compare(name.length() - 4, 4, ".obj") != 0)
+			continue;
+
+		TTK::IO::MappedFile source;
+		if (!source.open(assetPath + name))
+			return 1;
+
+		TTK::OBJMesh mesh;
+		mesh.parseMesh(assetPath + name, source.data(), source.size());
+		if (mesh.vertices.empty())
+			continue;
+
+		QuantizedMesh quantized;
+		quantizeMesh(mesh, quantized);
+		reorderVertices(quantized);
+
+		std::vector<unsigned char> cooked;
+		encodeMesh(quantized, cooked);
+
+		writer.addFile(getCookedMeshName(name), &cooked[0], cooked.size());
+	}
+
+	if (!writer.write(assetPackFile))
+		return 1;
+
+	printf("Packed %u files, %.2f MB into %.2f MB: %s\n", writer.getNumFiles(),
+		writer.getTotalSize() / (1024.0 * 1024.0), writer.getTotalStoredSize() / (1024.0 * 1024.0), assetPackFile.c_str());
+	return 0;
+}
+
+// Reads assets from the pack if there is one
+// Note: packed files win over loose ones, so delete the pack to hot reload assets
+void mountAssetPack()
+{
+	if (TTK::IO::fileExists(assetPackFile))
+		TTK::IO::mountPack(assetPackFile, assetPath);
+}
+
 /* function main()
 * Description:
 *  - this is the main function
@@ -778,6 +1999,26 @@ int main(int argc, char **argv)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// Run a benchmark and exit (ie. --bench skinning)
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--bench")
+			return runBenchmarks(argv[i + 1]);
+	}
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--make-pack")
+			return makeAssetPack();
+	}
+
+	mountAssetPack();
+
+	// No window, render a fixed number of frames and exit
+	HeadlessOptions headless = parseHeadlessOptions(argc, argv);
+	if (headless.enabled)
+		return runHeadless(headless);
+
 	/* initialize the window and OpenGL properly */
 	glutInit(&argc, argv);
 	glutInitWindowSize(windowWidth, windowHeight);
@@ -791,32 +2032,17 @@ int main(int argc, char **argv)
 	glutReshapeFunc(WindowReshapeCallbackFunction);
 	glutMouseFunc(MouseClickCallbackFunction);
 	glutMotionFunc(MouseMotionCallbackFunction);
-	glutTimerFunc(1, TimerCallbackFunction, 0);
+	glutIdleFunc(IdleCallbackFunction);
 	glutSpecialFunc(SpecialInputCallbackFunction);
 
-	// Init GLEW
-	GLenum err = glewInit();
-	if (err != GLEW_OK)
-	{
-		std::cout << "TTK::InitializeTTK Error: GLEW failed to init" << std::endl;
-	}
-	printf("OpenGL version: %s, GLSL version: %s\n", glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
-
-	// Init IL
-	ilInit();
+	initializeGL();
 
-	// Init GL
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
+	setFramePacing(PACING_VSYNC);
 
-	// Initialize scene
-	initializeShaders();
-	initializeScene();
+	// Scene is loaded, start preparing frames
+	framePipeline.start(prepareFrame);
 
 	/* Start Game Loop */
-	deltaTime = glutGet(GLUT_ELAPSED_TIME);
-	deltaTime /= 1000.0f;
-
 	glutMainLoop();
 
 	return 0;